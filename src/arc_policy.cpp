@@ -0,0 +1,153 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "arc_policy.h"
+
+namespace badgerdb {
+
+ArcPolicy::ArcPolicy(FrameStates* states, FrameId first, std::uint32_t num)
+    : ReplacementPolicy(states, first, num),
+      target(0),
+      t1(first, num),
+      t2(first, num),
+      freeFrames(first, num),
+      keys(num) {
+  for (std::uint32_t i = 0; i < num; ++i) {
+    freeFrames.pushFront(first + i);
+  }
+}
+
+FrameId ArcPolicy::claimOldest(const FrameList& list,
+                               const FrameFilter* skip) {
+  FrameId frame = list.back();
+  while (frame != FrameList::NONE &&
+         (isPassedOver(frame, skip) || !claim(frame))) {
+    frame = list.newer(frame);
+  }
+  return frame;
+}
+
+void ArcPolicy::frameAccessed(FrameId frame) {
+  if (t1.contains(frame)) {
+    t1.remove(frame);
+  } else if (t2.contains(frame)) {
+    t2.remove(frame);
+  } else {
+    return;
+  }
+  t2.pushFront(frame);
+}
+
+void ArcPolicy::frameLoaded(FrameId frame, const PageKey& key) {
+  keys[frame - firstFrame] = key;
+  if (b1.contains(key)) {
+    // Recency would have kept this page: give T1 more room.
+    const std::uint32_t delta =
+        b1.size() >= b2.size() ? 1 : b2.size() / b1.size();
+    target = target + delta < numFrames ? target + delta : numFrames;
+    b1.erase(key);
+    t2.pushFront(frame);
+  } else if (b2.contains(key)) {
+    // Frequency would have kept this page: give T2 more room.
+    const std::uint32_t delta =
+        b2.size() >= b1.size() ? 1 : b1.size() / b2.size();
+    target = target > delta ? target - delta : 0;
+    b2.erase(key);
+    t2.pushFront(frame);
+  } else {
+    t1.pushFront(frame);
+  }
+
+  // Keep |T1| + |B1| <= c and the whole directory within 2c.
+  while (t1.size() + b1.size() > numFrames && b1.size() > 0) {
+    b1.popBack();
+  }
+  while (t1.size() + t2.size() + b1.size() + b2.size() > 2 * numFrames &&
+         b2.size() > 0) {
+    b2.popBack();
+  }
+}
+
+void ArcPolicy::frameFreed(FrameId frame) {
+  if (t1.contains(frame)) {
+    t1.remove(frame);
+  } else if (t2.contains(frame)) {
+    t2.remove(frame);
+  }
+  freeFrames.pushFront(frame);
+}
+
+void ArcPolicy::frameTaken(FrameId frame) {
+  if (t1.contains(frame)) {
+    t1.remove(frame);
+  } else if (t2.contains(frame)) {
+    t2.remove(frame);
+  }
+}
+
+void ArcPolicy::frameResident(FrameId frame, const PageKey& key) {
+  if (freeFrames.contains(frame)) {
+    freeFrames.remove(frame);
+  }
+  b1.erase(key);
+  b2.erase(key);
+  keys[frame - firstFrame] = key;
+  t1.pushFront(frame);
+}
+
+bool ArcPolicy::pickVictim(const PageKey& key, FrameId& frame,
+                           const FrameFilter* skip) {
+  if (freeFrames.size() > 0) {
+    frame = freeFrames.back();
+    freeFrames.remove(frame);
+    return true;
+  }
+
+  // REPLACE: evict from T1 if it is above its target (or at it, when the
+  // incoming page was evicted from T2 before), otherwise from T2.
+  const bool preferT1 =
+      t1.size() > 0 &&
+      (t1.size() > target || (t1.size() == target && b2.contains(key)));
+  FrameId victim = claimOldest(preferT1 ? t1 : t2, skip);
+  bool fromT1 = preferT1;
+  if (victim == FrameList::NONE) {
+    victim = claimOldest(preferT1 ? t2 : t1, skip);
+    fromT1 = !preferT1;
+  }
+  if (victim == FrameList::NONE) {
+    return false;
+  }
+
+  const PageKey& evicted = keys[victim - firstFrame];
+  if (fromT1) {
+    t1.remove(victim);
+    b1.pushFront(evicted);
+  } else {
+    t2.remove(victim);
+    b2.pushFront(evicted);
+  }
+  frame = victim;
+  return true;
+}
+
+void ArcPolicy::victimOrder(std::vector<FrameId>& order) const {
+  // Replacement takes from whichever list exceeds its target; list the larger
+  // one first.
+  const FrameList& first = t1.size() > target ? t1 : t2;
+  const FrameList& second = &first == &t1 ? t2 : t1;
+  order.clear();
+  for (FrameId frame = first.back(); frame != FrameList::NONE;
+       frame = first.newer(frame)) {
+    order.push_back(frame);
+  }
+  for (FrameId frame = second.back(); frame != FrameList::NONE;
+       frame = second.newer(frame)) {
+    order.push_back(frame);
+  }
+}
+
+}
@@ -0,0 +1,89 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Adaptive Replacement Cache policy (Megiddo and Modha).
+ *
+ * Resident pages are split between T1 (seen once recently) and T2 (seen at
+ * least twice).  Ghost lists B1 and B2 remember pages recently evicted from T1
+ * and T2; a request for a page in B1 grows the target size of T1, one in B2
+ * shrinks it.  The split thus adapts between recency and frequency, and a
+ * scan only ever churns T1.
+ */
+class ArcPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs an ARC policy over the frames [first, first + num).
+   *
+   * @param states      Frame state words of the buffer manager.
+   * @param first       First frame of the partition.
+   * @param num         Number of frames in the partition.
+   */
+  ArcPolicy(FrameStates* states, FrameId first, std::uint32_t num);
+
+  void frameAccessed(FrameId frame);
+  void frameLoaded(FrameId frame, const PageKey& key);
+  void frameFreed(FrameId frame);
+  bool pickVictim(const PageKey& key, FrameId& frame,
+                  const FrameFilter* skip);
+  void frameTaken(FrameId frame);
+  void frameResident(FrameId frame, const PageKey& key);
+  void victimOrder(std::vector<FrameId>& order) const;
+
+ private:
+  /**
+   * Claims the least recently used unpinned frame of a list and returns it,
+   * or returns FrameList::NONE.
+   *
+   * @param list    List to search.
+   * @param skip    Frames to pass over as if pinned, or NULL.
+   */
+  FrameId claimOldest(const FrameList& list, const FrameFilter* skip);
+
+  /**
+   * Target size of T1, between 0 and the number of frames.
+   */
+  std::uint32_t target;
+
+  /**
+   * Resident pages referenced once since they entered the pool.
+   */
+  FrameList t1;
+
+  /**
+   * Resident pages referenced more than once.
+   */
+  FrameList t2;
+
+  /**
+   * Frames not holding any page.
+   */
+  FrameList freeFrames;
+
+  /**
+   * Pages recently evicted from T1.
+   */
+  GhostList b1;
+
+  /**
+   * Pages recently evicted from T2.
+   */
+  GhostList b2;
+
+  /**
+   * Page held by every resident frame.
+   */
+  std::vector<PageKey> keys;
+};
+
+}
@@ -0,0 +1,388 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Microbenchmarks of the buffer manager's hot paths.
+ *
+ * Every workload runs a fixed number of operations with a seeded generator, so
+ * two runs with the same options issue the same page requests.  For each
+ * workload the throughput and the 50th and 99th percentile latency of a single
+ * operation are printed, one line per workload:
+ *
+ *   workload             ops      ops/sec    p50(ns)    p99(ns)   hit%
+ *
+ * Usage: badgerdb_bench [--ops N] [--frames N] [--pages N] [--threads N]
+ *                       [--seed N] [--only NAME]
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "buf_scan_iterator.h"
+#include "bulk_loader.h"
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "page_handle.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+/**
+ * Options shared by all workloads.
+ */
+struct Options {
+  std::uint64_t ops = 200000;
+  std::uint32_t frames = 1000;
+  std::uint32_t pages = 4000;
+  unsigned threads = 4;
+  std::uint64_t seed = 42;
+  std::string only;
+};
+
+/**
+ * Draws page indexes in [0, n) with a Zipfian distribution, using the
+ * precomputed CDF.
+ */
+class ZipfGenerator {
+ public:
+  ZipfGenerator(std::uint32_t n, double theta) : cdf(n) {
+    double sum = 0;
+    for (std::uint32_t i = 0; i < n; i++) {
+      sum += 1.0 / std::pow(i + 1, theta);
+      cdf[i] = sum;
+    }
+    for (std::uint32_t i = 0; i < n; i++) {
+      cdf[i] /= sum;
+    }
+  }
+
+  std::uint32_t operator()(std::mt19937_64& rng) {
+    const double u = std::uniform_real_distribution<double>(0, 1)(rng);
+    return std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+  }
+
+ private:
+  std::vector<double> cdf;
+};
+
+/**
+ * Latencies of the operations of one workload, in nanoseconds.
+ */
+class Recorder {
+ public:
+  void record(std::uint64_t nanos) { samples.push_back(nanos); }
+
+  void merge(const Recorder& other) {
+    samples.insert(samples.end(), other.samples.begin(), other.samples.end());
+  }
+
+  std::uint64_t percentile(double p) {
+    if (samples.empty()) {
+      return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    std::size_t index = (std::size_t) (p * (samples.size() - 1));
+    return samples[index];
+  }
+
+  std::size_t size() const { return samples.size(); }
+
+ private:
+  std::vector<std::uint64_t> samples;
+};
+
+/**
+ * A file with a number of pages, removed when the workload is done.
+ */
+struct BenchFile {
+  explicit BenchFile(std::uint32_t pages) : name("bench.db") {
+    try {
+      File::remove(name);
+    } catch (const FileNotFoundException&) {
+    }
+    file = new File(File::create(name));
+    std::vector<Page> allocated = file->allocatePages(pages);
+    for (std::size_t i = 0; i < allocated.size(); i++) {
+      pageNos.push_back(allocated[i].page_number());
+    }
+  }
+
+  ~BenchFile() {
+    delete file;
+    File::remove(name);
+  }
+
+  std::string name;
+  File* file;
+  std::vector<PageId> pageNos;
+};
+
+void report(const std::string& name, Recorder& latencies, double seconds,
+            BufMgr& bufMgr) {
+  const BufStats stats = bufMgr.getBufStats();
+  std::cout << std::left << std::setw(18) << name << std::right
+            << std::setw(10) << latencies.size()
+            << std::setw(13) << std::fixed << std::setprecision(0)
+            << latencies.size() / seconds
+            << std::setw(11) << latencies.percentile(0.50)
+            << std::setw(11) << latencies.percentile(0.99)
+            << std::setw(7) << std::setprecision(1)
+            << 100 * stats.hitRatio() << "\n";
+}
+
+/**
+ * Reads pages chosen by a generator, one at a time, marking a share of them
+ * dirty on unpin.
+ */
+template <typename Generator>
+void randomReads(const std::string& name, const Options& options,
+                 Generator pick, double writeShare) {
+  BenchFile bench(options.pages);
+  BufMgr bufMgr(options.frames);
+  std::mt19937_64 rng(options.seed);
+  std::uniform_real_distribution<double> coin(0, 1);
+  Recorder latencies;
+  bufMgr.clearBufStats();
+  const std::uint64_t start = BufMetrics::now();
+  for (std::uint64_t op = 0; op < options.ops; op++) {
+    const PageId pageNo = bench.pageNos[pick(rng)];
+    const bool dirty = coin(rng) < writeShare;
+    const std::uint64_t begin = BufMetrics::now();
+    Page* page;
+    bufMgr.readPage(bench.file, pageNo, page);
+    bufMgr.unPinPage(bench.file, pageNo, dirty);
+    latencies.record(BufMetrics::now() - begin);
+  }
+  report(name, latencies, (BufMetrics::now() - start) / 1e9, bufMgr);
+  bufMgr.flushFile(bench.file);
+}
+
+void sequentialScan(const Options& options) {
+  BenchFile bench(options.pages);
+  BufMgr bufMgr(options.frames);
+  Recorder latencies;
+  bufMgr.clearBufStats();
+  const std::uint64_t start = BufMetrics::now();
+  while (latencies.size() < options.ops) {
+    std::uint64_t begin = BufMetrics::now();
+    for (BufScanIterator iter(&bufMgr, bench.file);
+         iter != BufScanIterator() && latencies.size() < options.ops; ++iter) {
+      const std::uint64_t end = BufMetrics::now();
+      latencies.record(end - begin);
+      begin = end;
+    }
+  }
+  report("seq_scan", latencies, (BufMetrics::now() - start) / 1e9, bufMgr);
+  bufMgr.flushFile(bench.file);
+}
+
+void bulkAlloc(const Options& options) {
+  BenchFile bench(0);
+  BufMgr bufMgr(options.frames);
+  Recorder latencies;
+  bufMgr.clearBufStats();
+  const std::uint64_t ops = std::min<std::uint64_t>(options.ops, 20000);
+  const std::uint64_t start = BufMetrics::now();
+  for (std::uint64_t op = 0; op < ops; op++) {
+    const std::uint64_t begin = BufMetrics::now();
+    PageId pageNo;
+    Page* page;
+    bufMgr.allocPage(bench.file, pageNo, page);
+    bufMgr.unPinPage(bench.file, pageNo, true);
+    latencies.record(BufMetrics::now() - begin);
+  }
+  report("alloc_bulk", latencies, (BufMetrics::now() - start) / 1e9, bufMgr);
+  bufMgr.flushFile(bench.file);
+}
+
+void bulkLoad(const Options& options) {
+  // Same records through the loader, which takes no frames; the pool only
+  // reports the (empty) hit ratio
+  BenchFile bench(0);
+  BufMgr bufMgr(options.frames);
+  Recorder latencies;
+  const std::string record(100, 'r');
+  const std::uint64_t start = BufMetrics::now();
+  {
+    BulkLoader loader(*bench.file);
+    for (std::uint64_t op = 0; op < options.ops; op++) {
+      const std::uint64_t begin = BufMetrics::now();
+      loader.insertRecord(record);
+      latencies.record(BufMetrics::now() - begin);
+    }
+    loader.finish();
+  }
+  report("bulk_load", latencies, (BufMetrics::now() - start) / 1e9, bufMgr);
+}
+
+void threadedHits(const Options& options) {
+  // Every page fits, so after warming up every read is a hit
+  const std::uint32_t resident = options.frames / 2;
+  BenchFile bench(resident);
+  BufMgr bufMgr(options.frames, options.threads);
+  for (std::uint32_t i = 0; i < resident; i++) {
+    Page* page;
+    bufMgr.readPage(bench.file, bench.pageNos[i], page);
+    bufMgr.unPinPage(bench.file, bench.pageNos[i], false);
+  }
+  bufMgr.clearBufStats();
+
+  std::vector<Recorder> latencies(options.threads);
+  std::vector<std::thread> workers;
+  const std::uint64_t start = BufMetrics::now();
+  for (unsigned t = 0; t < options.threads; t++) {
+    workers.push_back(std::thread([&, t]() {
+      std::mt19937_64 rng(options.seed + t);
+      std::uniform_int_distribution<std::uint32_t> pick(0, resident - 1);
+      for (std::uint64_t op = t; op < options.ops; op += options.threads) {
+        const PageId pageNo = bench.pageNos[pick(rng)];
+        const std::uint64_t begin = BufMetrics::now();
+        Page* page;
+        bufMgr.readPage(bench.file, pageNo, page);
+        bufMgr.unPinPage(bench.file, pageNo, false);
+        latencies[t].record(BufMetrics::now() - begin);
+      }
+    }));
+  }
+  for (unsigned t = 0; t < options.threads; t++) {
+    workers[t].join();
+  }
+  const double seconds = (BufMetrics::now() - start) / 1e9;
+  for (unsigned t = 1; t < options.threads; t++) {
+    latencies[0].merge(latencies[t]);
+  }
+  report("mt_hit", latencies[0], seconds, bufMgr);
+  bufMgr.flushFile(bench.file);
+}
+
+void threadedPins(const Options& options, const bool shared) {
+  // Every thread pins and unpins the same few resident pages, either by page
+  // number, through the hash table and the partition mutex, or by sharing the
+  // pin of a handle, which takes neither
+  const std::uint32_t hot = std::min<std::uint32_t>(8, options.frames);
+  BenchFile bench(hot);
+  BufMgr bufMgr(options.frames, options.threads);
+  std::vector<PageHandle> handles;
+  for (std::uint32_t i = 0; i < hot; i++) {
+    handles.push_back(bufMgr.readPage(bench.file, bench.pageNos[i]));
+  }
+  bufMgr.clearBufStats();
+
+  std::vector<Recorder> latencies(options.threads);
+  std::vector<std::thread> workers;
+  const std::uint64_t start = BufMetrics::now();
+  for (unsigned t = 0; t < options.threads; t++) {
+    workers.push_back(std::thread([&, t]() {
+      std::mt19937_64 rng(options.seed + t);
+      std::uniform_int_distribution<std::uint32_t> pick(0, hot - 1);
+      for (std::uint64_t op = t; op < options.ops; op += options.threads) {
+        const std::uint32_t i = pick(rng);
+        const std::uint64_t begin = BufMetrics::now();
+        if (shared) {
+          PageHandle pin = handles[i].share();
+        } else {
+          Page* page;
+          bufMgr.readPage(bench.file, bench.pageNos[i], page);
+          bufMgr.unPinPage(bench.file, bench.pageNos[i], false);
+        }
+        latencies[t].record(BufMetrics::now() - begin);
+      }
+    }));
+  }
+  for (unsigned t = 0; t < options.threads; t++) {
+    workers[t].join();
+  }
+  const double seconds = (BufMetrics::now() - start) / 1e9;
+  for (unsigned t = 1; t < options.threads; t++) {
+    latencies[0].merge(latencies[t]);
+  }
+  report(shared ? "mt_pin_handle" : "mt_pin_locked", latencies[0], seconds,
+         bufMgr);
+  handles.clear();
+  bufMgr.flushFile(bench.file);
+}
+
+bool selected(const Options& options, const std::string& name) {
+  return options.only.empty() || options.only == name;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  for (int a = 1; a + 1 < argc; a += 2) {
+    const std::string flag = argv[a];
+    const char* value = argv[a + 1];
+    if (flag == "--ops") {
+      options.ops = std::strtoull(value, NULL, 10);
+    } else if (flag == "--frames") {
+      options.frames = std::strtoul(value, NULL, 10);
+    } else if (flag == "--pages") {
+      options.pages = std::strtoul(value, NULL, 10);
+    } else if (flag == "--threads") {
+      options.threads = std::strtoul(value, NULL, 10);
+    } else if (flag == "--seed") {
+      options.seed = std::strtoull(value, NULL, 10);
+    } else if (flag == "--only") {
+      options.only = value;
+    } else {
+      std::cerr << "unknown option " << flag << "\n";
+      return 1;
+    }
+  }
+  if (options.frames == 0 || options.pages == 0 || options.threads == 0) {
+    std::cerr << "--frames, --pages and --threads must be positive\n";
+    return 1;
+  }
+
+  std::cout << std::left << std::setw(18) << "workload" << std::right
+            << std::setw(10) << "ops" << std::setw(13) << "ops/sec"
+            << std::setw(11) << "p50(ns)" << std::setw(11) << "p99(ns)"
+            << std::setw(7) << "hit%" << "\n";
+
+  std::uniform_int_distribution<std::uint32_t> uniform(0, options.pages - 1);
+  if (selected(options, "uniform_read")) {
+    randomReads("uniform_read", options, uniform, 0.0);
+  }
+  if (selected(options, "zipf_read")) {
+    randomReads("zipf_read", options, ZipfGenerator(options.pages, 0.99), 0.0);
+  }
+  if (selected(options, "seq_scan")) {
+    sequentialScan(options);
+  }
+  if (selected(options, "mixed_rw")) {
+    randomReads("mixed_rw", options, ZipfGenerator(options.pages, 0.99), 0.3);
+  }
+  if (selected(options, "alloc_bulk")) {
+    bulkAlloc(options);
+  }
+  if (selected(options, "bulk_load")) {
+    bulkLoad(options);
+  }
+  if (selected(options, "mt_hit")) {
+    threadedHits(options);
+  }
+  if (selected(options, "mt_pin_locked")) {
+    threadedPins(options, false);
+  }
+  if (selected(options, "mt_pin_handle")) {
+    threadedPins(options, true);
+  }
+  return 0;
+}
@@ -5,8 +5,11 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <iostream>
+#include <thread>
 #include "buffer.h"
 #include "bufHashTbl.h"
 #include "exceptions/hash_already_present_exception.h"
@@ -15,100 +18,233 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
+const std::uint64_t hashBucket::EMPTY;
+const std::uint32_t BufHashTbl::MIGRATE_STEP;
+constexpr double BufHashTbl::DEFAULT_MAX_LOAD;
+
+std::uint64_t BufHashTbl::keyOf(const File* file, const PageId pageNo)
+{
+  return ((std::uint64_t) file->id() << 32) | pageNo;
+}
+
+std::uint64_t BufHashTbl::hash(const std::uint64_t key)
+{
+  // splitmix64 finalizer, so that neither consecutive pages nor files opened one after another land in neighbouring
+  // slots
+  std::uint64_t value = key * 0x9E3779B97F4A7C15ULL;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
+}
+
+std::uint32_t BufHashTbl::home(const hashSlots* table, const std::uint64_t value)
+{
+  // the high half: BufMgr picks partitions from the low bits of a similar mix
+  return (std::uint32_t) (value >> 32) & table->mask;
+}
+
+hashSlots* BufHashTbl::allocSlots(const std::uint32_t slots)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
-  return value;
+  hashSlots* table = new hashSlots;
+  table->size = 1;
+  while (table->size < slots)
+    table->size <<= 1;
+  table->mask = table->size - 1;
+  table->slots = new hashBucket [table->size];
+  for(std::uint32_t i=0; i < table->size; i++)
+    table->slots[i].key.store(hashBucket::EMPTY, std::memory_order_relaxed);
+  return table;
 }
 
-BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+BufHashTbl::BufHashTbl(int htSize, double maxLoad)
+	: draining(NULL), migrated(0), count(0), maxLoad(std::min(std::max(maxLoad, 0.1), 0.9)), version(0)
 {
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
-  for(int i=0; i < HTSIZE; i++)
-    ht[i] = NULL;
+  // enough slots to hold htSize entries below the maximum load, so that
+  // probe sequences stay short and always end at an empty slot
+  current.store(allocSlots((std::uint32_t) (std::max(htSize, 1) / this->maxLoad) + 1), std::memory_order_relaxed);
 }
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
-    }
+  retired.push_back(current.load(std::memory_order_relaxed));
+  if (draining.load(std::memory_order_relaxed) != NULL)
+    retired.push_back(draining.load(std::memory_order_relaxed));
+  for (std::size_t t = 0; t < retired.size(); t++) {
+    delete [] retired[t]->slots;
+    delete retired[t];
   }
-  delete [] ht;
 }
 
-void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+void BufHashTbl::beginWrite()
 {
-  int index = hash(file, pageNo);
+  version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void BufHashTbl::endWrite()
+{
+  version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
 
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+std::uint32_t BufHashTbl::slotOf(const hashSlots* table, const std::uint64_t key)
+{
+  for (std::uint32_t index = home(table, hash(key)), n = 0; n < table->size; index = (index + 1) & table->mask, n++) {
+    const std::uint64_t slotKey = table->slots[index].key.load(std::memory_order_relaxed);
+    if (slotKey == hashBucket::EMPTY)
+      break;
+    if (slotKey == key)
+      return index;
   }
+  return table->size;
+}
 
-  tmpBuc = new hashBucket;
-  if (!tmpBuc)
-  	throw HashTableException();
+bool BufHashTbl::probe(const hashSlots* table, const std::uint64_t key, FrameId& frameNo)
+{
+  const std::uint32_t index = slotOf(table, key);
+  if (index == table->size)
+    return false;
+  frameNo = table->slots[index].frameNo.load(std::memory_order_relaxed);
+  return true;
+}
 
-  tmpBuc->file = (File*) file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
+void BufHashTbl::place(hashSlots* table, const std::uint64_t key, const FrameId frameNo)
+{
+  std::uint32_t index = home(table, hash(key));
+  while (table->slots[index].key.load(std::memory_order_relaxed) != hashBucket::EMPTY)
+    index = (index + 1) & table->mask;
+  table->slots[index].frameNo.store(frameNo, std::memory_order_relaxed);
+  table->slots[index].key.store(key, std::memory_order_relaxed);
 }
 
-void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
+void BufHashTbl::erase(hashSlots* table, std::uint32_t hole)
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-    {
-      frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
-    }
-    tmpBuc = tmpBuc->next;
+  // Shift back every following entry of the cluster whose home slot does not
+  // lie between the hole and its current position.
+  for (std::uint32_t next = (hole + 1) & table->mask; ; next = (next + 1) & table->mask) {
+    const std::uint64_t slotKey = table->slots[next].key.load(std::memory_order_relaxed);
+    if (slotKey == hashBucket::EMPTY)
+      break;
+    const std::uint32_t slotHome = home(table, hash(slotKey));
+    const bool stays = (hole <= next) ? (hole < slotHome && slotHome <= next)
+                                      : (hole < slotHome || slotHome <= next);
+    if (stays)
+      continue;
+    table->slots[hole].frameNo.store(table->slots[next].frameNo.load(std::memory_order_relaxed),
+                                     std::memory_order_relaxed);
+    table->slots[hole].key.store(slotKey, std::memory_order_relaxed);
+    hole = next;
   }
+  table->slots[hole].key.store(hashBucket::EMPTY, std::memory_order_relaxed);
+}
 
-  throw HashNotFoundException(file->filename(), pageNo);
+void BufHashTbl::grow()
+{
+  hashSlots* old = current.load(std::memory_order_relaxed);
+  if (old->size > (1U << 30))
+    throw HashTableException();
+  migrate(std::numeric_limits<std::uint32_t>::max());
+  hashSlots* table = allocSlots(old->size * 2);
+
+  beginWrite();
+  draining.store(old, std::memory_order_release);
+  current.store(table, std::memory_order_release);
+  migrated = 0;
+  endWrite();
 }
 
-void BufHashTbl::remove(const File* file, const PageId pageNo) {
+void BufHashTbl::migrate(std::uint32_t slots)
+{
+  hashSlots* old = draining.load(std::memory_order_relaxed);
+  if (old == NULL)
+    return;
+  hashSlots* table = current.load(std::memory_order_relaxed);
+
+  beginWrite();
+  // Every slot below migrated stays empty: nothing is inserted into the old array, and erasing an entry only shifts
+  // later entries of its cluster back, into slots at or above migrated.
+  for (; slots > 0 && migrated < old->size; slots--) {
+    hashBucket& slot = old->slots[migrated];
+    const std::uint64_t slotKey = slot.key.load(std::memory_order_relaxed);
+    if (slotKey == hashBucket::EMPTY) {
+      migrated++;
+      continue;
+    }
+    place(table, slotKey, slot.frameNo.load(std::memory_order_relaxed));
+    erase(old, migrated);
+  }
+  if (migrated == old->size) {
+    draining.store(NULL, std::memory_order_relaxed);
+    retired.push_back(old);
+  }
+  endWrite();
+}
+
+void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+{
+  FrameId frame;
+  if (find(file, pageNo, frame))
+    throw HashAlreadyPresentException(file->filename(), pageNo, frame);
+
+  if (count + 1 > maxLoad * current.load(std::memory_order_relaxed)->size)
+    grow();
+  migrate(MIGRATE_STEP);
+
+  beginWrite();
+  place(current.load(std::memory_order_relaxed), keyOf(file, pageNo), frameNo);
+  count++;
+  endWrite();
+}
 
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  hashBucket* prevBuc = NULL;
-
-  while (tmpBuc)
-	{
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-		{
-      if(prevBuc) 
-				prevBuc->next = tmpBuc->next;
-      else
-				ht[index] = tmpBuc->next;
-
-      delete tmpBuc;
-      return;
+bool BufHashTbl::find(const File* file, const PageId pageNo, FrameId &frameNo) const
+{
+  const std::uint64_t key = keyOf(file, pageNo);
+  while (true) {
+    const std::uint32_t before = version.load(std::memory_order_acquire);
+    if (before & 1) {
+      // a writer is shifting slots; let it finish
+      std::this_thread::yield();
+      continue;
     }
-		else
-		{
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
+
+    // entries not yet moved to the current array are still in the draining one
+    FrameId frame = 0;
+    const hashSlots* draining = this->draining.load(std::memory_order_acquire);
+    const bool found = probe(current.load(std::memory_order_acquire), key, frame) ||
+                       (draining != NULL && probe(draining, key, frame));
+
+    // the slots read above are only meaningful if no writer ran meanwhile
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (version.load(std::memory_order_relaxed) == before) {
+      if (found)
+        frameNo = frame; // return frameNo by reference
+      return found;
     }
   }
+}
+
+void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
+{
+  if (!find(file, pageNo, frameNo))
+    throw HashNotFoundException(file->filename(), pageNo);
+}
+
+void BufHashTbl::remove(const File* file, const PageId pageNo) {
+
+  migrate(MIGRATE_STEP);
+  hashSlots* table = current.load(std::memory_order_relaxed);
+  const std::uint64_t key = keyOf(file, pageNo);
+  std::uint32_t hole = slotOf(table, key);
+  if (hole == table->size && draining.load(std::memory_order_relaxed) != NULL) {
+    table = draining.load(std::memory_order_relaxed);
+    hole = slotOf(table, key);
+  }
+  if (hole == table->size)
+    throw HashNotFoundException(file->filename(), pageNo);
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  beginWrite();
+  erase(table, hole);
+  count--;
+  endWrite();
 }
 
 }
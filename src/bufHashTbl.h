@@ -7,84 +7,251 @@
 
 #pragma once
 
+#include <atomic>
+#include <vector>
 #include "file.h"
 
 namespace badgerdb {
 
 /**
-* @brief Declarations for buffer pool hash table
+* @brief Declarations for buffer pool hash table slots
+*
+* Fields are atomics so that lookups may read a slot while a writer is changing it; a torn read is detected by the
+* table's version counter and the lookup is retried.
 */
 struct hashBucket {
 	/**
-	 * pointer a file object (more on this below)
+	 * identifier of the page: the file id (File::id()) in the high half, the page number within the file in the low
+	 * half; EMPTY if the slot is empty
 	 */
-	File *file;
+	std::atomic<std::uint64_t> key;
 
 	/**
-	 * page number within a file
+	 * frame number of page in the buffer pool
 	 */
-	PageId pageNo;
+	std::atomic<FrameId> frameNo;
 
 	/**
-	 * frame number of page in the buffer pool
+	 * key of an empty slot; file ids start at 1
+	 */
+	static const std::uint64_t EMPTY = 0;
+};
+
+
+/**
+* @brief One slot array of the hash table
+*/
+struct hashSlots {
+	/**
+	 * Number of slots, always a power of two
+	 */
+	std::uint32_t size;
+
+	/**
+	 * size - 1, used to wrap slot indices
 	 */
-	FrameId frameNo;
+	std::uint32_t mask;
 
 	/**
-	 * Next node in the hash table
+	 * The slots
 	 */
-	hashBucket*   next;
+	hashBucket* slots;
 };
 
 
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
 *
-* @warning This class is not threadsafe.
+* Open addressing with linear probing over a flat slot array; removals shift the following entries back instead of
+* leaving tombstones, so probe sequences stay short. A page is keyed by one 64-bit word, its file id and page number,
+* spread over the slots by a mixing hash; File objects naming the same open file therefore share entries.
+*
+* The table grows when an insert would push its load factor past the maximum given at construction. Growing does not
+* rehash everything at once: a slot array of twice the size takes all inserts, and every insert and remove also moves
+* a few entries over from the old array, which lookups keep searching until it is empty. No single call pays for more
+* than a bounded number of moves. Slot arrays given up are kept until the table is destroyed, since lock-free readers
+* may still be probing them; together they are smaller than the array in use.
+*
+* Readers never lock: find() and lookup() read optimistically and validate against a version counter that writers
+* bump before and after every change (a sequence lock).
+*
+* @warning insert() and remove() must be serialized by the caller (BufMgr holds the partition mutex); they may run
+* concurrently with any number of lookups.
 */
 class BufHashTbl
 {
  private:
 	/**
-	 *	Size of Hash Table
+	 * Old entries moved to the new slot array during every insert and remove while the table grows
+	 */
+	static const std::uint32_t MIGRATE_STEP = 8;
+
+	/**
+	 * Slot array taking inserts
+	 */
+  std::atomic<hashSlots*> current;
+
+	/**
+	 * Slot array being emptied into current while the table grows; NULL otherwise
+	 */
+  std::atomic<hashSlots*> draining;
+
+	/**
+	 * Slots of draining below this index are empty
+	 */
+  std::uint32_t migrated;
+
+	/**
+	 * Number of entries in the table
+	 */
+  std::uint32_t count;
+
+	/**
+	 * Highest ratio of entries to slots of current before the table grows
+	 */
+  double maxLoad;
+
+	/**
+	 * Slot arrays given up by growing, freed with the table
 	 */
-  int HTSIZE;
+  std::vector<hashSlots*> retired;
+
 	/**
-	 * Actual Hash table object
+	 * Sequence number of the table contents; odd while a writer is modifying slots
 	 */
-  hashBucket**  ht;
+  std::atomic<std::uint32_t> version;
 
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * returns the key of a page, as stored in hashBucket::key
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
+	 * @return  			Key of the page.
+	 */
+  static std::uint64_t keyOf(const File* file, const PageId pageNo);
+
+	/**
+	 * returns a hash value of a key
+	 *
+	 * @param key   	Key from keyOf()
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+  static std::uint64_t hash(const std::uint64_t key);
+
+	/**
+	 * returns the home slot of a hash value in a slot array
+	 *
+	 * @param table  	Slot array
+	 * @param value  	Hash value from hash()
+	 * @return  			Slot index.
+	 */
+  static std::uint32_t home(const hashSlots* table, const std::uint64_t value);
+
+	/**
+	 * Returns the slot of table holding key, or table->size if it is not present.
+	 *
+	 * @param table  	Slot array to search
+	 * @param key   	Key from keyOf()
+	 * @return  			Slot index or table->size.
+	 */
+  static std::uint32_t slotOf(const hashSlots* table, const std::uint64_t key);
+
+	/**
+	 * Returns the frame of key in table, or false if it is not present. Readers must validate the result.
+	 *
+	 * @param table  	Slot array to search
+	 * @param key   	Key from keyOf()
+	 * @param frameNo Set to the frame if found
+	 * @return  			True if found.
+	 */
+  static bool probe(const hashSlots* table, const std::uint64_t key, FrameId& frameNo);
+
+	/**
+	 * Allocates an empty slot array with at least the given number of slots.
+	 *
+	 * @param slots  	Slots wanted; rounded up to a power of two
+	 * @return  			New slot array.
+	 */
+  static hashSlots* allocSlots(const std::uint32_t slots);
+
+	/**
+	 * Stores an entry into the first empty slot of its probe sequence. Caller must have checked it is absent and
+	 * must be inside beginWrite().
+	 */
+  static void place(hashSlots* table, const std::uint64_t key, const FrameId frameNo);
+
+	/**
+	 * Empties one occupied slot, shifting back the following entries of its cluster. Caller must be inside
+	 * beginWrite().
+	 *
+	 * @param table  	Slot array
+	 * @param hole   	Slot to empty
+	 */
+  static void erase(hashSlots* table, std::uint32_t hole);
+
+	/**
+	 * Starts growing into a slot array of twice the size, finishing any growth still in progress first.
+	 */
+  void grow();
+
+	/**
+	 * Moves up to a number of entries from the draining array to the current one.
+	 *
+	 * @param entries	Most entries to move
+	 */
+  void migrate(std::uint32_t entries);
+
+	/**
+	 * Marks the beginning of a modification; concurrent readers will retry.
+	 */
+  void beginWrite();
+
+	/**
+	 * Marks the end of a modification started with beginWrite().
+	 */
+  void endWrite();
 
  public:
 	/**
+	 * Default maximum load factor
+	 */
+	static constexpr double DEFAULT_MAX_LOAD = 0.5;
+
+	/**
    * Constructor of BufHashTbl class
+	 *
+	 * @param htSize	Expected number of entries; the table starts with enough slots to hold them at the maximum load,
+	 *              	so that it allocates nothing more until it holds more than htSize entries
+	 * @param maxLoad	Highest ratio of entries to slots before the table grows; clamped to [0.1, 0.9]
 	 */
-	BufHashTbl(const int htSize);  // constructor
+	BufHashTbl(const int htSize, const double maxLoad = DEFAULT_MAX_LOAD);  // constructor
 
 	/**
    * Destructor of BufHashTbl class
 	 */
   ~BufHashTbl(); // destructor
-	
+
 	/**
-   * Insert entry into hash table mapping (file, pageNo) to frameNo.
+   * Insert entry into hash table mapping (file, pageNo) to frameNo; grows the table if needed.
 	 *
 	 * @param file   	File object
 	 * @param pageNo 	Page number in the file
 	 * @param frameNo Frame number assigned to that page of the file
    * @throws  HashAlreadyPresentException	if the corresponding page already exists in the hash table
-   * @throws  HashTableException (optional) if could not create a new bucket as running of memory
+   * @throws  HashTableException if the table is at its largest possible size
 	 */
   void insert(const File* file, const PageId pageNo, const FrameId frameNo);
 
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool (ie. in the hash table) without throwing or locking.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, set only if the page is found
+	 * @return				True if the page entry is in the hash table
+	 */
+  bool find(const File* file, const PageId pageNo, FrameId &frameNo) const;
+
 	/**
    * Check if (file, pageNo) is currently in the buffer pool (ie. in
    * the hash table).
@@ -92,7 +259,7 @@ class BufHashTbl
 	 * @param file  	File object
 	 * @param pageNo	Page number in the file
 	 * @param frameNo Frame number reference
-   * @throws HashNotFoundException if the page entry is not found in the hash table 
+   * @throws HashNotFoundException if the page entry is not found in the hash table
 	 */
   void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
 
@@ -101,9 +268,33 @@ class BufHashTbl
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
-   * @throws HashNotFoundException if the page entry is not found in the hash table 
+   * @throws HashNotFoundException if the page entry is not found in the hash table
+	 */
+  void remove(const File* file, const PageId pageNo);
+
+	/**
+	 * Returns the number of entries. Caller must be the single writer.
+	 */
+  std::uint32_t size() const
+  {
+		return count;
+  }
+
+	/**
+	 * Returns the number of slots taking inserts. Caller must be the single writer.
+	 */
+  std::uint32_t slots() const
+  {
+		return current.load(std::memory_order_relaxed)->size;
+  }
+
+	/**
+	 * Returns true while entries are still being moved to a larger slot array. Caller must be the single writer.
 	 */
-  void remove(const File* file, const PageId pageNo);  
+  bool growing() const
+  {
+		return draining.load(std::memory_order_relaxed) != NULL;
+  }
 };
 
 }
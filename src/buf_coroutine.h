@@ -0,0 +1,153 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+// Coroutines need C++20; the rest of the tree builds as C++11, so to older
+// compilers this header declares nothing
+#if __cplusplus >= 202002L && defined(__has_include)
+#if __has_include(<coroutine>)
+#define BADGERDB_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef BADGERDB_HAS_COROUTINES
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Hands a suspended coroutine back to the scheduler it runs on, e.g. by
+ * queueing the handle for the scheduler's thread to resume.
+ *
+ * Called on the I/O engine thread that completed the read.  An empty executor
+ * resumes the coroutine right there.
+ */
+typedef std::function<void(std::coroutine_handle<>)> ResumeExecutor;
+
+/**
+ * @brief Awaitable read of a page through the buffer pool; see awaitPage().
+ *
+ * A hit completes the read within BufMgr::readPageAsync(), so the coroutine
+ * goes on without suspending.  On a miss the coroutine suspends while the
+ * frame is filled and is resumed through the executor once the page is in.  A
+ * read that completes on the engine thread before the coroutine has finished
+ * suspending also goes on without suspending, on the awaiting thread.
+ *
+ * The awaiter lives in the coroutine frame and is used by one co_await only.
+ */
+class PageAwaiter {
+ public:
+  PageAwaiter(BufMgr& buf_mgr, File* file, const PageId page_number,
+              ResumeExecutor executor)
+      : buf_mgr_(&buf_mgr),
+        file_(file),
+        page_number_(page_number),
+        executor_(std::move(executor)),
+        page_(NULL),
+        done_(false) {
+  }
+
+  /**
+   * Always starts the read, which alone can tell a hit.
+   */
+  bool await_ready() const noexcept { return false; }
+
+  /**
+   * Starts the read.
+   *
+   * @param handle  The awaiting coroutine.
+   * @return  False if the read has completed already, so the coroutine goes
+   *          on at once.
+   */
+  bool await_suspend(std::coroutine_handle<> handle) {
+    handle_ = handle;
+    buf_mgr_->readPageAsync(file_, page_number_,
+                            [this](Page* page, std::exception_ptr error) {
+      page_ = page;
+      error_ = error;
+      // Whoever comes second finds the read complete and the coroutine
+      // suspended, and resumes it.  The awaiter lives in the coroutine frame,
+      // which the coroutine may destroy as soon as it is handed over, so the
+      // executor and handle are taken out of it first.
+      if (done_.exchange(true, std::memory_order_acq_rel)) {
+        const ResumeExecutor executor = std::move(executor_);
+        const std::coroutine_handle<> handle = handle_;
+        if (executor) {
+          executor(handle);
+        } else {
+          handle.resume();
+        }
+      }
+    });
+    return !done_.exchange(true, std::memory_order_acq_rel);
+  }
+
+  /**
+   * Returns the page, pinned for the caller, who must unpin it as after
+   * BufMgr::readPage().
+   *
+   * @throws  The exception that made the read fail, e.g.
+   *          BufferExceededException or InvalidPageException.
+   */
+  Page* await_resume() {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+    return page_;
+  }
+
+ private:
+  BufMgr* buf_mgr_;
+  File* file_;
+  PageId page_number_;
+  ResumeExecutor executor_;
+  std::coroutine_handle<> handle_;
+
+  /**
+   * Result of the read; written before <done_> is set the second time.
+   */
+  Page* page_;
+  std::exception_ptr error_;
+
+  /**
+   * Set by the first of the completed read and the finished suspension.
+   */
+  std::atomic<bool> done_;
+};
+
+/**
+ * Reads a page from a coroutine:
+ *
+ *   Page* page = co_await awaitPage(bufMgr, file, pageNo, executor);
+ *
+ * so that one thread can keep many misses outstanding without a thread
+ * blocked on each.  The page comes back pinned, as from BufMgr::readPage().
+ *
+ * @param buf_mgr      Buffer manager to read through.
+ * @param file         File of the page.
+ * @param page_number  Number of the page.
+ * @param executor     Resumes the coroutine after a miss; empty to resume it
+ *                     on the I/O engine thread.
+ */
+inline PageAwaiter awaitPage(BufMgr& buf_mgr, File* file,
+                             const PageId page_number,
+                             ResumeExecutor executor = ResumeExecutor()) {
+  return PageAwaiter(buf_mgr, file, page_number, std::move(executor));
+}
+
+}
+
+#endif
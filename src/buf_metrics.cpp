@@ -0,0 +1,69 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "buf_metrics.h"
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+const unsigned BufMetrics::LATENCY_BUCKETS;
+
+BufMetrics::BufMetrics() {
+  clear();
+}
+
+void BufMetrics::recordMissLatency(std::uint64_t nanos) {
+  unsigned bucket = 0;
+  for (std::uint64_t micros = nanos / 1000; micros > 0 && bucket + 1 < LATENCY_BUCKETS; micros >>= 1) {
+    bucket++;
+  }
+  shard().values[NUM_COUNTERS + bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void BufMetrics::snapshot(BufStats& stats) const {
+  std::uint64_t sums[NUM_VALUES] = {0};
+  for (unsigned s = 0; s < NUM_SHARDS; s++) {
+    for (unsigned v = 0; v < NUM_VALUES; v++) {
+      sums[v] += shards[s].values[v].load(std::memory_order_relaxed);
+    }
+  }
+  stats.accesses += sums[ACCESSES];
+  stats.hits += sums[HITS];
+  stats.misses += sums[MISSES];
+  stats.diskreads += sums[DISK_READS];
+  stats.diskwrites += sums[DISK_WRITES];
+  stats.evictions += sums[EVICTIONS];
+  stats.dirtyEvictions += sums[DIRTY_EVICTIONS];
+  stats.cleanerWrites += sums[CLEANER_WRITES];
+  stats.victimSearches += sums[VICTIM_SEARCHES];
+  stats.pinWaits += sums[PIN_WAITS];
+  stats.pinWaitNanos += sums[PIN_WAIT_NANOS];
+  stats.remoteHits += sums[REMOTE_HITS];
+  stats.frameWaits += sums[FRAME_WAITS];
+  stats.frameWaitNanos += sums[FRAME_WAIT_NANOS];
+  stats.ringReuses += sums[RING_REUSES];
+  for (unsigned b = 0; b < LATENCY_BUCKETS; b++) {
+    stats.missLatency[b] += sums[NUM_COUNTERS + b];
+  }
+}
+
+void BufMetrics::clear() {
+  for (unsigned s = 0; s < NUM_SHARDS; s++) {
+    for (unsigned v = 0; v < NUM_VALUES; v++) {
+      shards[s].values[v].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+unsigned BufMetrics::shardIndex() {
+  static std::atomic<unsigned> nextShard(0);
+  thread_local unsigned index = nextShard.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+  return index;
+}
+
+}
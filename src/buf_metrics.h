@@ -0,0 +1,142 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace badgerdb {
+
+struct BufStats;
+
+/**
+ * @brief Event counters of the buffer manager, cheap enough to keep on in
+ * production.
+ *
+ * Counters are spread over a fixed number of shards, each on cache lines of
+ * its own.  A thread always adds to the same shard, chosen when it first
+ * counts something, so threads do not bounce counter lines between cores;
+ * adds are relaxed atomic increments.  Reading the counters (snapshot()) sums
+ * the shards, which may miss events counted concurrently but never tears a
+ * single counter.
+ */
+class BufMetrics {
+ public:
+  /**
+   * Events counted.
+   */
+  enum Counter {
+    ACCESSES,         // pins requested through readPage() and friends
+    HITS,             // pins of pages already in the pool
+    MISSES,           // pins that had to bring the page in
+    DISK_READS,       // pages read from disk, including allocations
+    DISK_WRITES,      // pages written to disk
+    EVICTIONS,        // valid pages evicted to make room
+    DIRTY_EVICTIONS,  // evicted pages that had to be written first
+    CLEANER_WRITES,   // pages written back by the page cleaner
+    VICTIM_SEARCHES,  // frames requested from the replacement policies
+    PIN_WAITS,        // pins that waited for a read or write in flight
+    PIN_WAIT_NANOS,   // total time spent in those waits
+    REMOTE_HITS,      // hits on frames placed on another NUMA node
+    FRAME_WAITS,      // allocations that waited for a frame to be unpinned
+    FRAME_WAIT_NANOS, // total time spent in those waits
+    RING_REUSES,      // scan misses that reused a frame of their scan ring
+    NUM_COUNTERS
+  };
+
+  /**
+   * Number of buckets of the miss latency histogram.  Bucket 0 counts misses
+   * served in under 1 microsecond, bucket i > 0 those in [2^(i-1), 2^i)
+   * microseconds; the last bucket also takes everything slower.
+   */
+  static const unsigned LATENCY_BUCKETS = 24;
+
+  BufMetrics();
+
+  /**
+   * Counts events.
+   *
+   * @param counter   Event to count.
+   * @param n         Number of events.
+   */
+  void add(Counter counter, std::uint64_t n = 1) {
+    shard().values[counter].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /**
+   * Records the time it took to serve a miss.
+   *
+   * @param nanos   Latency in nanoseconds.
+   */
+  void recordMissLatency(std::uint64_t nanos);
+
+  /**
+   * Adds the sum of every counter to the matching fields of a snapshot.
+   *
+   * @param stats   Snapshot to fill in.
+   */
+  void snapshot(BufStats& stats) const;
+
+  /**
+   * Zeroes every counter.
+   */
+  void clear();
+
+  /**
+   * Returns the current time in nanoseconds, for measuring latencies.
+   */
+  static std::uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+ private:
+  BufMetrics(const BufMetrics&);
+  BufMetrics& operator=(const BufMetrics&);
+
+  /**
+   * Number of shards; threads beyond this share them.
+   */
+  static const unsigned NUM_SHARDS = 16;
+
+  /**
+   * Number of values kept per shard: the counters, then the histogram.
+   */
+  static const unsigned NUM_VALUES = NUM_COUNTERS + LATENCY_BUCKETS;
+
+  /**
+   * Bytes of a cache line.
+   */
+  static const unsigned CACHE_LINE = 64;
+
+  /**
+   * Counters of one group of threads, padded to whole cache lines.
+   */
+  struct Shard {
+    std::atomic<std::uint64_t> values[NUM_VALUES];
+    char padding[CACHE_LINE - NUM_VALUES * sizeof(std::uint64_t) % CACHE_LINE];
+  };
+
+  /**
+   * Returns the shard of the calling thread.
+   */
+  Shard& shard() { return shards[shardIndex()]; }
+
+  /**
+   * Returns the shard index of the calling thread, choosing one on first use.
+   */
+  static unsigned shardIndex();
+
+  /**
+   * The shards.
+   */
+  Shard shards[NUM_SHARDS];
+};
+
+}
@@ -0,0 +1,131 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <vector>
+#include "buf_scan_iterator.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Scans the records of a file through the buffer pool a page at a time.
+ *
+ * Each call to next() moves to the next page of the file holding records,
+ * pinned through a BufScanIterator (so sequential scans are prefetched), and
+ * hands out all of its records at once as views into the buffered page (see
+ * Page::getRecords()).  The views stay valid until the following call to
+ * next(), which unpins the page.
+ *
+ * Like BufScanIterator, the scanner owns the pin on the current page, so it
+ * cannot be copied.
+ */
+class BufRecordScanner {
+ public:
+  /**
+   * Constructs a scanner over the records of a file; nothing is pinned until
+   * the first call to next().
+   *
+   * @param buf_mgr     Buffer manager to read the pages through.
+   * @param file        File to scan.
+   * @param read_ahead  Number of pages to prefetch ahead of the scan.
+   */
+  BufRecordScanner(BufMgr* buf_mgr, File* file,
+                   const unsigned read_ahead =
+                       BufScanIterator::DEFAULT_READ_AHEAD)
+      : buf_mgr_(buf_mgr),
+        file_(file),
+        read_ahead_(read_ahead),
+        started_(false),
+        page_number_(Page::INVALID_NUMBER) {
+  }
+
+  BufRecordScanner(const BufRecordScanner&) = delete;
+  BufRecordScanner& operator=(const BufRecordScanner&) = delete;
+
+  /**
+   * Moves to the next page holding records and returns them, skipping pages
+   * without any.
+   *
+   * @param records   Receives a view of each record of the page, in slot
+   *                  order.
+   * @return  False once every page has been scanned; records is then empty.
+   */
+  bool next(std::vector<RecordView>& records) {
+    if (!started_) {
+      iter_ = BufScanIterator(buf_mgr_, file_, read_ahead_);
+      started_ = true;
+    } else if (iter_ != BufScanIterator()) {
+      ++iter_;
+    }
+    for (; iter_ != BufScanIterator(); ++iter_) {
+      if ((*iter_)->getRecords(records, &slots_) > 0) {
+        page_number_ = (*iter_)->page_number();
+        return true;
+      }
+    }
+    records.clear();
+    slots_.clear();
+    page_number_ = Page::INVALID_NUMBER;
+    return false;
+  }
+
+  /**
+   * Returns the number of the page the last batch came from.
+   *
+   * @return  Page number, or Page::INVALID_NUMBER once the scan is over.
+   */
+  PageId page_number() const { return page_number_; }
+
+  /**
+   * Returns the slot number of each record of the last batch, so that
+   * RecordId{page_number(), slots()[i]} identifies the i-th record.
+   *
+   * @return  Slot numbers.
+   */
+  const std::vector<SlotId>& slots() const { return slots_; }
+
+ private:
+  /**
+   * Buffer manager the pages are read through.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * File being scanned.
+   */
+  File* file_;
+
+  /**
+   * Number of pages to prefetch ahead of the scan.
+   */
+  unsigned read_ahead_;
+
+  /**
+   * Whether the first page has been pinned.
+   */
+  bool started_;
+
+  /**
+   * Iterator holding the pin on the current page.
+   */
+  BufScanIterator iter_;
+
+  /**
+   * Page the last batch came from.
+   */
+  PageId page_number_;
+
+  /**
+   * Slot numbers of the records of the last batch.
+   */
+  std::vector<SlotId> slots_;
+};
+
+}
@@ -0,0 +1,287 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cassert>
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Iterator for scanning the pages of a file through the buffer pool.
+ *
+ * Unlike FileIterator, which reads a private copy of every page straight from
+ * the file, this iterator pins each page in the buffer pool while it is the
+ * current one.  Once the pages have been visited in ascending, consecutive
+ * order a few times the scan is taken to be sequential, and the pages after
+ * the current one are prefetched (see BufMgr::prefetchPage()) so that their
+ * reads overlap with the work done on earlier pages.
+ *
+ * A scan of a whole table constructed with AccessHint::SEQUENTIAL_SCAN reads
+ * and prefetches its pages into the scan ring (see BufMgr::setScanRing()), so
+ * it leaves the rest of the buffer pool as it found it.
+ *
+ * The iterator owns the pin on the current page, so it can be moved but not
+ * copied.
+ */
+class BufScanIterator {
+ public:
+  /**
+   * Number of pages kept in flight ahead of a sequential scan by default.
+   */
+  static const unsigned DEFAULT_READ_AHEAD = 8;
+
+  /**
+   * Number of consecutive page numbers after which the scan counts as
+   * sequential.
+   */
+  static const unsigned SEQUENTIAL_THRESHOLD = 2;
+
+  /**
+   * Constructs an iterator past the last page; compares equal to any iterator
+   * that has finished its scan.
+   */
+  BufScanIterator()
+      : buf_mgr_(NULL),
+        file_(NULL),
+        current_page_number_(Page::INVALID_NUMBER),
+        page_(NULL),
+        read_ahead_(0),
+        hint_(AccessHint::NORMAL),
+        run_length_(0),
+        prefetched_up_to_(Page::INVALID_NUMBER),
+        num_pages_(0) {
+  }
+
+  /**
+   * Constructs an iterator over the pages in a file, pinning the first page.
+   *
+   * @param buf_mgr     Buffer manager to read the pages through.
+   * @param file        File to iterate over.
+   * @param read_ahead  Number of pages to prefetch ahead of a sequential scan;
+   *                    0 turns prefetching off.
+   * @param hint        Hint of every read and prefetch of the scan.
+   */
+  BufScanIterator(BufMgr* buf_mgr, File* file,
+                  const unsigned read_ahead = DEFAULT_READ_AHEAD,
+                  const AccessHint hint = AccessHint::NORMAL)
+      : buf_mgr_(buf_mgr),
+        file_(file),
+        page_(NULL),
+        read_ahead_(read_ahead),
+        hint_(hint),
+        run_length_(0),
+        prefetched_up_to_(Page::INVALID_NUMBER) {
+    assert(buf_mgr_ != NULL && file_ != NULL);
+    const FileHeader& header = file_->readHeader();
+    current_page_number_ = header.first_used_page;
+    num_pages_ = header.num_pages;
+    pin();
+  }
+
+  /**
+   * Takes over the scan, and the pin on its current page, of another
+   * iterator, which is left past the last page.
+   *
+   * @param other   Iterator to move from.
+   */
+  BufScanIterator(BufScanIterator&& other)
+      : buf_mgr_(other.buf_mgr_),
+        file_(other.file_),
+        current_page_number_(other.current_page_number_),
+        page_(other.page_),
+        read_ahead_(other.read_ahead_),
+        hint_(other.hint_),
+        run_length_(other.run_length_),
+        prefetched_up_to_(other.prefetched_up_to_),
+        num_pages_(other.num_pages_) {
+    other.current_page_number_ = Page::INVALID_NUMBER;
+    other.page_ = NULL;
+  }
+
+  /**
+   * Unpins the current page and takes over the scan of another iterator,
+   * which is left past the last page.
+   *
+   * @param other   Iterator to move from.
+   */
+  BufScanIterator& operator=(BufScanIterator&& other) {
+    if (this != &other) {
+      unpin();
+      buf_mgr_ = other.buf_mgr_;
+      file_ = other.file_;
+      current_page_number_ = other.current_page_number_;
+      page_ = other.page_;
+      read_ahead_ = other.read_ahead_;
+      hint_ = other.hint_;
+      run_length_ = other.run_length_;
+      prefetched_up_to_ = other.prefetched_up_to_;
+      num_pages_ = other.num_pages_;
+      other.current_page_number_ = Page::INVALID_NUMBER;
+      other.page_ = NULL;
+    }
+    return *this;
+  }
+
+  BufScanIterator(const BufScanIterator&) = delete;
+  BufScanIterator& operator=(const BufScanIterator&) = delete;
+
+  /**
+   * Unpins the current page.
+   */
+  ~BufScanIterator() {
+    unpin();
+  }
+
+  /**
+   * Advances the iterator to the next page in the file, unpinning the current
+   * one.
+   */
+	inline BufScanIterator& operator++() {
+    assert(page_ != NULL);
+    const PageId next_page_number = page_->next_page_number();
+    if (next_page_number == current_page_number_ + 1) {
+      ++run_length_;
+    } else {
+      run_length_ = 0;
+    }
+    unpin();
+    current_page_number_ = next_page_number;
+    if (current_page_number_ != Page::INVALID_NUMBER) {
+      readAhead();
+      pin();
+    }
+
+		return *this;
+	}
+
+  /**
+   * Returns true if this iterator is equal to the given iterator.  Iterators
+   * past the last page are equal to each other whatever their file.
+   *
+   * @param rhs   Iterator to compare against.
+   * @return    True if other iterator is equal to this one.
+   */
+	inline bool operator==(const BufScanIterator& rhs) const {
+    if (current_page_number_ == Page::INVALID_NUMBER ||
+        rhs.current_page_number_ == Page::INVALID_NUMBER) {
+      return current_page_number_ == rhs.current_page_number_;
+    }
+    return file_->id() == rhs.file_->id() &&
+        current_page_number_ == rhs.current_page_number_;
+  }
+
+	inline bool operator!=(const BufScanIterator& rhs) const {
+    return !(*this == rhs);
+  }
+
+  /**
+   * Dereferences the iterator, returning the current page as pinned in the
+   * buffer pool.  The page stays valid until the iterator moves on.
+   *
+   * @return  Buffered page.
+   */
+	inline Page* operator*() const {
+    assert(page_ != NULL);
+    return page_;
+  }
+
+ private:
+  /**
+   * Pins the current page in the buffer pool.
+   */
+  void pin() {
+    if (current_page_number_ != Page::INVALID_NUMBER) {
+      buf_mgr_->readPage(file_, current_page_number_, page_, hint_);
+    }
+  }
+
+  /**
+   * Unpins the current page, if any.
+   */
+  void unpin() {
+    if (page_ != NULL) {
+      buf_mgr_->unPinPage(file_, current_page_number_, false /* dirty */);
+      page_ = NULL;
+    }
+  }
+
+  /**
+   * Keeps the pages following the current one in flight while the scan is
+   * sequential.
+   */
+  void readAhead() {
+    if (read_ahead_ == 0 || run_length_ < SEQUENTIAL_THRESHOLD) {
+      return;
+    }
+    PageId first = current_page_number_;
+    if (prefetched_up_to_ != Page::INVALID_NUMBER &&
+        prefetched_up_to_ >= first) {
+      first = prefetched_up_to_ + 1;
+    }
+    PageId last = current_page_number_ + read_ahead_;
+    if (last >= num_pages_) {
+      last = num_pages_ - 1;
+    }
+    for (PageId page_number = first; page_number <= last; ++page_number) {
+      buf_mgr_->prefetchPage(file_, page_number, hint_);
+    }
+    prefetched_up_to_ = last;
+  }
+
+  /**
+   * Buffer manager the pages are read through.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * File we're iterating over.
+   */
+  File* file_;
+
+  /**
+   * Number of page in file iterator is currently pointing to.
+   */
+  PageId current_page_number_;
+
+  /**
+   * Current page as pinned in the buffer pool; NULL past the last page.
+   */
+  Page* page_;
+
+  /**
+   * Number of pages to prefetch ahead of a sequential scan.
+   */
+  unsigned read_ahead_;
+
+  /**
+   * Hint of the reads of the scan.
+   */
+  AccessHint hint_;
+
+  /**
+   * Number of steps in a row that moved to the next page number.
+   */
+  unsigned run_length_;
+
+  /**
+   * Highest page number prefetched so far.
+   */
+  PageId prefetched_up_to_;
+
+  /**
+   * Number of pages in the file when the scan started; no page at or beyond
+   * it is prefetched.
+   */
+  PageId num_pages_;
+};
+
+}
@@ -0,0 +1,237 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "buf_trace.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#include "buf_metrics.h"
+#include "buffer.h"
+#include "file.h"
+#include "replacement_policy.h"
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * First bytes of a trace file.
+ */
+const char TRACE_MAGIC[8] = {'B', 'D', 'B', 'T', 'R', 'A', 'C', 'E'};
+
+/**
+ * Version of the trace file format.
+ */
+const std::uint32_t TRACE_VERSION = 1;
+
+template <typename T>
+void writeValue(std::ofstream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+void readValue(std::ifstream& in, T& value) {
+  in.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+
+FileId simulatedFile(std::uint32_t id) {
+  // File ids start at 1.
+  return id + 1;
+}
+
+}
+
+const std::uint64_t TraceRecord::TIME_MASK;
+
+BufTrace::BufTrace() : enabled_(false), startNanos(0), appended(0) {
+}
+
+void BufTrace::start(std::size_t capacity) {
+  std::lock_guard<std::mutex> guard(mutex);
+  ring.assign(capacity == 0 ? 1 : capacity, TraceRecord());
+  appended = 0;
+  fileIds.clear();
+  fileNames.clear();
+  startNanos = BufMetrics::now();
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void BufTrace::stop() {
+  std::lock_guard<std::mutex> guard(mutex);
+  enabled_.store(false, std::memory_order_relaxed);
+}
+
+void BufTrace::append(TraceRecord::Op op, const File* file, PageId pageNo) {
+  const std::uint64_t now = BufMetrics::now();
+  std::lock_guard<std::mutex> guard(mutex);
+  if (!enabled_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  std::unordered_map<FileId, std::uint32_t>::iterator id =
+      fileIds.find(file->id());
+  if (id == fileIds.end()) {
+    id = fileIds.insert(std::make_pair(file->id(),
+                                       (std::uint32_t) fileNames.size()))
+             .first;
+    fileNames.push_back(file->filename());
+  }
+  TraceRecord& record = ring[appended % ring.size()];
+  record.stamp = ((now - startNanos) & TraceRecord::TIME_MASK) |
+      ((std::uint64_t) op << 56);
+  record.file = id->second;
+  record.pageNo = pageNo;
+  appended++;
+}
+
+std::vector<TraceRecord> BufTrace::records() const {
+  std::lock_guard<std::mutex> guard(mutex);
+  std::vector<TraceRecord> result;
+  if (appended <= ring.size()) {
+    result.assign(ring.begin(), ring.begin() + appended);
+  } else {
+    const std::size_t oldest = appended % ring.size();
+    result.assign(ring.begin() + oldest, ring.end());
+    result.insert(result.end(), ring.begin(), ring.begin() + oldest);
+  }
+  return result;
+}
+
+std::vector<std::string> BufTrace::files() const {
+  std::lock_guard<std::mutex> guard(mutex);
+  return fileNames;
+}
+
+void BufTrace::save(const std::string& path) const {
+  const std::vector<TraceRecord> saved = records();
+  const std::vector<std::string> names = files();
+  std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+  out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  writeValue(out, TRACE_VERSION);
+  writeValue(out, (std::uint32_t) names.size());
+  for (std::size_t f = 0; f < names.size(); f++) {
+    writeValue(out, (std::uint32_t) names[f].size());
+    out.write(names[f].data(), names[f].size());
+  }
+  writeValue(out, (std::uint64_t) saved.size());
+  for (std::size_t r = 0; r < saved.size(); r++) {
+    writeValue(out, saved[r].stamp);
+    writeValue(out, saved[r].file);
+    writeValue(out, saved[r].pageNo);
+  }
+  out.flush();
+  if (!out) {
+    throw FileIOException(path, "write trace", errno);
+  }
+}
+
+void BufTrace::load(const std::string& path, std::vector<TraceRecord>& records,
+                    std::vector<std::string>& files) {
+  std::ifstream in(path.c_str(), std::ios::binary);
+  if (!in) {
+    throw FileIOException(path, "open trace", errno);
+  }
+  char magic[sizeof(TRACE_MAGIC)];
+  std::uint32_t version = 0;
+  in.read(magic, sizeof(magic));
+  readValue(in, version);
+  if (!in || std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 ||
+      version != TRACE_VERSION) {
+    throw FileIOException(path, "read trace", EINVAL);
+  }
+
+  std::uint32_t numFiles = 0;
+  readValue(in, numFiles);
+  files.clear();
+  for (std::uint32_t f = 0; f < numFiles && in; f++) {
+    std::uint32_t length = 0;
+    readValue(in, length);
+    std::string name(length, '\0');
+    in.read(&name[0], length);
+    files.push_back(name);
+  }
+  std::uint64_t numRecords = 0;
+  readValue(in, numRecords);
+  records.clear();
+  for (std::uint64_t r = 0; r < numRecords && in; r++) {
+    TraceRecord record;
+    readValue(in, record.stamp);
+    readValue(in, record.file);
+    readValue(in, record.pageNo);
+    records.push_back(record);
+  }
+  if (!in) {
+    throw FileIOException(path, "read trace", EINVAL);
+  }
+}
+
+BufTrace::ReplayResult BufTrace::replay(const std::vector<TraceRecord>& records,
+                                        ReplacementPolicyType policyType,
+                                        std::uint32_t frames) {
+  FrameStates states(frames);
+  std::unique_ptr<ReplacementPolicy> policy(
+      ReplacementPolicy::create(policyType, &states, 0, frames));
+  std::unordered_map<PageKey, FrameId, PageKeyHash> table;
+  std::vector<PageKey> frameKeys(frames);
+  ReplayResult result = {0, 0, 0};
+
+  for (std::size_t r = 0; r < records.size(); r++) {
+    const TraceRecord& record = records[r];
+    const PageKey key = {simulatedFile(record.file), record.pageNo};
+    std::unordered_map<PageKey, FrameId, PageKeyHash>::iterator found =
+        table.find(key);
+    switch (record.op()) {
+      case TraceRecord::READ:
+      case TraceRecord::ALLOC: {
+        const bool read = record.op() == TraceRecord::READ;
+        result.reads += read;
+        if (found != table.end()) {
+          states.pin(found->second);
+          policy->frameAccessed(found->second);
+          result.hits += read;
+          break;
+        }
+        FrameId frame;
+        if (!policy->pickVictim(key, frame, NULL)) {
+          result.exceeded++;
+          break;
+        }
+        if (states.test(frame, FrameStates::VALID)) {
+          table.erase(frameKeys[frame]);
+        }
+        states.store(frame, FrameStates::VALID | FrameStates::REFBIT | 1);
+        frameKeys[frame] = key;
+        table[key] = frame;
+        policy->frameLoaded(frame, key);
+        break;
+      }
+      case TraceRecord::UNPIN:
+      case TraceRecord::UNPIN_DIRTY:
+        if (found != table.end()) {
+          states.unpin(found->second, record.op() == TraceRecord::UNPIN_DIRTY
+                                          ? FrameStates::DIRTY
+                                          : 0);
+        }
+        break;
+      case TraceRecord::DISPOSE:
+        if (found != table.end()) {
+          const FrameId frame = found->second;
+          table.erase(found);
+          states.store(frame, 0);
+          policy->frameFreed(frame);
+        }
+        break;
+    }
+  }
+  return result;
+}
+
+}
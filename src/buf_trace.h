@@ -0,0 +1,209 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+class File;
+enum class ReplacementPolicyType;
+
+/**
+ * @brief One buffer manager call in a trace; 16 bytes.
+ */
+struct TraceRecord {
+  /**
+   * Calls recorded.
+   */
+  enum Op : std::uint8_t {
+    READ,         // readPage() and its batched and asynchronous forms
+    UNPIN,        // unPinPage() of a clean page
+    UNPIN_DIRTY,  // unPinPage() marking the page dirty
+    ALLOC,        // allocPage()
+    DISPOSE       // disposePage()
+  };
+
+  /**
+   * Bits of <stamp> holding the time; the top byte holds the Op.
+   */
+  static const std::uint64_t TIME_MASK = (1ULL << 56) - 1;
+
+  /**
+   * Nanoseconds since the trace started, and the Op in the top byte.
+   */
+  std::uint64_t stamp;
+
+  /**
+   * Index of the file in BufTrace::files().
+   */
+  std::uint32_t file;
+
+  /**
+   * Page the call was about.
+   */
+  PageId pageNo;
+
+  Op op() const { return static_cast<Op>(stamp >> 56); }
+
+  std::uint64_t nanos() const { return stamp & TIME_MASK; }
+};
+
+/**
+ * @brief Optional record of the calls made to a buffer manager.
+ *
+ * While tracing is on, every call is appended to a ring buffer of fixed
+ * capacity, so a long-running process keeps its most recent calls without
+ * growing.  Files are recorded by small integer ids; their names are kept
+ * once.  A trace can be saved in a compact binary format and loaded again, and
+ * replay() runs a trace against a simulated buffer pool of any size and
+ * replacement policy, without touching the disk, to see what hit ratio it
+ * would have had.
+ *
+ * Appending takes a mutex; the check whether tracing is on does not, so a
+ * buffer manager that is not tracing pays one relaxed load per call.
+ */
+class BufTrace {
+ public:
+  /**
+   * Outcome of replaying a trace.
+   */
+  struct ReplayResult {
+    std::uint64_t reads;     // READ records replayed
+    std::uint64_t hits;      // reads that found the page in the simulated pool
+    std::uint64_t exceeded;  // reads and allocations that found every frame pinned
+
+    double hitRatio() const {
+      return reads == 0 ? 0.0 : (double) hits / reads;
+    }
+  };
+
+  BufTrace();
+
+  /**
+   * Starts recording, discarding any earlier records.
+   *
+   * @param capacity  Number of records kept; older ones are overwritten.
+   */
+  void start(std::size_t capacity);
+
+  /**
+   * Stops recording; the records stay available.
+   */
+  void stop();
+
+  /**
+   * Returns true while recording.
+   */
+  bool enabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Appends a record if recording.
+   *
+   * @param op      Call made.
+   * @param file    File of the page.
+   * @param pageNo  Page the call was about.
+   */
+  void record(TraceRecord::Op op, const File* file, PageId pageNo) {
+    if (enabled()) {
+      append(op, file, pageNo);
+    }
+  }
+
+  /**
+   * Copies the records, oldest first.
+   */
+  std::vector<TraceRecord> records() const;
+
+  /**
+   * Returns the names of the files of the records, indexed by
+   * TraceRecord::file.
+   */
+  std::vector<std::string> files() const;
+
+  /**
+   * Writes the records and file names to a trace file.
+   *
+   * @param path    Name of the trace file; replaced if it exists.
+   * @throws  FileIOException  If the file cannot be written.
+   */
+  void save(const std::string& path) const;
+
+  /**
+   * Reads a trace file written by save().
+   *
+   * @param path      Name of the trace file.
+   * @param records   Receives the records, oldest first.
+   * @param files     Receives the file names.
+   * @throws  FileIOException  If the file cannot be read or is not a trace.
+   */
+  static void load(const std::string& path, std::vector<TraceRecord>& records,
+                   std::vector<std::string>& files);
+
+  /**
+   * Replays a trace against a simulated buffer pool: a single partition of
+   * the given size managed by the given policy, exactly as BufMgr would, but
+   * without any page contents.
+   *
+   * @param records   Trace to replay.
+   * @param policy    Replacement policy of the simulated pool.
+   * @param frames    Number of frames of the simulated pool.
+   * @return  Hits and reads of the replay.
+   */
+  static ReplayResult replay(const std::vector<TraceRecord>& records,
+                             ReplacementPolicyType policy,
+                             std::uint32_t frames);
+
+ private:
+  BufTrace(const BufTrace&);
+  BufTrace& operator=(const BufTrace&);
+
+  void append(TraceRecord::Op op, const File* file, PageId pageNo);
+
+  /**
+   * Guards everything below.
+   */
+  mutable std::mutex mutex;
+
+  /**
+   * True while recording.
+   */
+  std::atomic<bool> enabled_;
+
+  /**
+   * Time the trace started, from BufMetrics::now().
+   */
+  std::uint64_t startNanos;
+
+  /**
+   * The ring buffer.
+   */
+  std::vector<TraceRecord> ring;
+
+  /**
+   * Number of records appended since the trace started.
+   */
+  std::uint64_t appended;
+
+  /**
+   * Id of every file seen, and the names of the files by id.
+   */
+  std::unordered_map<FileId, std::uint32_t> fileIds;
+  std::vector<std::string> fileNames;
+};
+
+}
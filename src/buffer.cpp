@@ -1,8 +1,8 @@
 /**
- * This file implements the BufMgr class and all its functions. In essence, the BufMgr uses an LRU
- * clock replacement algorithm that takes in a page request and if it is in buffer pool BufMgr
- * returns pointer that to page. If the page is not in the pool, it frees a frame and gets the page
- * to the frame from the disk.
+ * This file implements the BufMgr class and all its functions. In essence, the BufMgr takes in a
+ * page request and if it is in buffer pool BufMgr returns pointer that to page. If the page is not
+ * in the pool, it frees the frame chosen by the replacement policy (CLOCK by default) and gets the
+ * page to the frame from the disk.
  *
  * CS 564 Group 55
  * James Ma: 9079648441
@@ -16,14 +16,25 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <memory>
 #include <iostream>
 #include "buffer.h"
+#include "page_handle.h"
+#include "frame_arena.h"
+#include "io_engine.h"
+#include "log_manager.h"
+#include "numa.h"
+#include "replacement_policy.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
-#include "exceptions/hash_not_found_exception.h"
+#include "exceptions/file_io_exception.h"
 #include <stdio.h>
 #include <inttypes.h>
 
@@ -33,189 +44,1611 @@ namespace badgerdb {
 // Constructor of the class BufMgr
 //----------------------------------------
 
-BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
-	bufDescTable = new BufDesc[bufs];
+BufMgr::BufMgr(std::uint32_t bufs, std::uint32_t parts, ReplacementPolicyType policy, std::uint32_t maxBufs,
+               bool numa)
+	: numBufs(std::max(bufs, maxBufs)), activeBufs(bufs), policyType(policy), ioEngine(NULL), wal(NULL),
+	  cleanerRunning(false),
+	  cleanerStop(false), cleanerKick(false), cleanerLow(0), cleanerHigh(0), cleanerInterval(0), warmerStop(false),
+	  warmedPages(0), frameWaitMs(0), scanRingFrames(DEFAULT_SCAN_RING) {
+	// Everything per frame is allocated for the largest size the pool can be resized to
+	bufDescTable = new BufDesc[numBufs];
+	bufStateTable = new FrameStates(numBufs);
+	latchTable = new FrameLatch[numBufs];
 
 	// Initializes variables stored in the buffer table
-	for (FrameId i = 0; i < bufs; i++) {
+	for (FrameId i = 0; i < numBufs; i++) {
 		bufDescTable[i].frameNo = i;
-		bufDescTable[i].valid = false;
 	}
 
-	bufPool = new Page[bufs];
+	// Frames are views over one aligned arena instead of separately allocated pages
+	arena = new FrameArena(numBufs);
+	bufPool = static_cast<Page*>(::operator new(sizeof(Page) * numBufs));
+	for (FrameId i = 0; i < numBufs; i++) {
+		new (&bufPool[i]) Page(arena->frame(i));
+	}
 
-	int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-	hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+	// Splits the frames as evenly as possible between the partitions
+	if (parts == 0) {
+		parts = 1;
+	}
+	if (parts > bufs) {
+		parts = bufs;
+	}
+	numPartitions = parts;
+	partitions = new BufPartition[parts];
+	const unsigned nodes = numa ? numaNodes() : 1;
+	FrameId first = 0;
+	for (std::uint32_t p = 0; p < parts; p++) {
+		BufPartition& part = partitions[p];
+		part.firstFrame = first;
+		part.capacity = numBufs / parts + (p < numBufs % parts ? 1 : 0);
+		part.numFrames = bufs / parts + (p < bufs % parts ? 1 : 0);
+		if (numa) {
+			// Nothing has touched the frames yet, so they are committed on the node when first used
+			part.node = p % nodes;
+			arena->place(part.firstFrame, part.capacity, part.node);
+		}
+		first += part.capacity;
+	}
 
-	clockHand = bufs - 1;
+	// The metadata of each partition is allocated, and so first touched, by a thread running on its node
+	std::vector<std::thread> placers;
+	std::vector<std::exception_ptr> errors(nodes);
+	for (unsigned node = 0; node < nodes; node++) {
+		const auto build = [this, policy, parts, nodes, node, &errors]() {
+			try {
+				if (nodes > 1) {
+					numaRunOn(node);
+				}
+				for (std::uint32_t p = node; p < parts; p += nodes) {
+					BufPartition& part = partitions[p];
+					part.policy = ReplacementPolicy::create(policy, bufStateTable, part.firstFrame, part.numFrames);
+
+					// A partition never holds more pages than frames, so a table sized for its capacity never grows
+					// and inserts and removes made under the partition mutex never allocate
+					part.hashTable = new BufHashTbl (part.capacity);  // allocate the buffer hash table
+				}
+			} catch (...) {
+				errors[node] = std::current_exception();
+			}
+		};
+		if (nodes > 1) {
+			placers.push_back(std::thread(build));
+		} else {
+			build();
+		}
+	}
+	for (std::size_t t = 0; t < placers.size(); t++) {
+		placers[t].join();
+	}
+	for (unsigned node = 0; node < nodes; node++) {
+		if (errors[node]) {
+			std::rethrow_exception(errors[node]);
+		}
+	}
 }
 
 BufMgr::~BufMgr() {
-	// Flushes all files
+	warmerStop = true;
+	waitForWarmUp();
+	stopCleaner();
+	// Waits for asynchronous reads still in flight
+	delete ioEngine;
+
+	// Writes back every dirty page in one pass, then syncs each file that was written once
+	std::vector<const File*> written;
 	for (FrameId i = 0; i < numBufs; i++) {
-		if(bufDescTable[i].dirty) {
-			flushFile(bufDescTable[i].file);
+		const std::uint32_t state = bufStateTable->load(i);
+		if((state & FrameStates::VALID) && (state & FrameStates::DIRTY)) {
+			writeFrame(i);
+			if(std::find(written.begin(), written.end(), bufDescTable[i].file) == written.end()) {
+				written.push_back(bufDescTable[i].file);
+			}
 		}
 	}
+	for (std::size_t f = 0; f < written.size(); f++) {
+		written[f]->sync();
+	}
 	
 	// Deletes variables used in the file
-	delete[] bufPool;
+	for (std::uint32_t p = 0; p < numPartitions; p++) {
+		delete partitions[p].hashTable;
+		delete partitions[p].policy;
+	}
+	delete[] partitions;
+	for (FrameId i = 0; i < numBufs; i++) {
+		bufPool[i].~Page();
+	}
+	::operator delete(bufPool);
+	delete arena;
+	delete[] latchTable;
+	delete bufStateTable;
 	delete[] bufDescTable;
-	delete hashTable;
 }
 
-void BufMgr::advanceClock() {
-	clockHand = (clockHand+1)%numBufs;
+BufPartition& BufMgr::partitionFor(const File* file, const PageId pageNo) {
+	if (numPartitions == 1) {
+		return partitions[0];
+	}
+	// Mixes the file id and page number so that consecutive pages of a file spread over all partitions
+	std::uint64_t key = ((std::uint64_t) file->id() << 32) ^ ((std::uint64_t) pageNo * 0x9E3779B97F4A7C15ULL);
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	return partitions[key % numPartitions];
 }
 
+void BufMgr::countHit(const BufPartition& part){
+	metrics.add(BufMetrics::HITS);
+	if(part.node >= 0 && numaCurrentNode() != (unsigned) part.node){
+		metrics.add(BufMetrics::REMOTE_HITS);
+	}
+}
 
-void BufMgr::allocBuf(FrameId & frame){
-	int numPinnedPages=0; // number of pages pinned or currently being used
-	while(true){
-		advanceClock();
-		// If a frame has a pinned page
-		if(bufDescTable[clockHand].pinCnt>0){
-			numPinnedPages++;
-			// If all frames are pinned
-			if((unsigned)numPinnedPages==numBufs){
-				throw BufferExceededException();
+void BufMgr::frameHit(BufPartition& part, const FrameId frameNo, const AccessHint hint){
+	countHit(part);
+	part.policy->frameAccessed(frameNo);
+	if(hint != AccessHint::SEQUENTIAL_SCAN){
+		bufDescTable[frameNo].inRing = false;
+	}
+}
+
+bool BufMgr::pinUnlocked(BufPartition& part, const File* file, const PageId pageNo, FrameId& frameNo,
+                         const AccessHint hint){
+	// Other policies keep their bookkeeping under the mutex
+	if(policyType != ReplacementPolicyType::CLOCK ||
+	   !part.hashTable->find(file, pageNo, frameNo) || !bufStateTable->probe(frameNo)){
+		return false;
+	}
+	FrameId current;
+	if(!part.hashTable->find(file, pageNo, current) || current != frameNo){
+		bufStateTable->dropProbe(frameNo);
+		frameUnpinned(part, frameNo);
+		return false;
+	}
+	bufStateTable->keepProbe(frameNo);
+	countHit(part);
+	// What ClockPolicy::frameAccessed() does
+	bufStateTable->set(frameNo, FrameStates::REFBIT);
+	if(hint != AccessHint::SEQUENTIAL_SCAN){
+		bufDescTable[frameNo].inRing = false;
+	}
+	return true;
+}
+
+std::uint32_t BufMgr::scanRingSize(const BufPartition& part) const{
+	const std::uint32_t frames = scanRingFrames.load(std::memory_order_relaxed);
+	if(frames == 0){
+		return 0;
+	}
+	const std::uint32_t share = (frames + numPartitions - 1) / numPartitions;
+	return std::max<std::uint32_t>(1, std::min(share, part.numFrames / 4));
+}
+
+BufPartition& BufMgr::partitionOfFrame(const FrameId frameNo){
+	// The first numBufs % numPartitions partitions can hold one frame more than the others
+	const std::uint32_t small = numBufs / numPartitions;
+	const std::uint32_t large = numBufs % numPartitions;
+	if(frameNo < large * (small + 1)){
+		return partitions[frameNo / (small + 1)];
+	}
+	return partitions[large + (frameNo - large * (small + 1)) / small];
+}
+
+bool BufMgr::allocBuf(BufPartition& part, std::unique_lock<std::mutex>& guard, const File* file, const PageId pageNo,
+                      FrameId & frame, const bool mayFail){
+	const PageKey key = {file->id(), pageNo};
+	metrics.add(BufMetrics::VICTIM_SEARCHES);
+
+	// Pages of keep and evict-first classes in the partition
+	std::uint32_t kept = 0;
+	std::uint32_t evictFirst = 0;
+	if(!part.fileClasses.empty()){
+		// A class at its quota replaces one of its own pages
+		std::unordered_map<FileId, std::uint32_t>::const_iterator assigned = part.fileClasses.find(key.file);
+		if(assigned != part.fileClasses.end()){
+			const std::uint32_t classId = assigned->second;
+			std::unordered_map<std::uint32_t, BufferClass>::const_iterator def = part.classes.find(classId);
+			if(def != part.classes.end() && def->second.quota != 0){
+				const std::uint32_t active = std::max<std::uint32_t>(activeBufs, 1);
+				const std::uint32_t share = std::max<std::uint64_t>(1,
+					((std::uint64_t) def->second.quota * part.numFrames + active - 1) / active);
+				if(part.classFrames[classId] >= share &&
+				   findClassVictim(part, [classId](std::uint32_t c){ return c == classId; }, frame) &&
+				   bufStateTable->claim(frame)){
+					part.policy->frameTaken(frame);
+					evictFrame(part, frame);
+					return true;
+				}
 			}
 		}
-		// found unpinned page, restart count for checking buffer exceeded
-		else{
-			numPinnedPages=0;
+		for(std::unordered_map<std::uint32_t, std::uint32_t>::const_iterator c = part.classFrames.begin();
+		    c != part.classFrames.end(); ++c){
+			std::unordered_map<std::uint32_t, BufferClass>::const_iterator def = part.classes.find(c->first);
+			if(def != part.classes.end() && def->second.priority == BufferPriority::KEEP){
+				kept += c->second;
+			}else if(def != part.classes.end() && def->second.priority == BufferPriority::EVICT_FIRST){
+				evictFirst += c->second;
+			}
 		}
-	
-		// Exists a frame ready to use 
-		// Valid bit not set
-		if(bufDescTable[clockHand].valid == false){
-			bufDescTable[clockHand].Clear();
-			frame = clockHand;
-			return;
+	}
+
+	// A page of an evict-first class goes before the policy's other victims, and a page of a keep class only once no
+	// other page can go. The policy passes over the pages left alone without ageing them.
+	const FrameFilter notEvictFirst = [this, &part](FrameId f){
+		return priorityOf(part, bufDescTable[f].fileId) != BufferPriority::EVICT_FIRST;
+	};
+	const FrameFilter keep = [this, &part](FrameId f){
+		return priorityOf(part, bufDescTable[f].fileId) == BufferPriority::KEEP;
+	};
+	const auto pickFiltered = [&](){
+		return (evictFirst != 0 && part.policy->pickVictim(key, frame, &notEvictFirst)) ||
+		       (kept != 0 && part.policy->pickVictim(key, frame, &keep)) ||
+		       part.policy->pickVictim(key, frame, NULL);
+	};
+
+	std::chrono::steady_clock::time_point deadline;
+	bool waited = false;
+	// Takes the allocation off the waiters however the search ends
+	struct WaitRegistration {
+		std::atomic<std::uint32_t>* waiters;
+		~WaitRegistration(){
+			if(waiters != NULL){
+				waiters->fetch_sub(1);
+			}
+		}
+	} registration = {NULL};
+	// Throw exception if all buffer frames are pinned
+	while(!pickFiltered()){
+		if(mayFail){
+			return false;
+		}
+		// Frames the cleaner is writing back become available again shortly
+		bool cleaning = false;
+		for(FrameId i = part.firstFrame; i < part.firstFrame + part.numFrames && !cleaning; i++){
+			cleaning = bufStateTable->test(i, FrameStates::CLEANING);
 		}
-		// Valid bit is set
-		// If page is referenced recently, set refbit to false
-		else if(bufDescTable[clockHand].refbit == true){
-			bufDescTable[clockHand].refbit = false;
+		if(cleaning){
+			waitForIo(part, guard);
 			continue;
 		}
-		// If page is currently pinned
-		else if(bufDescTable[clockHand].pinCnt!=0){
+		// Otherwise waits, if allowed to, for a frame to be unpinned
+		if(!waited){
+			const unsigned waitMs = frameWaitMs.load(std::memory_order_relaxed);
+			if(waitMs == 0){
+				throw BufferExceededException();
+			}
+			waited = true;
+			deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(waitMs);
+			metrics.add(BufMetrics::FRAME_WAITS);
+			// Registers as waiting and searches once more before the first wait, so an unpin that takes no lock is
+			// either seen by that search or sees the registration and wakes the wait
+			part.frameWaiters.fetch_add(1);
+			registration.waiters = &part.frameWaiters;
+			std::atomic_thread_fence(std::memory_order_seq_cst);
 			continue;
+		}else if(std::chrono::steady_clock::now() >= deadline){
+			throw BufferExceededException();
 		}
-		// Found a location to allocate
-		else{
-			// If dirty bit is set, flush page to disk
-			if(bufDescTable[clockHand].dirty == true){
-				bufDescTable[clockHand].file -> writePage(bufPool[clockHand]);
-			}
-			// Remove the original page from BufDesc table 
-			hashTable->remove(bufDescTable[clockHand].file,bufDescTable[clockHand].pageNo);
-			bufDescTable[clockHand].Clear();
-			frame = clockHand;
-		
-			return;
+		const std::uint64_t start = BufMetrics::now();
+		part.ioDone.wait_until(guard, deadline);
+		metrics.add(BufMetrics::FRAME_WAIT_NANOS, BufMetrics::now() - start);
+	}
+	evictFrame(part, frame);
+	return true;
+}
+
+bool BufMgr::allocRingBuf(BufPartition& part, std::unique_lock<std::mutex>& guard, const File* file,
+                          const PageId pageNo, FrameId & frame, const bool mayFail){
+	const std::uint32_t size = scanRingSize(part);
+	if(size == 0){
+		return allocBuf(part, guard, file, pageNo, frame, mayFail);
+	}
+	// A ring that shrank drops the slots past its size
+	if(part.scanRing.size() > size){
+		for(std::size_t slot = size; slot < part.scanRing.size(); slot++){
+			bufDescTable[part.scanRing[slot]].inRing = false;
 		}
+		part.scanRing.resize(size);
 	}
-	
-	// Throw exception if all buffer frames are pinned
-	throw BufferExceededException();
+
+	if(part.scanRing.size() == size){
+		const std::size_t slot = part.scanRingNext % size;
+		const FrameId candidate = part.scanRing[slot];
+		// Reused in place unless someone else holds it or read it since, its page went away or the partition shrank
+		// past it
+		if(bufDescTable[candidate].inRing && candidate < part.firstFrame + part.numFrames &&
+		   bufStateTable->test(candidate, FrameStates::VALID) && bufStateTable->claim(candidate)){
+			metrics.add(BufMetrics::VICTIM_SEARCHES);
+			metrics.add(BufMetrics::RING_REUSES);
+			part.policy->frameTaken(candidate);
+			evictFrame(part, candidate);
+			part.scanRingNext = slot + 1;
+			frame = candidate;
+			bufDescTable[frame].inRing = true;
+			return true;
+		}
+	}
+
+	// The ring grows, or the slot takes a frame of the shared pool and the frame it had stays there. allocBuf() may
+	// wait for a frame, letting other scans change the ring meanwhile.
+	if(!allocBuf(part, guard, file, pageNo, frame, mayFail)){
+		return false;
+	}
+	if(part.scanRing.size() < size){
+		part.scanRing.push_back(frame);
+		part.scanRingNext = part.scanRing.size();
+	}else{
+		const std::size_t slot = part.scanRingNext % part.scanRing.size();
+		bufDescTable[part.scanRing[slot]].inRing = false;
+		part.scanRing[slot] = frame;
+		part.scanRingNext = slot + 1;
+	}
+	bufDescTable[frame].inRing = true;
+	return true;
+}
+
+void BufMgr::evictFrame(BufPartition& part, const FrameId frame){
+	// Evict the page currently held by the chosen frame; the caller claimed it
+	if(bufStateTable->test(frame, FrameStates::VALID)){
+		// If dirty bit is set, flush page to disk
+		metrics.add(BufMetrics::EVICTIONS);
+		if(bufStateTable->test(frame, FrameStates::DIRTY)){
+			try{
+				writeFrame(frame);
+			}catch(...){
+				// The page stays; the policy forgot the frame when it handed it out, so it takes it back
+				const BufDesc& desc = bufDescTable[frame];
+				const PageKey key = {desc.fileId, desc.pageNo};
+				part.policy->frameResident(frame, key);
+				bufStateTable->clear(frame, FrameStates::CLAIMED);
+				throw;
+			}
+			metrics.add(BufMetrics::DIRTY_EVICTIONS);
+			metrics.add(BufMetrics::DISK_WRITES);
+			// The cleaner is falling behind
+			if(cleanerRunning){
+				std::lock_guard<std::mutex> lock(cleanerMutex);
+				cleanerKick = true;
+				cleanerWake.notify_one();
+			}
+		}
+		// Remove the original page from BufDesc table 
+		unindexFrame(part, frame);
+	}
+	bufDescTable[frame].Clear();
+	bufStateTable->store(frame, 0);
+	// The frame may have been viewing a memory-mapped file
+	bufPool[frame].view(arena->frame(frame));
+}
+
+void BufMgr::readPage(File* file, const PageId pageNo, Page*& page, const AccessHint hint){
+	pinPage(file, pageNo, page, false, hint);
 }
 
-void BufMgr::readPage(File* file, const PageId pageNo, Page*& page){
+bool BufMgr::tryReadPage(File* file, const PageId pageNo, Page*& page){
+	return pinPage(file, pageNo, page, true, AccessHint::NORMAL);
+}
+
+bool BufMgr::pinPage(File* file, const PageId pageNo, Page*& page, const bool mayFail, const AccessHint hint){
+	// Attempts that give up leave no trace
+	if(!mayFail){
+		tracer.record(TraceRecord::READ, file, pageNo);
+	}
+	metrics.add(BufMetrics::ACCESSES);
+	BufPartition& part = partitionFor(file, pageNo);
 	FrameId frameNo;
-	try{
-		// If page in buffer pool 
-		hashTable->lookup(file,pageNo,frameNo);
-		bufDescTable[frameNo].refbit = true;
-		bufDescTable[frameNo].pinCnt++;
+	if(pinUnlocked(part, file, pageNo, frameNo, hint)){
+		if(mayFail){
+			tracer.record(TraceRecord::READ, file, pageNo);
+		}
 		page = &bufPool[frameNo];
-	}catch(HashNotFoundException& e){
+		return true;
+	}
+	std::unique_lock<std::mutex> guard(part.mutex);
+	// If page in buffer pool 
+	while(part.hashTable->find(file,pageNo,frameNo)){
+		bufStateTable->pin(frameNo);
+		// Waits for an asynchronous read of the page to finish
+		if(bufStateTable->test(frameNo, FrameStates::IO_PENDING)){
+			const std::uint64_t start = BufMetrics::now();
+			while(bufStateTable->test(frameNo, FrameStates::IO_PENDING)){
+				part.ioDone.wait(guard);
+			}
+			metrics.add(BufMetrics::PIN_WAITS);
+			metrics.add(BufMetrics::PIN_WAIT_NANOS, BufMetrics::now() - start);
+		}
+		if(bufStateTable->test(frameNo, FrameStates::VALID)){
+			frameHit(part, frameNo, hint);
+			if(mayFail){
+				tracer.record(TraceRecord::READ, file, pageNo);
+			}
+			page = &bufPool[frameNo];
+			return true;
+		}
+		// That read failed and the page is gone; read it ourselves
+		releaseFailedFrame(part, frameNo);
+	}
 
-		// If page not in buffer pool. Return pointer to frame containing the page
-		allocBuf(frameNo);
-		bufPool[frameNo] = file->readPage(pageNo);
-		hashTable->insert(file,pageNo,frameNo);
-		bufDescTable[frameNo].Set(file,pageNo);
-		page = &bufPool[frameNo];
+	// If page not in buffer pool. Return pointer to frame containing the page
+	metrics.add(BufMetrics::MISSES);
+	const std::uint64_t start = BufMetrics::now();
+	const bool allocated = hint == AccessHint::SEQUENTIAL_SCAN
+		? allocRingBuf(part, guard, file, pageNo, frameNo, mayFail)
+		: allocBuf(part, guard, file, pageNo, frameNo, mayFail);
+	if(!allocated){
+		return false;
+	}
+	if(mayFail){
+		tracer.record(TraceRecord::READ, file, pageNo);
+	}
+	try{
+		loadFrame(file, pageNo, frameNo);
+	}catch(...){
+		// The frame stays empty; hand it back to the policy
+		part.policy->frameFreed(frameNo);
+		frameReleased(part, frameNo);
+		throw;
+	}
+	setFrame(frameNo, file, pageNo, 0);
+	indexFrame(part, frameNo);
+	part.policy->frameLoaded(frameNo, PageKey{file->id(), pageNo});
+	if(!file->mapped()){
+		metrics.add(BufMetrics::DISK_READS);
 	}
+	metrics.recordMissLatency(BufMetrics::now() - start);
+	page = &bufPool[frameNo];
+	return true;
 }
 
-void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty){
-	// Unpins a page if it exists in the hash table
+PageHandle BufMgr::readPage(File* file, const PageId pageNo, const LatchMode mode){
+	Page* page;
+	readPage(file, pageNo, page);
+	PageHandle handle(this, pageNo, page - bufPool, page);
+	handle.latch(mode);
+	return handle;
+}
+
+void BufMgr::readPages(File* file, const std::vector<PageId>& pageNos, std::vector<Page*>& pages){
+	// What became of each requested page
+	enum Outcome { NONE, HIT, WAIT, MISS };
+	const std::size_t n = pageNos.size();
+	std::vector<Outcome> outcome(n, NONE);
+	std::vector<FrameId> frames(n);
+	std::vector<std::size_t> order;
+	std::vector<BufPartition*> parts;
+	groupByPartition(file, pageNos, order, parts);
+	pages.assign(n, NULL);
+	std::exception_ptr error;
+	metrics.add(BufMetrics::ACCESSES, n);
+	for(std::size_t i = 0; i < n; i++){
+		tracer.record(TraceRecord::READ, file, pageNos[i]);
+		if(pinUnlocked(*parts[i], file, pageNos[i], frames[i], AccessHint::NORMAL)){
+			outcome[i] = HIT;
+		}
+	}
+
+	// Pins the other buffered pages and reserves frames for the rest, one partition at a time. Pages already being
+	// read are waited for only once our own reads are done, so that two batches never wait for each other.
+	for(std::size_t o = 0; o < n && !error; ){
+		BufPartition& part = *parts[order[o]];
+		std::unique_lock<std::mutex> guard(part.mutex, std::defer_lock);
+		for(; o < n && parts[order[o]] == &part; o++){
+			const std::size_t i = order[o];
+			if(outcome[i] == HIT){
+				continue;
+			}
+			if(!guard.owns_lock()){
+				guard.lock();
+			}
+			FrameId& frameNo = frames[i];
+			if(part.hashTable->find(file,pageNos[i],frameNo)){
+				bufStateTable->pin(frameNo);
+				if(bufStateTable->test(frameNo, FrameStates::IO_PENDING)){
+					outcome[i] = WAIT;
+				}else{
+					frameHit(part, frameNo, AccessHint::NORMAL);
+					outcome[i] = HIT;
+				}
+				continue;
+			}
+			try{
+				allocBuf(part, guard, file, pageNos[i], frameNo);
+			}catch(...){
+				error = std::current_exception();
+				break;
+			}
+			setFrame(frameNo, file, pageNos[i], FrameStates::IO_PENDING);
+			indexFrame(part, frameNo);
+			part.policy->frameLoaded(frameNo, PageKey{file->id(), pageNos[i]});
+			metrics.add(BufMetrics::MISSES);
+			outcome[i] = MISS;
+		}
+	}
+
+	// Reads each run of consecutive missing pages with one transfer
+	std::vector<std::size_t> misses;
+	for(std::size_t i = 0; i < n; i++){
+		if(outcome[i] == MISS){
+			misses.push_back(i);
+		}
+	}
+	std::sort(misses.begin(), misses.end(), [&pageNos](std::size_t a, std::size_t b){
+		return pageNos[a] < pageNos[b];
+	});
+	std::vector<Page*> run;
+	for(std::size_t m = 0; m < misses.size(); ){
+		std::size_t end = m + 1;
+		while(end < misses.size() && pageNos[misses[end]] == pageNos[misses[end - 1]] + 1){
+			end++;
+		}
+		run.clear();
+		for(std::size_t r = m; r < end; r++){
+			run.push_back(&bufPool[frames[misses[r]]]);
+		}
+		std::exception_ptr runError;
+		const std::uint64_t start = BufMetrics::now();
+		try{
+			if(file->mapped()){
+				for(std::size_t r = m; r < end; r++){
+					loadFrame(file, pageNos[misses[r]], frames[misses[r]]);
+				}
+			}else{
+				file->readPagesInto(pageNos[misses[m]], run);
+				metrics.add(BufMetrics::DISK_READS, run.size());
+			}
+		}catch(...){
+			runError = std::current_exception();
+		}
+		// Every page of the run waited for the whole transfer
+		const std::uint64_t latency = BufMetrics::now() - start;
+		for(std::size_t r = m; r < end && !runError; r++){
+			metrics.recordMissLatency(latency);
+		}
+		for(std::size_t r = m; r < end; r++){
+			const std::size_t i = misses[r];
+			finishAsyncRead(*parts[i], frames[i], [](Page*, std::exception_ptr){}, runError);
+			outcome[i] = runError ? NONE : HIT;
+		}
+		if(runError && !error){
+			error = runError;
+		}
+		m = end;
+	}
+
+	// Collects the pages other readers were bringing in; if their read failed, reads the page ourselves
+	for(std::size_t i = 0; i < n; i++){
+		if(outcome[i] != WAIT){
+			continue;
+		}
+		BufPartition& part = *parts[i];
+		{
+			std::unique_lock<std::mutex> guard(part.mutex);
+			const std::uint64_t start = BufMetrics::now();
+			while(bufStateTable->test(frames[i], FrameStates::IO_PENDING)){
+				part.ioDone.wait(guard);
+			}
+			metrics.add(BufMetrics::PIN_WAITS);
+			metrics.add(BufMetrics::PIN_WAIT_NANOS, BufMetrics::now() - start);
+			if(bufStateTable->test(frames[i], FrameStates::VALID)){
+				frameHit(part, frames[i], AccessHint::NORMAL);
+				outcome[i] = HIT;
+				continue;
+			}
+			releaseFailedFrame(part, frames[i]);
+			outcome[i] = NONE;
+		}
+		if(!error){
+			try{
+				// Pinned wherever the page is read into; frames[i] no longer holds it
+				readPage(file, pageNos[i], pages[i]);
+				outcome[i] = HIT;
+			}catch(...){
+				error = std::current_exception();
+			}
+		}
+	}
+
+	if(error){
+		for(std::size_t i = 0; i < n; i++){
+			if(outcome[i] == HIT){
+				unPinPage(file, pageNos[i], false);
+			}
+		}
+		pages.assign(n, NULL);
+		std::rethrow_exception(error);
+	}
+	for(std::size_t i = 0; i < n; i++){
+		if(pages[i] == NULL){
+			pages[i] = &bufPool[frames[i]];
+		}
+	}
+}
+
+void BufMgr::readPageAsync(File* file, const PageId pageNo, PageReadCallback callback, const AccessHint hint){
+	// Pages of mapped files are ready as soon as the frame views them
+	if(file->mapped()){
+		Page* page;
+		try{
+			readPage(file, pageNo, page, hint);
+		}catch(...){
+			if(callback){
+				callback(NULL, std::current_exception());
+			}
+			return;
+		}
+		if(callback){
+			callback(page, std::exception_ptr());
+		}else{
+			unPinPage(file, pageNo, false);
+		}
+		return;
+	}
+
+	tracer.record(TraceRecord::READ, file, pageNo);
+	metrics.add(BufMetrics::ACCESSES);
+	BufPartition& part = partitionFor(file, pageNo);
+	FrameId frameNo;
+	// Nothing left to bring in
+	if(!callback && part.hashTable->find(file,pageNo,frameNo)){
+		metrics.add(BufMetrics::HITS);
+		tracer.record(TraceRecord::UNPIN, file, pageNo);
+		return;
+	}
+	if(callback && pinUnlocked(part, file, pageNo, frameNo, hint)){
+		callback(&bufPool[frameNo], std::exception_ptr());
+		return;
+	}
+	std::unique_lock<std::mutex> guard(part.mutex);
+	// If page in buffer pool
+	if(part.hashTable->find(file,pageNo,frameNo)){
+		// Nothing left to bring in
+		if(!callback){
+			metrics.add(BufMetrics::HITS);
+			tracer.record(TraceRecord::UNPIN, file, pageNo);
+			return;
+		}
+		bufStateTable->pin(frameNo);
+		if(bufStateTable->test(frameNo, FrameStates::IO_PENDING)){
+			// Called back together with the reader that started the transfer
+			metrics.add(BufMetrics::PIN_WAITS);
+			part.ioWaiters[frameNo].push_back(callback);
+			return;
+		}
+		frameHit(part, frameNo, hint);
+		guard.unlock();
+		callback(&bufPool[frameNo], std::exception_ptr());
+		return;
+	}
+
+	// Reserves a frame for the page; readers arriving meanwhile find it pinned and pending
+	metrics.add(BufMetrics::MISSES);
+	const std::uint64_t start = BufMetrics::now();
 	try{
+		if(hint == AccessHint::SEQUENTIAL_SCAN){
+			allocRingBuf(part, guard, file, pageNo, frameNo, false);
+		}else{
+			allocBuf(part, guard, file, pageNo, frameNo);
+		}
+	}catch(...){
+		guard.unlock();
+		if(callback){
+			callback(NULL, std::current_exception());
+		}
+		return;
+	}
+	setFrame(frameNo, file, pageNo, FrameStates::IO_PENDING);
+	indexFrame(part, frameNo);
+	part.policy->frameLoaded(frameNo, PageKey{file->id(), pageNo});
+	guard.unlock();
+
+	BufPartition* partPtr = &part;
+	engine().read(file, pageNo, bufPool[frameNo], [this, partPtr, frameNo, callback, start](std::exception_ptr error){
+		if(!error){
+			metrics.add(BufMetrics::DISK_READS);
+			metrics.recordMissLatency(BufMetrics::now() - start);
+		}
+		finishAsyncRead(*partPtr, frameNo, callback, error);
+	});
+}
+
+std::future<Page*> BufMgr::readPageAsync(File* file, const PageId pageNo){
+	std::shared_ptr<std::promise<Page*> > promise(new std::promise<Page*>);
+	std::future<Page*> result = promise->get_future();
+	readPageAsync(file, pageNo, [promise](Page* page, std::exception_ptr error){
+		if(error){
+			promise->set_exception(error);
+		}else{
+			promise->set_value(page);
+		}
+	});
+	return result;
+}
+
+void BufMgr::prefetchPage(File* file, const PageId pageNo, const AccessHint hint){
+	// Mapped pages need no frame until they are read; have the kernel page them in
+	if(file->mapped()){
+		file->advise(AccessPattern::WILLNEED, pageNo, 1);
+		return;
+	}
+	{
+		BufPartition& part = partitionFor(file, pageNo);
+		std::lock_guard<std::mutex> guard(part.mutex);
 		FrameId frameNo;
-		hashTable->lookup(file,pageNo,frameNo);
-		// If the page is not pinned throw exception
-		if(bufDescTable[frameNo].pinCnt==0){
-			throw PageNotPinnedException(file->filename(), pageNo, frameNo);
+		// Already buffered or being read
+		if(part.hashTable->find(file,pageNo,frameNo)){
+			return;
 		}
-		// Decreases the pincount
-		if(bufDescTable[frameNo].pinCnt>0){
-			bufDescTable[frameNo].pinCnt--;
+	}
+	// The read pins the frame only until the page is in
+	readPageAsync(file, pageNo, PageReadCallback(), hint);
+}
+
+IoEngine& BufMgr::engine(){
+	std::call_once(ioEngineOnce, [this](){
+		ioEngine = IoEngine::create();
+	});
+	return *ioEngine;
+}
+
+void BufMgr::finishAsyncRead(BufPartition& part, const FrameId frameNo, const PageReadCallback& callback,
+                             std::exception_ptr error){
+	std::vector<PageReadCallback> waiters;
+	{
+		std::lock_guard<std::mutex> guard(part.mutex);
+		// A page that could not be read is never ready for a hit to pin
+		bufStateTable->clear(frameNo, error ? FrameStates::IO_PENDING | FrameStates::VALID : FrameStates::IO_PENDING);
+		std::unordered_map<FrameId, std::vector<PageReadCallback> >::iterator it = part.ioWaiters.find(frameNo);
+		if(it != part.ioWaiters.end()){
+			waiters.swap(it->second);
+			part.ioWaiters.erase(it);
 		}
-		// Sets dirty bit to true if told to by boolean argument
-		if(dirty==true){
-			bufDescTable[frameNo].dirty=true;
+		if(error){
+			// Nobody gets the page: drop it, and the pins of the callers that are told so
+			unindexFrame(part, frameNo);
+			for(std::size_t w = 0; w <= waiters.size(); w++){
+				releaseFailedFrame(part, frameNo);
+			}
+		}else if(!callback){
+			// A read that only brings the page in gives up its pin along with the pending state, so that whoever
+			// waited for the read (e.g. flushFile()) never finds the page pinned by it
+			tracer.record(TraceRecord::UNPIN, bufDescTable[frameNo].file, bufDescTable[frameNo].pageNo);
+			bufStateTable->unpin(frameNo);
+		}
+	}
+	part.ioDone.notify_all();
+
+	Page* page = error ? NULL : &bufPool[frameNo];
+	if(callback){
+		callback(page, error);
+	}
+	for(std::size_t w = 0; w < waiters.size(); w++){
+		waiters[w](page, error);
+	}
+}
+
+void BufMgr::releaseFailedFrame(BufPartition& part, const FrameId frameNo){
+	bufStateTable->unpin(frameNo);
+	if(bufStateTable->pinCount(frameNo) == 0){
+		bufDescTable[frameNo].Clear();
+		bufStateTable->store(frameNo, 0);
+		part.policy->frameFreed(frameNo);
+		frameReleased(part, frameNo);
+	}
+}
+
+void BufMgr::frameReleased(BufPartition& part, const FrameId frameNo){
+	if(part.frameWaiters.load(std::memory_order_relaxed) != 0 && bufStateTable->pinCount(frameNo) == 0){
+		part.ioDone.notify_all();
+	}
+}
+
+void BufMgr::frameUnpinned(BufPartition& part, const FrameId frameNo){
+	// Pairs with the fence of allocBuf() after an allocation registers as waiting
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(part.frameWaiters.load(std::memory_order_relaxed) != 0 && bufStateTable->pinCount(frameNo) == 0){
+		// Taking the mutex makes sure the allocation is waiting before it is woken
+		std::lock_guard<std::mutex> guard(part.mutex);
+		part.ioDone.notify_all();
+	}
+}
+
+void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty){
+	tracer.record(dirty ? TraceRecord::UNPIN_DIRTY : TraceRecord::UNPIN, file, pageNo);
+	BufPartition& part = partitionFor(file, pageNo);
+	std::lock_guard<std::mutex> guard(part.mutex);
+	// Unpins a page if it exists in the hash table
+	FrameId frameNo;
+	if(!part.hashTable->find(file,pageNo,frameNo)){
+		return;
+	}
+	// Decreases the pincount, setting the dirty bit in the same step if told to by boolean argument; if the page
+	// is not pinned throw exception
+	if(!bufStateTable->unpin(frameNo, dirty ? FrameStates::DIRTY : 0)){
+		throw PageNotPinnedException(file->filename(), pageNo, frameNo);
+	}
+	frameReleased(part, frameNo);
+}
+
+void BufMgr::unPinFrame(const FrameId frameNo, const bool dirty){
+	// The pin held keeps the page in the frame, so its description can be read without the partition mutex
+	tracer.record(dirty ? TraceRecord::UNPIN_DIRTY : TraceRecord::UNPIN, bufDescTable[frameNo].file,
+	              bufDescTable[frameNo].pageNo);
+	if(!bufStateTable->unpin(frameNo, dirty ? FrameStates::DIRTY : 0)){
+		throw PageNotPinnedException(bufDescTable[frameNo].file->filename(), bufDescTable[frameNo].pageNo, frameNo);
+	}
+	frameUnpinned(partitionOfFrame(frameNo), frameNo);
+}
+
+void BufMgr::repinFrame(const FrameId frameNo){
+	tracer.record(TraceRecord::READ, bufDescTable[frameNo].file, bufDescTable[frameNo].pageNo);
+	metrics.add(BufMetrics::ACCESSES);
+	countHit(partitionOfFrame(frameNo));
+	bufStateTable->pin(frameNo);
+}
+
+void BufMgr::unPinPages(File* file, const std::vector<PageId>& pageNos, const bool dirty){
+	std::vector<std::size_t> order;
+	std::vector<BufPartition*> parts;
+	groupByPartition(file, pageNos, order, parts);
+	for(std::size_t i = 0; i < pageNos.size(); i++){
+		tracer.record(dirty ? TraceRecord::UNPIN_DIRTY : TraceRecord::UNPIN, file, pageNos[i]);
+	}
+	std::exception_ptr error;
+	for(std::size_t o = 0; o < order.size(); ){
+		BufPartition& part = *parts[order[o]];
+		std::lock_guard<std::mutex> guard(part.mutex);
+		for(; o < order.size() && parts[order[o]] == &part; o++){
+			const PageId pageNo = pageNos[order[o]];
+			FrameId frameNo;
+			if(!part.hashTable->find(file,pageNo,frameNo)){
+				continue;
+			}
+			if(!bufStateTable->unpin(frameNo, dirty ? FrameStates::DIRTY : 0) && !error){
+				error = std::make_exception_ptr(PageNotPinnedException(file->filename(), pageNo, frameNo));
+			}
+			frameReleased(part, frameNo);
 		}
-	}catch(HashNotFoundException& e){
+	}
+	if(error){
+		std::rethrow_exception(error);
 	}
 }
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page){
 	// allocate an empty page 
 	Page np = file->allocatePage();
-	// obtain a buffer pool frame 
-	FrameId frameNo;
-	allocBuf(frameNo);
 	// return page number of newly allocated page via pageNo 
 	pageNo = np.page_number();
-	bufPool[frameNo] = np;
+	tracer.record(TraceRecord::ALLOC, file, pageNo);
+	metrics.add(BufMetrics::ACCESSES);
+	metrics.add(BufMetrics::DISK_READS);
+	// obtain a buffer pool frame in the partition owning the new page
+	BufPartition& part = partitionFor(file, pageNo);
+	std::unique_lock<std::mutex> guard(part.mutex);
+	FrameId frameNo;
+	allocBuf(part, guard, file, pageNo, frameNo);
+	if(file->mapped()){
+		bufPool[frameNo].view(file->mapPage(pageNo));
+	}else{
+		bufPool[frameNo] = np;
+	}
 	// insert into hashTable 
-	hashTable->insert(file,pageNo,frameNo);
-	bufDescTable[frameNo].Set(file,pageNo);
+	setFrame(frameNo, file, pageNo, 0);
+	indexFrame(part, frameNo);
+	part.policy->frameLoaded(frameNo, PageKey{file->id(), pageNo});
 	
 	// pointer to the buffer frame 
 	page = &bufPool[frameNo];
 }
 
+PageHandle BufMgr::allocPage(File* file){
+	PageId pageNo;
+	Page* page;
+	allocPage(file, pageNo, page);
+	return PageHandle(this, pageNo, page - bufPool, page);
+}
+
+void BufMgr::allocPages(File* file, const std::size_t count, std::vector<PageId>& pageNos, std::vector<Page*>& pages){
+	// allocate the empty pages in one go
+	std::vector<Page> newPages = file->allocatePages(count);
+	metrics.add(BufMetrics::ACCESSES, count);
+	metrics.add(BufMetrics::DISK_READS, count);
+	pageNos.resize(count);
+	for(std::size_t i = 0; i < count; i++){
+		pageNos[i] = newPages[i].page_number();
+		tracer.record(TraceRecord::ALLOC, file, pageNos[i]);
+	}
+	pages.assign(count, NULL);
+
+	std::vector<std::size_t> order;
+	std::vector<BufPartition*> parts;
+	groupByPartition(file, pageNos, order, parts);
+	std::exception_ptr error;
+	for(std::size_t o = 0; o < count && !error; ){
+		BufPartition& part = *parts[order[o]];
+		std::unique_lock<std::mutex> guard(part.mutex);
+		for(; o < count && parts[order[o]] == &part; o++){
+			const std::size_t i = order[o];
+			FrameId frameNo;
+			try{
+				allocBuf(part, guard, file, pageNos[i], frameNo);
+			}catch(...){
+				error = std::current_exception();
+				break;
+			}
+			if(file->mapped()){
+				bufPool[frameNo].view(file->mapPage(pageNos[i]));
+			}else{
+				bufPool[frameNo] = newPages[i];
+			}
+			setFrame(frameNo, file, pageNos[i], 0);
+			indexFrame(part, frameNo);
+			part.policy->frameLoaded(frameNo, PageKey{file->id(), pageNos[i]});
+			pages[i] = &bufPool[frameNo];
+		}
+	}
+
+	if(error){
+		for(std::size_t i = 0; i < count; i++){
+			if(pages[i] != NULL){
+				unPinPage(file, pageNos[i], false);
+			}
+		}
+		pages.assign(count, NULL);
+		std::rethrow_exception(error);
+	}
+}
+
 void BufMgr::flushFile(const File* file){
-	// Searches thorugh all the frames
-	for(FrameId i=0;i<numBufs;i++){
-		// If invalid
-		if(bufDescTable[i].valid==false){
-			throw BadBufferException(bufDescTable[i].frameNo, bufDescTable[i].dirty, 
-			bufDescTable[i].valid, bufDescTable[i].refbit);
-		}
-		// If pinned
-		else if(bufDescTable[i].pinCnt>0){
-			throw PagePinnedException(file->filename(), bufDescTable[i].pageNo, 
-			bufDescTable[i].frameNo);
-		}
-		// If still dirty
-		else if(bufDescTable[i].dirty == true){
-			bufDescTable[i].file->writePage(bufPool[bufDescTable[i].frameNo]);
-			bufDescTable[i].dirty = false;
-		}
-		// Removes page
-		hashTable->remove(bufDescTable[i].file,bufDescTable[i].pageNo);
-		bufDescTable[i].Clear();
+	// Visits only the frames of the file, one partition at a time
+	for(std::uint32_t p=0;p<numPartitions;p++){
+		BufPartition& part = partitions[p];
+		std::unique_lock<std::mutex> guard(part.mutex);
+		std::unordered_map<FileId, FrameId>::iterator head = part.fileFrames.find(file->id());
+		while(head != part.fileFrames.end()){
+			const FrameId i = head->second;
+			// Lets cleaner writes and reads in flight (e.g. prefetches) finish; the list may change while waiting, so
+			// start again from its head
+			const std::uint32_t state = bufStateTable->load(i);
+			if(state & (FrameStates::CLEANING | FrameStates::IO_PENDING)){
+				waitForIo(part, guard);
+				head = part.fileFrames.find(file->id());
+				continue;
+			}
+			// If invalid
+			if((state & FrameStates::VALID) == 0){
+				throw BadBufferException(bufDescTable[i].frameNo, (state & FrameStates::DIRTY) != 0, 
+				false, (state & FrameStates::REFBIT) != 0);
+			}
+			// Hits pin the page without the mutex until the frame is claimed
+			bufStateTable->claimPinned(i);
+			const std::uint32_t claimed = bufStateTable->load(i);
+			// If pinned
+			if(claimed & FrameStates::PIN_MASK){
+				bufStateTable->clear(i, FrameStates::CLAIMED);
+				throw PagePinnedException(file->filename(), bufDescTable[i].pageNo, 
+				bufDescTable[i].frameNo);
+			}
+			// If still dirty
+			else if(claimed & FrameStates::DIRTY){
+				try{
+					writeFrame(i);
+				}catch(...){
+					bufStateTable->clear(i, FrameStates::CLAIMED);
+					throw;
+				}
+				metrics.add(BufMetrics::DISK_WRITES);
+			}
+			// Removes page
+			unindexFrame(part, i);
+			bufDescTable[i].Clear();
+			bufStateTable->store(i, 0);
+			part.policy->frameFreed(i);
+			frameReleased(part, i);
+			head = part.fileFrames.find(file->id());
+		}
+	}
+	// Makes the written pages durable
+	file->sync();
+}
+
+Lsn BufMgr::checkpoint(){
+	// Every page changed by a record appended before this point is dirty now, being written by the cleaner or still
+	// pinned by the thread that changed it
+	const Lsn redoLsn = (wal != NULL) ? wal->appendedLsn() : 0;
+
+	// Collects those pages, one partition at a time, keyed like the hash table so that sorting puts each file's pages
+	// in page number order. A frame still being read into holds no changes yet, and no page until the read ends.
+	std::vector<std::pair<std::uint64_t, FrameId> > dirty;
+	for(std::uint32_t p = 0; p < numPartitions; p++){
+		BufPartition& part = partitions[p];
+		std::lock_guard<std::mutex> guard(part.mutex);
+		for(FrameId i = part.firstFrame; i < part.firstFrame + part.numFrames; i++){
+			const std::uint32_t state = bufStateTable->load(i);
+			if((state & FrameStates::VALID) && !(state & FrameStates::IO_PENDING) &&
+			   (state & (FrameStates::DIRTY | FrameStates::CLEANING | FrameStates::PIN_MASK))){
+				const BufDesc& desc = bufDescTable[i];
+				dirty.push_back(std::make_pair(((std::uint64_t) desc.fileId << 32) | desc.pageNo, i));
+			}
+		}
 	}
+	std::sort(dirty.begin(), dirty.end());
+
+	// Writes them back like the cleaner does, holding only the partition of the page and only while marking it, so
+	// the pool keeps serving requests meanwhile
+	std::vector<File*> files;
+	for(std::size_t d = 0; d < dirty.size(); d++){
+		const FrameId frameNo = dirty[d].second;
+		BufPartition& part = partitionOfFrame(frameNo);
+		std::unique_lock<std::mutex> guard(part.mutex);
+		waitForCleaning(part, guard, frameNo);
+		const BufDesc& desc = bufDescTable[frameNo];
+		// A page evicted meanwhile was written back on its way out, and a clean, unpinned one by the cleaner; a frame
+		// taken meanwhile by a read of the same page still being read holds nothing to write
+		const std::uint32_t state = bufStateTable->load(frameNo);
+		if(!(state & FrameStates::VALID) || (state & FrameStates::IO_PENDING) ||
+		   !(state & (FrameStates::DIRTY | FrameStates::PIN_MASK)) ||
+		   (((std::uint64_t) desc.fileId << 32) | desc.pageNo) != dirty[d].first){
+			continue;
+		}
+		bufStateTable->set(frameNo, FrameStates::CLEANING);
+		bufStateTable->clear(frameNo, FrameStates::DIRTY);
+		File* file = desc.file;
+		guard.unlock();
+		// A pinned page may be changing: the shared latch waits for a writer holding it to finish. CLEANING keeps the
+		// page in its frame meanwhile, and the partition mutex is not held, as the writer may need it.
+		FrameLatch& latch = latchTable[frameNo];
+		latch.lockShared();
+		try{
+			writeFrame(frameNo);
+		}catch(...){
+			latch.unlockShared();
+			guard.lock();
+			bufStateTable->clear(frameNo, FrameStates::CLEANING);
+			bufStateTable->set(frameNo, FrameStates::DIRTY);
+			guard.unlock();
+			part.ioDone.notify_all();
+			throw;
+		}
+		latch.unlockShared();
+		guard.lock();
+		bufStateTable->clear(frameNo, FrameStates::CLEANING);
+		metrics.add(BufMetrics::DISK_WRITES);
+		guard.unlock();
+		part.ioDone.notify_all();
+		if(files.empty() || files.back()->id() != file->id()){
+			files.push_back(file);
+		}
+	}
+
+	// The pages must be durable before the log says recovery need not look further back
+	for(std::size_t f = 0; f < files.size(); f++){
+		files[f]->sync();
+	}
+	return (wal != NULL) ? wal->checkpoint(redoLsn) : 0;
 }
 
 void BufMgr::disposePage(File* file, const PageId PageNo){
-	try{
-			FrameId frameNo;
-			//  Make sure that page to be deleted is allocated in buffer pool 
-			hashTable->lookup(file,PageNo,frameNo);
-			// frame is freed 
-			bufDescTable[frameNo].Clear();
-			// corresponding entry from hash table is also removed 
-			hashTable->remove(file,PageNo);
-			// delete from file 
-			file->deletePage(PageNo);
-	}catch(HashNotFoundException& e){
+	tracer.record(TraceRecord::DISPOSE, file, PageNo);
+	BufPartition& part = partitionFor(file, PageNo);
+	std::unique_lock<std::mutex> guard(part.mutex);
+	FrameId frameNo;
+	// If the page is allocated in the buffer pool
+	if(part.hashTable->find(file,PageNo,frameNo)){
+		waitForCleaning(part, guard, frameNo);
+		// Hits pin the page without the mutex until the frame is claimed
+		bufStateTable->claimPinned(frameNo);
+		// corresponding entry from hash table is removed and the frame is freed
+		unindexFrame(part, frameNo);
+		bufDescTable[frameNo].Clear();
+		bufStateTable->store(frameNo, 0);
+		part.policy->frameFreed(frameNo);
+		frameReleased(part, frameNo);
+	}
+	// delete from file 
+	file->deletePage(PageNo);
+}
+
+void BufMgr::setBufferClass(std::uint32_t classId, BufferPriority priority, std::uint32_t quota){
+	if(classId == 0){
+		return;
+	}
+	const BufferClass def = {priority, quota};
+	for(std::uint32_t p = 0; p < numPartitions; p++){
+		std::lock_guard<std::mutex> guard(partitions[p].mutex);
+		partitions[p].classes[classId] = def;
+	}
+}
+
+void BufMgr::assignBufferClass(const File* file, std::uint32_t classId){
+	const FileId fileId = file->id();
+	for(std::uint32_t p = 0; p < numPartitions; p++){
+		BufPartition& part = partitions[p];
+		std::lock_guard<std::mutex> guard(part.mutex);
+		const std::uint32_t frames = framesOfFile(part, fileId);
+		std::unordered_map<FileId, std::uint32_t>::iterator assigned = part.fileClasses.find(fileId);
+		if(assigned != part.fileClasses.end()){
+			part.classFrames[assigned->second] -= frames;
+			part.fileClasses.erase(assigned);
+		}
+		if(classId != 0){
+			part.fileClasses[fileId] = classId;
+			part.classFrames[classId] += frames;
+		}
+	}
+}
+
+std::uint32_t BufMgr::bufferClassFrames(std::uint32_t classId){
+	std::uint32_t frames = 0;
+	for(std::uint32_t p = 0; p < numPartitions; p++){
+		std::lock_guard<std::mutex> guard(partitions[p].mutex);
+		std::unordered_map<std::uint32_t, std::uint32_t>::const_iterator c = partitions[p].classFrames.find(classId);
+		if(c != partitions[p].classFrames.end()){
+			frames += c->second;
+		}
+	}
+	return frames;
+}
+
+BufferPriority BufMgr::priorityOf(const BufPartition& part, const FileId fileId) const{
+	std::unordered_map<FileId, std::uint32_t>::const_iterator assigned = part.fileClasses.find(fileId);
+	if(assigned == part.fileClasses.end()){
+		return BufferPriority::NORMAL;
+	}
+	std::unordered_map<std::uint32_t, BufferClass>::const_iterator def = part.classes.find(assigned->second);
+	return def == part.classes.end() ? BufferPriority::NORMAL : def->second.priority;
+}
+
+bool BufMgr::findClassVictim(const BufPartition& part, const std::function<bool(std::uint32_t)>& match,
+                             FrameId& frame) const{
+	for(std::unordered_map<FileId, std::uint32_t>::const_iterator assigned = part.fileClasses.begin();
+	    assigned != part.fileClasses.end(); ++assigned){
+		if(!match(assigned->second)){
+			continue;
+		}
+		std::unordered_map<FileId, FrameId>::const_iterator head = part.fileFrames.find(assigned->first);
+		if(head == part.fileFrames.end()){
+			continue;
+		}
+		// Prefers a page the clock has not seen referenced since it last passed
+		FrameId fallback = BufDesc::NO_FRAME;
+		for(FrameId f = head->second; f != BufDesc::NO_FRAME; f = bufDescTable[f].nextInFile){
+			const std::uint32_t state = bufStateTable->load(f);
+			if((state & FrameStates::VALID) && !(state & FrameStates::UNEVICTABLE)){
+				if(!(state & FrameStates::REFBIT)){
+					frame = f;
+					return true;
+				}
+				if(fallback == BufDesc::NO_FRAME){
+					fallback = f;
+				}
+			}
+		}
+		if(fallback != BufDesc::NO_FRAME){
+			frame = fallback;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::uint32_t BufMgr::framesOfFile(const BufPartition& part, const FileId fileId) const{
+	std::uint32_t frames = 0;
+	std::unordered_map<FileId, FrameId>::const_iterator head = part.fileFrames.find(fileId);
+	if(head != part.fileFrames.end()){
+		for(FrameId f = head->second; f != BufDesc::NO_FRAME; f = bufDescTable[f].nextInFile){
+			frames++;
+		}
+	}
+	return frames;
+}
+
+void BufMgr::groupByPartition(const File* file, const std::vector<PageId>& pageNos, std::vector<std::size_t>& order,
+                              std::vector<BufPartition*>& parts){
+	parts.resize(pageNos.size());
+	order.resize(pageNos.size());
+	for(std::size_t i = 0; i < pageNos.size(); i++){
+		parts[i] = &partitionFor(file, pageNos[i]);
+		order[i] = i;
+	}
+	if(numPartitions > 1){
+		std::stable_sort(order.begin(), order.end(), [&parts](std::size_t a, std::size_t b){
+			return parts[a] < parts[b];
+		});
+	}
+}
+
+void BufMgr::indexFrame(BufPartition& part, const FrameId frameNo){
+	BufDesc& desc = bufDescTable[frameNo];
+	part.hashTable->insert(desc.file, desc.pageNo, frameNo);
+	// Pushes the frame onto the front of its file's list
+	std::pair<std::unordered_map<FileId, FrameId>::iterator, bool> head =
+		part.fileFrames.insert(std::make_pair(desc.fileId, frameNo));
+	desc.prevInFile = BufDesc::NO_FRAME;
+	desc.nextInFile = head.second ? BufDesc::NO_FRAME : head.first->second;
+	if(!head.second){
+		bufDescTable[head.first->second].prevInFile = frameNo;
+		head.first->second = frameNo;
+	}
+	if(!part.fileClasses.empty()){
+		std::unordered_map<FileId, std::uint32_t>::const_iterator assigned = part.fileClasses.find(desc.fileId);
+		if(assigned != part.fileClasses.end()){
+			part.classFrames[assigned->second]++;
+		}
+	}
+}
+
+void BufMgr::unindexFrame(BufPartition& part, const FrameId frameNo){
+	BufDesc& desc = bufDescTable[frameNo];
+	part.hashTable->remove(desc.file, desc.pageNo);
+	if(desc.nextInFile != BufDesc::NO_FRAME){
+		bufDescTable[desc.nextInFile].prevInFile = desc.prevInFile;
+	}
+	if(desc.prevInFile != BufDesc::NO_FRAME){
+		bufDescTable[desc.prevInFile].nextInFile = desc.nextInFile;
+	}else if(desc.nextInFile != BufDesc::NO_FRAME){
+		part.fileFrames[desc.fileId] = desc.nextInFile;
+	}else{
+		part.fileFrames.erase(desc.fileId);
+	}
+	if(!part.fileClasses.empty()){
+		std::unordered_map<FileId, std::uint32_t>::const_iterator assigned = part.fileClasses.find(desc.fileId);
+		if(assigned != part.fileClasses.end()){
+			part.classFrames[assigned->second]--;
+		}
+	}
+}
+
+void BufMgr::writeFrame(const FrameId frameNo){
+	// Write-ahead rule: the log records of the page are durable before the page is
+	if(wal != NULL){
+		wal->flushTo(bufPool[frameNo].lsn());
+	}
+	bufDescTable[frameNo].file->writePage(bufPool[frameNo]);
+}
+
+void BufMgr::loadFrame(File* file, const PageId pageNo, const FrameId frameNo){
+	if(file->mapped()){
+		bufPool[frameNo].view(file->mapPage(pageNo));
+	}else{
+		file->readPageInto(pageNo, bufPool[frameNo]);
+	}
+}
+
+void BufMgr::setFrame(const FrameId frameNo, File* file, const PageId pageNo, const std::uint32_t flags){
+	bufDescTable[frameNo].Set(file,pageNo);
+	// Valid, referenced and pinned once by the caller
+	bufStateTable->store(frameNo, FrameStates::VALID | FrameStates::REFBIT | 1 | flags);
+}
+
+void BufMgr::waitForCleaning(BufPartition& part, std::unique_lock<std::mutex>& guard, const FrameId frameNo){
+	while(bufStateTable->test(frameNo, FrameStates::CLEANING)){
+		waitForIo(part, guard);
+	}
+}
+
+void BufMgr::waitForIo(BufPartition& part, std::unique_lock<std::mutex>& guard){
+	const std::uint64_t start = BufMetrics::now();
+	part.ioDone.wait(guard);
+	metrics.add(BufMetrics::PIN_WAITS);
+	metrics.add(BufMetrics::PIN_WAIT_NANOS, BufMetrics::now() - start);
+}
+
+void BufMgr::startCleaner(double lowWatermark, double highWatermark, unsigned intervalMs){
+	std::lock_guard<std::mutex> lock(cleanerMutex);
+	if(cleanerRunning){
+		return;
+	}
+	cleanerLow = std::min(std::max(lowWatermark, 0.0), 1.0);
+	cleanerHigh = std::min(std::max(highWatermark, cleanerLow), 1.0);
+	cleanerInterval = intervalMs;
+	cleanerStop = false;
+	cleanerKick = false;
+	cleanerRunning = true;
+	cleaner = std::thread(&BufMgr::runCleaner, this);
+}
+
+void BufMgr::stopCleaner(){
+	{
+		std::lock_guard<std::mutex> lock(cleanerMutex);
+		if(!cleanerRunning){
+			return;
+		}
+		cleanerStop = true;
+	}
+	cleanerWake.notify_one();
+	cleaner.join();
+	cleanerRunning = false;
+}
+
+void BufMgr::runCleaner(){
+	std::unique_lock<std::mutex> lock(cleanerMutex);
+	while(!cleanerStop){
+		cleanerWake.wait_for(lock, std::chrono::milliseconds(cleanerInterval));
+		if(cleanerStop){
+			break;
+		}
+		const bool urgent = cleanerKick;
+		cleanerKick = false;
+		lock.unlock();
+		cleanPartitions(urgent);
+		lock.lock();
+	}
+}
+
+void BufMgr::cleanPartitions(bool urgent){
+	std::mutex doneMutex;
+	std::condition_variable allDone;
+	std::uint32_t outstanding = 0;
+	std::vector<FrameId> order;
+	std::vector<std::pair<FrameId, File*> > batch;
+	// Copies being written; they outlive the writes, which are all waited for below
+	std::vector<std::unique_ptr<Page> > images;
+
+	for(std::uint32_t p = 0; p < numPartitions; p++){
+		BufPartition& part = partitions[p];
+		batch.clear();
+		{
+			std::lock_guard<std::mutex> guard(part.mutex);
+			std::uint32_t dirty = 0;
+			for(FrameId i = part.firstFrame; i < part.firstFrame + part.numFrames; i++){
+				const std::uint32_t state = bufStateTable->load(i);
+				if((state & FrameStates::VALID) && (state & FrameStates::DIRTY)){
+					dirty++;
+				}
+			}
+			const std::uint32_t low = (std::uint32_t) (cleanerLow * part.numFrames);
+			if(dirty <= low || (!urgent && dirty < cleanerHigh * part.numFrames)){
+				continue;
+			}
+			// Writes back the frames the policy would evict first; they are marked clean now so that a page dirtied
+			// again while it is being written stays dirty
+			std::uint32_t excess = dirty - low;
+			part.policy->victimOrder(order);
+			for(std::size_t o = 0; o < order.size() && excess > 0; o++){
+				const FrameId frameNo = order[o];
+				const std::uint32_t state = bufStateTable->load(frameNo);
+				if((state & FrameStates::VALID) && (state & FrameStates::DIRTY) && !(state & FrameStates::UNEVICTABLE)){
+					bufStateTable->set(frameNo, FrameStates::CLEANING);
+					bufStateTable->clear(frameNo, FrameStates::DIRTY);
+					batch.push_back(std::make_pair(frameNo, bufDescTable[frameNo].file));
+					excess--;
+				}
+			}
+		}
+
+		// CLEANING keeps the pages in their frames, but they may be pinned and changed again meanwhile, so each is
+		// copied under its shared latch and the copy is written. A page a writer holds is left dirty for the next
+		// round rather than waited for: the writer may be waiting for one of the frames of the batch.
+		Lsn newest = 0;
+		std::size_t kept = 0;
+		for(std::size_t b = 0; b < batch.size(); b++){
+			const FrameId frameNo = batch[b].first;
+			FrameLatch& latch = latchTable[frameNo];
+			if(!latch.tryLockShared()){
+				{
+					std::lock_guard<std::mutex> guard(part.mutex);
+					bufStateTable->clear(frameNo, FrameStates::CLEANING);
+					bufStateTable->set(frameNo, FrameStates::DIRTY);
+				}
+				part.ioDone.notify_all();
+				continue;
+			}
+			images.push_back(std::unique_ptr<Page>(new Page(bufPool[frameNo])));
+			latch.unlockShared();
+			newest = std::max(newest, images.back()->lsn());
+			batch[kept++] = std::make_pair(frameNo, batch[b].second);
+		}
+		batch.resize(kept);
+		const std::size_t firstImage = images.size() - kept;
+
+		{
+			std::lock_guard<std::mutex> lock(doneMutex);
+			outstanding += batch.size();
+		}
+		// The log must cover the copies before any of them reaches the disk
+		if(wal != NULL && !batch.empty()){
+			wal->flushTo(newest);
+		}
+		BufPartition* partPtr = &part;
+		for(std::size_t b = 0; b < batch.size(); b++){
+			const FrameId frameNo = batch[b].first;
+			engine().write(batch[b].second, *images[firstImage + b],
+			               [this, partPtr, frameNo, &doneMutex, &allDone, &outstanding](std::exception_ptr error){
+				{
+					std::lock_guard<std::mutex> guard(partPtr->mutex);
+					bufStateTable->clear(frameNo, FrameStates::CLEANING);
+					if(error){
+						// Left for the next round or for eviction to write
+						bufStateTable->set(frameNo, FrameStates::DIRTY);
+					}else{
+						metrics.add(BufMetrics::CLEANER_WRITES);
+						metrics.add(BufMetrics::DISK_WRITES);
+					}
+				}
+				partPtr->ioDone.notify_all();
+				std::lock_guard<std::mutex> lock(doneMutex);
+				if(--outstanding == 0){
+					allDone.notify_one();
+				}
+			});
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(doneMutex);
+	while(outstanding > 0){
+		allDone.wait(lock);
+	}
+}
+
+namespace {
+
+/**
+ * Identifies a file written by BufMgr::saveResidentPages().
+ */
+const char WARM_UP_MAGIC[8] = {'B', 'D', 'B', 'W', 'A', 'R', 'M', '\0'};
+
+/**
+ * Version of the format of that file.
+ */
+const std::uint32_t WARM_UP_VERSION = 1;
+
+}
+
+void BufMgr::saveResidentPages(const std::string& path){
+	// Ranks the pages of each partition from the end its policy would evict last; pinned pages and pages referenced
+	// since the policy last looked go ahead of all others
+	struct Resident{
+		std::uint64_t rank;
+		std::uint32_t file;
+		PageId pageNo;
+	};
+	std::vector<Resident> resident;
+	std::vector<std::string> names;
+	std::unordered_map<FileId, std::uint32_t> fileIndex;
+	std::vector<FrameId> order;
+	for(std::uint32_t p = 0; p < numPartitions; p++){
+		BufPartition& part = partitions[p];
+		std::lock_guard<std::mutex> guard(part.mutex);
+		part.policy->victimOrder(order);
+		for(std::size_t o = order.size(); o-- > 0; ){
+			const FrameId frameNo = order[o];
+			const std::uint32_t state = bufStateTable->load(frameNo);
+			if(!(state & FrameStates::VALID) || (state & FrameStates::IO_PENDING)){
+				continue;
+			}
+			const BufDesc& desc = bufDescTable[frameNo];
+			std::unordered_map<FileId, std::uint32_t>::iterator index = fileIndex.find(desc.fileId);
+			if(index == fileIndex.end()){
+				index = fileIndex.insert(std::make_pair(desc.fileId, (std::uint32_t) names.size())).first;
+				names.push_back(desc.file->filename());
+			}
+			const bool hot = (state & (FrameStates::PIN_MASK | FrameStates::REFBIT)) != 0;
+			const Resident page = {((hot ? 0ULL : 1ULL) << 32) | (order.size() - 1 - o), index->second, desc.pageNo};
+			resident.push_back(page);
+		}
+	}
+	// Partitions take turns, so the hottest pages of every one of them come first
+	std::stable_sort(resident.begin(), resident.end(), [](const Resident& a, const Resident& b){
+		return a.rank < b.rank;
+	});
+
+	std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+	out.write(WARM_UP_MAGIC, sizeof(WARM_UP_MAGIC));
+	out.write(reinterpret_cast<const char*>(&WARM_UP_VERSION), sizeof(WARM_UP_VERSION));
+	const std::uint32_t numFiles = names.size();
+	out.write(reinterpret_cast<const char*>(&numFiles), sizeof(numFiles));
+	for(std::size_t f = 0; f < names.size(); f++){
+		const std::uint32_t length = names[f].size();
+		out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		out.write(names[f].data(), length);
+	}
+	const std::uint64_t numPages = resident.size();
+	out.write(reinterpret_cast<const char*>(&numPages), sizeof(numPages));
+	for(std::size_t r = 0; r < resident.size(); r++){
+		out.write(reinterpret_cast<const char*>(&resident[r].file), sizeof(resident[r].file));
+		out.write(reinterpret_cast<const char*>(&resident[r].pageNo), sizeof(resident[r].pageNo));
+	}
+	out.flush();
+	if(!out){
+		throw FileIOException(path, "write resident pages", errno);
+	}
+}
+
+void BufMgr::startWarmUp(const std::string& path, const std::vector<File*>& files){
+	warmerStop = true;
+	waitForWarmUp();
+
+	std::ifstream in(path.c_str(), std::ios::binary);
+	if(!in){
+		throw FileIOException(path, "open resident pages", errno);
+	}
+	char magic[sizeof(WARM_UP_MAGIC)];
+	std::uint32_t version = 0;
+	in.read(magic, sizeof(magic));
+	in.read(reinterpret_cast<char*>(&version), sizeof(version));
+	if(!in || std::memcmp(magic, WARM_UP_MAGIC, sizeof(magic)) != 0 || version != WARM_UP_VERSION){
+		throw FileIOException(path, "read resident pages", EINVAL);
+	}
+
+	// Each listed file is matched with the open file of that name, if any
+	std::uint32_t numFiles = 0;
+	in.read(reinterpret_cast<char*>(&numFiles), sizeof(numFiles));
+	std::vector<File*> listed;
+	for(std::uint32_t f = 0; f < numFiles && in; f++){
+		std::uint32_t length = 0;
+		in.read(reinterpret_cast<char*>(&length), sizeof(length));
+		std::string name(length, '\0');
+		in.read(&name[0], length);
+		File* match = NULL;
+		for(std::size_t o = 0; o < files.size() && match == NULL; o++){
+			if(files[o]->filename() == name){
+				match = files[o];
+			}
+		}
+		listed.push_back(match);
+	}
+	std::uint64_t numPages = 0;
+	in.read(reinterpret_cast<char*>(&numPages), sizeof(numPages));
+	std::vector<std::pair<File*, PageId> > pages;
+	for(std::uint64_t r = 0; r < numPages && in && pages.size() < numFrames(); r++){
+		std::uint32_t file = 0;
+		PageId pageNo = 0;
+		in.read(reinterpret_cast<char*>(&file), sizeof(file));
+		in.read(reinterpret_cast<char*>(&pageNo), sizeof(pageNo));
+		if(in && file < listed.size() && listed[file] != NULL){
+			pages.push_back(std::make_pair(listed[file], pageNo));
+		}
+	}
+	if(!in){
+		throw FileIOException(path, "read resident pages", EINVAL);
+	}
+
+	warmerStop = false;
+	warmedPages = 0;
+	warmer = std::thread(&BufMgr::runWarmUp, this, std::move(pages));
+}
+
+std::size_t BufMgr::waitForWarmUp(){
+	if(warmer.joinable()){
+		warmer.join();
+	}
+	return warmedPages;
+}
+
+void BufMgr::runWarmUp(std::vector<std::pair<File*, PageId> > pages){
+	std::vector<std::pair<File*, PageId> > batch;
+	std::vector<PageId> pageNos;
+	std::vector<Page*> pinned;
+	for(std::size_t start = 0; start < pages.size() && !warmerStop; start += WARM_UP_BATCH){
+		batch.assign(pages.begin() + start, pages.begin() + std::min(pages.size(), start + WARM_UP_BATCH));
+		std::sort(batch.begin(), batch.end(), [](const std::pair<File*, PageId>& a, const std::pair<File*, PageId>& b){
+			return a.first->id() != b.first->id() ? a.first->id() < b.first->id() : a.second < b.second;
+		});
+		for(std::size_t b = 0; b < batch.size(); ){
+			File* file = batch[b].first;
+			pageNos.clear();
+			for(; b < batch.size() && batch[b].first == file; b++){
+				pageNos.push_back(batch[b].second);
+			}
+			try{
+				readPages(file, pageNos, pinned);
+				unPinPages(file, pageNos, false);
+				warmedPages += pageNos.size();
+			}catch(const BadgerDbException&){
+				// A page no longer exists, or the frames ran out; the pages that can still be read are read one by one
+				for(std::size_t i = 0; i < pageNos.size(); i++){
+					try{
+						Page* page;
+						readPage(file, pageNos[i], page);
+						unPinPage(file, pageNos[i], false);
+						warmedPages++;
+					}catch(const BadgerDbException&){
+					}
+				}
+			}
+		}
 	}
 }
 
@@ -223,16 +1656,122 @@ void BufMgr::printSelf(void) {
 	BufDesc* tmpbuf;
 	int validFrames = 0;
   
-	for (std::uint32_t i = 0; i < numBufs; i++) {
+	for (std::uint32_t p = 0; p < numPartitions; p++) {
+		std::lock_guard<std::mutex> guard(partitions[p].mutex);
+		for (FrameId i = partitions[p].firstFrame; i < partitions[p].firstFrame + partitions[p].numFrames; i++) {
   		tmpbuf = &(bufDescTable[i]);
-		std::cout << "FrameNo:" << i << " ";
-		tmpbuf->Print();
+			std::cout << "FrameNo:" << i << " ";
+			const std::uint32_t state = bufStateTable->load(i);
+			tmpbuf->Print(state);
 
-  	if (tmpbuf->valid == true) {
-   	 	validFrames++;
-	}
+  		if (state & FrameStates::VALID) {
+   	 		validFrames++;
+			}
+		}
   }
 
 	std::cout << "Total Number of Valid Frames:" << validFrames << "\n";
 }
+
+std::uint32_t BufMgr::resize(std::uint32_t frames){
+	std::lock_guard<std::mutex> serial(resizeMutex);
+	frames = std::min(std::max(frames, numPartitions), numBufs);
+	// One partition at a time; the others keep serving requests meanwhile
+	for (std::uint32_t p = 0; p < numPartitions; p++) {
+		const std::uint32_t target = frames / numPartitions + (p < frames % numPartitions ? 1 : 0);
+		BufPartition& part = partitions[p];
+		std::unique_lock<std::mutex> guard(part.mutex);
+		const std::uint32_t before = part.numFrames;
+		if (target > part.numFrames) {
+			part.numFrames = target;
+		} else if (target < part.numFrames) {
+			shrinkPartition(part, guard, target);
+		}
+		if (part.numFrames != before) {
+			rebuildPolicy(part);
+			activeBufs += part.numFrames - before;
+		}
+	}
+	return activeBufs;
+}
+
+void BufMgr::shrinkPartition(BufPartition& part, std::unique_lock<std::mutex>& guard, const std::uint32_t target){
+	// Lets the cleaner finish with the frames to give up; the policy must not hand any frame out once eviction starts,
+	// so the lock is kept from then on
+	for (FrameId i = part.firstFrame + target; i < part.firstFrame + part.numFrames; i++) {
+		if (bufStateTable->test(i, FrameStates::CLEANING)) {
+			waitForIo(part, guard);
+			i = part.firstFrame + target - 1;
+		}
+	}
+
+	// Frames are given up from the end of the partition; a pinned frame, and every frame before it, stays
+	std::uint32_t keep = part.numFrames;
+	while (keep > target && bufStateTable->claim(part.firstFrame + keep - 1)) {
+		keep--;
+	}
+	for (FrameId i = part.firstFrame + keep; i < part.firstFrame + part.numFrames; i++) {
+		if (bufStateTable->test(i, FrameStates::VALID) && bufStateTable->test(i, FrameStates::DIRTY)) {
+			writeFrame(i);
+			bufStateTable->clear(i, FrameStates::DIRTY);
+			metrics.add(BufMetrics::DISK_WRITES);
+		}
+	}
+	for (FrameId i = part.firstFrame + keep; i < part.firstFrame + part.numFrames; i++) {
+		if (bufStateTable->test(i, FrameStates::VALID)) {
+			unindexFrame(part, i);
+			metrics.add(BufMetrics::EVICTIONS);
+		}
+		bufDescTable[i].Clear();
+		bufStateTable->store(i, 0);
+		bufPool[i].view(arena->frame(i));
+	}
+	arena->release(part.firstFrame + keep, part.numFrames - keep);
+	part.numFrames = keep;
+}
+
+void BufMgr::rebuildPolicy(BufPartition& part){
+	ReplacementPolicy* fresh = ReplacementPolicy::create(policyType, bufStateTable, part.firstFrame, part.numFrames);
+	// The resident pages move over in the order the old policy would have evicted them; the rest of the frames stay
+	// free. Reference bits and other frame state are left as they are.
+	std::vector<FrameId> order;
+	part.policy->victimOrder(order);
+	std::vector<bool> moved(part.numFrames, false);
+	for (std::size_t n = 0; n < order.size(); n++) {
+		const FrameId i = order[n];
+		if (i >= part.firstFrame && i < part.firstFrame + part.numFrames && !moved[i - part.firstFrame] &&
+		    bufStateTable->test(i, FrameStates::VALID)) {
+			fresh->frameResident(i, PageKey{bufDescTable[i].fileId, bufDescTable[i].pageNo});
+			moved[i - part.firstFrame] = true;
+		}
+	}
+	for (FrameId i = part.firstFrame; i < part.firstFrame + part.numFrames; i++) {
+		if (!moved[i - part.firstFrame] && bufStateTable->test(i, FrameStates::VALID)) {
+			fresh->frameResident(i, PageKey{bufDescTable[i].fileId, bufDescTable[i].pageNo});
+		}
+	}
+	part.scanOffset += part.policy->framesScanned();
+	delete part.policy;
+	part.policy = fresh;
+}
+
+BufStats BufMgr::getBufStats() {
+	BufStats stats;
+	metrics.snapshot(stats);
+	for (std::uint32_t p = 0; p < numPartitions; p++) {
+		std::lock_guard<std::mutex> guard(partitions[p].mutex);
+		stats.clockRevolutions += (double) ((std::int64_t) partitions[p].policy->framesScanned() +
+			partitions[p].scanOffset) / partitions[p].numFrames;
+	}
+	return stats;
+}
+
+void BufMgr::clearBufStats() {
+	metrics.clear();
+	for (std::uint32_t p = 0; p < numPartitions; p++) {
+		std::lock_guard<std::mutex> guard(partitions[p].mutex);
+		partitions[p].scanOffset = -(std::int64_t) partitions[p].policy->framesScanned();
+	}
+}
+
 }
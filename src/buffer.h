@@ -7,8 +7,22 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include "file.h"
 #include "bufHashTbl.h"
+#include "buf_metrics.h"
+#include "buf_trace.h"
+#include "frame_latch.h"
 
 namespace badgerdb {
 
@@ -18,196 +32,1167 @@ namespace badgerdb {
 class BufMgr;
 
 /**
-* @brief Class for maintaining information about buffer pool frames
+* forward declaration of PageHandle class
+*/
+class PageHandle;
+
+/**
+* forward declaration of ReplacementPolicy class
+*/
+class ReplacementPolicy;
+
+/**
+* forward declaration of FrameArena class
+*/
+class FrameArena;
+
+/**
+* forward declaration of IoEngine class
+*/
+class IoEngine;
+
+/**
+* forward declaration of LogManager class
+*/
+class LogManager;
+
+/**
+* @brief Callback receiving the result of BufMgr::readPageAsync(): the pinned page on success, or NULL together with
+* the exception that made the read fail
+*/
+typedef std::function<void(Page*, std::exception_ptr)> PageReadCallback;
+
+/**
+* @brief Page replacement policies the buffer manager can be constructed with
+*/
+enum class ReplacementPolicyType {
+	/**
+   * Single reference bit per frame swept by a clock hand (the default)
+	 */
+	CLOCK,
+
+	/**
+   * Evicts the page whose second most recent access is oldest (LRU-2)
+	 */
+	LRU_K,
+
+	/**
+   * Filters pages referenced once through a FIFO before they can enter the main LRU queue
+	 */
+	TWO_Q,
+
+	/**
+   * Adaptive replacement cache balancing recency against frequency
+	 */
+	ARC,
+
+	/**
+   * Clock approximation of LIRS using hot/cold pages and test periods
+	 */
+	CLOCK_PRO
+};
+
+/**
+* @brief How the pages of a buffer class compete for frames with the pages of others; see BufMgr::setBufferClass()
+*/
+enum class BufferPriority {
+	/**
+   * Left to the replacement policy (the default)
+	 */
+	NORMAL,
+
+	/**
+   * Kept while pages of other classes can be evicted instead, e.g. for index files
+	 */
+	KEEP,
+
+	/**
+   * Evicted before the pages of any other class, e.g. for temporary files
+	 */
+	EVICT_FIRST
+};
+
+/**
+* @brief How a read intends to use the page it asks for; see BufMgr::readPage()
+*/
+enum class AccessHint {
+	/**
+   * The page may be used again; it competes for frames of the shared pool (the default)
+	 */
+	NORMAL,
+
+	/**
+   * Part of a scan that will not come back to the page, e.g. of a whole table; pages read in go to a small ring of
+   * frames that the scan reuses in place (see BufMgr::setScanRing())
+	 */
+	SEQUENTIAL_SCAN
+};
+
+/**
+* @brief Priority and frame quota shared by the files of one buffer class
+*/
+struct BufferClass
+{
+	/**
+   * Priority of the pages of the class when frames are needed
+	 */
+  BufferPriority priority;
+
+	/**
+   * Most frames the files of the class may hold together; 0 for no limit
+	 */
+  std::uint32_t quota;
+};
+
+/**
+* @brief Packed per-frame state words of the buffer pool, one 32-bit atomic per frame
+*
+* The pin count occupies the low bits of a frame's word and the flags below the high ones, so the clock sweep reads
+* everything it needs about a frame from one word, sixteen frames per cache line, and pinning or unpinning a frame is
+* a single atomic operation. Words only change with the partition mutex of their frame held, except where noted.
+*
+* Buffer hits pin frames without the mutex (probe()), so a frame found unpinned under the mutex may not stay so. A page
+* is only taken out of its frame once the frame is claimed (claim(), claimPinned()), which no probe gets past.
+*/
+class FrameStates {
+ public:
+	/**
+   * Bits of a state word holding the pin count
+	 */
+  static const std::uint32_t PIN_MASK = 0x00FFFFFF;
+
+	/**
+   * The frame holds a page
+	 */
+  static const std::uint32_t VALID = 1u << 24;
+
+	/**
+   * The page has been modified since it was read or written back
+	 */
+  static const std::uint32_t DIRTY = 1u << 25;
+
+	/**
+   * The frame has been referenced recently (the clock reference bit)
+	 */
+  static const std::uint32_t REFBIT = 1u << 26;
+
+	/**
+   * An asynchronous read into this frame is in flight; the page must not be used until it is cleared
+	 */
+  static const std::uint32_t IO_PENDING = 1u << 27;
+
+	/**
+   * The page cleaner is writing this frame back; the frame cannot be evicted meanwhile
+	 */
+  static const std::uint32_t CLEANING = 1u << 28;
+
+	/**
+   * The frame is being emptied, or its page removed; lookups without the partition mutex no longer pin it
+	 */
+  static const std::uint32_t CLAIMED = 1u << 29;
+
+	/**
+   * Pins taken by buffer hits without the partition mutex before they know the frame holds their page (probes); a hit
+   * finding the most there can be takes the mutex instead
+	 */
+  static const std::uint32_t PROBE_MASK = 3u << 30;
+
+	/**
+   * One probe
+	 */
+  static const std::uint32_t PROBE_ONE = 1u << 30;
+
+	/**
+   * Bits that keep a frame from being evicted
+	 */
+  static const std::uint32_t UNEVICTABLE = PIN_MASK | IO_PENDING | CLEANING | CLAIMED | PROBE_MASK;
+
+	/**
+   * Constructs the state words of the given number of frames, all free.
+   *
+   * @param num	Number of frames
+	 */
+  explicit FrameStates(std::uint32_t num)
+		: words(new std::atomic<std::uint32_t>[num]) {
+		for (std::uint32_t i = 0; i < num; i++) {
+			words[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+  ~FrameStates() { delete[] words; }
+
+	/**
+   * Returns the state word of a frame.
+	 */
+  std::uint32_t load(FrameId frame) const { return words[frame].load(std::memory_order_acquire); }
+
+	/**
+   * Replaces the state word of a frame.
+	 */
+  void store(FrameId frame, std::uint32_t word) { words[frame].store(word, std::memory_order_release); }
+
+	/**
+   * Returns true if any of the given flags is set for a frame.
+	 */
+  bool test(FrameId frame, std::uint32_t flags) const { return (load(frame) & flags) != 0; }
+
+	/**
+   * Sets the given flags of a frame.
+	 */
+  void set(FrameId frame, std::uint32_t flags) { words[frame].fetch_or(flags, std::memory_order_acq_rel); }
+
+	/**
+   * Clears the given flags of a frame.
+	 */
+  void clear(FrameId frame, std::uint32_t flags) { words[frame].fetch_and(~flags, std::memory_order_acq_rel); }
+
+	/**
+   * Returns the number of pins on a frame.
+	 */
+  std::uint32_t pinCount(FrameId frame) const { return load(frame) & PIN_MASK; }
+
+	/**
+   * Adds a pin to a frame.
+	 */
+  void pin(FrameId frame) { words[frame].fetch_add(1, std::memory_order_acq_rel); }
+
+	/**
+   * Drops a pin from a frame and sets the given flags in the same step.
+   *
+   * @param frame	Frame to unpin
+   * @param flags	Flags to set, e.g. DIRTY
+   * @return			False, leaving the word alone, if the frame was not pinned
+	 */
+  bool unpin(FrameId frame, std::uint32_t flags = 0) {
+		std::uint32_t word = words[frame].load(std::memory_order_relaxed);
+		do {
+			if ((word & PIN_MASK) == 0) {
+				return false;
+			}
+		} while (!words[frame].compare_exchange_weak(word, (word - 1) | flags, std::memory_order_acq_rel));
+		return true;
+	}
+
+	/**
+   * Adds a probe to a frame that holds a page ready for use: valid, not being read into and not claimed. Any thread
+   * may call this.
+   *
+   * @param frame	Frame to probe
+   * @return			False, leaving the word alone, if the frame is in no such state or has as many probes as it can hold
+	 */
+  bool probe(FrameId frame) {
+		std::uint32_t word = words[frame].load(std::memory_order_relaxed);
+		do {
+			if ((word & (VALID | IO_PENDING | CLAIMED)) != VALID || (word & PROBE_MASK) == PROBE_MASK) {
+				return false;
+			}
+		} while (!words[frame].compare_exchange_weak(word, word + PROBE_ONE, std::memory_order_acq_rel));
+		return true;
+	}
+
+	/**
+   * Turns a probe into a pin.
+	 */
+  void keepProbe(FrameId frame) { words[frame].fetch_add(1u - PROBE_ONE, std::memory_order_acq_rel); }
+
+	/**
+   * Drops a probe.
+	 */
+  void dropProbe(FrameId frame) { words[frame].fetch_sub(PROBE_ONE, std::memory_order_acq_rel); }
+
+	/**
+   * Claims a frame to be emptied: sets CLAIMED in the same step that finds nothing keeping the frame from being
+   * evicted, so that no probe can pin it afterwards. Free frames are claimed too.
+   *
+   * @param frame	Frame to claim
+   * @return			False, leaving the word alone, if the frame cannot be evicted
+	 */
+  bool claim(FrameId frame) {
+		std::uint32_t word = words[frame].load(std::memory_order_relaxed);
+		do {
+			if (word & UNEVICTABLE) {
+				return false;
+			}
+		} while (!words[frame].compare_exchange_weak(word, word | CLAIMED, std::memory_order_acq_rel));
+		return true;
+	}
+
+	/**
+   * Claims a frame whatever its pins, e.g. to remove its page: sets CLAIMED and waits for the probes already taken to
+   * be dropped or turned into pins, which takes no longer than a hash table lookup. The pin count is stable then.
+   *
+   * @param frame	Frame to claim
+	 */
+  void claimPinned(FrameId frame) {
+		words[frame].fetch_or(CLAIMED, std::memory_order_acq_rel);
+		while (words[frame].load(std::memory_order_acquire) & PROBE_MASK) {
+			std::this_thread::yield();
+		}
+	}
+
+	/**
+   * Returns the address of the state word of a frame, for scanning many words at once.
+	 */
+  const std::atomic<std::uint32_t>* data(FrameId frame) const { return &words[frame]; }
+
+ private:
+  FrameStates(const FrameStates&);
+  FrameStates& operator=(const FrameStates&);
+
+	/**
+   * State word of every frame
+	 */
+  std::atomic<std::uint32_t>* words;
+};
+
+/**
+* @brief Class for maintaining which page a buffer pool frame holds
+*
+* Only the rarely changing identity of the frame lives here; its pin count and flags are in FrameStates.
 */
 class BufDesc {
 
-	friend class BufMgr;
+	friend class BufMgr;
+
+ private:
+	/**
+   * Marks the end of a list of frames
+	 */
+  static const FrameId NO_FRAME = 0xFFFFFFFF;
+
+	/**
+   * Pointer to file to which corresponding frame is assigned
+	 */
+  File* file;
+
+	/**
+   * Identifier of that file (File::id()); together with pageNo the key of the page in the hash table and the policy
+	 */
+  FileId fileId;
+
+	/**
+   * Page within file to which corresponding frame is assigned
+	 */
+  PageId pageNo;
+
+	/**
+   * Frame number of the frame, in the buffer pool, being used
+	 */
+  FrameId	frameNo;
+
+	/**
+   * Neighbours in the list of frames of the partition holding pages of the same file; maintained by BufMgr while
+   * the frame is in the hash table
+	 */
+  FrameId prevInFile;
+  FrameId nextInFile;
+
+	/**
+   * True while the frame is in the scan ring of its partition (see BufPartition::scanRing): brought in by a scan and
+   * not read since by anyone else
+	 */
+  std::atomic<bool> inRing;
+
+	/**
+   * Initialize buffer frame for a new user
+	 */
+  void Clear()
+	{
+		file = NULL;
+		fileId = 0;
+		pageNo = Page::INVALID_NUMBER;
+		inRing = false;
+  };
+
+	/**
+	 * Set values of member variables corresponding to assignment of frame to a page in the file. Called when a frame 
+	 * in buffer pool is allocated to any page in the file through readPage() or allocPage()
+	 *
+	 * @param filePtr	File object
+	 * @param pageNum	Page number in the file
+	 */
+  void Set(File* filePtr, PageId pageNum)
+	{ 
+		file = filePtr;
+		fileId = filePtr->id();
+    pageNo = pageNum;
+  }
+
+	/**
+	 * Prints the frame together with its state word.
+	 *
+	 * @param state	State word of the frame (see FrameStates)
+	 */
+  void Print(std::uint32_t state)
+	{
+		if(file != NULL)
+		{
+			std::cout << "file:" << file->filename() << " ";
+			std::cout << "pageNo:" << pageNo << " ";
+		}
+		else
+			std::cout << "file:NULL ";
+
+		std::cout << "valid:" << ((state & FrameStates::VALID) != 0) << " ";
+		std::cout << "pinCnt:" << (state & FrameStates::PIN_MASK) << " ";
+		std::cout << "dirty:" << ((state & FrameStates::DIRTY) != 0) << " ";
+		std::cout << "refbit:" << ((state & FrameStates::REFBIT) != 0) << " ";
+		std::cout << "ioPending:" << ((state & FrameStates::IO_PENDING) != 0) << " ";
+		std::cout << "cleaning:" << ((state & FrameStates::CLEANING) != 0) << "\n";
+  }
+
+	/**
+   * Constructor of BufDesc class 
+	 */
+  BufDesc()
+	{
+  	Clear();
+  }
+};
+
+
+/**
+* @brief Statistics of buffer usage, as a snapshot taken by BufMgr::getBufStats()
+*/
+struct BufStats
+{
+	/**
+   * Total number of accesses to buffer pool
+	 */
+  std::uint64_t accesses;
+
+	/**
+   * Accesses that found the page in the buffer pool
+	 */
+  std::uint64_t hits;
+
+	/**
+   * Accesses that had to bring the page in
+	 */
+  std::uint64_t misses;
+
+	/**
+   * Number of pages read from disk (including allocs)
+	 */
+  std::uint64_t diskreads;
+
+	/**
+   * Number of pages written back to disk
+	 */
+  std::uint64_t diskwrites;
+
+	/**
+   * Valid pages evicted to make room for others
+	 */
+  std::uint64_t evictions;
+
+	/**
+   * Evicted pages that were dirty and had to be written first
+	 */
+  std::uint64_t dirtyEvictions;
+
+	/**
+   * Pages written back by the page cleaner
+	 */
+  std::uint64_t cleanerWrites;
+
+	/**
+   * Number of times a replacement policy was asked for a frame
+	 */
+  std::uint64_t victimSearches;
+
+	/**
+   * Full sweeps over their partitions made by clock hands while searching; frames examined divided by partition size
+	 */
+  double clockRevolutions;
+
+	/**
+   * Pins that had to wait for a read or write of the frame in flight
+	 */
+  std::uint64_t pinWaits;
+
+	/**
+   * Total time spent in those waits, in nanoseconds
+	 */
+  std::uint64_t pinWaitNanos;
+
+	/**
+   * Hits on frames placed on another NUMA node than the one the calling thread ran on; only counted by a buffer pool
+   * with NUMA placement
+	 */
+  std::uint64_t remoteHits;
+
+	/**
+   * Allocations that found every frame of their partition pinned and waited for one (see BufMgr::setFrameWait())
+	 */
+  std::uint64_t frameWaits;
+
+	/**
+   * Total time spent in those waits, in nanoseconds
+	 */
+  std::uint64_t frameWaitNanos;
+
+	/**
+   * Misses of scans (AccessHint::SEQUENTIAL_SCAN) that reused a frame of their scan ring in place
+	 */
+  std::uint64_t ringReuses;
+
+	/**
+   * Histogram of miss latencies: missLatency[0] counts misses served in under 1us, missLatency[i] those that took
+   * [2^(i-1), 2^i) us; the last bucket also counts slower ones
+	 */
+  std::uint64_t missLatency[BufMetrics::LATENCY_BUCKETS];
+
+	/**
+   * Share of accesses that were hits; 0 if there were none
+	 */
+  double hitRatio() const
+  {
+		return accesses == 0 ? 0.0 : (double) hits / accesses;
+  }
+
+	/**
+   * Clock revolutions per victim search; values near or above 1 mean nearly every frame is pinned or hot (thrashing)
+	 */
+  double revolutionsPerAllocation() const
+  {
+		return victimSearches == 0 ? 0.0 : clockRevolutions / victimSearches;
+  }
+
+	/**
+   * Clear all values 
+	 */
+  void clear()
+  {
+		accesses = hits = misses = diskreads = diskwrites = 0;
+		evictions = dirtyEvictions = cleanerWrites = victimSearches = 0;
+		clockRevolutions = 0;
+		pinWaits = pinWaitNanos = remoteHits = frameWaits = frameWaitNanos = ringReuses = 0;
+		for (unsigned b = 0; b < BufMetrics::LATENCY_BUCKETS; b++) {
+			missLatency[b] = 0;
+		}
+  }
+      
+	/**
+   * Constructor of BufStats class 
+	 */
+  BufStats()
+  {
+		clear();
+  }
+};
+
+
+/**
+* @brief Independently locked slice of the buffer pool
+*
+* Every (File, page) pair maps to exactly one partition. A partition owns a contiguous range of frames together with
+* its own replacement policy and hash table, so requests that land in different partitions never contend with each other.
+*/
+struct BufPartition
+{
+	/**
+   * Protects the frames, replacement policy and hash table of this partition
+	 */
+  std::mutex mutex;
+
+	/**
+   * First frame of the buffer pool owned by this partition
+	 */
+  FrameId firstFrame;
+
+	/**
+   * Number of frames in use by this partition, [firstFrame, firstFrame + numFrames)
+	 */
+  std::uint32_t numFrames;
+
+	/**
+   * Number of frames the partition can grow to; it owns the frames [firstFrame, firstFrame + capacity)
+	 */
+  std::uint32_t capacity;
+
+	/**
+   * Replacement policy choosing victims among the frames of this partition
+	 */
+  ReplacementPolicy *policy;
+
+	/**
+   * Hash table mapping (File, page) to frame for the pages cached in this partition
+	 */
+  BufHashTbl *hashTable;
+
+	/**
+   * Signalled whenever an asynchronous read into, or a cleaner write from, a frame of this partition finishes, and
+   * while allocations wait for a frame, whenever one is unpinned or freed
+	 */
+  std::condition_variable ioDone;
+
+	/**
+   * Number of allocations waiting for a frame of this partition to be unpinned. Changed under the mutex, but read
+   * without it by unpins that take no lock
+	 */
+  std::atomic<std::uint32_t> frameWaiters{0};
+
+	/**
+   * Callbacks of readPageAsync() calls that found their page already being read, by frame
+	 */
+  std::unordered_map<FrameId, std::vector<PageReadCallback> > ioWaiters;
+
+	/**
+   * First frame of the list of frames caching pages of each file (see BufDesc::nextInFile)
+	 */
+  std::unordered_map<FileId, FrameId> fileFrames;
+
+	/**
+   * Added to the frames examined by the replacement policy to get those examined since the statistics were last
+   * cleared; accounts for the clear and for policies replaced by BufMgr::resize()
+	 */
+  std::int64_t scanOffset = 0;
+
+	/**
+   * NUMA node the frames, hash table and policy of this partition are placed on; -1 without NUMA placement
+	 */
+  int node = -1;
+
+	/**
+   * Definition of every buffer class, by class; copied to every partition so allocations find it under this mutex
+	 */
+  std::unordered_map<std::uint32_t, BufferClass> classes;
+
+	/**
+   * Buffer class of every file assigned one, by file
+	 */
+  std::unordered_map<FileId, std::uint32_t> fileClasses;
+
+	/**
+   * Frames of this partition holding pages of each buffer class, by class
+	 */
+  std::unordered_map<std::uint32_t, std::uint32_t> classFrames;
+
+	/**
+   * Frames that reads with AccessHint::SEQUENTIAL_SCAN reuse in turn, so that scans take no more of the partition;
+   * slots whose frame left the ring (BufDesc::inRing) get a new frame when their turn comes
+	 */
+  std::vector<FrameId> scanRing;
+
+	/**
+   * Slot of <scanRing> the next scan miss tries
+	 */
+  std::size_t scanRingNext = 0;
+};
+
+
+/**
+* @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+*
+* All public member functions are threadsafe. Pages are spread over one or more partitions (see BufPartition), each
+* guarded by its own mutex; with a single partition the buffer manager behaves like one global clock. Under the clock
+* policy a read that finds its page buffered takes no lock; the other policies record every hit under the mutex.
+*/
+class BufMgr 
+{
+	friend class PageHandle;
+
+ public:
+	/**
+   * Frames of the scan rings of all partitions together unless changed by setScanRing(); the size of PostgreSQL's
+   * rings at the default page size
+	 */
+  static const std::uint32_t DEFAULT_SCAN_RING = 32;
+
+ private:
+	/**
+   * Number of frames allocated for the buffer pool: the most it can be resized to
+	 */
+  std::uint32_t numBufs;
+
+	/**
+   * Number of frames currently in use by the partitions
+	 */
+  std::atomic<std::uint32_t> activeBufs;
+
+	/**
+   * Replacement policy of every partition, for partitions changing size
+	 */
+  ReplacementPolicyType policyType;
+
+	/**
+   * Serializes calls to resize()
+	 */
+  std::mutex resizeMutex;
+
+	/**
+   * Number of partitions the buffer pool is split into
+	 */
+  std::uint32_t numPartitions;
+
+	/**
+   * Array of partitions; frames of partition i follow those of partition i-1
+	 */
+  BufPartition *partitions;
+
+	/**
+   * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
+	 */
+  BufDesc *bufDescTable;
+
+	/**
+   * Pin count and flags of every frame, kept apart from bufDescTable so that sweeps over them touch little memory
+	 */
+  FrameStates *bufStateTable;
+
+	/**
+   * Reader-writer latch over the contents of every frame, taken through PageHandle
+	 */
+  FrameLatch *latchTable;
+
+	/**
+   * Memory holding the contents of every frame; bufPool[i] views arena->frame(i)
+	 */
+  FrameArena *arena;
+
+	/**
+   * Maintains Buffer pool usage statistics 
+	 */
+  BufMetrics metrics;
+
+	/**
+   * Record of the calls made, while tracing is on
+	 */
+  BufTrace tracer;
+
+	/**
+   * Engine performing asynchronous reads; created on first use
+	 */
+  IoEngine *ioEngine;
+
+	/**
+   * Guards the creation of ioEngine
+	 */
+  std::once_flag ioEngineOnce;
+
+	/**
+	 * Returns the I/O engine, creating it if needed.
+	 */
+  IoEngine& engine();
+
+	/**
+	 * Write-ahead log dirty pages are flushed against; NULL if there is none
+	 */
+  LogManager *wal;
+
+	/**
+	 * Writes a frame back to its file, first making the log durable up to the page's LSN. Caller must keep the frame
+	 * from changing.
+	 *
+	 * @param frameNo	Frame to write
+	 */
+  void writeFrame(const FrameId frameNo);
+
+	/**
+	 * Finishes an asynchronous read into a frame: marks the frame ready (or drops the page after a failure), wakes
+	 * the threads waiting for it and runs the callbacks. Called by the I/O engine without the partition mutex held.
+	 *
+	 * @param part  	Partition of the frame
+	 * @param frameNo	Frame the page was read into
+	 * @param callback	Callback of the readPageAsync() call that started the read
+	 * @param error 	Exception raised by the read, or null on success
+	 */
+  void finishAsyncRead(BufPartition& part, const FrameId frameNo, const PageReadCallback& callback,
+                       std::exception_ptr error);
+
+	/**
+	 * Drops one pin on a frame whose asynchronous read failed; the last pin frees the frame. Caller must hold the
+	 * partition mutex.
+	 *
+	 * @param part  	Partition of the frame
+	 * @param frameNo	Frame to release
+	 */
+  void releaseFailedFrame(BufPartition& part, const FrameId frameNo);
+
+	/**
+	 * Returns the partition responsible for caching the given page.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			Partition the page belongs to
+	 */
+  BufPartition& partitionFor(const File* file, const PageId pageNo);
+
+	/**
+	 * Returns the partition the given frame belongs to.
+	 *
+	 * @param frameNo	Frame number
+	 * @return  			Partition holding the frame
+	 */
+  BufPartition& partitionOfFrame(const FrameId frameNo);
+
+	/**
+   * Counts a hit on a frame of the given partition, and whether it crossed NUMA nodes
+	 *
+	 * @param part  	Partition of the frame
+	 */
+  void countHit(const BufPartition& part);
+
+	/**
+	 * Accounts for a pin of a buffered page: counts the hit and tells the replacement policy. A frame of the scan ring
+	 * read other than by a scan leaves the ring, so scans do not take pages others use. Caller must hold the partition
+	 * mutex.
+	 *
+	 * @param part  	Partition of the frame
+	 * @param frameNo	Frame holding the page
+	 * @param hint  	Hint of the read
+	 */
+  void frameHit(BufPartition& part, const FrameId frameNo, const AccessHint hint);
+
+	/**
+	 * Pins a buffered page without the partition mutex, as frameHit() accounts for it, if the page is ready for use
+	 * and the replacement policy records accesses in the frame state words (the clock). The frame found in the hash
+	 * table is probed, then looked up once more: the probe keeps the frame from being given to another page, so the
+	 * frame holds the page if the table still says so. Otherwise the probe is dropped and the caller takes the mutex.
+	 *
+	 * @param part  	Partition of the page
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frameNo	Set to the frame holding the page
+	 * @param hint  	Hint of the read
+	 * @return  			True if the page was pinned
+	 */
+  bool pinUnlocked(BufPartition& part, const File* file, const PageId pageNo, FrameId& frameNo,
+                   const AccessHint hint);
+
+	/**
+	 * Allocates a frame for a page read by a scan: the next frame of the partition's scan ring if no one has it pinned,
+	 * else a frame from allocBuf() that takes its place in the ring. Caller must hold the partition mutex.
+	 *
+	 * @param part  	Partition of the page
+	 * @param guard 	Lock held on the partition mutex
+	 * @param file  	File of the page
+	 * @param pageNo	Page to allocate a frame for
+	 * @param frame 	Frame reserved for the page
+	 * @param mayFail	As for allocBuf()
+	 * @return 				False if mayFail is set and no frame was free
+	 */
+  bool allocRingBuf(BufPartition& part, std::unique_lock<std::mutex>& guard, const File* file, const PageId pageNo,
+                    FrameId & frame, const bool mayFail);
+
+	/**
+	 * Returns the number of frames of the scan ring of a partition; 0 if scans use the shared pool like other reads
+	 *
+	 * @param part  	Partition of the ring
+	 */
+  std::uint32_t scanRingSize(const BufPartition& part) const;
+
+	/**
+	 * Unpins the page held by a frame, as unPinPage() does but without looking the page up. Used by PageHandle. The
+	 * pin being dropped keeps the page in its frame, so this is one atomic operation on the frame's state word and
+	 * takes no lock unless an allocation is waiting for a frame.
+	 *
+	 * @param frameNo	Frame holding the page
+	 * @param dirty		True if the page needs to be marked dirty
+   * @throws  PageNotPinnedException If the frame is not pinned
+	 */
+  void unPinFrame(const FrameId frameNo, const bool dirty);
+
+	/**
+	 * Pins the page held by a frame once more, for a handle sharing the pin of another (see PageHandle::share()). The
+	 * frame is pinned already, so its page cannot go away: this is one atomic operation on the frame's state word,
+	 * with no hash table lookup and no lock. Counted as a hit, but not reported to the replacement policy.
+	 *
+	 * @param frameNo	Frame holding the page, pinned by the caller
+	 */
+  void repinFrame(const FrameId frameNo);
 
- private:
 	/**
-   * Pointer to file to which corresponding frame is assigned
+	 * Allocate a free frame within the partition for the given page, evicting the victim chosen by the partition's
+	 * replacement policy. Caller must hold the partition mutex.
+	 *
+	 * If the only unpinned frames are being written back by the page cleaner, waits for those writes. If every frame is
+	 * pinned, waits up to the time set by setFrameWait() for one to be unpinned.
+	 *
+	 * @param part  	Partition to allocate the frame from
+	 * @param guard 	Lock held on the partition mutex
+	 * @param file   	File of the page the frame is allocated for
+	 * @param pageNo  Page the frame is allocated for
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param mayFail	Return false at once instead of waiting or throwing if no frame is available
+	 * @return  			False if mayFail is set and no frame is available
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
-  File* file;
+  bool allocBuf(BufPartition& part, std::unique_lock<std::mutex>& guard, const File* file, const PageId pageNo,
+                FrameId & frame, const bool mayFail = false);
 
 	/**
-   * Page within file to which corresponding frame is assigned
+   * Wakes allocations waiting for a frame of the partition if the given frame is no longer pinned. Caller must hold
+   * the partition mutex.
+	 *
+	 * @param part  	Partition of the frame
+	 * @param frameNo	Frame unpinned or freed
 	 */
-  PageId pageNo;
+  void frameReleased(BufPartition& part, const FrameId frameNo);
 
 	/**
-   * Frame number of the frame, in the buffer pool, being used
+   * Wakes allocations waiting for a frame of the partition, as frameReleased() does, after an unpin that did not hold
+   * the partition mutex. The mutex is only taken if an allocation is waiting.
+	 *
+	 * @param part  	Partition of the frame
+	 * @param frameNo	Frame unpinned
 	 */
-  FrameId	frameNo;
+  void frameUnpinned(BufPartition& part, const FrameId frameNo);
 
 	/**
-   * Number of times this page has been pinned
+   * Pins a page for readPage() and tryReadPage(), reading it in if needed
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param page  	Set to the pinned page
+	 * @param mayFail	Return false instead of waiting or throwing if no frame is available for the page
+	 * @param hint  	How the page will be used
+	 * @return  			False if mayFail is set and the page could not be pinned at once
 	 */
-  int pinCnt;
+  bool pinPage(File* file, const PageId pageNo, Page*& page, const bool mayFail, const AccessHint hint);
 
 	/**
-   * True if page is dirty;  false otherwise
+   * Writes back the page held by a frame the replacement policy no longer tracks (if dirty) and removes it from the
+   * partition, leaving the frame empty. Caller must hold the partition mutex.
+	 *
+	 * @param part  	Partition of the frame
+	 * @param frame 	Frame to empty
 	 */
-  bool dirty;
+  void evictFrame(BufPartition& part, const FrameId frame);
 
 	/**
-   * True if page is valid
+   * Returns the priority of the buffer class of a file in a partition. Caller must hold the partition mutex.
+	 *
+	 * @param part  	Partition
+	 * @param fileId	File
 	 */
-  bool valid;
+  BufferPriority priorityOf(const BufPartition& part, const FileId fileId) const;
 
 	/**
-   * Has this buffer frame been reference recently
+   * Finds a frame of a partition holding an evictable page of the given buffer classes. Caller must hold the
+   * partition mutex.
+	 *
+	 * @param part  	Partition to search
+	 * @param match 	Whether the pages of a buffer class may be chosen
+	 * @param frame 	Frame found
+	 * @return  			False if there is no such frame
 	 */
-  bool refbit;
+  bool findClassVictim(const BufPartition& part, const std::function<bool(std::uint32_t)>& match, FrameId& frame) const;
 
 	/**
-   * Initialize buffer frame for a new user
+   * Counts the frames of a partition holding pages of a file. Caller must hold the partition mutex.
+	 *
+	 * @param part  	Partition
+	 * @param fileId	File
 	 */
-  void Clear()
-	{
-    pinCnt = 0;
-		file = NULL;
-		pageNo = Page::INVALID_NUMBER;
-    dirty = false;
-    refbit = false;
-		valid = false;
-  };
+  std::uint32_t framesOfFile(const BufPartition& part, const FileId fileId) const;
 
 	/**
-	 * Set values of member variables corresponding to assignment of frame to a page in the file. Called when a frame 
-	 * in buffer pool is allocated to any page in the file through readPage() or allocPage()
+	 * Orders the indices of a list of pages by the partition each page belongs to, so that a batch can lock every
+	 * partition once.
 	 *
-	 * @param filePtr	File object
-	 * @param pageNum	Page number in the file
+	 * @param file   	File of the pages
+	 * @param pageNos	Numbers of the pages
+	 * @param order  	Receives the indices into pageNos, grouped by partition
+	 * @param parts  	Receives the partition of each page, indexed like pageNos
 	 */
-  void Set(File* filePtr, PageId pageNum)
-	{ 
-		file = filePtr;
-    pageNo = pageNum;
-    pinCnt = 1;
-    dirty = false;
-    valid = true;
-    refbit = true;
-  }
+  void groupByPartition(const File* file, const std::vector<PageId>& pageNos, std::vector<std::size_t>& order,
+                        std::vector<BufPartition*>& parts);
 
-  void Print()
-	{
-		if(file != NULL)
-		{
-			std::cout << "file:" << file->filename() << " ";
-			std::cout << "pageNo:" << pageNo << " ";
-		}
-		else
-			std::cout << "file:NULL ";
+	/**
+	 * Makes a frame set up for a page findable: adds it to the hash table and to the list of frames of its file.
+	 * Caller must hold the partition mutex.
+	 *
+	 * @param part  	Partition of the frame
+	 * @param frameNo	Frame holding the page
+	 */
+  void indexFrame(BufPartition& part, const FrameId frameNo);
 
-		std::cout << "valid:" << valid << " ";
-		std::cout << "pinCnt:" << pinCnt << " ";
-		std::cout << "dirty:" << dirty << " ";
-		std::cout << "refbit:" << refbit << "\n";
-  }
+	/**
+	 * Undoes indexFrame() before the frame is given up. Caller must hold the partition mutex.
+	 *
+	 * @param part  	Partition of the frame
+	 * @param frameNo	Frame holding the page
+	 */
+  void unindexFrame(BufPartition& part, const FrameId frameNo);
 
 	/**
-   * Constructor of BufDesc class 
+	 * Brings a page into a frame returned by allocBuf(): a frame of a memory-mapped file is pointed at the page in the
+	 * mapping, any other frame receives a copy read from the file.
+	 *
+	 * @param file   	File of the page
+	 * @param pageNo  Page to load
+	 * @param frameNo	Frame to load it into
+	 * @throws InvalidPageException If the page does not exist in the file
 	 */
-  BufDesc()
-	{
-  	Clear();
-  }
-};
+  void loadFrame(File* file, const PageId pageNo, const FrameId frameNo);
 
+	/**
+	 * Assigns a frame to a page and marks it valid, referenced and pinned once. Caller must hold the partition lock.
+	 *
+	 * @param frameNo	Frame being assigned
+	 * @param file   	File of the page
+	 * @param pageNo  Page held by the frame
+	 * @param flags  	Further FrameStates flags to set, e.g. IO_PENDING
+	 */
+  void setFrame(const FrameId frameNo, File* file, const PageId pageNo, const std::uint32_t flags);
 
-/**
-* @brief Class to maintain statistics of buffer usage 
-*/
-struct BufStats
-{
 	/**
-   * Total number of accesses to buffer pool
+	 * Waits once for a read or write in flight in the partition to finish, counting the wait as a pin wait. Caller
+	 * must hold the partition mutex through guard.
+	 *
+	 * @param part   	Partition the transfer belongs to
+	 * @param guard  	Lock held on the partition mutex
 	 */
-  int accesses;
+  void waitForIo(BufPartition& part, std::unique_lock<std::mutex>& guard);
 
 	/**
-   * Number of pages read from disk (including allocs)
+	 * Gives up frames from the end of a partition, down to target or to the last pinned frame. Caller must hold the
+	 * partition mutex through guard and rebuild the policy afterwards.
+	 *
+	 * @param part   	Partition to shrink
+	 * @param guard  	Lock held on the partition mutex
+	 * @param target 	Number of frames wanted
 	 */
-  int diskreads;
+  void shrinkPartition(BufPartition& part, std::unique_lock<std::mutex>& guard, const std::uint32_t target);
 
 	/**
-   * Number of pages written back to disk
+	 * Replaces the replacement policy of a partition whose size changed by a new one over its frames in use, holding
+	 * the pages resident now. Caller must hold the partition mutex.
+	 *
+	 * @param part   	Partition whose policy to replace
 	 */
-  int diskwrites;
+  void rebuildPolicy(BufPartition& part);
 
 	/**
-   * Clear all values 
+	 * Waits until the page cleaner is no longer writing the given frame. Caller must hold the partition mutex.
+	 *
+	 * @param part  	Partition of the frame
+	 * @param guard 	Lock held on the partition mutex
+	 * @param frameNo	Frame to wait for
 	 */
-  void clear()
-  {
-		accesses = diskreads = diskwrites = 0;
-  }
-      
+  void waitForCleaning(BufPartition& part, std::unique_lock<std::mutex>& guard, const FrameId frameNo);
+
 	/**
-   * Constructor of BufStats class 
+	 * Body of the page cleaner thread.
 	 */
-  BufStats()
-  {
-		clear();
-  }
-};
+  void runCleaner();
 
+	/**
+	 * Writes back dirty, unpinned frames of every partition that has too many of them, soonest victims first, and
+	 * waits for the writes.
+	 *
+	 * @param urgent	Clean partitions above the low watermark even if they have not reached the high one
+	 */
+  void cleanPartitions(bool urgent);
 
-/**
-* @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
-*/
-class BufMgr 
-{
- private:
 	/**
-   * Current position of clockhand in our buffer pool
+   * Page cleaner thread, if started
 	 */
-  FrameId clockHand;
+  std::thread cleaner;
 
 	/**
-   * Number of frames in the buffer pool
+   * Guards the cleaner control fields below
 	 */
-  std::uint32_t numBufs;
-	
+  std::mutex cleanerMutex;
+
 	/**
-   * Hash table mapping (File, page) to frame
+   * Wakes the cleaner early, to stop or because a foreground miss had to write a dirty victim
 	 */
-  BufHashTbl *hashTable;
+  std::condition_variable cleanerWake;
 
 	/**
-   * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
+   * True while the cleaner thread runs; read without cleanerMutex by the miss path
 	 */
-  BufDesc *bufDescTable;
+  std::atomic<bool> cleanerRunning;
 
 	/**
-   * Maintains Buffer pool usage statistics 
+   * Asks the cleaner thread to exit
+	 */
+  bool cleanerStop;
+
+	/**
+   * Asks the cleaner for an urgent round
+	 */
+  bool cleanerKick;
+
+	/**
+   * Fraction of dirty frames a partition is cleaned down to
+	 */
+  double cleanerLow;
+
+	/**
+   * Fraction of dirty frames at which the cleaner starts on a partition
+	 */
+  double cleanerHigh;
+
+	/**
+   * Time between two rounds of the cleaner, in milliseconds
 	 */
-  BufStats bufStats;
+  unsigned cleanerInterval;
 
 	/**
-   * Advance clock to next frame in the buffer pool
+	 * Number of pages a warm-up reads per call to readPages()
 	 */
-  void advanceClock();
+  static const std::size_t WARM_UP_BATCH = 64;
 
 	/**
-	 * Allocate a free frame.  
+	 * Body of the warm-up thread: reads the pages, hottest first, a batch at a time, each batch in file and page
+	 * number order so runs of consecutive pages are read with one transfer.
 	 *
-	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
-	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 * @param pages 	Pages to bring in, hottest first
+	 */
+  void runWarmUp(std::vector<std::pair<File*, PageId> > pages);
+
+	/**
+   * Warm-up thread, if started
+	 */
+  std::thread warmer;
+
+	/**
+   * Asks the warm-up thread to exit
+	 */
+  std::atomic<bool> warmerStop;
+
+	/**
+   * Pages the last warm-up has brought in or found buffered so far
+	 */
+  std::atomic<std::size_t> warmedPages;
+
+	/**
+   * How long allocations wait for a frame to be unpinned, in milliseconds (see setFrameWait())
 	 */
-  void allocBuf(FrameId & frame);
+  std::atomic<unsigned> frameWaitMs;
+
+	/**
+   * Frames of the scan rings of all partitions together (see setScanRing())
+	 */
+  std::atomic<std::uint32_t> scanRingFrames;
 
  public:
 	/**
-   * Actual buffer pool from which frames are allocated
+   * Actual buffer pool from which frames are allocated. Each Page is a view over its frame in the arena, so assigning
+   * to bufPool[i] copies bytes into the frame.
 	 */
   Page* bufPool;
 
 	/**
    * Constructor of BufMgr class
+	 *
+	 * @param bufs  	Number of frames in the buffer pool
+	 * @param parts 	Number of independently locked partitions; clamped to [1, bufs]
+	 * @param policy	Page replacement policy used by every partition
+	 * @param maxBufs	Most frames resize() can grow the pool to; address space for them is reserved up front, but
+	 *              	memory is only committed as frames are used. Values below bufs mean bufs.
+	 * @param numa  	Places the partitions round-robin on the NUMA nodes of the machine: the frames of partition i,
+	 *              	its hash table and its replacement policy go to node i % numaNodes(), and hits on frames of
+	 *              	another node than the caller's are counted in BufStats::remoteHits. Use at least as many
+	 *              	partitions as nodes.
 	 */
-  BufMgr(std::uint32_t bufs);
+  BufMgr(std::uint32_t bufs, std::uint32_t parts = 1,
+         ReplacementPolicyType policy = ReplacementPolicyType::CLOCK, std::uint32_t maxBufs = 0,
+         bool numa = false);
 	
 	/**
    * Destructor of BufMgr class
@@ -218,16 +1203,212 @@ class BufMgr
 	 * Reads the given page from the file into a frame and returns the pointer to page.
 	 * If the requested page is already present in the buffer pool pointer to that frame is returned
 	 * otherwise a new frame is allocated from the buffer pool for reading the page.
+	 * A scan passing AccessHint::SEQUENTIAL_SCAN takes a frame of the scan ring on a miss rather than one of the shared
+	 * pool, so it evicts at most the pages of the ring however many pages it reads; pages already buffered are used
+	 * where they are.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number in the file to be read
 	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @param hint  	How the page will be used
+	 */
+  void readPage(File* file, const PageId PageNo, Page*& page, const AccessHint hint = AccessHint::NORMAL);
+
+	/**
+	 * Reads the given page like the form above, returning a handle that unpins the page when it goes away (see
+	 * PageHandle); no unPinPage() call is needed. The handle can also latch the page against concurrent readers and
+	 * writers of its contents.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param mode  	Latch to take on the page before returning; waits for conflicting holders
+	 * @return  			Handle on the pinned page
+	 */
+  PageHandle readPage(File* file, const PageId PageNo, const LatchMode mode = LatchMode::NONE);
+
+	/**
+	 * Reads the given page like readPage(), unless that would mean waiting for a frame: if the page is not buffered
+	 * and every frame of its partition is pinned or being written back, returns false at once instead of waiting or
+	 * throwing. The page is pinned only if true is returned.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param page  	Set to the pinned page if it could be pinned
+	 * @return  			False if no frame was available
+	 */
+  bool tryReadPage(File* file, const PageId PageNo, Page*& page);
+
+	/**
+	 * Reads several pages of a file into the buffer pool at once, like calling readPage() for each of them. Each
+	 * partition is locked once for all of its pages, and missing pages with consecutive numbers are read from the
+	 * file in one transfer. Either every page is pinned or, if any of them cannot be read, none is.
+	 *
+	 * @param file   	File object
+	 * @param pageNos	Numbers of the pages to read; may contain duplicates, each of which pins the page again
+	 * @param pages  	Receives the pinned pages; pages[i] holds page pageNos[i]
+	 * @throws BufferExceededException If the buffer pool runs out of unpinned frames
+	 * @throws InvalidPageException If any page does not exist in the file
+	 */
+  void readPages(File* file, const std::vector<PageId>& pageNos, std::vector<Page*>& pages);
+
+	/**
+	 * Starts reading a page into the buffer pool without waiting for the disk. If the page is already buffered the
+	 * callback runs right away on the calling thread; otherwise a frame is reserved, the read is handed to the I/O
+	 * engine and the callback runs on an engine thread once the page is in. Either way the page is pinned for the
+	 * caller, who must unpin it as after readPage(). Other readers of the page wait for the read in flight.
+	 *
+	 * With an empty callback the page is only brought in: it is unpinned as soon as the read completes, in the same
+	 * step that marks it readable, so nobody sees it pinned afterwards; failures are ignored.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param callback	Receives the page, or the exception (e.g. BufferExceededException, InvalidPageException); may
+	 *               	be empty
+	 * @param hint  	How the page will be used, as for readPage()
+	 */
+  void readPageAsync(File* file, const PageId PageNo, PageReadCallback callback,
+                     const AccessHint hint = AccessHint::NORMAL);
+
+	/**
+	 * Starts reading a page into the buffer pool without waiting for the disk, like the callback form.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @return  			Future yielding the pinned page, or rethrowing the exception that made the read fail
+	 */
+  std::future<Page*> readPageAsync(File* file, const PageId PageNo);
+
+	/**
+	 * Starts bringing a page into the buffer pool in the background without pinning it for the caller, so that a
+	 * later readPage() finds it there. Does nothing if the page is already buffered. Failures, including a page that
+	 * does not exist or a buffer pool with no unpinned frame, are ignored.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param hint  	How the page will be used, as for readPage(); a scan reading ahead should pass its own hint
+	 */
+  void prefetchPage(File* file, const PageId PageNo, const AccessHint hint = AccessHint::NORMAL);
+
+	/**
+	 * Makes the buffer pool follow the write-ahead rule for a log: no dirty page is written back, by eviction, flushing,
+	 * resizing or the page cleaner, before the log is durable up to the page's LSN (see LogManager::flushTo()). Call
+	 * before pages are logged; the log must outlive the buffer manager.
+	 *
+	 * @param log 	Log pages are written against; NULL for none
+	 */
+  void setLog(LogManager* log)
+  {
+		wal = log;
+  }
+
+	/**
+	 * Sets how long a request for a page that is not buffered waits, when every frame of its partition is pinned, for
+	 * a frame to be unpinned before throwing BufferExceededException. Releasing pins (unPinPage(), a PageHandle going
+	 * away, disposePage()) wakes the waiting requests, so a burst of pins degrades into brief waits instead of failed
+	 * requests.
+	 *
+	 * @param timeoutMs	Most time to wait, in milliseconds; 0 (the default) throws at once
+	 */
+  void setFrameWait(unsigned timeoutMs)
+  {
+		frameWaitMs.store(timeoutMs, std::memory_order_relaxed);
+  }
+
+	/**
+	 * Sets how many frames reads with AccessHint::SEQUENTIAL_SCAN may take, like PostgreSQL's buffer access strategy
+	 * rings: each partition keeps its share of them in a ring, and a scan that misses reuses the next frame of the ring
+	 * in place, writing its page back first if dirty. A frame someone has pinned is skipped and replaced in the ring by
+	 * one from the shared pool. Frames another reader has used since the scan brought them in leave the ring and stay
+	 * with the shared pool. Each ring holds at most a quarter of its partition. Shrinking the rings takes effect as
+	 * their frames come round.
+	 *
+	 * @param frames	Frames of all rings together; 0 lets scans take frames of the shared pool like other reads
+	 */
+  void setScanRing(std::uint32_t frames)
+  {
+		scanRingFrames.store(frames, std::memory_order_relaxed);
+  }
+
+	/**
+	 * Defines or changes a buffer class, a group of files (e.g. those of one tenant) whose pages share a priority and a
+	 * frame quota. A page of a class at its quota takes the frame of another page of the class rather than a frame
+	 * holding someone else's page, so a scan of one tenant evicts only that tenant's pages. Quotas are enforced per
+	 * partition, each allowing a class its share of the quota in proportion to the partition's frames, and only while
+	 * pages of the class can be evicted; changing a class evicts nothing by itself.
+	 *
+	 * @param classId 	Class to define; any number but 0, which stands for the files assigned no class
+	 * @param priority	Priority of the pages of the class when frames are needed
+	 * @param quota   	Most frames the files of the class may hold together; 0 for no limit
+	 */
+  void setBufferClass(std::uint32_t classId, BufferPriority priority, std::uint32_t quota = 0);
+
+	/**
+	 * Puts a file in a buffer class, or takes it out of its class. Pages of the file already buffered count towards the
+	 * quota of the new class from then on. Files start out in no class: NORMAL priority and no quota.
+	 *
+	 * @param file  	File to assign
+	 * @param classId 	Class of the file, defined before or later by setBufferClass(); 0 for none
+	 */
+  void assignBufferClass(const File* file, std::uint32_t classId);
+
+	/**
+	 * Returns the number of frames holding pages of the files of a buffer class.
+	 *
+	 * @param classId 	Class
+	 */
+  std::uint32_t bufferClassFrames(std::uint32_t classId);
+
+	/**
+	 * Starts the background page cleaner. Whenever the share of dirty frames in a partition reaches highWatermark, the
+	 * cleaner writes dirty, unpinned frames back through the I/O engine, the ones the replacement policy would evict
+	 * first before others, until the share is down to lowWatermark. That way misses find clean victims and rarely
+	 * have to write. Does nothing if the cleaner is already running.
+	 *
+	 * @param lowWatermark 	Share of dirty frames, in [0, 1], a partition is cleaned down to
+	 * @param highWatermark	Share of dirty frames, in [lowWatermark, 1], at which cleaning starts
+	 * @param intervalMs   	Time between two checks of the partitions, in milliseconds
+	 */
+  void startCleaner(double lowWatermark = 0.1, double highWatermark = 0.25, unsigned intervalMs = 10);
+
+	/**
+	 * Stops the page cleaner and waits for its writes in flight. Does nothing if it is not running.
+	 */
+  void stopCleaner();
+
+	/**
+	 * Saves the list of pages in the buffer pool, hottest first by the replacement policy's reckoning (pinned and
+	 * recently referenced pages ahead of the others), so that a later buffer manager can warm up with it (see
+	 * startWarmUp()). Call it at shutdown, or periodically so a crash also leaves a recent list behind.
+	 *
+	 * @param path 	Name of the file to write; replaced if it exists
+	 * @throws FileIOException If the file cannot be written
+	 */
+  void saveResidentPages(const std::string& path);
+
+	/**
+	 * Starts bringing the pages listed by saveResidentPages() back into the buffer pool in the background, hottest
+	 * first and in page-sorted batches, reading consecutive pages with one transfer. Only pages of the given files are
+	 * read, as many as the pool has frames; pages that no longer exist are skipped. A warm-up already running is
+	 * stopped first.
+	 *
+	 * @param path 	Name of the file written by saveResidentPages()
+	 * @param files	Open files the listed pages may belong to, matched by name
+	 * @throws FileIOException If the file cannot be read
+	 */
+  void startWarmUp(const std::string& path, const std::vector<File*>& files);
+
+	/**
+	 * Waits for the warm-up to finish. Does nothing if none was started.
+	 *
+	 * @return  			Number of pages the last warm-up brought in or found already buffered
 	 */
-  void readPage(File* file, const PageId PageNo, Page*& page);
+  std::size_t waitForWarmUp();
 
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
 	 *
+	 * Unpinning a page that is not in the buffer pool is a no-op.
+	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number
 	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
@@ -235,6 +1416,17 @@ class BufMgr
 	 */
   void unPinPage(File* file, const PageId PageNo, const bool dirty);
 
+	/**
+	 * Unpins several pages of a file at once, like calling unPinPage() for each of them, locking each partition once.
+	 * Every page that is pinned is unpinned even if another one is not.
+	 *
+	 * @param file   	File object
+	 * @param pageNos	Numbers of the pages to unpin
+	 * @param dirty		True if the pages need to be marked dirty
+   * @throws  PageNotPinnedException If any of the pages is not pinned; the first such page is reported
+	 */
+  void unPinPages(File* file, const std::vector<PageId>& pageNos, const bool dirty);
+
 	/**
 	 * Allocates a new, empty page in the file and returns the Page object.
 	 * The newly allocated page is also assigned a frame in the buffer pool.
@@ -246,7 +1438,59 @@ class BufMgr
   void allocPage(File* file, PageId &PageNo, Page*& page); 
 
 	/**
-	 * Writes out all dirty pages of the file to disk.
+	 * Allocates a new, empty page like the form above, returning a handle that unpins the page when it goes away (see
+	 * PageHandle). The handle reports the number of the page.
+	 *
+	 * @param file   	File object
+	 * @return  			Handle on the pinned page
+	 */
+  PageHandle allocPage(File* file);
+
+	/**
+	 * Allocates several new, empty pages in the file (see File::allocatePages()) and assigns each a frame in the
+	 * buffer pool, pinned, locking each partition once. If the buffer pool runs out of frames, the pages stay allocated
+	 * in the file but none is left pinned.
+	 *
+	 * @param file   	File object
+	 * @param count  	Number of pages to allocate
+	 * @param pageNos	Receives the numbers of the new pages
+	 * @param pages  	Receives the pinned pages; pages[i] holds page pageNos[i]
+	 * @throws BufferExceededException If the buffer pool runs out of unpinned frames
+	 */
+  void allocPages(File* file, const std::size_t count, std::vector<PageId>& pageNos, std::vector<Page*>& pages);
+
+	/**
+	 * Changes the number of frames in use while the buffer pool keeps serving requests: the partitions are resized one
+	 * at a time, each locked only while its own frames change. Growing hands out frames reserved at construction.
+	 * Shrinking gives up frames from the end of each partition, writing back and evicting their pages and returning
+	 * their memory to the operating system; a partition cannot shrink past a frame that is pinned, so the pool may
+	 * stay larger than asked. Each resized partition starts its replacement policy afresh over its resident pages.
+	 *
+	 * @param frames 	Number of frames wanted; clamped to [number of partitions, maxBufs]
+	 * @return  			Number of frames in use afterwards
+	 */
+  std::uint32_t resize(std::uint32_t frames);
+
+	/**
+	 * Returns the number of frames currently in use.
+	 */
+  std::uint32_t numFrames() const
+  {
+		return activeBufs;
+  }
+
+	/**
+	 * Returns the most frames the pool can be resized to.
+	 */
+  std::uint32_t maxFrames() const
+  {
+		return numBufs;
+  }
+
+	/**
+	 * Writes out all dirty pages of the file to disk, removes the file's pages from the buffer pool and syncs the file,
+	 * so they are durable once this returns. Only the frames holding pages of this file are visited. Reads and page
+	 * cleaner writes of the file's pages still in flight are waited for first.
 	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
 	 * Otherwise Error returned.
 	 *
@@ -256,12 +1500,27 @@ class BufMgr
 	 */
   void flushFile(const File* file);
 
+	/**
+	 * Takes a fuzzy checkpoint: writes back every page that is dirty or pinned when it starts, in file and page number
+	 * order, while the buffer pool keeps serving requests, syncs their files and then records the checkpoint in the log
+	 * (see LogManager::checkpoint()), so that recovery only reads the log from where the checkpoint started. Pages may
+	 * be pinned and changed meanwhile: a pinned page is written under a shared latch (see PageHandle::latch()), so
+	 * never while a writer holds it, and a page dirtied again while it is written stays dirty. Pages still being read
+	 * in are skipped, since they hold no changes yet. Without a log set with
+	 * setLog() the pages are only written back and synced.
+	 *
+	 * @return  			LSN of the CHECKPOINT record, or 0 without a log
+   * @throws  FileIOException If a page, a file or the log cannot be written; the page being written stays dirty
+	 */
+  Lsn checkpoint();
+
 	/**
 	 * Delete page from file and also from buffer pool if present.
 	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number
+   * @throws InvalidPageException If the page does not exist in the file or is not in use
 	 */
   void disposePage(File* file, const PageId PageNo);
 
@@ -271,20 +1530,24 @@ class BufMgr
   void  printSelf();
 
 	/**
-   * Get buffer pool usage statistics
+   * Get buffer pool usage statistics. The counters are summed when this is called, so the snapshot may miss events
+   * counted concurrently.
+	 */
+  BufStats getBufStats();
+
+	/**
+   * Returns the call trace of this buffer manager. Tracing is off until BufTrace::start() is called on it; from then
+   * on every readPage(), unPinPage(), allocPage() and disposePage(), in all their forms, is recorded.
 	 */
-  BufStats & getBufStats()
+  BufTrace& trace()
   {
-		return bufStats;
+		return tracer;
   }
 
 	/**
    * Clear buffer pool usage statistics
 	 */
-  void clearBufStats() 
-  {
-		bufStats.clear();
-  }
+  void clearBufStats();
 };
 
 }
@@ -0,0 +1,61 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bulk_loader.h"
+
+namespace badgerdb {
+
+BulkLoader::BulkLoader(File& file, const std::size_t batch_pages)
+    : file_(file),
+      staged_(batch_pages == 0 ? 1 : batch_pages),
+      filled_(0),
+      pages_loaded_(0),
+      records_loaded_(0) {
+}
+
+BulkLoader::~BulkLoader() {
+  try {
+    flush();
+  } catch (...) {
+    // Destructors must not throw; the pages staged are lost.
+  }
+}
+
+void BulkLoader::insertRecord(const char* record_data,
+                              const std::size_t length) {
+  if (filled_ > 0 && staged_[filled_ - 1].hasSpaceForRecord(length)) {
+    staged_[filled_ - 1].insertRecord(record_data, length);
+  } else {
+    if (filled_ == staged_.size()) {
+      flush();
+    }
+    // Counted once it holds the record, so a record too large leaves no empty
+    // page behind
+    staged_[filled_].insertRecord(record_data, length);
+    ++filled_;
+  }
+  ++records_loaded_;
+}
+
+void BulkLoader::flush() {
+  if (filled_ == 0) {
+    return;
+  }
+  file_.appendPages(&staged_[0], filled_);
+  pages_loaded_ += filled_;
+  for (std::size_t i = 0; i < filled_; ++i) {
+    staged_[i] = Page();
+  }
+  filled_ = 0;
+}
+
+void BulkLoader::finish() {
+  flush();
+  file_.sync();
+}
+
+}
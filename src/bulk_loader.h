@@ -0,0 +1,125 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Loads records into new pages at the end of a file without going
+ *        through the buffer pool.
+ *
+ * Records are packed into pages of a private staging area, in the order they
+ * are inserted.  Once the area is full its pages are appended to the file
+ * with File::appendPages(), one sequential write for all of them, so a load
+ * costs no frames, no replacement and no per-page allocation.  The file
+ * header is written once, by finish().
+ *
+ * The pages are new, so no frame of the buffer pool can hold a stale copy of
+ * them, but they are not logged: a file loaded this way is only durable once
+ * finish() returns.  Records are not given record ids, since the number of a
+ * page is only known when it is appended; the pages are found as any other,
+ * e.g. with a FileIterator.
+ *
+ * A loader is used by one thread at a time; other threads may meanwhile use
+ * the file, as the pages of one batch are appended at once.
+ */
+class BulkLoader {
+ public:
+  /**
+   * Number of pages staged before they are appended, by default.
+   */
+  static const std::size_t DEFAULT_BATCH_PAGES = 128;
+
+  /**
+   * Constructs a loader appending to a file.
+   *
+   * @param file          File to load; must outlive the loader.
+   * @param batch_pages   Number of pages appended by each write.
+   */
+  explicit BulkLoader(File& file,
+                      const std::size_t batch_pages = DEFAULT_BATCH_PAGES);
+
+  /**
+   * Appends the pages still staged, but does not sync the file; errors are
+   * ignored, so call finish() to learn of them.
+   */
+  ~BulkLoader();
+
+  /**
+   * Adds a record to the load, after the records added before it.
+   *
+   * @param record_data   Bytes to store.
+   * @throws  InsufficientSpaceException  If the record does not fit in an
+   *                                      empty page.
+   */
+  void insertRecord(const std::string& record_data) {
+    insertRecord(record_data.data(), record_data.size());
+  }
+
+  /**
+   * Adds a record to the load, after the records added before it.
+   *
+   * @param record_data   Bytes to store.
+   * @param length        Number of bytes.
+   * @throws  InsufficientSpaceException  If the record does not fit in an
+   *                                      empty page.
+   */
+  void insertRecord(const char* record_data, const std::size_t length);
+
+  /**
+   * Appends the pages staged so far to the file.  The page being filled is
+   * appended too, so the next record starts a new page.
+   */
+  void flush();
+
+  /**
+   * Appends the pages staged so far and syncs the file, header included.
+   */
+  void finish();
+
+  /**
+   * Returns the number of pages appended to the file so far.
+   */
+  std::uint64_t pagesLoaded() const { return pages_loaded_; }
+
+  /**
+   * Returns the number of records added so far.
+   */
+  std::uint64_t recordsLoaded() const { return records_loaded_; }
+
+ private:
+  BulkLoader(const BulkLoader&);
+  BulkLoader& operator=(const BulkLoader&);
+
+  /**
+   * File loaded.
+   */
+  File& file_;
+
+  /**
+   * Pages of the next batch.
+   */
+  std::vector<Page> staged_;
+
+  /**
+   * Number of pages of <staged_> holding records; the last is being filled.
+   */
+  std::size_t filled_;
+
+  std::uint64_t pages_loaded_;
+  std::uint64_t records_loaded_;
+};
+
+}
@@ -0,0 +1,177 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "clock_policy.h"
+
+#include <algorithm>
+
+// ThreadSanitizer takes vector loads of the state words for plain reads racing
+// with the atomic unpins, so sanitized builds scan a word at a time
+#if defined(__SANITIZE_THREAD__)
+#define BADGERDB_SCALAR_SCAN 1
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace badgerdb {
+
+const std::uint32_t ClockPolicy::BLOCK_FRAMES;
+
+ClockPolicy::ClockPolicy(FrameStates* states, FrameId first, std::uint32_t num)
+    : ReplacementPolicy(states, first, num),
+      clockHand(first + num - 1) {
+}
+
+void ClockPolicy::frameAccessed(FrameId frame) {
+  setRefbit(frame, true);
+}
+
+void ClockPolicy::frameLoaded(FrameId frame, const PageKey& key) {
+  setRefbit(frame, true);
+}
+
+void ClockPolicy::frameFreed(FrameId frame) {
+}
+
+void ClockPolicy::frameTaken(FrameId frame) {
+}
+
+void ClockPolicy::frameResident(FrameId frame, const PageKey& key) {
+  // The reference bit in the state word is all the clock knows of a page.
+}
+
+bool ClockPolicy::pickVictim(const PageKey& key, FrameId& frame,
+                             const FrameFilter* skip) {
+  // Offset within the partition of the frame after the hand
+  std::uint32_t next = (clockHand - firstFrame + 1) % numFrames;
+  while (true) {
+    bool evictableSeen = false;
+    for (std::uint32_t swept = 0; swept < numFrames;) {
+      // Blocks never wrap around the end of the partition
+      const std::uint32_t count =
+          std::min(std::min(BLOCK_FRAMES, numFrames - next), numFrames - swept);
+      std::uint32_t candidates, referenced, evictable;
+      scanBlock(states->data(firstFrame + next), count, candidates, referenced,
+                evictable);
+      if (skip != NULL) {
+        // Frames passed over count as pinned and keep their reference bits.
+        for (std::uint32_t mask = evictable; mask != 0; mask &= mask - 1) {
+          const std::uint32_t offset = __builtin_ctz(mask);
+          if (isPassedOver(firstFrame + next + offset, skip)) {
+            candidates &= ~(1u << offset);
+            referenced &= ~(1u << offset);
+            evictable &= ~(1u << offset);
+          }
+        }
+      }
+      // A frame pinned since the scan is no candidate after all.
+      while (candidates != 0 &&
+             !claim(firstFrame + next + __builtin_ctz(candidates))) {
+        candidates &= candidates - 1;
+      }
+      if (candidates != 0) {
+        // Frames passed before the victim lose their second chance.
+        const std::uint32_t offset = __builtin_ctz(candidates);
+        scanned += offset + 1;
+        clearRefbits(firstFrame + next, referenced & ((1u << offset) - 1));
+        clockHand = firstFrame + next + offset;
+        frame = clockHand;
+        return true;
+      }
+      clearRefbits(firstFrame + next, referenced);
+      scanned += count;
+      evictableSeen = evictableSeen || evictable != 0;
+      next = (next + count) % numFrames;
+      swept += count;
+    }
+    // A whole revolution cleared every reference bit; the next one finds any
+    // unpinned frame, unless there is none.
+    if (!evictableSeen) {
+      return false;
+    }
+  }
+}
+
+void ClockPolicy::clearRefbits(FrameId first, std::uint32_t mask) {
+  while (mask != 0) {
+    setRefbit(first + __builtin_ctz(mask), false);
+    mask &= mask - 1;
+  }
+}
+
+void ClockPolicy::scanBlock(const std::atomic<std::uint32_t>* words,
+                            std::uint32_t count, std::uint32_t& candidates,
+                            std::uint32_t& referenced,
+                            std::uint32_t& evictable) {
+  // Words are read without ordering: the caller holds the partition lock,
+  // and every change to the bits tested here is made under it too, but for
+  // pins on buffer hits and unpins through a PageHandle.  A frame seen
+  // unpinned may be pinned since, which claiming the victim finds out.
+  candidates = referenced = evictable = 0;
+  std::uint32_t i = 0;
+#if defined(__AVX2__) && !defined(BADGERDB_SCALAR_SCAN)
+  const std::uint32_t* raw = reinterpret_cast<const std::uint32_t*>(words);
+  const __m256i unevictable = _mm256_set1_epi32(FrameStates::UNEVICTABLE);
+  const __m256i used = _mm256_set1_epi32(FrameStates::VALID | FrameStates::REFBIT);
+  const __m256i refbit = _mm256_set1_epi32(FrameStates::REFBIT);
+  const __m256i zero = _mm256_setzero_si256();
+  for (; i + 8 <= count; i += 8) {
+    const __m256i w =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(raw + i));
+    const __m256i free =
+        _mm256_cmpeq_epi32(_mm256_and_si256(w, unevictable), zero);
+    const __m256i recent = _mm256_cmpeq_epi32(_mm256_and_si256(w, used), used);
+    const __m256i ref = _mm256_cmpeq_epi32(_mm256_and_si256(w, refbit), refbit);
+    candidates |= (std::uint32_t) _mm256_movemask_ps(
+                      _mm256_castsi256_ps(_mm256_andnot_si256(recent, free)))
+                  << i;
+    referenced |=
+        (std::uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(ref)) << i;
+    evictable |=
+        (std::uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(free)) << i;
+  }
+#elif defined(__SSE2__) && !defined(BADGERDB_SCALAR_SCAN)
+  const std::uint32_t* raw = reinterpret_cast<const std::uint32_t*>(words);
+  const __m128i unevictable = _mm_set1_epi32(FrameStates::UNEVICTABLE);
+  const __m128i used = _mm_set1_epi32(FrameStates::VALID | FrameStates::REFBIT);
+  const __m128i refbit = _mm_set1_epi32(FrameStates::REFBIT);
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 4 <= count; i += 4) {
+    const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i));
+    const __m128i free = _mm_cmpeq_epi32(_mm_and_si128(w, unevictable), zero);
+    const __m128i recent = _mm_cmpeq_epi32(_mm_and_si128(w, used), used);
+    const __m128i ref = _mm_cmpeq_epi32(_mm_and_si128(w, refbit), refbit);
+    candidates |= (std::uint32_t) _mm_movemask_ps(
+                      _mm_castsi128_ps(_mm_andnot_si128(recent, free)))
+                  << i;
+    referenced |= (std::uint32_t) _mm_movemask_ps(_mm_castsi128_ps(ref)) << i;
+    evictable |= (std::uint32_t) _mm_movemask_ps(_mm_castsi128_ps(free)) << i;
+  }
+#endif
+  for (; i < count; i++) {
+    const std::uint32_t w = words[i].load(std::memory_order_relaxed);
+    const bool free = (w & FrameStates::UNEVICTABLE) == 0;
+    const bool recent = (w & FrameStates::VALID) && (w & FrameStates::REFBIT);
+    candidates |= (std::uint32_t) (free && !recent) << i;
+    referenced |= (std::uint32_t) ((w & FrameStates::REFBIT) != 0) << i;
+    evictable |= (std::uint32_t) free << i;
+  }
+}
+
+void ClockPolicy::victimOrder(std::vector<FrameId>& order) const {
+  // The hand sweeps on from the frame after its current position.
+  order.clear();
+  for (std::uint32_t step = 1; step <= numFrames; ++step) {
+    order.push_back(firstFrame + (clockHand - firstFrame + step) % numFrames);
+  }
+}
+
+}
@@ -0,0 +1,80 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief The classic CLOCK (second chance) replacement policy.
+ *
+ * A hand sweeps the frames of the partition in order.  Referenced frames get
+ * their reference bit cleared and are skipped once; the first frame that is
+ * invalid, or valid, unreferenced and unpinned, is the victim.  The hand
+ * moves in blocks of frame state words, so a sweep past many pinned or
+ * referenced frames costs a few vector compares per block rather than a
+ * branch per frame.
+ */
+class ClockPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs a clock over the frames [first, first + num).
+   *
+   * @param states      Frame state words of the buffer manager.
+   * @param first       First frame of the partition.
+   * @param num         Number of frames in the partition.
+   */
+  ClockPolicy(FrameStates* states, FrameId first, std::uint32_t num);
+
+  void frameAccessed(FrameId frame);
+  void frameLoaded(FrameId frame, const PageKey& key);
+  void frameFreed(FrameId frame);
+  bool pickVictim(const PageKey& key, FrameId& frame,
+                  const FrameFilter* skip);
+  void frameTaken(FrameId frame);
+  void frameResident(FrameId frame, const PageKey& key);
+  void victimOrder(std::vector<FrameId>& order) const;
+
+ private:
+  /**
+   * Number of frames whose state words are tested together.
+   */
+  static const std::uint32_t BLOCK_FRAMES = 32;
+
+  /**
+   * Clears the reference bits of the frames selected by a block mask.
+   *
+   * @param first       Frame of bit 0 of the mask.
+   * @param mask        Bit i selects frame first + i.
+   */
+  void clearRefbits(FrameId first, std::uint32_t mask);
+
+  /**
+   * Classifies up to BLOCK_FRAMES consecutive state words at once, using
+   * SSE2 or AVX2 where the compiler targets them.  Bit i of each mask
+   * describes words[i].
+   *
+   * @param words       First state word of the block.
+   * @param count       Number of words in the block.
+   * @param candidates  Set to the frames that can be the victim right away:
+   *                    unpinned, and free or unreferenced.
+   * @param referenced  Set to the frames whose reference bit is set.
+   * @param evictable   Set to the frames that are unpinned.
+   */
+  static void scanBlock(const std::atomic<std::uint32_t>* words,
+                        std::uint32_t count, std::uint32_t& candidates,
+                        std::uint32_t& referenced, std::uint32_t& evictable);
+
+  /**
+   * Current position of clockhand in the partition
+   */
+  FrameId clockHand;
+};
+
+}
@@ -0,0 +1,296 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "clock_pro_policy.h"
+
+namespace badgerdb {
+
+ClockProPolicy::ClockProPolicy(FrameStates* states, FrameId first,
+                               std::uint32_t num)
+    : ReplacementPolicy(states, first, num),
+      handCold(clock.end()),
+      handHot(clock.end()),
+      handTest(clock.end()),
+      framePos(num),
+      resident(num, false),
+      referenced(num, false),
+      freeFrames(first, num),
+      numHot(0),
+      numColdResident(0),
+      coldTarget(num > 1 ? num / 2 : 1) {
+  for (std::uint32_t i = 0; i < num; ++i) {
+    freeFrames.pushFront(first + i);
+  }
+}
+
+ClockProPolicy::Position ClockProPolicy::following(Position pos) {
+  ++pos;
+  return pos == clock.end() ? clock.begin() : pos;
+}
+
+ClockProPolicy::Position ClockProPolicy::insertAtHead(const Entry& entry) {
+  if (clock.empty()) {
+    clock.push_back(entry);
+    handCold = handHot = handTest = clock.begin();
+    return clock.begin();
+  }
+  return clock.insert(handHot, entry);
+}
+
+void ClockProPolicy::moveToHead(Position pos) {
+  if (clock.size() == 1) {
+    return;
+  }
+  if (handCold == pos) handCold = following(pos);
+  if (handTest == pos) handTest = following(pos);
+  if (handHot == pos) handHot = following(pos);
+  clock.splice(handHot, clock, pos);
+}
+
+void ClockProPolicy::erase(Position pos) {
+  if (clock.size() == 1) {
+    clock.clear();
+    handCold = handHot = handTest = clock.end();
+    return;
+  }
+  if (handCold == pos) handCold = following(pos);
+  if (handTest == pos) handTest = following(pos);
+  if (handHot == pos) handHot = following(pos);
+  clock.erase(pos);
+}
+
+void ClockProPolicy::endTest(Position pos) {
+  pos->test = false;
+  if (coldTarget > 1) {
+    --coldTarget;
+  }
+  if (pos->frame == FrameList::NONE) {
+    ghosts.erase(pos->key);
+    erase(pos);
+  }
+}
+
+bool ClockProPolicy::runHandHot(const FrameFilter* skip) {
+  if (numHot == 0) {
+    return false;
+  }
+  // Two revolutions reach every hot page with its reference cleared.
+  for (std::size_t steps = 2 * clock.size(); steps > 0; --steps) {
+    Position pos = handHot;
+    handHot = following(handHot);
+    if (pos->hot) {
+      if (skip != NULL && (*skip)(pos->frame)) {
+        continue;
+      }
+      const FrameId i = pos->frame - firstFrame;
+      if (referenced[i]) {
+        referenced[i] = false;
+        continue;
+      }
+      pos->hot = false;
+      --numHot;
+      ++numColdResident;
+      return true;
+    }
+    if (pos->test) {
+      endTest(pos);
+    }
+  }
+  return false;
+}
+
+void ClockProPolicy::runHandTest() {
+  while (ghosts.size() > numFrames) {
+    Position pos = handTest;
+    handTest = following(handTest);
+    if (!pos->hot && pos->test) {
+      endTest(pos);
+    }
+  }
+}
+
+void ClockProPolicy::frameAccessed(FrameId frame) {
+  referenced[frame - firstFrame] = true;
+}
+
+void ClockProPolicy::frameLoaded(FrameId frame, const PageKey& key) {
+  const FrameId i = frame - firstFrame;
+  referenced[i] = false;
+  resident[i] = true;
+
+  std::unordered_map<PageKey, Position, PageKeyHash>::iterator ghost =
+      ghosts.find(key);
+  if (ghost == ghosts.end()) {
+    const Entry entry = {key, frame, false /* hot */, true /* test */};
+    framePos[i] = insertAtHead(entry);
+    ++numColdResident;
+    return;
+  }
+
+  // Re-referenced during its test period: the page has a short reuse
+  // distance, so it comes back hot and cold pages get more room.
+  Position pos = ghost->second;
+  ghosts.erase(ghost);
+  if (coldTarget + 1 < numFrames) {
+    ++coldTarget;
+  }
+  pos->frame = frame;
+  pos->hot = true;
+  pos->test = false;
+  ++numHot;
+  moveToHead(pos);
+  framePos[i] = pos;
+  while (numHot > hotTarget() && runHandHot(NULL)) {
+  }
+}
+
+void ClockProPolicy::frameFreed(FrameId frame) {
+  const FrameId i = frame - firstFrame;
+  if (resident[i]) {
+    Position pos = framePos[i];
+    if (pos->hot) {
+      --numHot;
+    } else {
+      --numColdResident;
+    }
+    erase(pos);
+    resident[i] = false;
+  }
+  freeFrames.pushFront(frame);
+}
+
+void ClockProPolicy::frameTaken(FrameId frame) {
+  const FrameId i = frame - firstFrame;
+  if (resident[i]) {
+    Position pos = framePos[i];
+    if (pos->hot) {
+      --numHot;
+    } else {
+      --numColdResident;
+    }
+    erase(pos);
+    resident[i] = false;
+  }
+}
+
+void ClockProPolicy::frameResident(FrameId frame, const PageKey& key) {
+  if (freeFrames.contains(frame)) {
+    freeFrames.remove(frame);
+  }
+  std::unordered_map<PageKey, Position, PageKeyHash>::iterator ghost =
+      ghosts.find(key);
+  if (ghost != ghosts.end()) {
+    const Position pos = ghost->second;
+    ghosts.erase(ghost);
+    erase(pos);
+  }
+  const FrameId i = frame - firstFrame;
+  referenced[i] = false;
+  resident[i] = true;
+  const Entry entry = {key, frame, false /* hot */, true /* test */};
+  framePos[i] = insertAtHead(entry);
+  ++numColdResident;
+}
+
+bool ClockProPolicy::pickVictim(const PageKey& key, FrameId& frame,
+                                const FrameFilter* skip) {
+  if (freeFrames.size() > 0) {
+    frame = freeFrames.back();
+    freeFrames.remove(frame);
+    return true;
+  }
+
+  std::uint32_t numPinned = 0;  // consecutive pinned cold pages seen
+  while (true) {
+    if (numColdResident == 0 || numPinned >= numColdResident) {
+      // No cold page can be evicted; demote a hot one and retry.
+      if (!runHandHot(skip)) {
+        return false;
+      }
+      numPinned = 0;
+      continue;
+    }
+
+    Position pos = handCold;
+    handCold = following(handCold);
+    if (pos->hot || pos->frame == FrameList::NONE) {
+      continue;
+    }
+    const FrameId candidate = pos->frame;
+    ++scanned;
+    const FrameId i = candidate - firstFrame;
+    if (isPassedOver(candidate, skip)) {
+      ++numPinned;
+      continue;
+    }
+    numPinned = 0;
+
+    if (referenced[i]) {
+      referenced[i] = false;
+      if (pos->test) {
+        // Reused within its test period: promote to hot.
+        pos->hot = true;
+        pos->test = false;
+        ++numHot;
+        --numColdResident;
+        moveToHead(pos);
+        while (numHot > hotTarget() && runHandHot(skip)) {
+        }
+      } else {
+        // Give the page a test period at the head of the clock.
+        pos->test = true;
+        moveToHead(pos);
+      }
+      continue;
+    }
+
+    if (!claim(candidate)) {
+      ++numPinned;
+      continue;
+    }
+
+    // Evict the page.  If it is still in its test period it stays on the clock
+    // as a non-resident page so that a quick return is recognized.
+    --numColdResident;
+    resident[i] = false;
+    if (pos->test) {
+      pos->frame = FrameList::NONE;
+      ghosts[pos->key] = pos;
+      runHandTest();
+    } else {
+      erase(pos);
+    }
+    frame = candidate;
+    return true;
+  }
+}
+
+void ClockProPolicy::victimOrder(std::vector<FrameId>& order) const {
+  // The cold hand evicts resident cold pages in clock order; hot pages only
+  // become victims after being demoted, so they come last.
+  order.clear();
+  if (clock.empty()) {
+    return;
+  }
+  std::list<Entry>::const_iterator start = handCold;
+  if (start == clock.end()) {
+    start = clock.begin();
+  }
+  for (int hot = 0; hot < 2; ++hot) {
+    std::list<Entry>::const_iterator pos = start;
+    do {
+      if (pos->frame != FrameList::NONE && pos->hot == (hot == 1)) {
+        order.push_back(pos->frame);
+      }
+      if (++pos == clock.end()) {
+        pos = clock.begin();
+      }
+    } while (pos != start);
+  }
+}
+
+}
@@ -0,0 +1,198 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief CLOCK-Pro replacement policy (Jiang, Chen and Zhang).
+ *
+ * All resident pages plus recently evicted cold pages sit on one circular
+ * list, ordered by recency.  Pages are hot or cold; a newly loaded page
+ * starts cold and "in test".  A cold page that is referenced again during its
+ * test period, even after being evicted, proves a short reuse distance and
+ * becomes hot.  Three hands sweep the list:
+ *
+ * - the cold hand evicts unreferenced resident cold pages,
+ * - the hot hand demotes unreferenced hot pages to cold and ends the test
+ *   periods it passes,
+ * - the test hand ends test periods to bound the number of remembered
+ *   non-resident pages.
+ *
+ * The number of frames reserved for cold pages adapts: it grows when a page
+ * is re-referenced during its test period and shrinks when a test period
+ * expires.  Only cold pages are ever evicted, so a scan cannot flush hot pages.
+ */
+class ClockProPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs a CLOCK-Pro policy over the frames [first, first + num).
+   *
+   * @param states      Frame state words of the buffer manager.
+   * @param first       First frame of the partition.
+   * @param num         Number of frames in the partition.
+   */
+  ClockProPolicy(FrameStates* states, FrameId first, std::uint32_t num);
+
+  void frameAccessed(FrameId frame);
+  void frameLoaded(FrameId frame, const PageKey& key);
+  void frameFreed(FrameId frame);
+  bool pickVictim(const PageKey& key, FrameId& frame,
+                  const FrameFilter* skip);
+  void frameTaken(FrameId frame);
+  void frameResident(FrameId frame, const PageKey& key);
+  void victimOrder(std::vector<FrameId>& order) const;
+
+ private:
+  /**
+   * @brief A page on the clock.
+   */
+  struct Entry {
+    /**
+     * Identity of the page.
+     */
+    PageKey key;
+
+    /**
+     * Frame holding the page, or FrameList::NONE if it is not resident.
+     */
+    FrameId frame;
+
+    /**
+     * Whether the page is hot.
+     */
+    bool hot;
+
+    /**
+     * Whether the page is in its test period.
+     */
+    bool test;
+  };
+
+  typedef std::list<Entry>::iterator Position;
+
+  /**
+   * Returns the position after the given one, wrapping around the list.
+   */
+  Position following(Position pos);
+
+  /**
+   * Inserts a page at the head of the clock (the spot the hot hand reaches
+   * last).
+   *
+   * @param entry   Page to insert.
+   * @return  Position of the page.
+   */
+  Position insertAtHead(const Entry& entry);
+
+  /**
+   * Moves a page to the head of the clock.
+   *
+   * @param pos   Position of the page.
+   */
+  void moveToHead(Position pos);
+
+  /**
+   * Removes a page from the clock, moving any hand that points at it.
+   *
+   * @param pos   Position of the page.
+   */
+  void erase(Position pos);
+
+  /**
+   * Ends the test period of a cold page, shrinking the cold target and
+   * forgetting the page if it is not resident.
+   *
+   * @param pos   Position of the page.
+   */
+  void endTest(Position pos);
+
+  /**
+   * Runs the hot hand until it has demoted one hot page.  Pages passed over
+   * by <skip> are neither demoted nor lose their reference.
+   *
+   * @param skip    Frames to pass over, or NULL.
+   * @return  False if there was no hot page to demote.
+   */
+  bool runHandHot(const FrameFilter* skip);
+
+  /**
+   * Runs the test hand until at most as many non-resident pages are
+   * remembered as there are frames.
+   */
+  void runHandTest();
+
+  /**
+   * Maximum number of hot pages currently allowed.
+   */
+  std::uint32_t hotTarget() const { return numFrames - coldTarget; }
+
+  /**
+   * The clock of pages.
+   */
+  std::list<Entry> clock;
+
+  /**
+   * Hand evicting cold pages.
+   */
+  Position handCold;
+
+  /**
+   * Hand demoting hot pages.
+   */
+  Position handHot;
+
+  /**
+   * Hand ending test periods.
+   */
+  Position handTest;
+
+  /**
+   * Position on the clock of the page held by every resident frame.
+   */
+  std::vector<Position> framePos;
+
+  /**
+   * Whether each frame holds a page on the clock.
+   */
+  std::vector<bool> resident;
+
+  /**
+   * Reference bit of every frame.
+   */
+  std::vector<bool> referenced;
+
+  /**
+   * Non-resident pages on the clock.
+   */
+  std::unordered_map<PageKey, Position, PageKeyHash> ghosts;
+
+  /**
+   * Frames not holding any page.
+   */
+  FrameList freeFrames;
+
+  /**
+   * Number of resident hot pages.
+   */
+  std::uint32_t numHot;
+
+  /**
+   * Number of resident cold pages.
+   */
+  std::uint32_t numColdResident;
+
+  /**
+   * Adaptive number of frames meant for cold pages.
+   */
+  std::uint32_t coldTarget;
+};
+
+}
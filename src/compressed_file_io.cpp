@@ -0,0 +1,289 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "compressed_file_io.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#include "crc32c.h"
+#include "exceptions/file_io_exception.h"
+#include "lz_codec.h"
+#include "page.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Unit of allocation of the file.
+ */
+const std::uint64_t SECTOR = 512;
+
+/**
+ * Start of the extents; the two superblocks come before.
+ */
+const std::uint64_t DATA_START = 2 * SECTOR;
+
+const char MAGIC[8] = {'B', 'D', 'B', 'C', 'M', 'P', 'R', '\0'};
+
+const std::uint32_t VERSION = 1;
+
+std::uint64_t sectorsFor(const std::uint64_t length) {
+  return (length + SECTOR - 1) / SECTOR;
+}
+
+}
+
+CompressedFileIo::CompressedFileIo(const std::string& filename,
+                                   const bool create_new)
+    : FileIo(filename, FileBackend::COMPRESSED),
+      raw_(FileIo::open(filename, create_new, FileBackend::POSIX)),
+      end_(DATA_START),
+      dirty_(false),
+      block_(Page::SIZE),
+      packed_(Page::SIZE) {
+  std::memset(&super_, 0, sizeof(super_));
+  if (create_new) {
+    std::memcpy(super_.magic, MAGIC, sizeof(MAGIC));
+    super_.version = VERSION;
+    super_.end = end_;
+    commit();
+    return;
+  }
+
+  bool found = false;
+  for (std::uint64_t slot = 0; slot < 2; ++slot) {
+    Superblock candidate;
+    raw_->read(reinterpret_cast<char*>(&candidate), sizeof(candidate),
+               slot * SECTOR);
+    const std::uint32_t stored = candidate.checksum;
+    candidate.checksum = 0;
+    if (std::memcmp(candidate.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        candidate.version != VERSION ||
+        crc32c(&candidate, sizeof(candidate)) != stored) {
+      continue;
+    }
+    candidate.checksum = stored;
+    if (!found || candidate.generation > super_.generation) {
+      super_ = candidate;
+      found = true;
+    }
+  }
+  if (!found || super_.mapLength % sizeof(Extent) != 0 ||
+      super_.end < DATA_START) {
+    throw FileIOException(filename, "open compressed", EINVAL);
+  }
+
+  map_.resize(super_.mapLength / sizeof(Extent));
+  if (!map_.empty()) {
+    raw_->read(reinterpret_cast<char*>(&map_[0]), super_.mapLength,
+               super_.mapOffset);
+    if (crc32c(&map_[0], super_.mapLength) != super_.mapChecksum) {
+      throw FileIOException(filename, "open compressed", EINVAL);
+    }
+  }
+  end_ = super_.end;
+  findFreeSpace();
+}
+
+CompressedFileIo::~CompressedFileIo() {
+  try {
+    if (dirty_) {
+      commit();
+    }
+  } catch (...) {
+    // Destructors must not throw; the file reads as of the last sync().
+  }
+}
+
+bool CompressedFileIo::detect(const std::string& filename) {
+  std::ifstream stream(filename, std::ifstream::binary);
+  for (std::uint64_t slot = 0; slot < 2 && stream; ++slot) {
+    char magic[sizeof(MAGIC)];
+    stream.seekg(slot * SECTOR, std::ios::beg);
+    stream.read(magic, sizeof(magic));
+    if (stream.gcount() == sizeof(magic) &&
+        std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void CompressedFileIo::read(char* buffer, const std::size_t length,
+                            const std::uint64_t offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const std::uint64_t position = offset + done;
+    const std::uint64_t block = position / Page::SIZE;
+    const std::size_t within = position % Page::SIZE;
+    const std::size_t count = std::min(length - done, Page::SIZE - within);
+    if (count == Page::SIZE) {
+      readBlock(block, buffer + done);
+    } else {
+      readBlock(block, &block_[0]);
+      std::memcpy(buffer + done, &block_[within], count);
+    }
+    done += count;
+  }
+}
+
+void CompressedFileIo::write(const char* buffer, const std::size_t length,
+                             const std::uint64_t offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const std::uint64_t position = offset + done;
+    const std::uint64_t block = position / Page::SIZE;
+    const std::size_t within = position % Page::SIZE;
+    const std::size_t count = std::min(length - done, Page::SIZE - within);
+    if (count == Page::SIZE) {
+      writeBlock(block, buffer + done);
+    } else {
+      readBlock(block, &block_[0]);
+      std::memcpy(&block_[within], buffer + done, count);
+      writeBlock(block, &block_[0]);
+    }
+    done += count;
+  }
+}
+
+void CompressedFileIo::sync() {
+  if (dirty_) {
+    commit();
+  }
+}
+
+void CompressedFileIo::readBlock(const std::uint64_t block, char* out) {
+  if (block >= map_.size() || map_[block].length == 0) {
+    std::memset(out, 0, Page::SIZE);
+    return;
+  }
+  const Extent& extent = map_[block];
+  if (extent.length == Page::SIZE) {
+    raw_->read(out, Page::SIZE, extent.offset);
+    return;
+  }
+  raw_->read(&packed_[0], extent.length, extent.offset);
+  if (!lzDecompress(&packed_[0], extent.length, out, Page::SIZE)) {
+    throw FileIOException(filename_, "decompress", EIO);
+  }
+}
+
+void CompressedFileIo::writeBlock(const std::uint64_t block,
+                                  const char* data) {
+  // A block that does not save at least a sector is stored as it is
+  std::size_t length =
+      lzCompress(data, Page::SIZE, &packed_[0], Page::SIZE - SECTOR);
+  const char* stored = &packed_[0];
+  if (length == 0) {
+    length = Page::SIZE;
+    stored = data;
+  }
+
+  if (block >= map_.size()) {
+    Extent empty = {0, 0, 0};
+    map_.resize(block + 1, empty);
+  }
+  const std::uint64_t position = allocate(sectorsFor(length));
+  raw_->write(stored, length, position);
+
+  Extent& extent = map_[block];
+  if (extent.length != 0) {
+    released_.push_back(std::make_pair(extent.offset,
+                                       sectorsFor(extent.length)));
+  }
+  extent.offset = position;
+  extent.length = static_cast<std::uint32_t>(length);
+  dirty_ = true;
+}
+
+std::uint64_t CompressedFileIo::allocate(const std::uint64_t sectors) {
+  // Best fit: the smallest free extent that is large enough, split if larger
+  std::map<std::uint64_t, std::vector<std::uint64_t> >::iterator fit =
+      free_.lower_bound(sectors);
+  if (fit == free_.end()) {
+    const std::uint64_t position = end_;
+    end_ += sectors * SECTOR;
+    return position;
+  }
+  const std::uint64_t position = fit->second.back();
+  const std::uint64_t size = fit->first;
+  fit->second.pop_back();
+  if (fit->second.empty()) {
+    free_.erase(fit);
+  }
+  if (size > sectors) {
+    free_[size - sectors].push_back(position + sectors * SECTOR);
+  }
+  return position;
+}
+
+void CompressedFileIo::findFreeSpace() {
+  std::vector<std::pair<std::uint64_t, std::uint64_t> > used;
+  for (std::size_t i = 0; i < map_.size(); ++i) {
+    if (map_[i].length != 0) {
+      used.push_back(std::make_pair(map_[i].offset,
+                                    sectorsFor(map_[i].length) * SECTOR));
+    }
+  }
+  if (super_.mapLength != 0) {
+    used.push_back(std::make_pair(super_.mapOffset,
+                                  sectorsFor(super_.mapLength) * SECTOR));
+  }
+  std::sort(used.begin(), used.end());
+
+  std::uint64_t position = DATA_START;
+  for (std::size_t i = 0; i < used.size(); ++i) {
+    if (used[i].first > position) {
+      free_[(used[i].first - position) / SECTOR].push_back(position);
+    }
+    position = std::max(position, used[i].first + used[i].second);
+  }
+  if (end_ > position) {
+    free_[(end_ - position) / SECTOR].push_back(position);
+  }
+}
+
+void CompressedFileIo::commit() {
+  Superblock next = super_;
+  next.generation = super_.generation + 1;
+  next.mapLength = static_cast<std::uint32_t>(map_.size() * sizeof(Extent));
+  next.mapOffset = 0;
+  next.mapChecksum = 0;
+  if (next.mapLength != 0) {
+    next.mapOffset = allocate(sectorsFor(next.mapLength));
+    next.mapChecksum = crc32c(&map_[0], next.mapLength);
+    raw_->write(reinterpret_cast<const char*>(&map_[0]), next.mapLength,
+                next.mapOffset);
+  }
+  next.end = end_;
+  next.checksum = 0;
+  next.checksum = crc32c(&next, sizeof(next));
+
+  // The blocks and the table must be durable before the superblock points at
+  // them, and the superblock before what it replaces is reused
+  raw_->sync();
+  char sector[SECTOR] = {0};
+  std::memcpy(sector, &next, sizeof(next));
+  raw_->write(sector, SECTOR, (next.generation % 2) * SECTOR);
+  raw_->sync();
+
+  if (super_.mapLength != 0) {
+    free_[sectorsFor(super_.mapLength)].push_back(super_.mapOffset);
+  }
+  for (std::size_t i = 0; i < released_.size(); ++i) {
+    free_[released_[i].second].push_back(released_[i].first);
+  }
+  released_.clear();
+  super_ = next;
+  dirty_ = false;
+}
+
+}
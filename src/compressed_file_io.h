@@ -0,0 +1,220 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "file_io.h"
+
+namespace badgerdb {
+
+/**
+ * @brief FileIo of the COMPRESSED backend: every Page::SIZE block of the file
+ *        is stored compressed (see lzCompress()) in an extent of its own.
+ *
+ * The file as seen through this object is a sequence of blocks, byte n being
+ * at offset n % Page::SIZE of block n / Page::SIZE.  On disk, a block takes as
+ * many 512-byte sectors as its compressed form needs, or Page::SIZE bytes
+ * stored as they are if it does not compress.  A mapping table says where each
+ * block is; blocks never written read as zeros.
+ *
+ * Blocks are never overwritten in place: each write goes to a free extent and
+ * the one it replaces is only reused after the next sync().  sync() writes the
+ * mapping table to a free extent too and then points a superblock at it, two
+ * of which alternate at the start of the file, so after a crash the file reads
+ * as it was at the last sync() that completed.  The table is written and
+ * synced when the object is destroyed as well.
+ *
+ * Transfers must be serialized by the caller.
+ */
+class CompressedFileIo : public FileIo {
+ public:
+  /**
+   * Opens a compressed file, or creates an empty one.
+   *
+   * @param filename    Name of the file.
+   * @param create_new  Whether to create (or truncate) the file.
+   * @throws  FileIOException  If the file cannot be opened, or is not a
+   *                           compressed file.
+   */
+  CompressedFileIo(const std::string& filename, const bool create_new);
+
+  ~CompressedFileIo() override;
+
+  /**
+   * Returns true if an existing file is a compressed file.
+   *
+   * @param filename  Name of the file.
+   */
+  static bool detect(const std::string& filename);
+
+  void read(char* buffer, const std::size_t length,
+            const std::uint64_t offset) override;
+
+  void write(const char* buffer, const std::size_t length,
+             const std::uint64_t offset) override;
+
+  void sync() override;
+
+  bool concurrent() const override { return false; }
+
+  /**
+   * Returns the number of bytes of the file on disk, free extents included.
+   */
+  std::uint64_t storedLength() const { return end_; }
+
+ private:
+  CompressedFileIo(const CompressedFileIo&);
+  CompressedFileIo& operator=(const CompressedFileIo&);
+
+  /**
+   * Where a block is stored.
+   */
+  struct Extent {
+    /**
+     * Position in the file; meaningless if <length> is 0.
+     */
+    std::uint64_t offset;
+
+    /**
+     * Bytes stored: Page::SIZE if the block is stored as it is, 0 if it was
+     * never written.
+     */
+    std::uint32_t length;
+
+    std::uint32_t reserved;
+  };
+
+  /**
+   * Start of the file's physical layout, a sector each, ahead of the extents.
+   */
+  struct Superblock {
+    char magic[8];
+    std::uint32_t version;
+
+    /**
+     * CRC-32C of the superblock, computed with this field set to 0.
+     */
+    std::uint32_t checksum;
+
+    /**
+     * Incremented by every sync(); the valid superblock with the highest
+     * generation is the current one.
+     */
+    std::uint64_t generation;
+
+    /**
+     * Extent holding the mapping table.
+     */
+    std::uint64_t mapOffset;
+
+    /**
+     * End of the space in use; everything after it is free.
+     */
+    std::uint64_t end;
+
+    /**
+     * Bytes of the mapping table, one Extent per block.
+     */
+    std::uint32_t mapLength;
+
+    /**
+     * CRC-32C of the mapping table.
+     */
+    std::uint32_t mapChecksum;
+  };
+
+  /**
+   * Reads a whole block.
+   *
+   * @param block   Number of the block.
+   * @param out     Receives Page::SIZE bytes.
+   * @throws  FileIOException  If the block does not decompress.
+   */
+  void readBlock(const std::uint64_t block, char* out);
+
+  /**
+   * Compresses a whole block and writes it to a new extent.
+   *
+   * @param block   Number of the block.
+   * @param data    Page::SIZE bytes.
+   */
+  void writeBlock(const std::uint64_t block, const char* data);
+
+  /**
+   * Takes a free extent of the given number of sectors, from the free lists
+   * or from the end of the file.
+   *
+   * @return  Position of the extent.
+   */
+  std::uint64_t allocate(const std::uint64_t sectors);
+
+  /**
+   * Returns the extents not referenced by the mapping table to the free
+   * lists; used when an existing file is opened.
+   */
+  void findFreeSpace();
+
+  /**
+   * Writes the mapping table and the next superblock, syncing before and
+   * after the superblock, and frees what they no longer reference.
+   */
+  void commit();
+
+  /**
+   * The file itself.
+   */
+  std::unique_ptr<FileIo> raw_;
+
+  /**
+   * Where each block is stored.
+   */
+  std::vector<Extent> map_;
+
+  /**
+   * Free extents by number of sectors.
+   */
+  std::map<std::uint64_t, std::vector<std::uint64_t> > free_;
+
+  /**
+   * Extents (position, sectors) replaced since the last sync(); still
+   * referenced by the mapping table on disk, so not yet free.
+   */
+  std::vector<std::pair<std::uint64_t, std::uint64_t> > released_;
+
+  /**
+   * The current superblock.
+   */
+  Superblock super_;
+
+  /**
+   * End of the space in use.
+   */
+  std::uint64_t end_;
+
+  /**
+   * Whether the mapping table changed since the last sync().
+   */
+  bool dirty_;
+
+  /**
+   * A block, decompressed.
+   */
+  std::vector<char> block_;
+
+  /**
+   * A block, compressed.
+   */
+  std::vector<char> packed_;
+};
+
+}
@@ -0,0 +1,194 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "crc32c.h"
+
+#include <cstring>
+
+// The SSE4.2 instructions are compiled for that target alone and only used
+// once the processor is known to have them; the ARMv8 ones need the compiler
+// to target them already.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_SSE42 1
+#include <nmmintrin.h>
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CRC32C_ARMV8 1
+#include <arm_acle.h>
+#define CRC32C_TARGET
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * CRC-32C polynomial, bit-reflected.
+ */
+const std::uint32_t POLYNOMIAL = 0x82F63B78;
+
+/**
+ * Bytes each of the three streams of the hardware loop covers per round.
+ */
+const std::size_t LANE = 1024;
+
+/**
+ * @brief Lookup tables, built on first use.
+ */
+struct Tables {
+  /**
+   * Slicing-by-8 tables: bytes[k][b] is the checksum register after byte b
+   * followed by k zero bytes.
+   */
+  std::uint32_t bytes[8][256];
+
+  /**
+   * Shifts a checksum register over LANE zero bytes, a byte of the register
+   * at a time: shift[k][b] is the result for byte k of the register being b.
+   */
+  std::uint32_t shift[4][256];
+
+  Tables();
+};
+
+std::uint32_t softwareUpdate(const Tables& tables, std::uint32_t crc,
+                             const unsigned char* data, std::size_t length) {
+  const std::uint32_t (*t)[256] = tables.bytes;
+  while (length >= 8) {
+    crc ^= (std::uint32_t) data[0] | (std::uint32_t) data[1] << 8 |
+           (std::uint32_t) data[2] << 16 | (std::uint32_t) data[3] << 24;
+    crc = t[7][crc & 0xFF] ^ t[6][(crc >> 8) & 0xFF] ^
+          t[5][(crc >> 16) & 0xFF] ^ t[4][crc >> 24] ^
+          t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    data += 8;
+    length -= 8;
+  }
+  for (; length > 0; data++, length--) {
+    crc = t[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+Tables::Tables() {
+  for (std::uint32_t b = 0; b < 256; b++) {
+    std::uint32_t crc = b;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ ((crc & 1) ? POLYNOMIAL : 0);
+    }
+    bytes[0][b] = crc;
+  }
+  for (int k = 1; k < 8; k++) {
+    for (std::uint32_t b = 0; b < 256; b++) {
+      bytes[k][b] = (bytes[k - 1][b] >> 8) ^ bytes[0][bytes[k - 1][b] & 0xFF];
+    }
+  }
+  // The checksum is linear in the register, so shifting it is the sum of
+  // shifting each of its bytes
+  const unsigned char zeros[LANE] = {0};
+  for (int k = 0; k < 4; k++) {
+    for (std::uint32_t b = 0; b < 256; b++) {
+      shift[k][b] = softwareUpdate(*this, b << (8 * k), zeros, LANE);
+    }
+  }
+}
+
+const Tables& tables() {
+  static const Tables built;
+  return built;
+}
+
+#if defined(CRC32C_SSE42) || defined(CRC32C_ARMV8)
+
+CRC32C_TARGET inline std::uint64_t crcWord(const std::uint64_t crc,
+                                           const unsigned char* data) {
+  std::uint64_t word;
+  std::memcpy(&word, data, sizeof(word));
+#if defined(CRC32C_SSE42)
+  return _mm_crc32_u64(crc, word);
+#else
+  return __crc32cd((std::uint32_t) crc, word);
+#endif
+}
+
+CRC32C_TARGET inline std::uint32_t crcByte(const std::uint32_t crc,
+                                           const unsigned char data) {
+#if defined(CRC32C_SSE42)
+  return _mm_crc32_u8(crc, data);
+#else
+  return __crc32cb(crc, data);
+#endif
+}
+
+inline std::uint32_t shiftLane(const Tables& tables, const std::uint32_t crc) {
+  return tables.shift[0][crc & 0xFF] ^ tables.shift[1][(crc >> 8) & 0xFF] ^
+         tables.shift[2][(crc >> 16) & 0xFF] ^ tables.shift[3][crc >> 24];
+}
+
+CRC32C_TARGET std::uint32_t hardwareUpdate(const Tables& tables,
+                                           std::uint32_t crc,
+                                           const unsigned char* data,
+                                           std::size_t length) {
+  // Each instruction waits for the one before it on the same stream, so three
+  // streams over consecutive lanes run side by side; the checksum of the lanes
+  // together is the first shifted over the second, the sum shifted over the
+  // third
+  while (length >= 3 * LANE) {
+    std::uint64_t first = crc;
+    std::uint64_t second = 0;
+    std::uint64_t third = 0;
+    for (std::size_t i = 0; i < LANE; i += 8) {
+      first = crcWord(first, data + i);
+      second = crcWord(second, data + LANE + i);
+      third = crcWord(third, data + 2 * LANE + i);
+    }
+    crc = shiftLane(tables, shiftLane(tables, first) ^ second) ^ third;
+    data += 3 * LANE;
+    length -= 3 * LANE;
+  }
+  std::uint64_t wide = crc;
+  for (; length >= 8; data += 8, length -= 8) {
+    wide = crcWord(wide, data);
+  }
+  crc = wide;
+  for (; length > 0; data++, length--) {
+    crc = crcByte(crc, *data);
+  }
+  return crc;
+}
+
+#endif
+
+bool hasHardware() {
+#if defined(CRC32C_SSE42)
+  static const bool supported = (__builtin_cpu_init(),
+                                 __builtin_cpu_supports("sse4.2") != 0);
+  return supported;
+#elif defined(CRC32C_ARMV8)
+  return true;
+#else
+  return false;
+#endif
+}
+
+}
+
+std::uint32_t crc32c(const void* data, std::size_t length, std::uint32_t crc) {
+  const Tables& lookup = tables();
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+#if defined(CRC32C_SSE42) || defined(CRC32C_ARMV8)
+  if (hasHardware()) {
+    return ~hardwareUpdate(lookup, ~crc, bytes, length);
+  }
+#endif
+  return ~softwareUpdate(lookup, ~crc, bytes, length);
+}
+
+bool crc32cHardware() {
+  return hasHardware();
+}
+
+}
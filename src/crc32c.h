@@ -0,0 +1,37 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * Computes the CRC-32C (Castagnoli) checksum of a buffer, or extends the
+ * checksum of what came before it: crc32c(b, n, crc32c(a, m)) is the checksum
+ * of a followed by b.
+ *
+ * Uses the CRC32 instructions of SSE4.2 or ARMv8 where the processor has them,
+ * running three independent streams so a page is checksummed at close to one
+ * 8-byte word per cycle, and falls back to tables otherwise.
+ *
+ * @param data    Bytes to checksum.
+ * @param length  Number of bytes.
+ * @param crc     Checksum of the bytes before <data>; 0 to start afresh.
+ * @return  Checksum of everything up to the end of <data>.
+ */
+std::uint32_t crc32c(const void* data, std::size_t length,
+                     std::uint32_t crc = 0);
+
+/**
+ * Returns true if crc32c() uses CRC32 instructions on this processor.
+ */
+bool crc32cHardware();
+
+}
@@ -0,0 +1,27 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_size_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+PageSizeException::PageSizeException(const std::string& file,
+                                     const std::size_t stored,
+                                     const std::size_t expected)
+    : BadgerDbException(""),
+      page_size_(stored),
+      filename_(file) {
+  std::stringstream ss;
+  ss << "File '" << filename_ << "' has pages of " << page_size_
+     << " bytes, but this build uses pages of " << expected << " bytes";
+  message_.assign(ss.str());
+}
+
+}
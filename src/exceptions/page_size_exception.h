@@ -0,0 +1,61 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a file being opened was created with
+ *        a different page size than the one compiled in (Page::SIZE).
+ */
+class PageSizeException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a page size exception for the given file.
+   *
+   * @param file      Name of the file.
+   * @param stored    Page size the file was created with.
+   * @param expected  Page size of this build.
+   */
+  PageSizeException(const std::string& file, const std::size_t stored,
+                    const std::size_t expected);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~PageSizeException() throw() {}
+
+  /**
+   * Returns the page size the file was created with.
+   */
+  virtual std::size_t page_size() const { return page_size_; }
+
+  /**
+   * Returns name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Page size the file was created with.
+   */
+  const std::size_t page_size_;
+
+  /**
+   * Name of file which caused this exception.
+   */
+  const std::string filename_;
+};
+
+}
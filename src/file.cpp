@@ -7,31 +7,38 @@
 
 #include "file.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <cstdio>
 #include <cassert>
+#include <cstring>
+#include <iterator>
 
+#include "compressed_file_io.h"
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/page_checksum_exception.h"
+#include "exceptions/page_size_exception.h"
 #include "file_iterator.h"
 #include "page.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
+File::StateMap File::open_states_;
 File::CountMap File::open_counts_;
+FileId File::next_id_ = 1;
 
-File File::create(const std::string& filename) {
-  return File(filename, true /* create_new */);
+File File::create(const std::string& filename, const FileBackend backend) {
+  return File(filename, true /* create_new */, backend);
 }
 
-File File::open(const std::string& filename) {
-  return File(filename, false /* create_new */);
+File File::open(const std::string& filename, const FileBackend backend) {
+  return File(filename, false /* create_new */, backend);
 }
 
 void File::remove(const std::string& filename) {
@@ -42,6 +49,7 @@ void File::remove(const std::string& filename) {
     throw FileOpenException(filename);
   }
   std::remove(filename.c_str());
+  std::remove(fsmName(filename).c_str());
 }
 
 bool File::isOpen(const std::string& filename) {
@@ -64,16 +72,17 @@ bool File::exists(const std::string& filename) {
 
 File::File(const File& other)
   : filename_(other.filename_),
-    stream_(open_streams_[filename_]) {
+    state_(open_states_[filename_]) {
   ++open_counts_[filename_];
 }
 
 File& File::operator=(const File& rhs) {
   // This accounts for self-assignment and assignment of a File object for the
   // same file.
+  const FileBackend backend = rhs.backend();
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
-  openIfNeeded(false /* create_new */);
+  openIfNeeded(false /* create_new */, backend);
   return *this;
 }
 
@@ -82,6 +91,7 @@ File::~File() {
 }
 
 Page File::allocatePage() {
+  std::lock_guard<std::recursive_mutex> lock(state_->mutex);
   FileHeader header = readHeader();
   Page new_page;
   Page existing_page;
@@ -91,48 +101,43 @@ Page File::allocatePage() {
     header.first_free_page = new_page.next_page_number();
     --header.num_free_pages;
 
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
+    // Keeps the used list in page order: the new page goes after the closest
+    // used page before it.
+    std::set<PageId>& used = usedPages(header);
+    std::set<PageId>::iterator next = used.lower_bound(new_page.page_number());
+    if (next == used.begin()) {
       // Either have no pages used or the head of the used list is a page later
       // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
+      new_page.set_next_page_number(header.first_used_page);
       header.first_used_page = new_page.page_number();
     } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
+      existing_page = readPage(*std::prev(next));
+      new_page.set_next_page_number(existing_page.next_page_number());
       existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
     }
+    if (new_page.next_page_number() == Page::INVALID_NUMBER) {
+      header.last_used_page = new_page.page_number();
+    }
+    used.insert(next, new_page.page_number());
 
     assert((header.num_free_pages == 0) ==
            (header.first_free_page == Page::INVALID_NUMBER));
   } else {
+    reserveExtent(header.num_pages + 1);
     new_page.set_page_number(header.num_pages);
     if (header.first_used_page == Page::INVALID_NUMBER) {
       header.first_used_page = new_page.page_number();
     } else {
       // If we have pages allocated, we need to add the new page to the tail
       // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
+      existing_page = readPage(header.last_used_page);
       existing_page.set_next_page_number(new_page.page_number());
     }
+    header.last_used_page = new_page.page_number();
+    if (state_->used_pages_known) {
+      state_->used_pages.insert(state_->used_pages.end(),
+                                new_page.page_number());
+    }
     ++header.num_pages;
   }
   writePage(new_page.page_number(), new_page);
@@ -146,59 +151,237 @@ Page File::allocatePage() {
   return new_page;
 }
 
+std::vector<Page> File::allocatePages(const std::size_t count) {
+  std::lock_guard<std::recursive_mutex> lock(state_->mutex);
+  std::vector<Page> new_pages;
+  new_pages.reserve(count);
+  FileHeader header = readHeader();
+  while (new_pages.size() < count && header.num_free_pages > 0) {
+    new_pages.push_back(allocatePage());
+    header = readHeader();
+  }
+  const std::size_t appended = count - new_pages.size();
+  if (appended == 0) {
+    return new_pages;
+  }
+
+  // The rest are appended in one go.
+  new_pages.resize(count);
+  appendPages(&new_pages[count - appended], appended);
+
+  return new_pages;
+}
+
+PageId File::appendPages(Page* pages, const std::size_t count) {
+  std::lock_guard<std::recursive_mutex> lock(state_->mutex);
+  FileHeader header = readHeader();
+  const PageId first = header.num_pages;
+  if (count == 0) {
+    return first;
+  }
+  const PageId tail = header.first_used_page == Page::INVALID_NUMBER
+      ? Page::INVALID_NUMBER : header.last_used_page;
+
+  // Chains the new pages after the tail and writes them in one go.
+  std::vector<const char*> buffers;
+  buffers.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    pages[i].set_page_number(first + i);
+    pages[i].set_next_page_number(i + 1 < count ? first + i + 1
+                                                : Page::INVALID_NUMBER);
+    pages[i].header_->checksum = pages[i].computeChecksum();
+    buffers.push_back(reinterpret_cast<const char*>(pages[i].header_));
+  }
+  reserveExtent(first + count);
+  state_->io->writev(&buffers[0], count, Page::SIZE, pagePosition(first));
+  for (std::size_t i = 0; i < count; ++i) {
+    recordLink(first + i, *pages[i].header_, true /* overwrite */);
+    noteFreeSpace(first + i, *pages[i].header_);
+  }
+
+  if (tail == Page::INVALID_NUMBER) {
+    header.first_used_page = first;
+  } else {
+    Page existing_page = readPage(tail);
+    existing_page.set_next_page_number(first);
+    writePage(tail, existing_page);
+  }
+  header.last_used_page = first + count - 1;
+  header.num_pages += count;
+  if (state_->used_pages_known) {
+    for (std::size_t i = 0; i < count; ++i) {
+      state_->used_pages.insert(state_->used_pages.end(), first + i);
+    }
+  }
+  writeHeader(header);
+
+  return first;
+}
+
+void File::extendTo(const PageId end) {
+  std::lock_guard<std::recursive_mutex> lock(state_->mutex);
+  const FileHeader header = readHeader();
+  if (end <= header.num_pages) {
+    return;
+  }
+  std::vector<Page> pages(end - header.num_pages);
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    const PageId page_number = header.num_pages + i;
+    try {
+      // Reads past the end of the file return an empty page.
+      const Page existing = readPage(page_number, true /* allow_free */);
+      if (existing.page_number() == page_number) {
+        pages[i] = existing;
+      }
+    } catch (const PageChecksumException&) {
+      // Torn by the crash; starts out empty.
+    }
+  }
+  appendPages(&pages[0], pages.size());
+}
+
 Page File::readPage(const PageId page_number) const {
+  Page page;
+  readPageInto(page_number, page);
+  return page;
+}
+
+void File::readPageInto(const PageId page_number, Page& page) const {
+  std::unique_lock<std::recursive_mutex> lock = lockIo();
   FileHeader header = readHeader();
   if (page_number >= header.num_pages) {
     throw InvalidPageException(page_number, filename_);
   }
-  return readPage(page_number, false /* allow_free */);
+  readPageInto(page_number, false /* allow_free */, page);
+}
+
+void File::readPagesInto(const PageId first_page_number,
+                         const std::vector<Page*>& pages) const {
+  if (pages.empty()) {
+    return;
+  }
+  std::unique_lock<std::recursive_mutex> lock = lockIo();
+  FileHeader header = readHeader();
+  if (first_page_number + pages.size() > header.num_pages) {
+    throw InvalidPageException(
+        std::max<PageId>(first_page_number, header.num_pages), filename_);
+  }
+  std::vector<char*> buffers;
+  buffers.reserve(pages.size());
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    buffers.push_back(reinterpret_cast<char*>(pages[i]->header_));
+  }
+  state_->io->readv(&buffers[0], pages.size(), Page::SIZE,
+                    pagePosition(first_page_number));
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    verifyChecksum(first_page_number + i, *pages[i]);
+  }
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    recordLink(first_page_number + i, *pages[i]->header_,
+               false /* overwrite */);
+  }
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    if (!pages[i]->isUsed()) {
+      throw InvalidPageException(first_page_number + i, filename_);
+    }
+  }
 }
 
 Page File::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
-  stream_->read(&page.data_[0], Page::DATA_SIZE);
+  readPageInto(page_number, allow_free, page);
+  return page;
+}
+
+void File::readPageInto(const PageId page_number, const bool allow_free,
+                        Page& page) const {
+  std::unique_lock<std::recursive_mutex> lock = lockIo();
+  state_->io->read(reinterpret_cast<char*>(page.header_), Page::SIZE,
+                   pagePosition(page_number));
+  verifyChecksum(page_number, page);
+  recordLink(page_number, *page.header_, false /* overwrite */);
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
-
-  return page;
 }
 
 void File::writePage(const Page& new_page) {
-  PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
+  std::lock_guard<std::recursive_mutex> lock(state_->mutex);
+  PageLink current = link(new_page.page_number());
+  if (!current.known) {
+    readPageHeader(new_page.page_number());
+    current = link(new_page.page_number());
+  }
+  if (!current.used) {
     // Page has been deleted since it was read.
     throw InvalidPageException(new_page.page_number(), filename_);
   }
   // Page on disk may have had its next page pointer updated since it was read;
   // we don't modify that, but we do keep all the other modifications to the
   // page header.
-  const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
-  header.next_page_number = next_page_number;
-  writePage(new_page.page_number(), header, new_page);
+  if (new_page.next_page_number() == current.next_page_number) {
+    writePage(new_page.page_number(), new_page);
+  } else {
+    PageHeader header = *new_page.header_;
+    header.next_page_number = current.next_page_number;
+    writePage(new_page.page_number(), header, new_page);
+  }
+}
+
+PageId File::findPageWithSpace(const std::size_t length) {
+  bool known;
+  {
+    std::lock_guard<std::mutex> lock(state_->fsm_mutex);
+    known = state_->fsm_known;
+  }
+  if (!known) {
+    std::lock_guard<std::recursive_mutex> lock(state_->mutex);
+    buildFreeSpaceMap();
+  }
+
+  // Categories round down, so every page of this category or above has room
+  const std::size_t needed = std::max<std::size_t>(
+      1, (length * 255 + Page::DATA_SIZE - 1) / Page::DATA_SIZE);
+  std::lock_guard<std::mutex> lock(state_->fsm_mutex);
+  for (std::size_t category = needed; category <= 255; ++category) {
+    const std::set<PageId>& pages = state_->fsm_buckets[category];
+    if (!pages.empty()) {
+      return *pages.begin();
+    }
+  }
+  return Page::INVALID_NUMBER;
+}
+
+void File::sync() const {
+  std::lock_guard<std::recursive_mutex> lock(state_->mutex);
+  flushHeader();
+  state_->io->sync();
+  if (state_->fsm_io) {
+    state_->fsm_io->sync();
+  }
 }
 
 void File::deletePage(const PageId page_number) {
+  std::lock_guard<std::recursive_mutex> lock(state_->mutex);
   FileHeader header = readHeader();
   Page existing_page = readPage(page_number);
   Page previous_page;
+  std::set<PageId>& used = usedPages(header);
   // If this page is the head of the used list, update the header to point to
   // the next page in line.
   if (page_number == header.first_used_page) {
     header.first_used_page = existing_page.next_page_number();
   } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
-      }
-    }
+    // Update the used page just before this one, which points to it.
+    std::set<PageId>::iterator current = used.find(page_number);
+    assert(current != used.end() && current != used.begin());
+    previous_page = readPage(*std::prev(current));
+    previous_page.set_next_page_number(existing_page.next_page_number());
   }
+  if (page_number == header.last_used_page) {
+    header.last_used_page = previous_page.page_number();
+  }
+  used.erase(page_number);
   // Clear the page and add it to the head of the free list.
   existing_page.initialize();
   existing_page.set_next_page_number(header.first_free_page);
@@ -220,85 +403,397 @@ FileIterator File::end() {
   return FileIterator(this, Page::INVALID_NUMBER);
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
-  openIfNeeded(create_new);
+File::File(const std::string& name, const bool create_new,
+           const FileBackend backend) : filename_(name) {
+  openIfNeeded(create_new, backend);
 
   if (create_new) {
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         0 /* last_used_page */,
+                         static_cast<std::uint32_t>(Page::SIZE)};
     writeHeader(header);
   }
 }
 
-void File::openIfNeeded(const bool create_new) {
+void File::openIfNeeded(const bool create_new, const FileBackend backend) {
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+    state_ = open_states_[filename_];
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
       if (already_exists) {
         throw FileExistsException(filename_);
       }
-      // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
         throw FileNotFoundException(filename_);
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
+    // New files are truncated on open.
+    state_.reset(new FileState);
+    state_->id = next_id_++;
+    // A compressed file can only be read as one
+    const FileBackend actual =
+        !create_new && CompressedFileIo::detect(filename_)
+            ? FileBackend::COMPRESSED : backend;
+    state_->io.reset(FileIo::open(filename_, create_new, actual));
+    if (!create_new) {
+      state_->io->read(reinterpret_cast<char*>(&state_->header),
+                       sizeof(state_->header), 0 /* offset */);
+      const std::size_t page_size = state_->header.page_size != 0
+          ? state_->header.page_size : LEGACY_PAGE_SIZE;
+      if (page_size != Page::SIZE) {
+        state_.reset();
+        throw PageSizeException(filename_, page_size, Page::SIZE);
+      }
+      loadFreeSpaceMap();
+      state_->reserved_pages = state_->header.num_pages;
+    } else {
+      // A map left by an earlier file of that name is overwritten
+      std::remove(fsmName(filename_).c_str());
+      state_->fsm_known = true;
+      state_->reserved_pages = 1;
+    }
+    state_->extent_pages = DEFAULT_EXTENT_SIZE / Page::SIZE;
+    open_states_[filename_] = state_;
     open_counts_[filename_] = 1;
   }
 }
 
+std::unique_lock<std::recursive_mutex> File::lockIo() const {
+  if (state_->io->concurrent()) {
+    return std::unique_lock<std::recursive_mutex>(state_->mutex,
+                                                  std::defer_lock);
+  }
+  return std::unique_lock<std::recursive_mutex>(state_->mutex);
+}
+
 void File::close() {
+  if (open_counts_[filename_] == 1) {
+    flushHeader();
+  }
   --open_counts_[filename_];
-  stream_.reset();
+  state_.reset();
   if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
+    open_states_.erase(filename_);
     open_counts_.erase(filename_);
   }
 }
 
 void File::writePage(const PageId page_number, const Page& new_page) {
-  writePage(page_number, new_page.header_, new_page);
+  writePage(page_number, *new_page.header_, new_page);
 }
 
 void File::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
-  stream_->flush();
+  // Assembles the page in memory, so it still takes a single transfer and the
+  // bytes checksummed are the bytes written even if the page changes meanwhile.
+  // Each thread has a page of its own for it, aligned for direct I/O and
+  // allocated once.
+  static thread_local Page out;
+  out = new_page;
+  *out.header_ = header;
+  out.header_->checksum = out.computeChecksum();
+  std::unique_lock<std::recursive_mutex> lock = lockIo();
+  state_->io->write(reinterpret_cast<const char*>(out.header_), Page::SIZE,
+                    pagePosition(page_number));
+  recordLink(page_number, header, true /* overwrite */);
+  noteFreeSpace(page_number, header);
 }
 
-FileHeader File::readHeader() const {
-  FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+void File::verifyChecksum(const PageId page_number, const Page& page) const {
+  // The buffer pool changes pages of mapped files in place, ahead of their
+  // checksums
+  const std::uint32_t stored = page.header_->checksum;
+  if (stored == 0 || mapped()) {
+    return;
+  }
+  const std::uint32_t computed = page.computeChecksum();
+  if (computed != stored) {
+    throw PageChecksumException(page_number, filename_, stored, computed);
+  }
+}
 
-  return header;
+FileHeader File::readHeader() const {
+  std::lock_guard<std::mutex> lock(state_->header_mutex);
+  return state_->header;
 }
 
 void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->flush();
+  std::lock_guard<std::mutex> lock(state_->header_mutex);
+  state_->header = header;
+  state_->header_dirty = true;
+}
+
+void File::flushHeader() const {
+  flushFreeSpaceMap();
+  std::unique_lock<std::recursive_mutex> io_lock = lockIo();
+  std::lock_guard<std::mutex> lock(state_->header_mutex);
+  if (state_->header_dirty) {
+    state_->io->write(reinterpret_cast<const char*>(&state_->header),
+                      sizeof(state_->header), 0 /* offset */);
+    state_->header_dirty = false;
+  }
+}
+
+std::uint8_t File::spaceCategory(const PageHeader& header) {
+  if (header.current_page_number == Page::INVALID_NUMBER) {
+    return 0;
+  }
+  // As Page::hasSpaceForRecord() counts it: a new record may need a new slot
+  std::size_t room = header.free_space_upper_bound -
+      header.free_space_lower_bound + header.fragmented_bytes;
+  const std::size_t slot = header.num_free_slots == 0 ? sizeof(PageSlot) : 0;
+  room = room > slot ? room - slot : 0;
+  return static_cast<std::uint8_t>(room * 255 / Page::DATA_SIZE);
+}
+
+void File::noteFreeSpace(const PageId page_number,
+                         const PageHeader& header) const {
+  std::lock_guard<std::mutex> lock(state_->fsm_mutex);
+  if (state_->fsm_known) {
+    setSpaceCategory(page_number, spaceCategory(header));
+  }
+}
+
+void File::setSpaceCategory(const PageId page_number,
+                            const std::uint8_t category) const {
+  FileState& state = *state_;
+  if (page_number >= state.fsm.size()) {
+    if (category == 0) {
+      return;
+    }
+    state.fsm.resize(page_number + 1, 0);
+  }
+  std::uint8_t& current = state.fsm[page_number];
+  if (current == category) {
+    return;
+  }
+  if (current != 0) {
+    state.fsm_buckets[current].erase(page_number);
+  }
+  if (category != 0) {
+    state.fsm_buckets[category].insert(page_number);
+  }
+  current = category;
+  state.fsm_changed.insert(page_number / Page::DATA_SIZE);
+}
+
+void File::loadFreeSpaceMap() {
+  FileState& state = *state_;
+  const std::string name = fsmName(filename_);
+  if (!std::ifstream(name)) {
+    return;
+  }
+  state.fsm_io.reset(FileIo::open(name, false, FileBackend::POSIX));
+  const FileHeader header = readHeader();
+  std::vector<std::uint8_t> categories;
+  Page page;
+  for (std::size_t k = 0; k * Page::DATA_SIZE < header.num_pages; ++k) {
+    // Pages never stored read as zeros, which stand for no room; a torn page
+    // means the map cannot be trusted
+    state.fsm_io->read(reinterpret_cast<char*>(page.header_), Page::SIZE,
+                       pagePosition(k));
+    if (page.header_->checksum != 0 &&
+        page.computeChecksum() != page.header_->checksum) {
+      return;
+    }
+    categories.insert(categories.end(), page.data_,
+                      page.data_ + Page::DATA_SIZE);
+  }
+
+  std::lock_guard<std::mutex> lock(state.fsm_mutex);
+  for (PageId page_number = 0; page_number < header.num_pages;
+       ++page_number) {
+    setSpaceCategory(page_number, categories[page_number]);
+  }
+  state.fsm_changed.clear();
+  state.fsm_known = true;
+}
+
+void File::buildFreeSpaceMap() {
+  if (state_->fsm_known) {
+    return;
+  }
+  const FileHeader header = readHeader();
+  std::vector<std::pair<PageId, std::uint8_t> > categories;
+  const std::set<PageId>& used = usedPages(header);
+  for (std::set<PageId>::const_iterator page_number = used.begin();
+       page_number != used.end(); ++page_number) {
+    categories.push_back(std::make_pair(
+        *page_number, spaceCategory(readPageHeader(*page_number))));
+  }
+
+  std::lock_guard<std::mutex> lock(state_->fsm_mutex);
+  for (std::size_t i = 0; i < categories.size(); ++i) {
+    setSpaceCategory(categories[i].first, categories[i].second);
+  }
+  // The whole map is stored with the header, zeros included
+  for (std::size_t k = 0; k * Page::DATA_SIZE < header.num_pages; ++k) {
+    state_->fsm_changed.insert(k);
+  }
+  state_->fsm_known = true;
+}
+
+void File::flushFreeSpaceMap() const {
+  std::lock_guard<std::recursive_mutex> lock(state_->mutex);
+  std::lock_guard<std::mutex> fsm_lock(state_->fsm_mutex);
+  FileState& state = *state_;
+  if (!state.fsm_known || state.fsm_changed.empty()) {
+    return;
+  }
+  if (!state.fsm_io) {
+    state.fsm_io.reset(FileIo::open(fsmName(filename_), true,
+                                    FileBackend::POSIX));
+  }
+  Page page;
+  for (std::set<std::size_t>::const_iterator k = state.fsm_changed.begin();
+       k != state.fsm_changed.end(); ++k) {
+    page.initialize();
+    page.set_page_number(*k);
+    const std::size_t first = *k * Page::DATA_SIZE;
+    if (first < state.fsm.size()) {
+      std::size_t count = state.fsm.size() - first;
+      if (count > Page::DATA_SIZE) {
+        count = Page::DATA_SIZE;
+      }
+      std::memcpy(page.data_, &state.fsm[first], count);
+    }
+    page.header_->checksum = page.computeChecksum();
+    state.fsm_io->write(reinterpret_cast<const char*>(page.header_),
+                        Page::SIZE, pagePosition(*k));
+  }
+  state.fsm_changed.clear();
+}
+
+std::string File::fsmName(const std::string& filename) {
+  return filename + ".fsm";
 }
 
 PageHeader File::readPageHeader(PageId page_number) const {
+  std::unique_lock<std::recursive_mutex> lock = lockIo();
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  state_->io->read(reinterpret_cast<char*>(&header), sizeof(header),
+                   pagePosition(page_number));
+  recordLink(page_number, header, false /* overwrite */);
 
   return header;
 }
 
+std::set<PageId>& File::usedPages(const FileHeader& header) {
+  if (!state_->used_pages_known) {
+    std::set<PageId>& used = state_->used_pages;
+    used.clear();
+    for (PageId page_number = header.first_used_page;
+         page_number != Page::INVALID_NUMBER;) {
+      PageLink current = link(page_number);
+      if (!current.known) {
+        readPageHeader(page_number);
+        current = link(page_number);
+      }
+      used.insert(used.end(), page_number);
+      page_number = current.next_page_number;
+    }
+    state_->used_pages_known = true;
+  }
+  return state_->used_pages;
+}
+
+void File::recordLink(const PageId page_number, const PageHeader& header,
+                      const bool overwrite) const {
+  std::lock_guard<std::mutex> lock(state_->links_mutex);
+  std::vector<PageLink>& links = state_->links;
+  if (page_number >= links.size()) {
+    links.resize(page_number + 1, PageLink{false, false, Page::INVALID_NUMBER});
+  }
+  PageLink& entry = links[page_number];
+  if (overwrite || !entry.known) {
+    entry.known = true;
+    entry.used = header.current_page_number != Page::INVALID_NUMBER;
+    entry.next_page_number = header.next_page_number;
+  }
+}
+
+PageLink File::link(const PageId page_number) const {
+  std::lock_guard<std::mutex> lock(state_->links_mutex);
+  if (page_number >= state_->links.size()) {
+    return PageLink{false, false, Page::INVALID_NUMBER};
+  }
+  return state_->links[page_number];
+}
+
+void File::advise(const AccessPattern pattern,
+                  const PageId first_page_number, const PageId count) const {
+  state_->io->advise(pattern, pagePosition(first_page_number),
+                     static_cast<std::uint64_t>(count) * Page::SIZE);
+}
+
+void File::setExtentSize(const std::uint64_t bytes) {
+  std::lock_guard<std::recursive_mutex> lock(state_->mutex);
+  state_->extent_pages =
+      static_cast<PageId>((bytes + Page::SIZE - 1) / Page::SIZE);
+}
+
+std::uint64_t File::extentSize() const {
+  std::lock_guard<std::recursive_mutex> lock(state_->mutex);
+  return pagePosition(state_->extent_pages);
+}
+
+void File::reserveExtent(const PageId end) {
+  const PageId extent = state_->extent_pages;
+  if (extent == 0 || end <= state_->reserved_pages) {
+    return;
+  }
+  // Rounded up so that extents start at multiples of their size
+  const PageId target = (end + extent - 1) / extent * extent;
+  state_->io->preallocate(pagePosition(state_->reserved_pages),
+                          pagePosition(target) -
+                              pagePosition(state_->reserved_pages));
+  state_->reserved_pages = target;
+}
+
+char* File::mapPage(const PageId page_number) const {
+  FileHeader header = readHeader();
+  const std::uint64_t offset = pagePosition(page_number);
+  if (page_number == Page::INVALID_NUMBER || page_number >= header.num_pages ||
+      offset + Page::SIZE > state_->io->mappedLength()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  char* frame = state_->io->mapping() + offset;
+  const PageHeader& page_header = *reinterpret_cast<PageHeader*>(frame);
+  recordLink(page_number, page_header, false /* overwrite */);
+  if (page_header.current_page_number == Page::INVALID_NUMBER) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return frame;
+}
+
+bool File::prepareAsyncRead(const PageId page_number, Page& page, int& fd,
+                            std::uint64_t& offset, char*& buffer) const {
+  fd = state_->io->descriptor();
+  if (fd < 0) {
+    return false;
+  }
+  FileHeader header = readHeader();
+  if (page_number >= header.num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  offset = pagePosition(page_number);
+  buffer = reinterpret_cast<char*>(page.header_);
+  return true;
+}
+
+void File::finishAsyncRead(const PageId page_number, const Page& page) const {
+  verifyChecksum(page_number, page);
+  recordLink(page_number, *page.header_, false /* overwrite */);
+  if (!page.isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+}
+
 }
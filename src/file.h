@@ -11,7 +11,11 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
 
+#include "file_io.h"
 #include "page.h"
 
 namespace badgerdb {
@@ -42,6 +46,18 @@ struct FileHeader {
    */
   PageId first_free_page;
 
+  /**
+   * Page number of the last used page in the file, so that pages can be
+   * appended to the used list without walking it.
+   */
+  PageId last_used_page;
+
+  /**
+   * Size of the pages of the file, in bytes.  0 in files created before it was
+   * recorded, all of which have pages of File::LEGACY_PAGE_SIZE bytes.
+   */
+  std::uint32_t page_size;
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -52,45 +68,236 @@ struct FileHeader {
     return num_pages == rhs.num_pages &&
         num_free_pages == rhs.num_free_pages &&
         first_used_page == rhs.first_used_page &&
-        first_free_page == rhs.first_free_page;
+        first_free_page == rhs.first_free_page &&
+        last_used_page == rhs.last_used_page &&
+        page_size == rhs.page_size;
   }
 };
 
+/**
+ * @brief What a File remembers about the position of one page in the used and
+ *        free lists.
+ */
+struct PageLink {
+  /**
+   * Whether the fields below reflect the page on disk.
+   */
+  bool known;
+
+  /**
+   * Whether the page is in use (on the used list) or free.
+   */
+  bool used;
+
+  /**
+   * Number of the next page on the list the page is on.
+   */
+  PageId next_page_number;
+};
+
+/**
+ * @brief State shared by all File objects referring to the same open file.
+ */
+struct FileState {
+  /**
+   * Identifier of the open file.
+   */
+  FileId id;
+
+  /**
+   * Backend for the underlying filesystem object.
+   */
+  std::unique_ptr<FileIo> io;
+
+  /**
+   * Mutex guarding <io> and the lists of the file.  Recursive because compound
+   * operations such as File::allocatePage() call the other I/O methods while
+   * holding it.
+   */
+  std::recursive_mutex mutex;
+
+  /**
+   * Mutex guarding <links>; taken briefly, also by transfers that skip <mutex>.
+   */
+  std::mutex links_mutex;
+
+  /**
+   * List links of the pages seen so far, indexed by page number.  Every change
+   * to a link goes through File, so a known link is always current and
+   * writing a page never has to read its header back from disk first.
+   */
+  std::vector<PageLink> links;
+
+  /**
+   * Numbers of the used pages, for finding the predecessor of a page on the
+   * used list without walking it.  Built by the first operation needing it;
+   * guarded by <mutex>.
+   */
+  std::set<PageId> used_pages;
+
+  /**
+   * Whether <used_pages> has been built.
+   */
+  bool used_pages_known;
+
+  /**
+   * Mutex guarding <header> and <header_dirty>; taken briefly, also by reads
+   * that skip <mutex>.
+   */
+  std::mutex header_mutex;
+
+  /**
+   * Current header of the file.  Loaded when the file is opened; changes are
+   * written back by File::sync() and when the last File object referring to
+   * the file is closed.
+   */
+  FileHeader header;
+
+  /**
+   * Whether <header> differs from the header on disk.
+   */
+  bool header_dirty;
+
+  /**
+   * Mutex guarding the free space map below; taken briefly, also by writes
+   * that skip <mutex>.
+   */
+  std::mutex fsm_mutex;
+
+  /**
+   * Free space category of every page, indexed by page number (see
+   * File::findPageWithSpace()); 0 for pages that are full, not in use or not
+   * written since the map was last stored.
+   */
+  std::vector<std::uint8_t> fsm;
+
+  /**
+   * Numbers of the pages of each category but 0, indexed by category.
+   */
+  std::vector<std::set<PageId> > fsm_buckets;
+
+  /**
+   * File storing the map (see File::fsmName()), in pages of its own: page k
+   * holds the categories of pages k * Page::DATA_SIZE onwards.  Opened when
+   * the map is first loaded or written; guarded by <mutex>.
+   */
+  std::unique_ptr<FileIo> fsm_io;
+
+  /**
+   * Pages of the map holding categories changed since it was last stored.
+   */
+  std::set<std::size_t> fsm_changed;
+
+  /**
+   * Whether <fsm> reflects the file.  False for a file without a map on disk
+   * until the first File::findPageWithSpace() builds one.
+   */
+  bool fsm_known;
+
+  /**
+   * Number of pages by which the file grows at a time (see
+   * File::setExtentSize()); 0 to grow it by the pages written.  Guarded by
+   * <mutex>.
+   */
+  PageId extent_pages;
+
+  /**
+   * Number of pages from the start of the file that storage has been
+   * allocated for, at least the pages in use.  Guarded by <mutex>.
+   */
+  PageId reserved_pages;
+
+  FileState()
+      : id(0), used_pages_known(false), header_dirty(false), fsm_buckets(256),
+        fsm_known(false), extent_pages(0), reserved_pages(0) {}
+};
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * The File class wraps an I/O backend (see FileBackend) for an underlying file
+ * on disk.  Files contain fixed-sized pages, and they never deallocate space
+ * (though they do reuse deleted pages if possible).  The file header occupies
+ * the first page-sized slot, so page n starts at byte n * Page::SIZE and every
+ * page is aligned for direct I/O.  If multiple File objects refer to the same
+ * underlying file, they will share the backend in memory.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
- * the already created stream for the file without actually opening the UNIX file again. 
+ * detects this (by looking in the open_states_ map) and just returns a file object with
+ * the already opened backend for the file without actually opening the UNIX file again. 
  *
- * @warning This class is not threadsafe.
+ * Writes are not flushed to stable storage individually; call sync() to make
+ * everything written so far durable.
+ *
+ * Every page written is stamped with a CRC-32C of its bytes (see
+ * Page::computeChecksum()), and every page read is checked against it, so a
+ * page torn by a crash or corrupted on disk is reported rather than used.
+ * Pages without a checksum are not checked, and neither are pages of
+ * memory-mapped files, which the buffer pool changes in place.
+ *
+ * Every page written also updates a free space map, one byte per page saying
+ * how much room the page has left, so that findPageWithSpace() can name a page
+ * for a new record without reading any.  Like PostgreSQL's free space map
+ * fork, the map is stored in pages of a file of its own next to the file, the
+ * file's name followed by ".fsm", which is written with the header and removed
+ * with the file.
+ *
+ * Files grow by extents of DEFAULT_EXTENT_SIZE bytes (see setExtentSize()):
+ * when a page is appended past the storage allocated so far, the whole next
+ * extent is preallocated with fallocate(), so pages appended one at a time are
+ * laid out contiguously on disk and sequential scans can read ahead.  Pages
+ * are still handed out one by one; the header, not the file size, says how
+ * many are in use.
+ *
+ * A file created with the COMPRESSED backend stores its pages compressed on
+ * disk; pages read from it are ordinary pages, so the buffer pool and callers
+ * see no difference.  Opening such a file always uses that backend.
+ *
+ * Compound operations and all I/O of the STREAM and COMPRESSED backends are
+ * serialized through a mutex shared by all File objects referring to the same
+ * underlying file, so different threads may read and write pages of one open
+ * file concurrently.
+ * With the POSIX and DIRECT backends, page reads do not take the mutex.
+ *
+ * @warning Creating, opening, closing and removing files is not threadsafe.
  */
 class File {
  public:
+  /**
+   * Page size of files whose header does not record one.
+   */
+  static const std::uint32_t LEGACY_PAGE_SIZE = 8192;
+
+  /**
+   * Size of the extents files grow by unless set otherwise, in bytes.
+   */
+  static const std::uint64_t DEFAULT_EXTENT_SIZE = 1 << 20;
+
   /**
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param backend   How to perform I/O on the file.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static File create(const std::string& filename);
+  static File create(const std::string& filename,
+                     const FileBackend backend = FileBackend::STREAM);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
 	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
 	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the backend associated with this File object are inserted into the
+	 * open_states_ map.
    *
    * @param filename  Name of the file.
+   * @param backend   How to perform I/O on the file; ignored if the file is
+   *                  already open, in which case its backend is shared.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  PageSizeException       If the file has pages of another size.
    */
-  static File open(const std::string& filename);
+  static File open(const std::string& filename,
+                   const FileBackend backend = FileBackend::STREAM);
 
   /**
    * Deletes an existing file.
@@ -145,6 +352,59 @@ class File {
    */
   Page allocatePage();
 
+  /**
+   * Allocates several pages in the file.  Free pages are reused first; the
+   * rest are appended to the end of the file with one walk to the tail of the
+   * used list and one write for all of them.
+   *
+   * @param count   Number of pages to allocate.
+   * @return The new pages, in the order they were allocated.
+   */
+  std::vector<Page> allocatePages(const std::size_t count);
+
+  /**
+   * Appends pages already filled in memory to the end of the file, with one
+   * write for all of them and no free page reused.  The pages are numbered
+   * consecutively from the end of the file and chained at the tail of the
+   * used list, which changes their headers in place.  The file header is only
+   * updated in memory, so it reaches the disk with the next sync().
+   *
+   * @param pages   First of the pages.
+   * @param count   Number of pages.
+   * @return Number of the first page appended.
+   */
+  PageId appendPages(Page* pages, const std::size_t count);
+
+  /**
+   * Grows the file so that it holds every page numbered below <end>, e.g. for
+   * recovery after a crash lost the header of pages allocated since the last
+   * sync().  The pages past the old end are chained at the tail of the used
+   * list; each keeps what is on disk if that is an intact page of that number
+   * and starts out empty otherwise.  Does nothing if the file holds them
+   * already.
+   *
+   * @param end   Number one past the last page the file must hold.
+   */
+  void extendTo(const PageId end);
+
+  /**
+   * Returns a used page with room for a record of the given length according
+   * to the free space map, or Page::INVALID_NUMBER if no page has.  Of the
+   * pages with enough room, one with the least is chosen, so that large gaps
+   * stay for large records.
+   *
+   * The map knows each page as it was last written to the file: pages changed
+   * in a buffer pool count once written back, and after a crash the map is as
+   * of the last sync().  Callers check Page::hasSpaceForRecord() before
+   * inserting.  A file without a map on disk, such as one created before the
+   * map was kept, has it built from the headers of its pages on the first
+   * call.
+   *
+   * @param length  Length of the record, in bytes.
+   * @return  Number of the page.
+   */
+  PageId findPageWithSpace(const std::size_t length);
+
   /**
    * Reads an existing page from the file.
    *
@@ -152,18 +412,56 @@ class File {
    * @return  The page.
    * @throws  InvalidPageException  If the page doesn't exist in the file or is
    *                                not currently used.
+   * @throws  PageChecksumException If the page does not match its checksum.
    */
   Page readPage(const PageId page_number) const;
 
   /**
-   * Writes a page into the file, replacing any existing contents.  The page
-   * must have been already allocated in this file by a call to allocatePage().
+   * Reads an existing page from the file directly into the given page object,
+   * overwriting its header and data in place.  Unlike readPage(), no temporary
+   * page is constructed or copied, so the only work is the transfer from disk.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into, typically a buffer pool frame.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.  The contents of
+   *                                <page> are unspecified in that case.
+   * @throws  PageChecksumException If the page does not match its checksum.
+   */
+  void readPageInto(const PageId page_number, Page& page) const;
+
+  /**
+   * Reads consecutive existing pages from the file directly into the given
+   * page objects, with one bounds check and, where the backend supports it,
+   * one transfer for all of them.
+   *
+   * @param first_page_number   Number of the first page to read.
+   * @param pages               Pages to read into; pages[i] receives page
+   *                            first_page_number + i.
+   * @throws  InvalidPageException  If any of the pages doesn't exist in the
+   *                                file or is not currently used.  The
+   *                                contents of all <pages> are unspecified in
+   *                                that case.
+   */
+  void readPagesInto(const PageId first_page_number,
+                     const std::vector<Page*>& pages) const;
+
+  /**
+   * Writes a page into the file, replacing any existing contents, with a
+   * checksum of what is written.  The page must have been already allocated in
+   * this file by a call to allocatePage().
    *
    * @see allocatePage()
    * @param new_page  Page to write.
    */
   void writePage(const Page& new_page);
 
+  /**
+   * Makes all pages and headers written so far durable, i.e. flushes them
+   * through the backend and the operating system to the device.
+   */
+  void sync() const;
+
   /**
    * Deletes a page from the file.
    *
@@ -178,6 +476,62 @@ class File {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * Returns the identifier of the open file, shared by every File object
+   * referring to it.  Identifiers are handed out in increasing order as files
+   * are opened and are not reused while the process runs, so a page is
+   * identified by (id(), page number) regardless of which File object names
+   * it.
+   *
+   * @return Identifier of file.
+   */
+  FileId id() const { return state_->id; }
+
+  /**
+   * Returns the I/O backend in use for this file.
+   *
+   * @return Backend of file.
+   */
+  FileBackend backend() const { return state_->io->backend(); }
+
+  /**
+   * Returns true if the file is memory-mapped (the MMAP backend), in which
+   * case a BufMgr serves its pages straight from the mapping.
+   *
+   * @return  Whether the file is mapped.
+   */
+  bool mapped() const { return state_->io->mapping() != NULL; }
+
+  /**
+   * Tells the operating system how pages of the file are going to be read,
+   * e.g. to read ahead for a scan or not at all for point lookups.
+   *
+   * @param pattern             Expected access pattern.
+   * @param first_page_number   First page the hint is about.
+   * @param count               Number of pages; 0 for the rest of the file.
+   */
+  void advise(const AccessPattern pattern,
+              const PageId first_page_number = 0,
+              const PageId count = 0) const;
+
+  /**
+   * Sets the size of the extents the file grows by from now on, for all File
+   * objects referring to it, until it is closed; the size is not stored with
+   * the file.  Storage already allocated is kept.  Backends
+   * that cannot preallocate (COMPRESSED) grow by the pages written whatever
+   * the size.
+   *
+   * @param bytes   Size of an extent, rounded up to whole pages; 0 to grow
+   *                the file only by the pages written.
+   */
+  void setExtentSize(const std::uint64_t bytes);
+
+  /**
+   * Returns the size of the extents the file grows by, in bytes; 0 if it grows
+   * by the pages written.
+   */
+  std::uint64_t extentSize() const;
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -201,8 +555,8 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  static std::uint64_t pagePosition(const PageId page_number) {
+    return static_cast<std::uint64_t>(page_number) * Page::SIZE;
   }
 
   /**
@@ -214,28 +568,49 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param backend     How to perform I/O on the file.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const FileBackend backend);
 
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing backend.
    *
    * @param create_new  Whether to create a new file.
+   * @param backend     How to perform I/O on the file if it has to be opened.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  void openIfNeeded(const bool create_new);
+  void openIfNeeded(const bool create_new, const FileBackend backend);
+
+  /**
+   * Makes sure storage is allocated for the first <end> pages of the file,
+   * preallocating up to the end of the extent holding the last of them if not.
+   * Called with <mutex> held, before pages past the end are written.
+   *
+   * @param end   Number of pages about to be in the file.
+   */
+  void reserveExtent(const PageId end);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Locks the file mutex unless the backend allows concurrent transfers, in
+   * which case the returned lock is not held.  Used by methods that perform a
+   * single transfer.
+   *
+   * @return  Lock on the file mutex, possibly not owning it.
+   */
+  std::unique_lock<std::recursive_mutex> lockIo() const;
+
+  /**
+   * Closes the underlying backend in <state_>, writing back the file header.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
@@ -245,8 +620,8 @@ class File {
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * No bounds checking is performed; a page past the end of the file reads as
+   * a free page.
    *
    * @param page_number   Number of page to read.
    * @param allow_free    Whether to allow reading a free (unused) page.
@@ -256,6 +631,19 @@ class File {
    */
   Page readPage(const PageId page_number, const bool allow_free) const;
 
+  /**
+   * Reads a page from the file into the given page object.  Same semantics as
+   * readPage(page_number, allow_free) without constructing a page.
+   *
+   * @param page_number   Number of page to read.
+   * @param allow_free    Whether to allow reading a free (unused) page.
+   * @param page          Page to read into.
+   * @throws  InvalidPageException  If the page is free (unused) and
+   *                                allow_free is false.
+   */
+  void readPageInto(const PageId page_number, const bool allow_free,
+                    Page& page) const;
+
   /**
    * Writes a page into the file at the given page number.  This does not
    * update ensure that the number in the header equals the position on disk.
@@ -279,19 +667,77 @@ class File {
                  const Page& new_page);
 
   /**
-   * Reads the header for this file from disk.
+   * Returns the header for this file, as kept in memory.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Replaces the header for this file.  The header reaches the disk on the
+   * next flushHeader().
    *
    * @param header  File header to write.
    */
   void writeHeader(const FileHeader& header);
 
+  /**
+   * Returns the free space category of a page: how much room it has for one
+   * more record, in 255ths of Page::DATA_SIZE rounded down; 0 if the page is
+   * not in use.
+   *
+   * @param header  Header of the page.
+   */
+  static std::uint8_t spaceCategory(const PageHeader& header);
+
+  /**
+   * Returns the name of the file storing the free space map of a file.
+   *
+   * @param filename  Name of the file.
+   */
+  static std::string fsmName(const std::string& filename);
+
+  /**
+   * Records in the free space map the room a page has left.
+   *
+   * @param page_number   Number of the page.
+   * @param header        Header of the page as written.
+   */
+  void noteFreeSpace(const PageId page_number, const PageHeader& header) const;
+
+  /**
+   * Sets the category of a page in the free space map.  Caller must hold
+   * <fsm_mutex>.
+   *
+   * @param page_number   Number of the page.
+   * @param category      Its category.
+   */
+  void setSpaceCategory(const PageId page_number,
+                        const std::uint8_t category) const;
+
+  /**
+   * Reads the free space map stored next to the file, if there is one.  A map
+   * that fails its checksums is dropped, to be built anew when needed.
+   */
+  void loadFreeSpaceMap();
+
+  /**
+   * Builds the free space map from the headers of the used pages.  Caller
+   * must hold <mutex>.
+   */
+  void buildFreeSpaceMap();
+
+  /**
+   * Writes the changed pages of the free space map.
+   */
+  void flushFreeSpaceMap() const;
+
+  /**
+   * Writes the header for this file to the disk if it has changed since it
+   * was last written.  The free space map is written first.
+   */
+  void flushHeader() const;
+
   /**
    * Reads only the header of the given page from disk (not the record data
    * or slot table).  No bounds checking is performed.
@@ -301,32 +747,119 @@ class File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
+  /**
+   * Returns the set of used pages of the file, walking the used list to build
+   * it the first time.  Caller must hold the file mutex.
+   *
+   * @param header  Current header of the file.
+   * @return  Numbers of the used pages.
+   */
+  std::set<PageId>& usedPages(const FileHeader& header);
+
+  /**
+   * Records the list links found in or written to a page header.
+   *
+   * @param page_number   Number of the page.
+   * @param header        Header of the page as it is on disk.
+   * @param overwrite     Whether to replace an already known link.  Writes do;
+   *                      reads only fill in unknown links, since a read that
+   *                      skips the file mutex may race with a write that has
+   *                      already recorded a newer link.
+   */
+  void recordLink(const PageId page_number, const PageHeader& header,
+                  const bool overwrite) const;
+
+  /**
+   * Checks a page just read against the checksum it was written with.
+   *
+   * @param page_number   Number of the page.
+   * @param page          The page as read.
+   * @throws  PageChecksumException If the page does not match its checksum.
+   */
+  void verifyChecksum(const PageId page_number, const Page& page) const;
+
+  /**
+   * Returns the remembered list links of a page.
+   *
+   * @param page_number   Number of the page.
+   * @return  Links of the page; not known if the page has not been seen.
+   */
+  PageLink link(const PageId page_number) const;
+
+  /**
+   * Checks that a page may be read and says where to read it from, so that an
+   * I/O engine can transfer it without going through this object.  Completed
+   * transfers must be handed to finishAsyncRead().
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page the engine will read into.
+   * @param fd            Descriptor to read from, returned via this variable.
+   * @param offset        Position of the page, returned via this variable.
+   * @param buffer        Memory to read Page::SIZE bytes into, returned via
+   *                      this variable.
+   * @return  False if the backend has no descriptor; the engine must then use
+   *          readPageInto().
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  bool prepareAsyncRead(const PageId page_number, Page& page, int& fd,
+                        std::uint64_t& offset, char*& buffer) const;
+
+  /**
+   * Returns where an existing page of a memory-mapped file is in the mapping,
+   * with the checks of readPageInto().
+   *
+   * @param page_number   Number of page to find.
+   * @return  Start of the page's bytes in the mapping.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  char* mapPage(const PageId page_number) const;
+
+  /**
+   * Completes a read started with prepareAsyncRead().
+   *
+   * @param page_number   Number of page that was read.
+   * @param page          Page that was read into.
+   * @throws  InvalidPageException  If the page is not currently used.
+   * @throws  PageChecksumException If the page does not match its checksum.
+   */
+  void finishAsyncRead(const PageId page_number, const Page& page) const;
+
   typedef std::map<std::string,
-                   std::shared_ptr<std::fstream> > StreamMap;
+                   std::shared_ptr<FileState> > StateMap;
   typedef std::map<std::string, int> CountMap;
 
   /**
-   * Streams for opened files.
+   * Shared state of opened files.
    */
-  static StreamMap open_streams_;
+  static StateMap open_states_;
 
   /**
    * Counts for opened files.
    */
   static CountMap open_counts_;
 
+  /**
+   * Identifier given to the next file opened.
+   */
+  static FileId next_id_;
+
   /**
    * Name of the file this object represents.
    */
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Backend, mutex and list links of the underlying filesystem object; shared
+   * by every File object referring to it.
    */
-  std::shared_ptr<std::fstream> stream_;
+  std::shared_ptr<FileState> state_;
 
+  friend class BufMgr;
+  friend class BufScanIterator;
   friend class FileIterator;
   friend class FileTest;
+  friend class UringIoEngine;
 };
 
 }
@@ -0,0 +1,615 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "file_io.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "compressed_file_io.h"
+#include "exceptions/file_io_exception.h"
+#include "page.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Allocates storage for a range of a file with fallocate(), or
+ * posix_fallocate() where that is missing.  Filesystems that cannot allocate
+ * ahead are left to allocate storage as the range is written.
+ */
+void allocateRange(const int fd, const std::string& filename,
+                   const std::uint64_t offset, const std::uint64_t length) {
+#ifdef __linux__
+  if (::fallocate(fd, 0 /* mode */, offset, length) == 0) {
+    return;
+  }
+  const int error = errno;
+#else
+  const int error = ::posix_fallocate(fd, offset, length);
+  if (error == 0) {
+    return;
+  }
+#endif
+  if (error == EOPNOTSUPP || error == ENOSYS || error == EINVAL) {
+    return;
+  }
+  throw FileIOException(filename, "preallocate", error);
+}
+
+/**
+ * @brief FileIo over a std::fstream.  Not safe for concurrent use.
+ */
+class StreamFileIo : public FileIo {
+ public:
+  StreamFileIo(const std::string& filename, const bool create_new)
+      : FileIo(filename, FileBackend::STREAM) {
+    std::ios_base::openmode mode =
+        std::fstream::in | std::fstream::out | std::fstream::binary;
+    if (create_new) {
+      mode = mode | std::fstream::trunc;
+    }
+    stream_.open(filename, mode);
+    if (!stream_) {
+      throw FileIOException(filename, "open", errno);
+    }
+  }
+
+  void read(char* buffer, const std::size_t length,
+            const std::uint64_t offset) override {
+    stream_.seekg(offset, std::ios::beg);
+    stream_.read(buffer, length);
+    const std::size_t got = stream_.gcount();
+    if (got < length) {
+      // Past the end of the file; keep the stream usable for the next call.
+      stream_.clear();
+      std::memset(buffer + got, 0, length - got);
+    }
+  }
+
+  void write(const char* buffer, const std::size_t length,
+             const std::uint64_t offset) override {
+    stream_.seekp(offset, std::ios::beg);
+    stream_.write(buffer, length);
+    if (!stream_) {
+      stream_.clear();
+      throw FileIOException(filename_, "write", EIO);
+    }
+  }
+
+  void sync() override {
+    stream_.flush();
+    // The stream does not expose its descriptor, but fsync() on any descriptor
+    // of the file flushes the file.
+    const int fd = ::open(filename_.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw FileIOException(filename_, "sync", errno);
+    }
+    const int result = ::fsync(fd);
+    const int error = errno;
+    ::close(fd);
+    if (result != 0) {
+      throw FileIOException(filename_, "sync", error);
+    }
+  }
+
+  bool concurrent() const override { return false; }
+
+  void preallocate(const std::uint64_t offset,
+                   const std::uint64_t length) override {
+    // As for sync(), any descriptor of the file will do
+    const int fd = ::open(filename_.c_str(), O_WRONLY);
+    if (fd < 0) {
+      throw FileIOException(filename_, "preallocate", errno);
+    }
+    try {
+      allocateRange(fd, filename_, offset, length);
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+    ::close(fd);
+  }
+
+ private:
+  std::fstream stream_;
+};
+
+/**
+ * @brief Heap block aligned for direct I/O, freed when it goes out of scope.
+ */
+class AlignedBuffer {
+ public:
+  explicit AlignedBuffer(const std::size_t length) : data_(NULL) {
+    void* mem;
+    if (posix_memalign(&mem, Page::ALIGNMENT, length) != 0) {
+      throw std::bad_alloc();
+    }
+    data_ = static_cast<char*>(mem);
+  }
+
+  ~AlignedBuffer() { std::free(data_); }
+
+  char* data() const { return data_; }
+
+ private:
+  AlignedBuffer(const AlignedBuffer&);
+  AlignedBuffer& operator=(const AlignedBuffer&);
+
+  char* data_;
+};
+
+/**
+ * @brief FileIo over pread()/pwrite(), optionally with O_DIRECT.
+ *
+ * With O_DIRECT, transfers whose buffer, offset and length are not all
+ * multiples of Page::ALIGNMENT go through an aligned bounce buffer covering
+ * the enclosing blocks; unaligned writes read those blocks first.  Full page
+ * transfers to and from the buffer pool are always aligned.
+ */
+class PosixFileIo : public FileIo {
+ public:
+  PosixFileIo(const std::string& filename, const bool create_new,
+              const bool direct)
+      : FileIo(filename, direct ? FileBackend::DIRECT : FileBackend::POSIX),
+        fd_(-1) {
+    int flags = O_RDWR;
+    if (create_new) {
+      flags |= O_CREAT | O_TRUNC;
+    }
+#ifdef O_DIRECT
+    if (direct) {
+      fd_ = ::open(filename.c_str(), flags | O_DIRECT, 0644);
+      if (fd_ < 0 && errno == EINVAL) {
+        // Filesystem does not support direct I/O (e.g. tmpfs).
+        backend_ = FileBackend::POSIX;
+      }
+    }
+#else
+    backend_ = FileBackend::POSIX;
+#endif
+    if (fd_ < 0) {
+      fd_ = ::open(filename.c_str(), flags, 0644);
+    }
+    if (fd_ < 0) {
+      throw FileIOException(filename, "open", errno);
+    }
+  }
+
+  ~PosixFileIo() { ::close(fd_); }
+
+  void read(char* buffer, const std::size_t length,
+            const std::uint64_t offset) override {
+    if (backend_ == FileBackend::DIRECT && !aligned(buffer, length, offset)) {
+      const std::uint64_t start = alignDown(offset);
+      const std::size_t span = alignUp(offset + length) - start;
+      AlignedBuffer bounce(span);
+      readFully(bounce.data(), span, start);
+      std::memcpy(buffer, bounce.data() + (offset - start), length);
+      return;
+    }
+    readFully(buffer, length, offset);
+  }
+
+  void write(const char* buffer, const std::size_t length,
+             const std::uint64_t offset) override {
+    if (backend_ == FileBackend::DIRECT && !aligned(buffer, length, offset)) {
+      const std::uint64_t start = alignDown(offset);
+      const std::size_t span = alignUp(offset + length) - start;
+      AlignedBuffer bounce(span);
+      readFully(bounce.data(), span, start);
+      std::memcpy(bounce.data() + (offset - start), buffer, length);
+      writeFully(bounce.data(), span, start);
+      return;
+    }
+    writeFully(buffer, length, offset);
+  }
+
+  void readv(char* const* buffers, const std::size_t count,
+             const std::size_t length, const std::uint64_t offset) override {
+    if (backend_ == FileBackend::DIRECT &&
+        !alignedAll(buffers, count, length, offset)) {
+      FileIo::readv(buffers, count, length, offset);
+      return;
+    }
+    transferFully(false /* write */, const_cast<char* const*>(buffers), count,
+                  length, offset);
+  }
+
+  void writev(const char* const* buffers, const std::size_t count,
+              const std::size_t length, const std::uint64_t offset) override {
+    if (backend_ == FileBackend::DIRECT &&
+        !alignedAll(buffers, count, length, offset)) {
+      FileIo::writev(buffers, count, length, offset);
+      return;
+    }
+    transferFully(true /* write */, const_cast<char* const*>(buffers), count,
+                  length, offset);
+  }
+
+  void sync() override {
+    if (::fdatasync(fd_) != 0) {
+      throw FileIOException(filename_, "sync", errno);
+    }
+  }
+
+  bool concurrent() const override { return true; }
+
+  int descriptor() const override { return fd_; }
+
+  void preallocate(const std::uint64_t offset,
+                   const std::uint64_t length) override {
+    allocateRange(fd_, filename_, offset, length);
+  }
+
+  void advise(const AccessPattern pattern, const std::uint64_t offset,
+              const std::uint64_t length) override {
+#ifdef POSIX_FADV_NORMAL
+    int advice = POSIX_FADV_NORMAL;
+    switch (pattern) {
+      case AccessPattern::SEQUENTIAL:
+        advice = POSIX_FADV_SEQUENTIAL;
+        break;
+      case AccessPattern::RANDOM:
+        advice = POSIX_FADV_RANDOM;
+        break;
+      case AccessPattern::WILLNEED:
+        advice = POSIX_FADV_WILLNEED;
+        break;
+      case AccessPattern::NORMAL:
+      default:
+        break;
+    }
+    // Only a hint; failures are of no consequence.
+    ::posix_fadvise(fd_, offset, length, advice);
+#endif
+  }
+
+ private:
+  static bool aligned(const char* buffer, const std::size_t length,
+                      const std::uint64_t offset) {
+    return reinterpret_cast<std::uintptr_t>(buffer) % Page::ALIGNMENT == 0 &&
+        length % Page::ALIGNMENT == 0 && offset % Page::ALIGNMENT == 0;
+  }
+
+  static bool alignedAll(const char* const* buffers, const std::size_t count,
+                         const std::size_t length,
+                         const std::uint64_t offset) {
+    for (std::size_t i = 0; i < count; ++i) {
+      if (!aligned(buffers[i], length, offset)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static std::uint64_t alignDown(const std::uint64_t offset) {
+    return offset - offset % Page::ALIGNMENT;
+  }
+
+  static std::uint64_t alignUp(const std::uint64_t offset) {
+    return alignDown(offset + Page::ALIGNMENT - 1);
+  }
+
+  void readFully(char* buffer, const std::size_t length,
+                 const std::uint64_t offset) {
+    std::size_t done = 0;
+    while (done < length) {
+      const ssize_t got = ::pread(fd_, buffer + done, length - done,
+                                  offset + done);
+      if (got < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw FileIOException(filename_, "read", errno);
+      }
+      if (got == 0) {
+        // Past the end of the file.
+        std::memset(buffer + done, 0, length - done);
+        return;
+      }
+      done += got;
+    }
+  }
+
+  void writeFully(const char* buffer, const std::size_t length,
+                  const std::uint64_t offset) {
+    std::size_t done = 0;
+    while (done < length) {
+      const ssize_t put = ::pwrite(fd_, buffer + done, length - done,
+                                   offset + done);
+      if (put < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw FileIOException(filename_, "write", errno);
+      }
+      done += put;
+    }
+  }
+
+  /**
+   * Moves count blocks of length bytes between the buffers and the file with
+   * preadv()/pwritev(), resuming after partial transfers.  Reads past the end
+   * of the file return zeros.
+   */
+  void transferFully(const bool write, char* const* buffers,
+                     const std::size_t count, const std::size_t length,
+                     const std::uint64_t offset) {
+    const std::size_t total = count * length;
+    std::size_t done = 0;
+    std::vector<iovec> iov;
+    while (done < total) {
+      iov.clear();
+      std::size_t block = done / length;
+      std::size_t skip = done % length;
+      for (; block < count && iov.size() < IOV_MAX; ++block, skip = 0) {
+        iovec entry;
+        entry.iov_base = buffers[block] + skip;
+        entry.iov_len = length - skip;
+        iov.push_back(entry);
+      }
+      const ssize_t moved =
+          write ? ::pwritev(fd_, &iov[0], iov.size(), offset + done)
+                : ::preadv(fd_, &iov[0], iov.size(), offset + done);
+      if (moved < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw FileIOException(filename_, write ? "write" : "read", errno);
+      }
+      if (moved == 0 && !write) {
+        // Past the end of the file.
+        for (block = done / length, skip = done % length; block < count;
+             ++block, skip = 0) {
+          std::memset(buffers[block] + skip, 0, length - skip);
+        }
+        return;
+      }
+      done += moved;
+    }
+  }
+
+  int fd_;
+};
+
+/**
+ * @brief FileIo over a shared memory mapping of the file.
+ *
+ * A range of address space large enough for RESERVE bytes is reserved when the
+ * file is opened, and the file is mapped at its start.  Growing the file maps
+ * the new part right after the old one, so the mapping never moves.  The file
+ * is extended in steps of CHUNK bytes; the header, not the file size, says how
+ * many pages are in use.
+ */
+class MmapFileIo : public FileIo {
+ public:
+  /**
+   * Largest file the mapping can hold.
+   */
+  static const std::uint64_t RESERVE = 1ULL << 36;
+
+  /**
+   * Granularity by which the file and mapping grow.
+   */
+  static const std::uint64_t CHUNK = 1ULL << 20;
+
+  MmapFileIo(const std::string& filename, const bool create_new)
+      : FileIo(filename, FileBackend::MMAP), fd_(-1), base_(NULL), mapped_(0) {
+    int flags = O_RDWR;
+    if (create_new) {
+      flags |= O_CREAT | O_TRUNC;
+    }
+    fd_ = ::open(filename.c_str(), flags, 0644);
+    if (fd_ < 0) {
+      throw FileIOException(filename, "open", errno);
+    }
+    void* reserved = ::mmap(NULL, RESERVE, PROT_NONE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserved == MAP_FAILED) {
+      const int error = errno;
+      ::close(fd_);
+      throw FileIOException(filename, "map", error);
+    }
+    base_ = static_cast<char*>(reserved);
+    struct stat info;
+    if (::fstat(fd_, &info) != 0) {
+      const int error = errno;
+      release();
+      throw FileIOException(filename, "map", error);
+    }
+    try {
+      grow(info.st_size);
+    } catch (...) {
+      release();
+      throw;
+    }
+  }
+
+  ~MmapFileIo() { release(); }
+
+  void read(char* buffer, const std::size_t length,
+            const std::uint64_t offset) override {
+    const std::uint64_t mapped = mapped_.load(std::memory_order_acquire);
+    std::size_t available = 0;
+    if (offset < mapped) {
+      available = std::min<std::uint64_t>(length, mapped - offset);
+    }
+    if (buffer != base_ + offset) {
+      std::memcpy(buffer, base_ + offset, available);
+    }
+    // Past the end of the mapping.
+    std::memset(buffer + available, 0, length - available);
+  }
+
+  void write(const char* buffer, const std::size_t length,
+             const std::uint64_t offset) override {
+    grow(offset + length);
+    // A page viewing the mapping is already in place.
+    if (buffer != base_ + offset) {
+      std::memcpy(base_ + offset, buffer, length);
+    }
+  }
+
+  void sync() override {
+    const std::uint64_t mapped = mapped_.load(std::memory_order_acquire);
+    if (mapped > 0 && ::msync(base_, mapped, MS_SYNC) != 0) {
+      throw FileIOException(filename_, "sync", errno);
+    }
+  }
+
+  bool concurrent() const override { return true; }
+
+  char* mapping() const override { return base_; }
+
+  void preallocate(const std::uint64_t offset,
+                   const std::uint64_t length) override {
+    // The mapping is grown first, since growing truncates the file to the
+    // length mapped, and the range is then filled in within it
+    grow(offset + length);
+    allocateRange(fd_, filename_, offset, length);
+  }
+
+  std::uint64_t mappedLength() const override {
+    return mapped_.load(std::memory_order_acquire);
+  }
+
+  void advise(const AccessPattern pattern, const std::uint64_t offset,
+              const std::uint64_t length) override {
+    const std::uint64_t mapped = mapped_.load(std::memory_order_acquire);
+    // madvise() needs a start aligned to the system page size.
+    const std::uint64_t start = offset - offset % Page::ALIGNMENT;
+    if (start >= mapped) {
+      return;
+    }
+    std::uint64_t end = length == 0 ? mapped : offset + length;
+    if (end > mapped) {
+      end = mapped;
+    }
+    int advice = MADV_NORMAL;
+    switch (pattern) {
+      case AccessPattern::SEQUENTIAL:
+        advice = MADV_SEQUENTIAL;
+        break;
+      case AccessPattern::RANDOM:
+        advice = MADV_RANDOM;
+        break;
+      case AccessPattern::WILLNEED:
+        advice = MADV_WILLNEED;
+        break;
+      case AccessPattern::NORMAL:
+      default:
+        break;
+    }
+    // Only a hint; failures are of no consequence.
+    ::madvise(base_ + start, end - start, advice);
+  }
+
+ private:
+  /**
+   * Extends the file and the mapping to cover at least the given length.
+   */
+  void grow(const std::uint64_t length) {
+    if (length <= mapped_.load(std::memory_order_acquire)) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(grow_mutex_);
+    const std::uint64_t mapped = mapped_.load(std::memory_order_relaxed);
+    if (length <= mapped) {
+      return;
+    }
+    std::uint64_t target = std::max(length, mapped * 2);
+    target = (target + CHUNK - 1) / CHUNK * CHUNK;
+    if (target > RESERVE) {
+      target = (length + CHUNK - 1) / CHUNK * CHUNK;
+    }
+    if (target > RESERVE) {
+      throw FileIOException(filename_, "map", EFBIG);
+    }
+    if (::ftruncate(fd_, target) != 0) {
+      throw FileIOException(filename_, "map", errno);
+    }
+    void* added = ::mmap(base_ + mapped, target - mapped,
+                         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd_,
+                         mapped);
+    if (added == MAP_FAILED) {
+      throw FileIOException(filename_, "map", errno);
+    }
+    mapped_.store(target, std::memory_order_release);
+  }
+
+  /**
+   * Unmaps the reservation and closes the descriptor.
+   */
+  void release() {
+    ::munmap(base_, RESERVE);
+    ::close(fd_);
+  }
+
+  int fd_;
+
+  char* base_;
+
+  /**
+   * Number of bytes at the start of the reservation mapped to the file.
+   */
+  std::atomic<std::uint64_t> mapped_;
+
+  /**
+   * Serializes growth of the mapping.
+   */
+  std::mutex grow_mutex_;
+};
+
+}
+
+void FileIo::readv(char* const* buffers, const std::size_t count,
+                   const std::size_t length, const std::uint64_t offset) {
+  for (std::size_t i = 0; i < count; ++i) {
+    read(buffers[i], length, offset + i * length);
+  }
+}
+
+void FileIo::writev(const char* const* buffers, const std::size_t count,
+                    const std::size_t length, const std::uint64_t offset) {
+  for (std::size_t i = 0; i < count; ++i) {
+    write(buffers[i], length, offset + i * length);
+  }
+}
+
+FileIo* FileIo::open(const std::string& filename, const bool create_new,
+                     const FileBackend backend) {
+  switch (backend) {
+    case FileBackend::POSIX:
+      return new PosixFileIo(filename, create_new, false /* direct */);
+    case FileBackend::DIRECT:
+      return new PosixFileIo(filename, create_new, true /* direct */);
+    case FileBackend::MMAP:
+      return new MmapFileIo(filename, create_new);
+    case FileBackend::COMPRESSED:
+      return new CompressedFileIo(filename, create_new);
+    case FileBackend::STREAM:
+    default:
+      return new StreamFileIo(filename, create_new);
+  }
+}
+
+}
@@ -0,0 +1,235 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace badgerdb {
+
+/**
+ * @brief How a File performs I/O on the underlying filesystem object.
+ */
+enum class FileBackend {
+  /**
+   * A std::fstream.  Every access seeks the shared stream position, so I/O on
+   * one file is serialized.
+   */
+  STREAM,
+
+  /**
+   * pread()/pwrite() on a raw file descriptor.  Transfers carry their own
+   * offset, so pages of one file can be read and written concurrently.
+   */
+  POSIX,
+
+  /**
+   * Like POSIX, but the file is opened with O_DIRECT so transfers bypass the
+   * kernel page cache and the buffer pool is the only cache.  Falls back to
+   * POSIX on filesystems that do not support direct I/O.
+   */
+  DIRECT,
+
+  /**
+   * The file is mapped into memory (mmap() with MAP_SHARED).  Transfers are
+   * copies to and from the mapping, and a BufMgr lets frames of pages of such
+   * a file view the mapping directly instead of holding a copy.  The mapping
+   * grows with the file inside a fixed reservation of address space, so
+   * addresses of pages stay valid while the file is open.
+   */
+  MMAP,
+
+  /**
+   * Every page is stored compressed, in an extent of as many 512-byte sectors
+   * as it needs, found through a mapping table kept in the file (see
+   * CompressedFileIo).  Meant for cold files of sparse or text pages: reads
+   * and writes cost a decompression or compression of the page in exchange
+   * for less I/O and space.  Transfers are serialized, and the buffer pool
+   * keeps its frames uncompressed.  An existing compressed file is recognized
+   * when opened, whatever backend is asked for.
+   */
+  COMPRESSED
+};
+
+/**
+ * @brief Expected access pattern, passed to the operating system as a hint.
+ */
+enum class AccessPattern {
+  /**
+   * No particular pattern (the default).
+   */
+  NORMAL,
+
+  /**
+   * Pages are read in ascending order; read ahead aggressively.
+   */
+  SEQUENTIAL,
+
+  /**
+   * Pages are read in no particular order; do not read ahead.
+   */
+  RANDOM,
+
+  /**
+   * The given pages will be read soon; start bringing them in.
+   */
+  WILLNEED
+};
+
+/**
+ * @brief Byte-level access to one open file, shared by all File objects
+ *        referring to it.
+ *
+ * Transfers are positional: each names its own offset.  Reads past the end of
+ * the file return zeros.  Errors reported by the operating system are thrown as
+ * FileIOException.
+ */
+class FileIo {
+ public:
+  /**
+   * Opens a file with the given backend.
+   *
+   * @param filename    Name of the file.
+   * @param create_new  Whether to create (or truncate) the file.
+   * @param backend     Backend to use.
+   * @return  Newly allocated I/O object; owned by the caller.
+   * @throws  FileIOException  If the file cannot be opened.
+   */
+  static FileIo* open(const std::string& filename, const bool create_new,
+                      const FileBackend backend);
+
+  virtual ~FileIo() {}
+
+  /**
+   * Reads bytes from the file.
+   *
+   * @param buffer  Destination of the bytes.
+   * @param length  Number of bytes to read.
+   * @param offset  Position in the file to read from.
+   */
+  virtual void read(char* buffer, const std::size_t length,
+                    const std::uint64_t offset) = 0;
+
+  /**
+   * Writes bytes to the file.
+   *
+   * @param buffer  Bytes to write.
+   * @param length  Number of bytes to write.
+   * @param offset  Position in the file to write to.
+   */
+  virtual void write(const char* buffer, const std::size_t length,
+                     const std::uint64_t offset) = 0;
+
+  /**
+   * Reads consecutive blocks of the file into separate buffers, as one
+   * transfer where the backend supports it.
+   *
+   * @param buffers Destinations of the blocks, in file order.
+   * @param count   Number of blocks.
+   * @param length  Number of bytes in each block.
+   * @param offset  Position in the file of the first block.
+   */
+  virtual void readv(char* const* buffers, const std::size_t count,
+                     const std::size_t length, const std::uint64_t offset);
+
+  /**
+   * Writes separate buffers to consecutive blocks of the file, as one transfer
+   * where the backend supports it.
+   *
+   * @param buffers Contents of the blocks, in file order.
+   * @param count   Number of blocks.
+   * @param length  Number of bytes in each block.
+   * @param offset  Position in the file of the first block.
+   */
+  virtual void writev(const char* const* buffers, const std::size_t count,
+                      const std::size_t length, const std::uint64_t offset);
+
+  /**
+   * Forces everything written so far to stable storage.  Writes are otherwise
+   * left to the backend and the operating system to flush when they see fit.
+   */
+  virtual void sync() = 0;
+
+  /**
+   * Returns true if transfers may be issued concurrently from several threads.
+   * Otherwise the caller must serialize them.
+   */
+  virtual bool concurrent() const = 0;
+
+  /**
+   * Returns the file descriptor transfers are performed on, or -1 if the
+   * backend does not have one.  Used to hand transfers to an IoEngine.
+   */
+  virtual int descriptor() const { return -1; }
+
+  /**
+   * Returns the start of the file's memory mapping, where byte n of the file is
+   * at mapping() + n, or NULL if the file is not mapped.  Only the first
+   * mappedLength() bytes may be accessed.
+   */
+  virtual char* mapping() const { return NULL; }
+
+  /**
+   * Returns the number of bytes of the file currently mapped.
+   */
+  virtual std::uint64_t mappedLength() const { return 0; }
+
+  /**
+   * Tells the operating system how a range of the file is going to be
+   * accessed.  Ignored by backends without such hints.
+   *
+   * @param pattern Expected access pattern.
+   * @param offset  Start of the range.
+   * @param length  Length of the range; 0 for the rest of the file.
+   */
+  virtual void advise(const AccessPattern pattern, const std::uint64_t offset,
+                      const std::uint64_t length) {}
+
+  /**
+   * Allocates storage for a range of the file ahead of the writes that will
+   * fill it, as one extent where the filesystem can, so pages appended one at
+   * a time still end up contiguous on disk.  The file grows to cover the range
+   * if it is shorter; the bytes preallocated read as zeros.  Ignored by
+   * backends and filesystems that cannot preallocate.
+   *
+   * @param offset  Start of the range.
+   * @param length  Length of the range.
+   * @throws  FileIOException  If the storage cannot be allocated, e.g. because
+   *                           the device is full.
+   */
+  virtual void preallocate(const std::uint64_t offset,
+                           const std::uint64_t length) {}
+
+  /**
+   * Backend actually in use; DIRECT may have fallen back to POSIX.
+   */
+  FileBackend backend() const { return backend_; }
+
+ protected:
+  /**
+   * Constructs the common part of an I/O object.
+   *
+   * @param filename  Name of the file, used in error messages.
+   * @param backend   Backend in use.
+   */
+  FileIo(const std::string& filename, const FileBackend backend)
+      : filename_(filename), backend_(backend) {}
+
+  /**
+   * Name of the file.
+   */
+  std::string filename_;
+
+  /**
+   * Backend in use.
+   */
+  FileBackend backend_;
+};
+
+}
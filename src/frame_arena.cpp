@@ -0,0 +1,51 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "frame_arena.h"
+
+#include <sys/mman.h>
+#include <new>
+
+#include "numa.h"
+
+namespace badgerdb {
+
+static_assert(Page::SIZE % FrameArena::ALIGNMENT == 0,
+              "Frames must stay aligned when laid out back to back.");
+
+FrameArena::FrameArena(std::size_t frames)
+    : base(NULL), bytes(frames * Page::SIZE) {
+  if (bytes == 0) {
+    bytes = Page::SIZE;
+  }
+  void* mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mem == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+#ifdef MADV_HUGEPAGE
+  // Only a hint; the arena works the same with ordinary pages.
+  madvise(mem, bytes, MADV_HUGEPAGE);
+#endif
+  base = static_cast<char*>(mem);
+}
+
+FrameArena::~FrameArena() {
+  munmap(base, bytes);
+}
+
+void FrameArena::release(FrameId first, std::size_t count) {
+  if (count > 0) {
+    madvise(frame(first), count * Page::SIZE, MADV_DONTNEED);
+  }
+}
+
+bool FrameArena::place(FrameId first, std::size_t count, unsigned node) {
+  return count == 0 || numaBind(frame(first), count * Page::SIZE, node);
+}
+
+}
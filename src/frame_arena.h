@@ -0,0 +1,94 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief One contiguous block of memory holding every frame of the buffer pool.
+ *
+ * Frames are Page::SIZE bytes each and laid out back to back, starting on an
+ * OS page boundary, so every frame is aligned for direct I/O and neighbouring
+ * frames share TLB entries.  The block is mapped anonymously (and therefore
+ * zero-filled) without reserving swap, so memory is only committed for frames
+ * that are used; where the kernel supports transparent huge pages the arena is
+ * advised to use them.
+ */
+class FrameArena {
+ public:
+  /**
+   * Alignment of the first frame, in bytes.
+   */
+  static const std::size_t ALIGNMENT = Page::ALIGNMENT;
+
+  /**
+   * Maps memory for the given number of frames.
+   *
+   * @param frames  Number of frames.
+   * @throws  std::bad_alloc  If the memory cannot be mapped.
+   */
+  explicit FrameArena(std::size_t frames);
+
+  /**
+   * Unmaps the memory.  Pages viewing the arena must be gone by then.
+   */
+  ~FrameArena();
+
+  /**
+   * Returns the first byte of a frame.
+   *
+   * @param frame   Frame number.
+   */
+  char* frame(FrameId frame) const { return base + frame * Page::SIZE; }
+
+  /**
+   * Returns the memory of some frames to the operating system; they read as
+   * zeros when next used.
+   *
+   * @param first   First frame.
+   * @param count   Number of frames.
+   */
+  void release(FrameId first, std::size_t count);
+
+  /**
+   * Asks for the memory of some frames to be placed on a NUMA node as it is
+   * committed (see numaBind()); frames already in use stay where they are.
+   *
+   * @param first   First frame.
+   * @param count   Number of frames.
+   * @param node    NUMA node.
+   * @return  False if the kernel does not support placement.
+   */
+  bool place(FrameId first, std::size_t count, unsigned node);
+
+  /**
+   * Number of bytes mapped.
+   */
+  std::size_t size() const { return bytes; }
+
+ private:
+  FrameArena(const FrameArena&);
+  FrameArena& operator=(const FrameArena&);
+
+  /**
+   * Start of the mapping.
+   */
+  char* base;
+
+  /**
+   * Length of the mapping.
+   */
+  std::size_t bytes;
+};
+
+}
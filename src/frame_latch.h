@@ -0,0 +1,182 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace badgerdb {
+
+/**
+ * @brief How a PageHandle latches the contents of its page.
+ */
+enum class LatchMode {
+  /**
+   * Pinned only: the page stays resident, but its contents are not protected.
+   */
+  NONE,
+
+  /**
+   * Shared with other readers; writers wait.
+   */
+  SHARED,
+
+  /**
+   * Exclusive: no other reader or writer holds the latch.
+   */
+  EXCLUSIVE
+};
+
+/**
+ * @brief Reader-writer latch protecting the contents of one buffer frame.
+ *
+ * A pin keeps a page in its frame; the latch orders the threads reading and
+ * changing what is on it.  Any number of shared holders or one exclusive
+ * holder may hold the latch, and waiting threads spin, yielding the CPU, since
+ * latches are held only for short accesses to one page.
+ *
+ * The latch also carries a version, bumped every time an exclusive holder
+ * lets go.  A reader that does not want to write to the latch word at all
+ * (e.g. on a hot index root page) reads the version, reads the page and then
+ * validates the version; if it is unchanged no writer intervened and what was
+ * read is consistent, otherwise the reader retries or falls back to a shared
+ * latch.
+ *
+ * The word holds the version in its upper 32 bits, the exclusive bit and the
+ * number of shared holders in its lower 32.
+ */
+class FrameLatch {
+ public:
+  /**
+   * Version returned by readVersion() while a writer holds the latch; never
+   * validates.
+   */
+  static const std::uint64_t LOCKED = ~0ULL;
+
+  FrameLatch() : word(0) {}
+
+  /**
+   * Waits until no writer holds the latch and shares it.
+   */
+  void lockShared() {
+    std::uint64_t w = word.load(std::memory_order_relaxed);
+    for (;;) {
+      if ((w & EXCLUSIVE_BIT) == 0 &&
+          word.compare_exchange_weak(w, w + 1, std::memory_order_acquire,
+                                     std::memory_order_relaxed)) {
+        return;
+      }
+      if (w & EXCLUSIVE_BIT) {
+        std::this_thread::yield();
+        w = word.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * Shares the latch unless a writer holds it.
+   *
+   * @return  True if the latch is now shared, false if a writer held it.
+   */
+  bool tryLockShared() {
+    std::uint64_t w = word.load(std::memory_order_relaxed);
+    while ((w & EXCLUSIVE_BIT) == 0) {
+      if (word.compare_exchange_weak(w, w + 1, std::memory_order_acquire,
+                                     std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Releases a shared hold.
+   */
+  void unlockShared() {
+    word.fetch_sub(1, std::memory_order_release);
+  }
+
+  /**
+   * Waits until nobody holds the latch and takes it exclusively.
+   */
+  void lockExclusive() {
+    std::uint64_t w = word.load(std::memory_order_relaxed);
+    for (;;) {
+      if ((w & HOLDERS_MASK) == 0 &&
+          word.compare_exchange_weak(w, w | EXCLUSIVE_BIT,
+                                     std::memory_order_acquire,
+                                     std::memory_order_relaxed)) {
+        return;
+      }
+      if (w & HOLDERS_MASK) {
+        std::this_thread::yield();
+        w = word.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * Releases the exclusive hold and bumps the version.
+   */
+  void unlockExclusive() {
+    const std::uint64_t w = word.load(std::memory_order_relaxed);
+    word.store((w & ~HOLDERS_MASK) + VERSION_ONE, std::memory_order_release);
+  }
+
+  /**
+   * Starts an optimistic read.
+   *
+   * @return  Version to pass to validate(), or LOCKED if a writer holds the
+   *          latch right now.
+   */
+  std::uint64_t readVersion() const {
+    const std::uint64_t w = word.load(std::memory_order_acquire);
+    return (w & EXCLUSIVE_BIT) ? LOCKED : w >> 32;
+  }
+
+  /**
+   * Finishes an optimistic read.
+   *
+   * @param version   Value returned by readVersion() before the read.
+   * @return  True if no writer held the latch since, so the read is
+   *          consistent.
+   */
+  bool validate(std::uint64_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const std::uint64_t w = word.load(std::memory_order_relaxed);
+    return version != LOCKED && (w & EXCLUSIVE_BIT) == 0 &&
+        (w >> 32) == version;
+  }
+
+ private:
+  FrameLatch(const FrameLatch&);
+  FrameLatch& operator=(const FrameLatch&);
+
+  /**
+   * Set while a writer holds the latch.
+   */
+  static const std::uint64_t EXCLUSIVE_BIT = 1ULL << 31;
+
+  /**
+   * Bits that are non-zero while anybody holds the latch.
+   */
+  static const std::uint64_t HOLDERS_MASK = 0xFFFFFFFFULL;
+
+  /**
+   * Increment of the version.
+   */
+  static const std::uint64_t VERSION_ONE = 1ULL << 32;
+
+  /**
+   * Version, exclusive bit and number of shared holders.
+   */
+  std::atomic<std::uint64_t> word;
+};
+
+}
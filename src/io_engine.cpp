@@ -0,0 +1,358 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "io_engine.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+IoEngine* IoEngine::create() {
+  IoEngine* engine = UringIoEngine::tryCreate(64);
+  if (engine == NULL) {
+    engine = new ThreadPoolIoEngine(4);
+  }
+  return engine;
+}
+
+//----------------------------------------
+// Thread pool
+//----------------------------------------
+
+ThreadPoolIoEngine::ThreadPoolIoEngine(unsigned threads)
+    : stopping(false) {
+  for (unsigned t = 0; t < threads; t++) {
+    workers.push_back(std::thread(&ThreadPoolIoEngine::run, this));
+  }
+}
+
+ThreadPoolIoEngine::~ThreadPoolIoEngine() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wakeup.notify_all();
+  for (std::size_t t = 0; t < workers.size(); t++) {
+    workers[t].join();
+  }
+}
+
+void ThreadPoolIoEngine::read(File* file, const PageId pageNo, Page& page,
+                              Completion done) {
+  Page* target = &page;
+  submit([file, pageNo, target, done]() {
+    std::exception_ptr error;
+    try {
+      file->readPageInto(pageNo, *target);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    done(error);
+  });
+}
+
+void ThreadPoolIoEngine::write(File* file, const Page& page,
+                               Completion done) {
+  const Page* source = &page;
+  submit([file, source, done]() {
+    std::exception_ptr error;
+    try {
+      file->writePage(*source);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    done(error);
+  });
+}
+
+void ThreadPoolIoEngine::submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(task);
+  }
+  wakeup.notify_one();
+}
+
+void ThreadPoolIoEngine::run() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (queue.empty() && !stopping) {
+        wakeup.wait(lock);
+      }
+      if (queue.empty()) {
+        return;
+      }
+      task = queue.front();
+      queue.pop_front();
+    }
+    task();
+  }
+}
+
+//----------------------------------------
+// io_uring
+//----------------------------------------
+
+#ifdef __NR_io_uring_setup
+
+namespace {
+
+/**
+ * Thread running UringIoEngine::reap(), which must never wait for ring slots.
+ */
+thread_local const UringIoEngine* reaperOf = NULL;
+
+int uringSetup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uringEnter(int fd, unsigned submit, unsigned complete, unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, submit, complete,
+                                  flags, NULL, 0));
+}
+
+}
+
+UringIoEngine* UringIoEngine::tryCreate(unsigned entries) {
+  UringIoEngine* engine = new UringIoEngine(entries);
+  if (engine->ringFd < 0) {
+    delete engine;
+    return NULL;
+  }
+  return engine;
+}
+
+UringIoEngine::UringIoEngine(unsigned entries)
+    : ringFd(-1), entries(entries), sqRing(MAP_FAILED), sqRingSize(0),
+      cqRing(MAP_FAILED), cqRingSize(0), sqes(MAP_FAILED), sqesSize(0),
+      inFlight(0), pool(2) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  const int fd = uringSetup(entries, &params);
+  if (fd < 0) {
+    return;
+  }
+  this->entries = params.sq_entries;
+
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (cqRingSize > sqRingSize) {
+      sqRingSize = cqRingSize;
+    }
+    cqRingSize = sqRingSize;
+  }
+  sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    cqRing = sqRing;
+  } else if (sqRing != MAP_FAILED) {
+    cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  }
+  sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  sqes = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+    ::close(fd);
+    return;
+  }
+
+  char* sq = static_cast<char*>(sqRing);
+  sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  char* cq = static_cast<char*>(cqRing);
+  cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes = cq + params.cq_off.cqes;
+
+  ringFd = fd;
+  reaper = std::thread(&UringIoEngine::reap, this);
+}
+
+UringIoEngine::~UringIoEngine() {
+  if (ringFd >= 0) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (inFlight > 0) {
+        slotFreed.wait(lock);
+      }
+      // A no-op with no request attached tells the reaper to stop.
+      push(IORING_OP_NOP, -1, NULL, 0, 0, 0);
+    }
+    reaper.join();
+    ::close(ringFd);
+  }
+  if (sqes != MAP_FAILED) {
+    munmap(sqes, sqesSize);
+  }
+  if (cqRing != MAP_FAILED && cqRing != sqRing) {
+    munmap(cqRing, cqRingSize);
+  }
+  if (sqRing != MAP_FAILED) {
+    munmap(sqRing, sqRingSize);
+  }
+}
+
+void UringIoEngine::read(File* file, const PageId pageNo, Page& page,
+                         Completion done) {
+  int fd;
+  std::uint64_t offset;
+  char* buffer;
+  try {
+    if (!file->prepareAsyncRead(pageNo, page, fd, offset, buffer)) {
+      pool.read(file, pageNo, page, done);
+      return;
+    }
+  } catch (...) {
+    done(std::current_exception());
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  if (inFlight >= entries) {
+    if (reaperOf == this) {
+      // Waiting here would stop completions from ever being reaped.
+      lock.unlock();
+      pool.read(file, pageNo, page, done);
+      return;
+    }
+    while (inFlight >= entries) {
+      slotFreed.wait(lock);
+    }
+  }
+  Request* request = new Request{file, pageNo, &page, done};
+  const int error = push(IORING_OP_READ, fd, buffer, Page::SIZE, offset,
+                         reinterpret_cast<std::uint64_t>(request));
+  if (error != 0) {
+    lock.unlock();
+    delete request;
+    done(std::make_exception_ptr(
+        FileIOException(file->filename(), "submit read", error)));
+    return;
+  }
+  inFlight++;
+}
+
+void UringIoEngine::write(File* file, const Page& page, Completion done) {
+  pool.write(file, page, done);
+}
+
+int UringIoEngine::push(std::uint8_t opcode, int fd, char* buffer,
+                         std::uint32_t length, std::uint64_t offset,
+                         std::uint64_t data) {
+  const unsigned tail = *sqTail;
+  const unsigned index = tail & *sqMask;
+  io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes) + index;
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<std::uint64_t>(buffer);
+  sqe->len = length;
+  sqe->off = offset;
+  sqe->user_data = data;
+  sqArray[index] = index;
+  __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+  // Without SQPOLL the kernel consumes the entry during this call, so the
+  // submission ring never holds more than one entry.
+  for (;;) {
+    if (uringEnter(ringFd, 1, 0, 0) >= 0) {
+      return 0;
+    }
+    if (errno != EINTR) {
+      // Take the entry back so the ring stays consistent.
+      const int error = errno;
+      __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+      return error;
+    }
+  }
+}
+
+void UringIoEngine::reap() {
+  reaperOf = this;
+  for (;;) {
+    unsigned head = *cqHead;
+    const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      uringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS);
+      continue;
+    }
+    for (; head != tail; head++) {
+      const io_uring_cqe* cqe =
+          static_cast<const io_uring_cqe*>(cqes) + (head & *cqMask);
+      Request* request = reinterpret_cast<Request*>(cqe->user_data);
+      const int result = cqe->res;
+      __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+      if (request == NULL) {
+        return;
+      }
+      complete(request, result);
+    }
+  }
+}
+
+void UringIoEngine::complete(Request* request, int result) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    inFlight--;
+  }
+  slotFreed.notify_all();
+
+  std::exception_ptr error;
+  try {
+    if (result < 0) {
+      throw FileIOException(request->file->filename(), "read", -result);
+    }
+    if (static_cast<std::size_t>(result) < Page::SIZE) {
+      // Short read; let the file finish it (and zero-fill past the end).
+      request->file->readPageInto(request->pageNo, *request->page);
+    } else {
+      request->file->finishAsyncRead(request->pageNo, *request->page);
+    }
+  } catch (...) {
+    error = std::current_exception();
+  }
+  Completion done = request->done;
+  delete request;
+  done(error);
+}
+
+#else
+
+UringIoEngine* UringIoEngine::tryCreate(unsigned) {
+  return NULL;
+}
+
+UringIoEngine::~UringIoEngine() {
+}
+
+void UringIoEngine::read(File* file, const PageId pageNo, Page& page,
+                         Completion done) {
+  pool.read(file, pageNo, page, done);
+}
+
+void UringIoEngine::write(File* file, const Page& page, Completion done) {
+  pool.write(file, page, done);
+}
+
+#endif
+
+}
@@ -0,0 +1,276 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Performs page reads and writes in the background.
+ *
+ * A request is handed to the engine together with a completion callback; the
+ * engine performs the transfer and invokes the callback on one of its own
+ * threads, passing an exception pointer that is null on success.  The page
+ * passed to a request must stay valid until its callback has run.  Callbacks
+ * should return quickly; they may submit further requests.
+ */
+class IoEngine {
+ public:
+  /**
+   * Callback invoked when a request finishes.
+   */
+  typedef std::function<void(std::exception_ptr)> Completion;
+
+  /**
+   * Creates the best engine available: io_uring where the kernel supports it,
+   * a thread pool otherwise.
+   *
+   * @return  Newly allocated engine; owned by the caller.
+   */
+  static IoEngine* create();
+
+  /**
+   * Waits for every outstanding request to complete.
+   */
+  virtual ~IoEngine() {}
+
+  /**
+   * Reads a used page of a file into the given page, with the checks of
+   * File::readPageInto().
+   *
+   * @param file    File to read from.
+   * @param pageNo  Number of the page to read.
+   * @param page    Page to read into.
+   * @param done    Invoked when the read has finished or failed.
+   */
+  virtual void read(File* file, const PageId pageNo, Page& page,
+                    Completion done) = 0;
+
+  /**
+   * Writes a page to a file, like File::writePage().
+   *
+   * @param file    File to write to.
+   * @param page    Page to write.
+   * @param done    Invoked when the write has finished or failed.
+   */
+  virtual void write(File* file, const Page& page, Completion done) = 0;
+};
+
+/**
+ * @brief IoEngine that runs blocking File calls on a pool of worker threads.
+ *
+ * Works with every file backend; the number of transfers in flight is bounded
+ * by the number of workers.
+ */
+class ThreadPoolIoEngine : public IoEngine {
+ public:
+  /**
+   * Starts the worker threads.
+   *
+   * @param threads   Number of workers.
+   */
+  explicit ThreadPoolIoEngine(unsigned threads);
+
+  /**
+   * Finishes all queued requests and stops the workers.
+   */
+  ~ThreadPoolIoEngine();
+
+  void read(File* file, const PageId pageNo, Page& page,
+            Completion done) override;
+
+  void write(File* file, const Page& page, Completion done) override;
+
+ private:
+  /**
+   * Queues a task for the workers.
+   *
+   * @param task  Task to run.
+   */
+  void submit(std::function<void()> task);
+
+  /**
+   * Body of a worker thread.
+   */
+  void run();
+
+  /**
+   * Guards <queue> and <stopping>.
+   */
+  std::mutex mutex;
+
+  /**
+   * Signalled when a task is queued or the pool is stopping.
+   */
+  std::condition_variable wakeup;
+
+  /**
+   * Tasks waiting for a worker.
+   */
+  std::deque<std::function<void()> > queue;
+
+  /**
+   * Set by the destructor; workers exit once the queue is empty.
+   */
+  bool stopping;
+
+  /**
+   * Worker threads.
+   */
+  std::vector<std::thread> workers;
+};
+
+/**
+ * @brief IoEngine that submits reads to a Linux io_uring instance.
+ *
+ * Reads of files with a descriptor-based backend (POSIX or DIRECT) are queued
+ * on the ring straight into the destination page, so one thread can keep many
+ * reads in flight; a single reaper thread runs the completions.  Writes, reads
+ * of STREAM files and reads submitted from a completion while the ring is full
+ * go to a small thread pool instead: writes must hold the file's list mutex
+ * across the transfer (see File::writePage()), which a ring cannot do.
+ */
+class UringIoEngine : public IoEngine {
+ public:
+  /**
+   * Sets up a ring with the given number of submission entries.
+   *
+   * @param entries   Maximum number of reads in flight on the ring.
+   * @return  Newly allocated engine, or NULL if io_uring is not available.
+   */
+  static UringIoEngine* tryCreate(unsigned entries);
+
+  /**
+   * Waits for all reads in flight, stops the reaper and tears down the ring.
+   */
+  ~UringIoEngine();
+
+  void read(File* file, const PageId pageNo, Page& page,
+            Completion done) override;
+
+  void write(File* file, const Page& page, Completion done) override;
+
+ private:
+  /**
+   * A read in flight; its address is the ring's user data.
+   */
+  struct Request {
+    File* file;
+    PageId pageNo;
+    Page* page;
+    Completion done;
+  };
+
+  /**
+   * Sets up the ring and starts the reaper; leaves <ringFd> negative if the
+   * kernel refuses.
+   *
+   * @param entries   Number of submission entries.
+   */
+  explicit UringIoEngine(unsigned entries);
+
+  /**
+   * Puts one entry on the submission ring and tells the kernel about it.
+   * Caller must hold <mutex>.
+   *
+   * @param opcode  IORING_OP_* code.
+   * @param fd      Descriptor to operate on.
+   * @param buffer  Destination of a read.
+   * @param length  Number of bytes.
+   * @param offset  Position in the file.
+   * @param data    User data returned with the completion.
+   * @return  0, or the errno value if the kernel rejected the entry.
+   */
+  int push(std::uint8_t opcode, int fd, char* buffer, std::uint32_t length,
+            std::uint64_t offset, std::uint64_t data);
+
+  /**
+   * Body of the reaper thread.
+   */
+  void reap();
+
+  /**
+   * Finishes a read whose transfer has completed.
+   *
+   * @param request   The read.
+   * @param result    Result reported by the kernel (bytes or -errno).
+   */
+  void complete(Request* request, int result);
+
+  /**
+   * Descriptor of the ring.
+   */
+  int ringFd;
+
+  /**
+   * Number of submission ring entries.
+   */
+  unsigned entries;
+
+  /**
+   * Mappings of the submission ring, completion ring and entry array.
+   */
+  void* sqRing;
+  std::size_t sqRingSize;
+  void* cqRing;
+  std::size_t cqRingSize;
+  void* sqes;
+  std::size_t sqesSize;
+
+  /**
+   * Fields of the submission ring.
+   */
+  unsigned* sqTail;
+  unsigned* sqMask;
+  unsigned* sqArray;
+
+  /**
+   * Fields of the completion ring.
+   */
+  unsigned* cqHead;
+  unsigned* cqTail;
+  unsigned* cqMask;
+  void* cqes;
+
+  /**
+   * Serializes submissions and guards <inFlight>.
+   */
+  std::mutex mutex;
+
+  /**
+   * Signalled when a read completes.
+   */
+  std::condition_variable slotFreed;
+
+  /**
+   * Number of reads submitted to the ring and not yet completed.
+   */
+  unsigned inFlight;
+
+  /**
+   * Thread that waits for and runs completions.
+   */
+  std::thread reaper;
+
+  /**
+   * Engine for writes and for reads the ring cannot take.
+   */
+  ThreadPoolIoEngine pool;
+};
+
+}
@@ -0,0 +1,408 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "log_manager.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <unordered_set>
+
+#include "file.h"
+#include "page.h"
+#include "exceptions/badgerdb_exception.h"
+#include "exceptions/file_io_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/page_checksum_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * @brief Reads the records of a log one after another, stopping at the first
+ *        one that is torn or is not a record at all.
+ */
+class LogReader {
+ public:
+  explicit LogReader(const std::string& filename)
+      : in_(filename.c_str(), std::ios::binary), size_(0), position_(0) {
+    if (in_) {
+      in_.seekg(0, std::ios::end);
+      size_ = in_.tellg();
+    }
+  }
+
+  /**
+   * Returns false if the log could not be opened.
+   */
+  bool isOpen() const { return in_.is_open(); }
+
+  /**
+   * Moves to the record starting at a log position.
+   *
+   * @return  False if the position lies past the end of the log.
+   */
+  bool seek(const Lsn position) {
+    if (position > size_) {
+      return false;
+    }
+    in_.clear();
+    in_.seekg(position, std::ios::beg);
+    position_ = position;
+    return true;
+  }
+
+  /**
+   * Reads the next record.
+   *
+   * @param header    Receives the header of the record.
+   * @param payload   Receives the rest of the record.
+   * @return  False at the end of the intact records.
+   */
+  bool next(LogRecordHeader& header, std::vector<char>& payload) {
+    if (position_ + sizeof(header) > size_ ||
+        !in_.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+      return false;
+    }
+    // A record is only taken as such if it says where it ends, and ends
+    // within the file
+    if (header.length < sizeof(header) ||
+        header.lsn != position_ + header.length || header.lsn > size_ ||
+        header.type > LogRecordHeader::CHECKPOINT) {
+      return false;
+    }
+    payload.resize(header.length - sizeof(header));
+    if (!payload.empty() && !in_.read(payload.data(), payload.size())) {
+      return false;
+    }
+    position_ = header.lsn;
+    return true;
+  }
+
+  /**
+   * Returns the log position just past the last record read.
+   */
+  Lsn position() const { return position_; }
+
+ private:
+  std::ifstream in_;
+  Lsn size_;
+  Lsn position_;
+};
+
+/**
+ * Contents of the master file: where the last complete checkpoint is.
+ */
+struct MasterRecord {
+  Lsn redoLsn;
+  Lsn checkpointLsn;
+};
+
+bool readMaster(const std::string& filename, MasterRecord& master) {
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  return in.read(reinterpret_cast<char*>(&master), sizeof(master)) &&
+      master.redoLsn <= master.checkpointLsn;
+}
+
+}
+
+LogManager::LogManager(const std::string& filename, unsigned commitDelayUs,
+                       bool create_new)
+    : name(filename),
+      io(FileIo::open(filename, create_new, FileBackend::POSIX)),
+      commitDelayUs(commitDelayUs),
+      pendingStart(0),
+      writing(false),
+      durable(0),
+      nextTxn(1),
+      syncCount(0) {
+  if (create_new) {
+    // A master file left from an earlier log would point into the new one
+    std::remove(masterName(name).c_str());
+    return;
+  }
+
+  // Only the records of the last checkpoint on can be read back, so those are
+  // enough to find the end of the log and the transactions already used
+  MasterRecord master;
+  LogReader reader(name);
+  if (!readMaster(masterName(name), master) || !reader.seek(master.redoLsn)) {
+    reader.seek(0);
+  }
+  LogRecordHeader header;
+  std::vector<char> payload;
+  TxnId next = 1;
+  while (reader.next(header, payload)) {
+    next = std::max(next, header.type == LogRecordHeader::CHECKPOINT
+                              ? header.txn : header.txn + 1);
+  }
+  // Cuts off a torn record, so that whatever follows it can never be taken
+  // for records appended later
+  if (::ftruncate(io->descriptor(), reader.position()) != 0) {
+    throw FileIOException(name, "truncate", errno);
+  }
+  pendingStart = reader.position();
+  durable.store(pendingStart, std::memory_order_relaxed);
+  nextTxn.store(next, std::memory_order_relaxed);
+}
+
+LogManager::~LogManager() {
+  try {
+    flushTo(appendedLsn());
+  } catch (const BadgerDbException&) {
+    // Nothing can be reported from a destructor; the records not yet written
+    // belong to transactions that have not committed.
+  }
+}
+
+Lsn LogManager::append(LogRecordHeader::Type type, TxnId txn,
+                       const char* const* parts, const std::size_t* lengths,
+                       std::size_t count) {
+  LogRecordHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.length = sizeof(header);
+  for (std::size_t p = 0; p < count; p++) {
+    header.length += lengths[p];
+  }
+  header.type = type;
+  header.lsn = pendingStart + pending.size() + header.length;
+  header.txn = txn;
+
+  const std::size_t offset = pending.size();
+  pending.resize(offset + header.length);
+  char* out = &pending[offset];
+  std::memcpy(out, &header, sizeof(header));
+  out += sizeof(header);
+  for (std::size_t p = 0; p < count; p++) {
+    std::memcpy(out, parts[p], lengths[p]);
+    out += lengths[p];
+  }
+  return header.lsn;
+}
+
+Lsn LogManager::logPage(TxnId txn, const File& file, Page& page) {
+  const std::uint32_t nameLength = file.filename().size();
+  const PageId pageNo = page.page_number();
+  const char* parts[] = {reinterpret_cast<const char*>(&nameLength),
+                         file.filename().data(),
+                         reinterpret_cast<const char*>(&pageNo),
+                         reinterpret_cast<const char*>(page.header_)};
+  const std::size_t lengths[] = {sizeof(nameLength), nameLength,
+                                 sizeof(pageNo), Page::SIZE};
+
+  std::lock_guard<std::mutex> guard(mutex);
+  // The image logged carries the LSN of its own record, which is known before
+  // anything is copied
+  Lsn lsn = pendingStart + pending.size() + sizeof(LogRecordHeader);
+  for (std::size_t p = 0; p < 4; p++) {
+    lsn += lengths[p];
+  }
+  page.header_->lsn = lsn;
+  return append(LogRecordHeader::PAGE, txn, parts, lengths, 4);
+}
+
+Lsn LogManager::commit(TxnId txn) {
+  Lsn lsn;
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    lsn = append(LogRecordHeader::COMMIT, txn, NULL, NULL, 0);
+  }
+  flushTo(lsn);
+  return lsn;
+}
+
+Lsn LogManager::checkpoint(Lsn redoLsn) {
+  std::lock_guard<std::mutex> master(masterMutex);
+  Lsn lsn;
+  {
+    const char* parts[] = {reinterpret_cast<const char*>(&redoLsn)};
+    const std::size_t lengths[] = {sizeof(redoLsn)};
+    std::lock_guard<std::mutex> guard(mutex);
+    // The record carries the next transaction identifier, so a reopened log
+    // does not hand out one already used
+    lsn = append(LogRecordHeader::CHECKPOINT,
+                 nextTxn.load(std::memory_order_relaxed), parts, lengths, 1);
+  }
+  flushTo(lsn);
+
+  // Replaces the master file in one step, so a crash leaves either the
+  // previous checkpoint or this one
+  const MasterRecord record = {redoLsn, lsn};
+  const std::string target = masterName(name);
+  const std::string temp = target + ".tmp";
+  {
+    std::unique_ptr<FileIo> out(
+        FileIo::open(temp, true /* create_new */, FileBackend::POSIX));
+    out->write(reinterpret_cast<const char*>(&record), sizeof(record), 0);
+    out->sync();
+  }
+  if (std::rename(temp.c_str(), target.c_str()) != 0) {
+    throw FileIOException(target, "rename", errno);
+  }
+  return lsn;
+}
+
+RecoveryStats LogManager::recover(const std::string& filename) {
+  LogReader reader(filename);
+  if (!reader.isOpen()) {
+    throw FileNotFoundException(filename);
+  }
+  RecoveryStats stats = RecoveryStats();
+  MasterRecord master;
+  if (readMaster(masterName(filename), master) && reader.seek(master.redoLsn)) {
+    stats.redoStart = master.redoLsn;
+  }
+
+  // First pass: finds the end of the log and the transactions that committed
+  LogRecordHeader header;
+  std::vector<char> payload;
+  std::unordered_set<TxnId> committed;
+  while (true) {
+    reader.seek(stats.redoStart);
+    while (reader.next(header, payload)) {
+      stats.records++;
+      if (header.type == LogRecordHeader::COMMIT) {
+        committed.insert(header.txn);
+      }
+    }
+    stats.end = reader.position();
+    if (stats.redoStart == 0 || stats.end >= master.checkpointLsn) {
+      break;
+    }
+    // The log ends before the checkpoint the master file names, so the master
+    // file does not belong to it; reads all of it instead
+    stats.redoStart = 0;
+    stats.records = 0;
+    committed.clear();
+  }
+  stats.committed = committed.size();
+
+  // Second pass: writes back the page images of committed transactions that
+  // are newer than the pages on disk, oldest first
+  std::map<std::string, File> files;
+  reader.seek(stats.redoStart);
+  while (reader.position() < stats.end && reader.next(header, payload)) {
+    if (header.type != LogRecordHeader::PAGE ||
+        committed.find(header.txn) == committed.end()) {
+      continue;
+    }
+    std::uint32_t nameLength = 0;
+    PageId pageNo;
+    if (payload.size() >= sizeof(nameLength)) {
+      std::memcpy(&nameLength, payload.data(), sizeof(nameLength));
+    }
+    if (payload.size() != sizeof(nameLength) + nameLength + sizeof(pageNo) +
+                              Page::SIZE) {
+      continue;
+    }
+    const std::string pageFile(payload.data() + sizeof(nameLength), nameLength);
+    const char* image = payload.data() + sizeof(nameLength) + nameLength;
+    std::memcpy(&pageNo, image, sizeof(pageNo));
+    image += sizeof(pageNo);
+
+    std::map<std::string, File>::iterator file = files.find(pageFile);
+    if (file == files.end()) {
+      if (!File::exists(pageFile)) {
+        stats.pagesSkipped++;
+        continue;
+      }
+      file = files.insert(std::make_pair(pageFile, File::open(pageFile))).first;
+    }
+    try {
+      // The page may have been allocated after its file header was last
+      // written.
+      file->second.extendTo(pageNo + 1);
+      bool newer = true;
+      try {
+        newer = file->second.readPage(pageNo).lsn() < header.lsn;
+      } catch (const PageChecksumException&) {
+        // Torn by the crash; the image replaces it whole
+      }
+      if (!newer) {
+        continue;
+      }
+      Page page;
+      std::memcpy(page.header_, image, Page::SIZE);
+      file->second.writePage(page);
+      stats.pagesRedone++;
+    } catch (const InvalidPageException&) {
+      // The page has been deleted since
+      stats.pagesSkipped++;
+    }
+  }
+  for (std::map<std::string, File>::iterator file = files.begin();
+       file != files.end(); ++file) {
+    file->second.sync();
+  }
+  return stats;
+}
+
+std::string LogManager::masterName(const std::string& filename) {
+  return filename + ".master";
+}
+
+Lsn LogManager::appendedLsn() const {
+  std::lock_guard<std::mutex> guard(mutex);
+  return pendingStart + pending.size();
+}
+
+void LogManager::flushTo(Lsn lsn) {
+  std::unique_lock<std::mutex> guard(mutex);
+  if (lsn > pendingStart + pending.size()) {
+    lsn = pendingStart + pending.size();
+  }
+  while (durable.load(std::memory_order_relaxed) < lsn) {
+    if (writing) {
+      // Another thread is writing; the records appended since go out with the
+      // next write, which one of the waiters performs.
+      written.wait(guard);
+      continue;
+    }
+    writing = true;
+    if (commitDelayUs > 0) {
+      guard.unlock();
+      std::this_thread::sleep_for(std::chrono::microseconds(commitDelayUs));
+      guard.lock();
+    }
+    std::vector<char> batch;
+    batch.swap(pending);
+    const Lsn start = pendingStart;
+    pendingStart += batch.size();
+    guard.unlock();
+
+    try {
+      io->write(batch.data(), batch.size(), start);
+      io->sync();
+    } catch (...) {
+      // Puts the records back in front of those appended meanwhile, so the
+      // next flush retries them
+      guard.lock();
+      batch.insert(batch.end(), pending.begin(), pending.end());
+      pending.swap(batch);
+      pendingStart = start;
+      writing = false;
+      written.notify_all();
+      throw;
+    }
+
+    guard.lock();
+    durable.store(start + batch.size(), std::memory_order_release);
+    syncCount.fetch_add(1, std::memory_order_relaxed);
+    writing = false;
+    written.notify_all();
+  }
+}
+
+}
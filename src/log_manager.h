@@ -0,0 +1,328 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "file_io.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class File;
+class Page;
+
+/**
+ * @brief Header of every record in the write-ahead log; 24 bytes.
+ */
+struct LogRecordHeader {
+  /**
+   * Kinds of records.
+   */
+  enum Type : std::uint8_t {
+    PAGE,       // after-image of a page: file name, page number and the page
+    COMMIT,     // end of a transaction; its pages are durable once this is
+    CHECKPOINT  // end of a checkpoint: the LSN recovery may start from
+  };
+
+  /**
+   * Bytes of the record, header included.
+   */
+  std::uint32_t length;
+
+  /**
+   * Type of the record.
+   */
+  Type type;
+
+  std::uint8_t reserved[3];
+
+  /**
+   * LSN of the record: the log position just past it.
+   */
+  Lsn lsn;
+
+  /**
+   * Transaction the record belongs to.
+   */
+  TxnId txn;
+};
+
+/**
+ * @brief What a recovery pass found and did; see LogManager::recover().
+ */
+struct RecoveryStats {
+  /**
+   * Log position the pass started from: that of the last complete checkpoint,
+   * or 0 if there is none.
+   */
+  Lsn redoStart;
+
+  /**
+   * LSN of the last intact record; everything after it is ignored.
+   */
+  Lsn end;
+
+  /**
+   * Number of records read from <redoStart> on.
+   */
+  std::uint64_t records;
+
+  /**
+   * Number of transactions found committed from <redoStart> on.
+   */
+  std::uint64_t committed;
+
+  /**
+   * Number of page images written back to their files.
+   */
+  std::uint64_t pagesRedone;
+
+  /**
+   * Number of page images of committed transactions left out because their
+   * file or page no longer exists.
+   */
+  std::uint64_t pagesSkipped;
+};
+
+/**
+ * @brief Write-ahead log with group commit.
+ *
+ * Transactions log the after-image of every page they change (logPage()),
+ * which also stamps the page with the LSN of the record, and then commit().
+ * Records are appended to an in-memory buffer; a commit returns once the log
+ * is durable up to its COMMIT record.  Commits that arrive while the log is
+ * being written wait for the next write, so one sequential write and one sync
+ * make a whole group of transactions durable.  A commit delay can be set to
+ * widen the groups at the cost of latency.
+ *
+ * A BufMgr given a log (BufMgr::setLog()) never writes a dirty page before
+ * the log is durable up to the page's LSN (flushTo()), so every page on disk
+ * is covered by the log.  Pages of memory-mapped files are written by the
+ * kernel at any time and get no such guarantee.
+ *
+ * A checkpoint (see BufMgr::checkpoint()) writes back every page dirtied
+ * before it began and then appends a CHECKPOINT record holding the log
+ * position it began at, which is also kept in a small master file next to the
+ * log (the log's name followed by ".master").  After a crash, recover() reads
+ * the log only from that position on and writes back the last image of every
+ * page changed by a committed transaction, so restart takes time in proportion
+ * to the log written since the last checkpoint, not to the size of the files.
+ * A page torn by the crash fails its checksum (see File) and is replaced by
+ * its last image.  Recovery only redoes: changes of transactions that never
+ * committed are not replayed, but are not undone either if they reached the
+ * disk.
+ *
+ * All methods are thread-safe.
+ */
+class LogManager {
+ public:
+  /**
+   * Creates a new, empty log, replacing any file of that name, or opens an
+   * existing one to append to it.  An existing log is read up to its last
+   * intact record; a record torn by a crash, and anything after it, is
+   * overwritten by the next records appended.
+   *
+   * @param filename      Name of the log file.
+   * @param commitDelayUs Microseconds a commit that is about to write the log
+   *                      waits for more commits to join it; 0 writes at once.
+   * @param create_new    True to start a new log, false to append to the
+   *                      existing one.
+   * @throws  FileIOException  If the file cannot be created or opened.
+   */
+  explicit LogManager(const std::string& filename,
+                      unsigned commitDelayUs = 0,
+                      bool create_new = true);
+
+  /**
+   * Makes everything appended durable and closes the log.
+   */
+  ~LogManager();
+
+  /**
+   * Returns the identifier of a new transaction.
+   */
+  TxnId begin() {
+    return nextTxn.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Appends the current contents of a page, stamping it with the LSN of the
+   * record first.  The caller must hold the page pinned, keep others from
+   * changing it meanwhile (e.g. by latching it exclusively) and mark it dirty
+   * when unpinning.
+   *
+   * @param txn     Transaction changing the page.
+   * @param file    File of the page.
+   * @param page    The page, as changed.
+   * @return  LSN of the record.
+   */
+  Lsn logPage(TxnId txn, const File& file, Page& page);
+
+  /**
+   * Appends the COMMIT record of a transaction and returns once it is
+   * durable.
+   *
+   * @param txn   Transaction to commit.
+   * @return  LSN of the COMMIT record.
+   * @throws  FileIOException  If the log cannot be written.
+   */
+  Lsn commit(TxnId txn);
+
+  /**
+   * Appends a CHECKPOINT record, returns once it is durable and records it in
+   * the master file.  Called by BufMgr::checkpoint() once every page dirtied
+   * before <redoLsn> was appended is on disk.
+   *
+   * @param redoLsn   Log position recovery may start from.
+   * @return  LSN of the CHECKPOINT record.
+   * @throws  FileIOException  If the log or the master file cannot be
+   *                           written.
+   */
+  Lsn checkpoint(Lsn redoLsn);
+
+  /**
+   * Brings the files a log refers to up to date after a crash: reads the log
+   * from its last complete checkpoint on and writes back, in log order, every
+   * page image of a committed transaction that is newer than the page on
+   * disk, then syncs the files.  A file whose header on disk ends before such
+   * a page, allocated after the header was last written, is grown to hold it
+   * (see File::extendTo()).  Running it again changes nothing.  Call it
+   * before the files are used, and before the log is opened for appending.
+   *
+   * @param filename  Name of the log file.
+   * @return  What was found and done.
+   * @throws  FileNotFoundException  If there is no log of that name.
+   */
+  static RecoveryStats recover(const std::string& filename);
+
+  /**
+   * Returns once the log is durable up to the given LSN, writing it if
+   * needed.
+   *
+   * @param lsn   LSN that must be durable.
+   * @throws  FileIOException  If the log cannot be written.
+   */
+  void flushTo(Lsn lsn);
+
+  /**
+   * Returns the LSN of the last record appended.
+   */
+  Lsn appendedLsn() const;
+
+  /**
+   * Returns the LSN up to which the log is durable.
+   */
+  Lsn durableLsn() const {
+    return durable.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Returns the number of times the log has been written and synced.
+   */
+  std::uint64_t syncs() const {
+    return syncCount.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the name of the log file.
+   */
+  const std::string& filename() const { return name; }
+
+ private:
+  LogManager(const LogManager&);
+  LogManager& operator=(const LogManager&);
+
+  /**
+   * Appends a record to the buffer. Caller must hold <mutex>.
+   *
+   * @param type      Type of the record.
+   * @param txn       Transaction of the record.
+   * @param parts     Payload, as consecutive pieces.
+   * @param lengths   Length of each piece.
+   * @param count     Number of pieces.
+   * @return  LSN of the record.
+   */
+  Lsn append(LogRecordHeader::Type type, TxnId txn, const char* const* parts,
+             const std::size_t* lengths, std::size_t count);
+
+  /**
+   * Returns the name of the master file of a log.
+   *
+   * @param filename  Name of the log file.
+   */
+  static std::string masterName(const std::string& filename);
+
+  /**
+   * Name of the log file.
+   */
+  const std::string name;
+
+  /**
+   * The log file.
+   */
+  std::unique_ptr<FileIo> io;
+
+  /**
+   * How long a writing commit waits for others to join.
+   */
+  const unsigned commitDelayUs;
+
+  /**
+   * Guards everything below except the atomics.
+   */
+  mutable std::mutex mutex;
+
+  /**
+   * Serializes checkpoint() calls, so the master file only moves forward.
+   */
+  std::mutex masterMutex;
+
+  /**
+   * Signalled when a write of the log finishes.
+   */
+  std::condition_variable written;
+
+  /**
+   * Records appended but not yet handed to a write.
+   */
+  std::vector<char> pending;
+
+  /**
+   * Log position of the first byte of <pending>.
+   */
+  Lsn pendingStart;
+
+  /**
+   * True while a thread is writing the log.
+   */
+  bool writing;
+
+  /**
+   * LSN up to which the log is durable.
+   */
+  std::atomic<Lsn> durable;
+
+  /**
+   * Identifier of the next transaction.
+   */
+  std::atomic<TxnId> nextTxn;
+
+  /**
+   * Number of writes and syncs of the log.
+   */
+  std::atomic<std::uint64_t> syncCount;
+};
+
+}
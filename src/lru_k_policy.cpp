@@ -0,0 +1,143 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "lru_k_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+LruKPolicy::LruKPolicy(FrameStates* states, FrameId first, std::uint32_t num,
+                       std::uint32_t k)
+    : ReplacementPolicy(states, first, num),
+      k(k == 0 ? 1 : k),
+      now(0),
+      history(num * this->k, 0),
+      keys(num),
+      resident(num, false),
+      freeFrames(first, num),
+      retainSeq(0) {
+  // Hand out low frame numbers first.
+  for (std::uint32_t i = 0; i < num; ++i) {
+    freeFrames.pushFront(first + i);
+  }
+}
+
+LruKPolicy::Rank LruKPolicy::rankOf(FrameId frame) const {
+  const std::uint64_t* hist = &history[(frame - firstFrame) * k];
+  return Rank(std::make_pair(hist[k - 1], hist[0]), frame);
+}
+
+void LruKPolicy::recordAccess(FrameId frame) {
+  std::uint64_t* hist = &history[(frame - firstFrame) * k];
+  std::copy_backward(hist, hist + k - 1, hist + k);
+  hist[0] = ++now;
+}
+
+void LruKPolicy::frameAccessed(FrameId frame) {
+  ranks.erase(rankOf(frame));
+  recordAccess(frame);
+  ranks.insert(rankOf(frame));
+}
+
+void LruKPolicy::frameLoaded(FrameId frame, const PageKey& key) {
+  const FrameId i = frame - firstFrame;
+  std::uint64_t* hist = &history[i * k];
+  std::unordered_map<PageKey,
+                     std::pair<std::vector<std::uint64_t>, std::uint64_t>,
+                     PageKeyHash>::iterator old = retained.find(key);
+  if (old != retained.end()) {
+    std::copy(old->second.first.begin(), old->second.first.end(), hist);
+    retained.erase(old);
+  } else {
+    std::fill(hist, hist + k, 0);
+  }
+  recordAccess(frame);
+  keys[i] = key;
+  resident[i] = true;
+  ranks.insert(rankOf(frame));
+}
+
+void LruKPolicy::frameFreed(FrameId frame) {
+  const FrameId i = frame - firstFrame;
+  if (resident[i]) {
+    ranks.erase(rankOf(frame));
+    resident[i] = false;
+  }
+  freeFrames.pushFront(frame);
+}
+
+void LruKPolicy::frameTaken(FrameId frame) {
+  const FrameId i = frame - firstFrame;
+  if (resident[i]) {
+    ranks.erase(rankOf(frame));
+    resident[i] = false;
+  }
+}
+
+void LruKPolicy::frameResident(FrameId frame, const PageKey& key) {
+  if (freeFrames.contains(frame)) {
+    freeFrames.remove(frame);
+  }
+  retained.erase(key);
+  const FrameId i = frame - firstFrame;
+  std::uint64_t* hist = &history[i * k];
+  // Ranked by the order the pages come in; no access is recorded.
+  std::fill(hist, hist + k, 0);
+  hist[0] = ++now;
+  keys[i] = key;
+  resident[i] = true;
+  ranks.insert(rankOf(frame));
+}
+
+bool LruKPolicy::pickVictim(const PageKey& key, FrameId& frame,
+                            const FrameFilter* skip) {
+  if (freeFrames.size() > 0) {
+    frame = freeFrames.back();
+    freeFrames.remove(frame);
+    return true;
+  }
+
+  for (std::set<Rank>::iterator it = ranks.begin(); it != ranks.end(); ++it) {
+    if (isPassedOver(it->second, skip) || !claim(it->second)) {
+      continue;
+    }
+    frame = it->second;
+    ranks.erase(it);
+
+    // Retain the history of the evicted page, forgetting the oldest retained
+    // history once as many pages are remembered as there are frames.
+    const FrameId i = frame - firstFrame;
+    resident[i] = false;
+    const std::uint64_t* hist = &history[i * k];
+    retained[keys[i]] = std::make_pair(std::vector<std::uint64_t>(hist, hist + k),
+                                       retainSeq);
+    retainedOrder.push_back(std::make_pair(keys[i], retainSeq++));
+    while (retainedOrder.size() > numFrames) {
+      const std::pair<PageKey, std::uint64_t> oldest = retainedOrder.front();
+      retainedOrder.pop_front();
+      std::unordered_map<PageKey,
+                         std::pair<std::vector<std::uint64_t>, std::uint64_t>,
+                         PageKeyHash>::iterator entry = retained.find(oldest.first);
+      if (entry != retained.end() && entry->second.second == oldest.second) {
+        retained.erase(entry);
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+void LruKPolicy::victimOrder(std::vector<FrameId>& order) const {
+  order.clear();
+  for (std::set<Rank>::const_iterator it = ranks.begin(); it != ranks.end();
+       ++it) {
+    order.push_back(it->second);
+  }
+}
+
+}
@@ -0,0 +1,127 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <deque>
+#include <set>
+#include <utility>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief LRU-K replacement policy (O'Neil, O'Neil and Weikum).
+ *
+ * Evicts the unpinned page whose K-th most recent access lies furthest in the
+ * past.  Pages referenced fewer than K times count as infinitely old and are
+ * evicted first, in LRU order, so a page touched once by a sequential scan
+ * never displaces pages that are referenced repeatedly.  The access history of
+ * evicted pages is retained for as many pages as there are frames, so a page
+ * that returns soon keeps its record.
+ */
+class LruKPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs an LRU-K policy over the frames [first, first + num).
+   *
+   * @param states      Frame state words of the buffer manager.
+   * @param first       First frame of the partition.
+   * @param num         Number of frames in the partition.
+   * @param k           Number of past references considered.
+   */
+  LruKPolicy(FrameStates* states, FrameId first, std::uint32_t num,
+             std::uint32_t k);
+
+  void frameAccessed(FrameId frame);
+  void frameLoaded(FrameId frame, const PageKey& key);
+  void frameFreed(FrameId frame);
+  bool pickVictim(const PageKey& key, FrameId& frame,
+                  const FrameFilter* skip);
+  void frameTaken(FrameId frame);
+  void frameResident(FrameId frame, const PageKey& key);
+  void victimOrder(std::vector<FrameId>& order) const;
+
+ private:
+  /**
+   * Eviction order of resident frames: K-th most recent access, then most
+   * recent access, then frame number.
+   */
+  typedef std::pair<std::pair<std::uint64_t, std::uint64_t>, FrameId> Rank;
+
+  /**
+   * Returns the current rank of a resident frame.
+   *
+   * @param frame   Resident frame.
+   */
+  Rank rankOf(FrameId frame) const;
+
+  /**
+   * Records an access at the current time in the history of a frame.
+   *
+   * @param frame   Frame being accessed.
+   */
+  void recordAccess(FrameId frame);
+
+  /**
+   * Number of past references considered.
+   */
+  std::uint32_t k;
+
+  /**
+   * Logical clock, advanced on every access.
+   */
+  std::uint64_t now;
+
+  /**
+   * Access history of every frame, K entries per frame, most recent first; 0
+   * means "never".
+   */
+  std::vector<std::uint64_t> history;
+
+  /**
+   * Page held by every resident frame.
+   */
+  std::vector<PageKey> keys;
+
+  /**
+   * Whether each frame currently holds a page known to this policy.
+   */
+  std::vector<bool> resident;
+
+  /**
+   * Resident frames in eviction order.
+   */
+  std::set<Rank> ranks;
+
+  /**
+   * Frames not holding any page.
+   */
+  FrameList freeFrames;
+
+  /**
+   * Retained history of evicted pages, with the sequence number of its entry
+   * in <retainedOrder>.
+   */
+  std::unordered_map<PageKey, std::pair<std::vector<std::uint64_t>, std::uint64_t>,
+                     PageKeyHash> retained;
+
+  /**
+   * Retained pages in order of eviction, with the sequence number they were
+   * retained under; entries whose number no longer matches are stale.  Holds at
+   * most as many entries as there are frames.
+   */
+  std::deque<std::pair<PageKey, std::uint64_t> > retainedOrder;
+
+  /**
+   * Sequence number for the next retained history.
+   */
+  std::uint64_t retainSeq;
+};
+
+}
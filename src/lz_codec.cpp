@@ -0,0 +1,219 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "lz_codec.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Shortest copy worth coding.
+ */
+const std::size_t MIN_MATCH = 4;
+
+/**
+ * Farthest back a copy may reach.
+ */
+const std::size_t MAX_OFFSET = 65535;
+
+/**
+ * Bits of the hash of four bytes used to find earlier occurrences.
+ */
+const int HASH_BITS = 12;
+
+/**
+ * Longest lengths held in the four bits of a token; longer ones continue in
+ * the bytes after it.
+ */
+const std::size_t TOKEN_MAX = 15;
+
+std::uint32_t read32(const unsigned char* p) {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+std::uint32_t hash4(const unsigned char* p) {
+  return (read32(p) * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/**
+ * @brief Appends to the compressed output, failing once it is full.
+ */
+class Writer {
+ public:
+  Writer(char* output, const std::size_t capacity)
+      : out_(reinterpret_cast<unsigned char*>(output)),
+        capacity_(capacity),
+        length_(0) {}
+
+  bool put(const unsigned char byte) {
+    if (length_ == capacity_) {
+      return false;
+    }
+    out_[length_++] = byte;
+    return true;
+  }
+
+  bool put(const unsigned char* bytes, const std::size_t count) {
+    if (capacity_ - length_ < count) {
+      return false;
+    }
+    std::memcpy(out_ + length_, bytes, count);
+    length_ += count;
+    return true;
+  }
+
+  /**
+   * Writes the part of a length that did not fit in its token: 255 while more
+   * follows, then the rest.
+   */
+  bool putLength(std::size_t extra) {
+    for (; extra >= 255; extra -= 255) {
+      if (!put(255)) {
+        return false;
+      }
+    }
+    return put((unsigned char) extra);
+  }
+
+  std::size_t length() const { return length_; }
+
+ private:
+  unsigned char* out_;
+  std::size_t capacity_;
+  std::size_t length_;
+};
+
+/**
+ * Writes a sequence: literals, then, unless <match> is 0, a copy.
+ */
+bool putSequence(Writer& out, const unsigned char* literals,
+                 const std::size_t numLiterals, const std::size_t offset,
+                 const std::size_t match) {
+  const std::size_t matchCode = match == 0 ? 0 : match - MIN_MATCH;
+  const unsigned char token = (unsigned char)
+      ((std::min(numLiterals, TOKEN_MAX) << 4) |
+       std::min(matchCode, TOKEN_MAX));
+  if (!out.put(token) ||
+      (numLiterals >= TOKEN_MAX && !out.putLength(numLiterals - TOKEN_MAX)) ||
+      !out.put(literals, numLiterals)) {
+    return false;
+  }
+  if (match == 0) {
+    return true;
+  }
+  return out.put((unsigned char) (offset & 0xFF)) &&
+      out.put((unsigned char) (offset >> 8)) &&
+      (matchCode < TOKEN_MAX || out.putLength(matchCode - TOKEN_MAX));
+}
+
+/**
+ * Reads the part of a length that did not fit in its token.
+ */
+bool getLength(const unsigned char*& in, const unsigned char* end,
+               std::size_t& length) {
+  unsigned char byte;
+  do {
+    if (in == end) {
+      return false;
+    }
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+}
+
+std::size_t lzCompress(const char* input, std::size_t length, char* output,
+                       std::size_t capacity) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(input);
+  // Position + 1 of the last occurrence of each hash; 0 for none
+  std::uint32_t last[1 << HASH_BITS] = {0};
+  Writer out(output, capacity);
+  std::size_t anchor = 0;
+  std::size_t pos = 0;
+  while (pos + MIN_MATCH <= length) {
+    const std::uint32_t h = hash4(in + pos);
+    const std::size_t candidate = last[h];
+    last[h] = pos + 1;
+    if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET ||
+        read32(in + candidate - 1) != read32(in + pos)) {
+      // Skips faster through bytes that do not repeat
+      pos += 1 + ((pos - anchor) >> 5);
+      continue;
+    }
+    const std::size_t from = candidate - 1;
+    std::size_t match = MIN_MATCH;
+    while (pos + match < length && in[from + match] == in[pos + match]) {
+      match++;
+    }
+    if (!putSequence(out, in + anchor, pos - anchor, pos - from, match)) {
+      return 0;
+    }
+    pos += match;
+    anchor = pos;
+  }
+  if (!putSequence(out, in + anchor, length - anchor, 0, 0)) {
+    return 0;
+  }
+  return out.length();
+}
+
+bool lzDecompress(const char* input, std::size_t length, char* output,
+                  std::size_t outputLength) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(input);
+  const unsigned char* end = in + length;
+  unsigned char* out = reinterpret_cast<unsigned char*>(output);
+  std::size_t produced = 0;
+  while (in < end) {
+    const unsigned char token = *in++;
+    std::size_t numLiterals = token >> 4;
+    if (numLiterals == TOKEN_MAX && !getLength(in, end, numLiterals)) {
+      return false;
+    }
+    if ((std::size_t) (end - in) < numLiterals ||
+        outputLength - produced < numLiterals) {
+      return false;
+    }
+    std::memcpy(out + produced, in, numLiterals);
+    in += numLiterals;
+    produced += numLiterals;
+    if (in == end) {
+      break;
+    }
+
+    if (end - in < 2) {
+      return false;
+    }
+    const std::size_t offset = in[0] | (std::size_t) in[1] << 8;
+    in += 2;
+    std::size_t match = token & 0x0F;
+    if (match == TOKEN_MAX && !getLength(in, end, match)) {
+      return false;
+    }
+    match += MIN_MATCH;
+    if (offset == 0 || offset > produced || outputLength - produced < match) {
+      return false;
+    }
+    // Byte by byte, since a copy may overlap the bytes it produces
+    const unsigned char* from = out + produced - offset;
+    for (std::size_t i = 0; i < match; i++) {
+      out[produced + i] = from[i];
+    }
+    produced += match;
+  }
+  return produced == outputLength;
+}
+
+}
@@ -0,0 +1,44 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * Compresses a buffer with a byte-oriented LZ77 code in the manner of LZ4:
+ * runs of literal bytes alternate with copies of at least four bytes from up
+ * to 64 KB back, found through a hash of the next four bytes.  Fast enough to
+ * run on every page write, and runs of equal bytes, such as the free space of
+ * a page, shrink to a few bytes.
+ *
+ * @param input     Bytes to compress.
+ * @param length    Number of bytes.
+ * @param output    Receives the compressed bytes.
+ * @param capacity  Room in <output>.
+ * @return  Number of compressed bytes, or 0 if they do not fit in <capacity>.
+ */
+std::size_t lzCompress(const char* input, std::size_t length, char* output,
+                       std::size_t capacity);
+
+/**
+ * Decompresses what lzCompress() produced.  Malformed input is detected rather
+ * than read or written out of bounds.
+ *
+ * @param input         Compressed bytes.
+ * @param length        Number of compressed bytes.
+ * @param output        Receives the original bytes.
+ * @param outputLength  Number of original bytes.
+ * @return  False if the input is malformed or does not decompress to exactly
+ *          <outputLength> bytes.
+ */
+bool lzDecompress(const char* input, std::size_t length, char* output,
+                  std::size_t outputLength);
+
+}
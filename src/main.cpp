@@ -1,10 +1,29 @@
 #include <iostream>
 #include <stdlib.h>
 //#include <stdio.h>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <memory>
+#include <stdexcept>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <vector>
 #include "page.h"
 #include "buffer.h"
+#include "buf_scan_iterator.h"
+#include "buf_record_scanner.h"
+#include "page_handle.h"
+#include "buf_coroutine.h"
+#include "bulk_loader.h"
+#include "log_manager.h"
+#include "numa.h"
+#include "crc32c.h"
+#include "exceptions/page_checksum_exception.h"
+#include "exceptions/page_size_exception.h"
 #include "file_iterator.h"
 #include "page_iterator.h"
 #include "exceptions/file_not_found_exception.h"
@@ -13,6 +32,7 @@
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/bad_buffer_exception.h"
+#include "exceptions/insufficient_space_exception.h"
 
 #define PRINT_ERROR(str) \
 { \
@@ -40,6 +60,46 @@ void test6();
 void test7();
 void test8();
 void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+void test31();
+void test32();
+void test33();
+void test34();
+void test35();
+void test36();
+void test37();
+void test38();
+void test39();
+void test40();
+void test41();
+void test42();
+void test43();
+void test44();
+void test45();
+void test46();
+void test47();
+void test48();
+void test49();
 void testBufMgr();
 
 int main() 
@@ -156,6 +216,46 @@ void testBufMgr()
 	test7();
 	test8();
 	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
+	test31();
+	test32();
+	test33();
+	test34();
+	test35();
+	test36();
+	test37();
+	test38();
+	test39();
+	test40();
+	test41();
+	test42();
+	test43();
+	test44();
+	test45();
+	test46();
+	test47();
+	test48();
+	test49();
 
 	//Close files before deleting them
 	file1.~File();
@@ -332,18 +432,24 @@ void test6()
 
 void test7()
 {
-	try
-	{
-		// Attempts to flush the same file several times
-		for (i = 1; i <= num; i++)
-			bufMgr->flushFile(file1ptr);
-		PRINT_ERROR("ERROR :: Should not have been able to flush the same file several times. Exception should have been thrown before execution reaches this point.");
-	}
-	// Catch BadBufferException because same file is flushed
-	catch(const BadBufferException& e)
+	//Flushing touches only the frames of the flushed file
+	Page* file2page;
+	bufMgr->readPage(file2ptr, 1, file2page);
+	bufMgr->unPinPage(file2ptr, 1, false);
+
+	// Flushing a file with no resident pages does nothing
+	for (i = 1; i <= num; i++)
+		bufMgr->flushFile(file1ptr);
+
+	bufMgr->readPage(file2ptr, 1, page);
+	if (page != file2page)
 	{
-		std::cout << "Test 7 passed" << "\n";
+		PRINT_ERROR("ERROR :: Flushing a file should not evict pages of other files.");
 	}
+	bufMgr->unPinPage(file2ptr, 1, false);
+	bufMgr->flushFile(file2ptr);
+
+	std::cout << "Test 7 passed" << "\n";
 }
 
 void test8()
@@ -381,5 +487,3374 @@ void test9()
 		}
 	
 	}
+
+	//Pages that are not in the buffer pool are deleted from the file as well
+	PageId unbuffered = file1ptr->allocatePage().page_number();
+	bufMgr->disposePage(file1ptr, unbuffered);
+	try
+	{
+		file1ptr->readPage(unbuffered);
+		PRINT_ERROR("ERROR :: Page should have been disposed. InvalidPageException should have been thrown before execution reaches this point.");
+	}
+	catch(const InvalidPageException& e)
+	{
+	}
 	std::cout<<"Test 9 passed" << "\n";
 }
+
+void test10()
+{
+	//Concurrent readers on a partitioned buffer pool
+	const std::string& filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		BufMgr* partitionedMgr = new BufMgr(num, 4);
+		std::vector<PageId> pages(2*num);
+		for (i = 0; i < 2*num; i++)
+		{
+			partitionedMgr->allocPage(&file6, pages[i], page);
+			sprintf((char*)tmpbuf, "test.6 Page %u %7.1f", pages[i], (float)pages[i]);
+			page->insertRecord(tmpbuf);
+			partitionedMgr->unPinPage(&file6, pages[i], true);
+		}
+
+		//Every thread reads random pages; twice as many pages as frames forces evictions in all partitions
+		std::atomic<int> mismatches(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; t++)
+		{
+			threads.push_back(std::thread([&, t]() {
+				unsigned int seed = t + 1;
+				char expected[100];
+				for (int n = 0; n < 1000; n++)
+				{
+					seed = seed * 1103515245 + 12345;
+					const PageId pageNo = pages[(seed >> 16) % pages.size()];
+					Page* threadPage;
+					partitionedMgr->readPage(&file6, pageNo, threadPage);
+					sprintf(expected, "test.6 Page %u %7.1f", pageNo, (float)pageNo);
+					const RecordId recordId = {pageNo, 1};
+					if (threadPage->getRecord(recordId) != expected)
+					{
+						mismatches++;
+					}
+					partitionedMgr->unPinPage(&file6, pageNo, false);
+				}
+			}));
+		}
+		for (std::size_t t = 0; t < threads.size(); t++)
+		{
+			threads[t].join();
+		}
+		if (mismatches != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		delete partitionedMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 10 passed" << "\n";
+}
+
+void test11()
+{
+	//Lookups in the hash table run without locks while a single writer keeps inserting and removing entries
+	BufHashTbl table(num);
+	for (i = 1; i <= num/2; i++)
+	{
+		table.insert(file1ptr, i, i);
+	}
+
+	std::atomic<bool> done(false);
+	std::thread writer([&]() {
+		for (int round = 0; round < 200; round++)
+		{
+			for (PageId p = 1; p <= num/2; p++)
+				table.insert(file2ptr, p, num + p);
+			for (PageId p = 1; p <= num/2; p++)
+				table.remove(file2ptr, p);
+		}
+		done = true;
+	});
+
+	int missing = 0;
+	while (!done)
+	{
+		for (PageId p = 1; p <= num/2; p++)
+		{
+			FrameId frameNo;
+			if (!table.find(file1ptr, p, frameNo) || frameNo != p)
+			{
+				missing++;
+			}
+		}
+	}
+	writer.join();
+
+	FrameId frameNo;
+	if (missing != 0 || table.find(file2ptr, 1, frameNo))
+	{
+		PRINT_ERROR("ERROR :: Hash table returned a wrong entry during concurrent updates");
+	}
+
+	std::cout << "Test 11 passed" << "\n";
+}
+
+void test12()
+{
+	//Every replacement policy must keep contents correct and refuse to evict pinned pages; all but CLOCK must also keep
+	//a repeatedly used set of pages resident while a long sequential scan passes through the pool
+	const std::string& filename = "test.7";
+	const ReplacementPolicyType policies[] = {ReplacementPolicyType::CLOCK, ReplacementPolicyType::LRU_K,
+		ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC, ReplacementPolicyType::CLOCK_PRO};
+	const PageId hotPages = num/4;
+	const PageId totalPages = 5*num;
+
+	for (std::size_t p = 0; p < sizeof(policies)/sizeof(policies[0]); p++)
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+
+		{
+			File file7 = File::create(filename);
+			std::vector<RecordId> records(totalPages + 1);
+			for (i = 1; i <= totalPages; i++)
+			{
+				Page newPage = file7.allocatePage();
+				sprintf((char*)tmpbuf, "test.7 Page %u", newPage.page_number());
+				records[newPage.page_number()] = newPage.insertRecord(tmpbuf);
+				file7.writePage(newPage);
+			}
+
+			BufMgr* policyMgr = new BufMgr(num, 1, policies[p]);
+			PageId nextCold = hotPages + 1;
+			//Hot pages are used again and again, interleaved with pages that are used once
+			for (int round = 0; round < 6; round++)
+			{
+				for (i = 1; i <= hotPages; i++)
+				{
+					policyMgr->readPage(&file7, i, page);
+					policyMgr->unPinPage(&file7, i, false);
+				}
+				for (int n = 0; n < 30; n++, nextCold++)
+				{
+					policyMgr->readPage(&file7, nextCold, page);
+					policyMgr->unPinPage(&file7, nextCold, false);
+				}
+			}
+			//A scan over more pages than there are frames
+			for (i = nextCold; i <= totalPages; i++)
+			{
+				policyMgr->readPage(&file7, i, page);
+				sprintf((char*)tmpbuf, "test.7 Page %u", i);
+				if(page->getRecord(records[i]) != tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				policyMgr->unPinPage(&file7, i, false);
+			}
+
+			//Change the hot pages behind the buffer manager's back; pages still buffered keep showing the old contents
+			for (i = 1; i <= hotPages; i++)
+			{
+				Page diskPage = file7.readPage(i);
+				diskPage.updateRecord(records[i], "changed");
+				file7.writePage(diskPage);
+			}
+			PageId resident = 0;
+			for (i = 1; i <= hotPages; i++)
+			{
+				policyMgr->readPage(&file7, i, page);
+				if(page->getRecord(records[i]) != "changed")
+				{
+					resident++;
+				}
+				policyMgr->unPinPage(&file7, i, false);
+			}
+			if (policies[p] != ReplacementPolicyType::CLOCK && resident != hotPages)
+			{
+				PRINT_ERROR("ERROR :: Scan evicted hot pages. Scan resistant policy should have kept them in the buffer pool.");
+			}
+
+			//Pinned pages are never evicted
+			for (i = 1; i <= num; i++)
+			{
+				policyMgr->readPage(&file7, i, page);
+			}
+			try
+			{
+				policyMgr->readPage(&file7, num + 1, page);
+				PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+			}
+			catch(const BufferExceededException &e)
+			{
+			}
+			for (i = 1; i <= num; i++)
+			{
+				policyMgr->unPinPage(&file7, i, false);
+			}
+
+			//A dirty page that cannot be written back stays in its frame, and the policy keeps offering that frame
+			policyMgr->readPage(&file7, 1, page);
+			page->updateRecord(records[1], "written back");
+			policyMgr->unPinPage(&file7, 1, true);
+			for (i = 2; i <= num; i++)
+			{
+				policyMgr->readPage(&file7, i, page);
+			}
+			file7.deletePage(1);
+			for (int attempt = 0; attempt < 2; attempt++)
+			{
+				try
+				{
+					policyMgr->readPage(&file7, num + 1, page);
+					PRINT_ERROR("ERROR :: Writing back a deleted page should fail. Exception should have been thrown before execution reaches this point.");
+				}
+				catch(const InvalidPageException &e)
+				{
+				}
+				catch(const BufferExceededException &e)
+				{
+					PRINT_ERROR("ERROR :: A frame whose write-back failed should still be offered as a victim.");
+				}
+			}
+			if (file7.allocatePage().page_number() != 1)
+			{
+				PRINT_ERROR("ERROR :: The deleted page should be allocated again.");
+			}
+			policyMgr->readPage(&file7, num + 1, page);
+			policyMgr->unPinPage(&file7, num + 1, false);
+			for (i = 2; i <= num; i++)
+			{
+				policyMgr->unPinPage(&file7, i, false);
+			}
+			if (file7.readPage(1).getRecord(records[1]) != "written back")
+			{
+				PRINT_ERROR("ERROR :: The page should have been written back once its write succeeded.");
+			}
+			delete policyMgr;
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 12 passed" << "\n";
+}
+
+void test13()
+{
+	//Buffered pages are views over their frame: copies are independent, assignment writes into the frame
+	PageId pageNo;
+	bufMgr->allocPage(file1ptr, pageNo, page);
+	Page* frame = page;
+	RecordId recordId = page->insertRecord("original");
+
+	Page copy = *page;
+	copy.updateRecord(recordId, "copy");
+	if(page->getRecord(recordId) != "original" || copy.getRecord(recordId) != "copy")
+	{
+		PRINT_ERROR("ERROR :: Copy of a buffered page should not share its frame.");
+	}
+
+	*page = copy;
+	if(page != frame || frame->getRecord(recordId) != "copy")
+	{
+		PRINT_ERROR("ERROR :: Assigning to a buffered page should copy into its frame.");
+	}
+	bufMgr->unPinPage(file1ptr, pageNo, true);
+
+	bufMgr->readPage(file1ptr, pageNo, page);
+	if(page->getRecord(recordId) != "copy")
+	{
+		PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+	}
+	bufMgr->unPinPage(file1ptr, pageNo, false);
+	bufMgr->disposePage(file1ptr, pageNo);
+
+	//A page moved from gives its storage away and gets new storage when assigned to, leaving the new owner alone
+	Page moved(std::move(copy));
+	Page other;
+	const RecordId otherId = other.insertRecord("other");
+	copy = other;
+	if(moved.getRecord(recordId) != "copy" || copy.getRecord(otherId) != "other")
+	{
+		PRINT_ERROR("ERROR :: Assigning to a page moved from should not change the page it moved to.");
+	}
+
+	std::cout << "Test 13 passed" << "\n";
+}
+
+void test14()
+{
+	//Positional backends: pages written through the buffer pool read back the same with any backend, also from several
+	//threads at once
+	const std::string& filename = "test.8";
+	const FileBackend backends[] = {FileBackend::POSIX, FileBackend::DIRECT};
+	const PageId totalPages = 2*num;
+
+	for (std::size_t b = 0; b < sizeof(backends)/sizeof(backends[0]); b++)
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+
+		{
+			File file8 = File::create(filename, backends[b]);
+			if (backends[b] == FileBackend::POSIX && file8.backend() != FileBackend::POSIX)
+			{
+				PRINT_ERROR("ERROR :: File should use the requested backend.");
+			}
+			BufMgr* backendMgr = new BufMgr(num, 2);
+			for (i = 1; i <= totalPages; i++)
+			{
+				PageId pageNo;
+				backendMgr->allocPage(&file8, pageNo, page);
+				sprintf((char*)tmpbuf, "test.8 Page %u %7.1f", pageNo, (float)pageNo);
+				page->insertRecord(tmpbuf);
+				backendMgr->unPinPage(&file8, pageNo, true);
+			}
+			delete backendMgr;
+			file8.sync();
+
+			std::atomic<int> mismatches(0);
+			std::vector<std::thread> threads;
+			for (int t = 0; t < 4; t++)
+			{
+				threads.push_back(std::thread([&, t]() {
+					char expected[100];
+					for (PageId pageNo = t + 1; pageNo <= totalPages; pageNo += 4)
+					{
+						Page threadPage = file8.readPage(pageNo);
+						sprintf(expected, "test.8 Page %u %7.1f", pageNo, (float)pageNo);
+						const RecordId recordId = {pageNo, 1};
+						if (threadPage.getRecord(recordId) != expected)
+						{
+							mismatches++;
+						}
+					}
+				}));
+			}
+			for (std::size_t t = 0; t < threads.size(); t++)
+			{
+				threads[t].join();
+			}
+			if (mismatches != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+
+		{
+			File file8 = File::open(filename);
+			PageId pages = 0;
+			for (FileIterator iter = file8.begin(); iter != file8.end(); ++iter)
+			{
+				Page filePage = *iter;
+				sprintf((char*)tmpbuf, "test.8 Page %u %7.1f", filePage.page_number(), (float)filePage.page_number());
+				const RecordId recordId = {filePage.page_number(), 1};
+				if (filePage.getRecord(recordId) != tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				pages++;
+			}
+			if (pages != totalPages)
+			{
+				PRINT_ERROR("ERROR :: File should contain every allocated page.");
+			}
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 14 passed" << "\n";
+}
+
+void test15()
+{
+	//Asynchronous reads: many reads in flight at once, repeated requests for a page being read share the transfer,
+	//and errors reach the caller through the future
+	const std::string& filename = "test.9";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file9 = File::create(filename, FileBackend::POSIX);
+		for (i = 1; i <= num; i++)
+		{
+			Page filePage = file9.allocatePage();
+			sprintf((char*)tmpbuf, "test.9 Page %u %7.1f", filePage.page_number(), (float)filePage.page_number());
+			filePage.insertRecord(tmpbuf);
+			file9.writePage(filePage);
+		}
+
+		BufMgr* asyncMgr = new BufMgr(num);
+		std::vector<std::future<Page*> > reads;
+		for (i = 1; i <= num/2; i++)
+		{
+			reads.push_back(asyncMgr->readPageAsync(&file9, i));
+			reads.push_back(asyncMgr->readPageAsync(&file9, i));
+		}
+		//A blocking reader of a page in flight waits for the same transfer
+		asyncMgr->readPage(&file9, 1, page);
+
+		std::atomic<int> callbacks(0);
+		for (i = num/2 + 1; i <= num; i++)
+		{
+			asyncMgr->readPageAsync(&file9, i, [&](Page* readPage, std::exception_ptr error) {
+				if (readPage != NULL && !error)
+				{
+					callbacks++;
+				}
+			});
+		}
+
+		std::vector<Page*> readPages;
+		for (std::size_t r = 0; r < reads.size(); r++)
+		{
+			readPages.push_back(reads[r].get());
+			const PageId pageNo = r/2 + 1;
+			sprintf((char*)tmpbuf, "test.9 Page %u %7.1f", pageNo, (float)pageNo);
+			const RecordId recordId = {pageNo, 1};
+			if (readPages[r]->getRecord(recordId) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		for (std::size_t r = 0; r < reads.size(); r += 2)
+		{
+			if (readPages[r] != readPages[r+1])
+			{
+				PRINT_ERROR("ERROR :: Reads of the same page should share one frame.");
+			}
+		}
+		if (page != readPages[0])
+		{
+			PRINT_ERROR("ERROR :: Blocking read should return the frame being read asynchronously.");
+		}
+		while (callbacks != (int) (num - num/2))
+		{
+			std::this_thread::yield();
+		}
+
+		//Every frame is pinned now, so a further miss fails through the future
+		try
+		{
+			asyncMgr->readPageAsync(&file9, num + 1).get();
+			PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const BufferExceededException &e)
+		{
+		}
+
+		for (i = 1; i <= num/2; i++)
+		{
+			asyncMgr->unPinPage(&file9, i, false);
+			asyncMgr->unPinPage(&file9, i, false);
+		}
+		asyncMgr->unPinPage(&file9, 1, false);
+		for (i = num/2 + 1; i <= num; i++)
+		{
+			asyncMgr->unPinPage(&file9, i, false);
+		}
+
+		//Pages that do not exist are reported as for readPage
+		try
+		{
+			asyncMgr->readPageAsync(&file9, num + 1).get();
+			PRINT_ERROR("ERROR :: Should not be able to read invalid page. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const InvalidPageException &e)
+		{
+		}
+		delete asyncMgr;
+	}
+	File::remove(filename);
+
+	//Files without a descriptor-based backend are read on the engine's worker threads
+	page = bufMgr->readPageAsync(file2ptr, 1).get();
+	sprintf((char*)tmpbuf, "test.2 Page %u %7.1f", 1, (float)1);
+	if(strncmp(page->getRecord({1, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+	{
+		PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+	}
+	bufMgr->unPinPage(file2ptr, 1, false);
+
+	std::cout << "Test 15 passed" << "\n";
+}
+
+void test16()
+{
+	//Background cleaner: dirty unpinned frames reach the disk without being evicted or flushed
+	const std::string& filename = "test.10";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file10 = File::create(filename, FileBackend::POSIX);
+		BufMgr* cleanedMgr = new BufMgr(num);
+		cleanedMgr->startCleaner(0.0, 0.0, 1);
+
+		std::vector<PageId> pageNos;
+		for (i = 0; i < num; i++)
+		{
+			PageId pageNo;
+			cleanedMgr->allocPage(&file10, pageNo, page);
+			sprintf((char*)tmpbuf, "test.10 Page %u %7.1f", pageNo, (float)pageNo);
+			page->insertRecord(tmpbuf);
+			cleanedMgr->unPinPage(&file10, pageNo, true);
+			pageNos.push_back(pageNo);
+		}
+
+		//Every page is written back by the cleaner alone
+		const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		std::size_t written = 0;
+		while (written < pageNos.size() && std::chrono::steady_clock::now() < deadline)
+		{
+			Page onDisk = file10.readPage(pageNos[written]);
+			if (onDisk.begin() != onDisk.end())
+			{
+				sprintf((char*)tmpbuf, "test.10 Page %u %7.1f", pageNos[written], (float)pageNos[written]);
+				if (*onDisk.begin() != tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				written++;
+			}
+			else
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+		if (written != pageNos.size())
+		{
+			PRINT_ERROR("ERROR :: Cleaner did not write back dirty pages.");
+		}
+
+		//Cleaned pages stay in the pool and can be dirtied again
+		cleanedMgr->readPage(&file10, pageNos[0], page);
+		cleanedMgr->unPinPage(&file10, pageNos[0], true);
+		cleanedMgr->stopCleaner();
+		delete cleanedMgr;
+		Page onDisk = file10.readPage(pageNos[0]);
+		if (onDisk.begin() == onDisk.end())
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 16 passed" << "\n";
+}
+
+void test17()
+{
+	//Scans through the buffer pool visit every used page in order, with read-ahead, and leave nothing pinned
+	const std::string& filename = "test.11";
+	const FileBackend backends[] = {FileBackend::STREAM, FileBackend::POSIX};
+	for (std::size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++)
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+
+		File file11 = File::create(filename, backends[b]);
+		for (i = 1; i <= 3*num; i++)
+		{
+			Page filePage = file11.allocatePage();
+			sprintf((char*)tmpbuf, "test.11 Page %u %7.1f", filePage.page_number(), (float)filePage.page_number());
+			filePage.insertRecord(tmpbuf);
+			file11.writePage(filePage);
+		}
+		//Gaps in the used list break the sequential run
+		file11.deletePage(num);
+		file11.deletePage(num + 1);
+
+		BufMgr* scanMgr = new BufMgr(num);
+		PageId expected = 1;
+		for (BufScanIterator iter(scanMgr, &file11); iter != BufScanIterator(); ++iter)
+		{
+			if (expected == num)
+			{
+				expected += 2;
+			}
+			if ((*iter)->page_number() != expected)
+			{
+				PRINT_ERROR("ERROR :: Scan visited pages out of order.");
+			}
+			sprintf((char*)tmpbuf, "test.11 Page %u %7.1f", expected, (float)expected);
+			if (*(*iter)->begin() != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			expected++;
+		}
+		if (expected != 3*num + 1)
+		{
+			PRINT_ERROR("ERROR :: Scan did not visit every page.");
+		}
+
+		//An abandoned scan releases its page
+		{
+			BufScanIterator iter(scanMgr, &file11);
+			++iter;
+		}
+		scanMgr->flushFile(&file11);
+		delete scanMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 17 passed" << "\n";
+}
+
+void test18()
+{
+	//Batched calls: runs of new pages are allocated and read together, and a failing batch leaves nothing pinned
+	const std::string& filename = "test.12";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file12 = File::create(filename, FileBackend::POSIX);
+		BufMgr* batchMgr = new BufMgr(num, 4);
+		std::vector<PageId> pageNos;
+		std::vector<Page*> pages;
+		batchMgr->allocPages(&file12, num/2, pageNos, pages);
+		for (std::size_t p = 0; p < pageNos.size(); p++)
+		{
+			if (pageNos[p] != pageNos[0] + p)
+			{
+				PRINT_ERROR("ERROR :: Pages allocated together should be consecutive.");
+			}
+			sprintf((char*)tmpbuf, "test.12 Page %u %7.1f", pageNos[p], (float)pageNos[p]);
+			pages[p]->insertRecord(tmpbuf);
+		}
+		batchMgr->unPinPages(&file12, pageNos, true);
+		batchMgr->flushFile(&file12);
+
+		//Reads the pages back from disk, requesting one of them twice
+		std::vector<PageId> wanted(pageNos);
+		wanted.push_back(pageNos[0]);
+		batchMgr->readPages(&file12, wanted, pages);
+		for (std::size_t p = 0; p < wanted.size(); p++)
+		{
+			sprintf((char*)tmpbuf, "test.12 Page %u %7.1f", wanted[p], (float)wanted[p]);
+			if (pages[p]->page_number() != wanted[p] || *pages[p]->begin() != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		if (pages[0] != pages[wanted.size() - 1])
+		{
+			PRINT_ERROR("ERROR :: Both reads of a page should return the same frame.");
+		}
+		batchMgr->unPinPages(&file12, wanted, false);
+
+		try
+		{
+			batchMgr->unPinPages(&file12, pageNos, false);
+			PRINT_ERROR("ERROR :: Pages have already been unpinned. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const PageNotPinnedException &e)
+		{
+		}
+
+		//A page that does not exist fails the whole batch
+		wanted.push_back(pageNos.back() + 1);
+		try
+		{
+			batchMgr->readPages(&file12, wanted, pages);
+			PRINT_ERROR("ERROR :: Should not be able to read invalid page. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const InvalidPageException &e)
+		{
+		}
+
+		//So does running out of frames
+		try
+		{
+			batchMgr->allocPages(&file12, num + 1, pageNos, pages);
+			PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const BufferExceededException &e)
+		{
+		}
+
+		//Flushing fails if any page is still pinned
+		batchMgr->flushFile(&file12);
+		delete batchMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 18 passed" << "\n";
+}
+
+void test19()
+{
+	//Allocation appends at the remembered tail and reuses freed pages in order, also after the file is reopened
+	const std::string& filename = "test.13";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file13 = File::create(filename);
+		for (i = 1; i <= 3*num; i++)
+		{
+			file13.allocatePage();
+		}
+		//Deletes the head, the tail and pages in between
+		file13.deletePage(1);
+		file13.deletePage(3*num);
+		file13.deletePage(num);
+		file13.deletePage(2*num);
+	}
+
+	{
+		File file13 = File::open(filename);
+		//Reuses the freed pages, then appends after the last used page
+		for (i = 0; i < 5; i++)
+		{
+			file13.allocatePage();
+		}
+		PageId expected = 1;
+		for (FileIterator iter = file13.begin(); iter != file13.end(); ++iter)
+		{
+			if ((*iter).page_number() != expected)
+			{
+				PRINT_ERROR("ERROR :: Used pages out of order.");
+			}
+			expected++;
+		}
+		if (expected != 3*num + 2)
+		{
+			PRINT_ERROR("ERROR :: Used list lost pages.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 19 passed" << "\n";
+}
+
+void test20()
+{
+	//The file header is kept in memory and reaches the disk when the file is synced
+	const std::string& filename = "test.14";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file14 = File::create(filename);
+		for (i = 1; i <= 3; i++)
+		{
+			file14.allocatePage();
+		}
+		file14.sync();
+
+		PageId numPages = 0;
+		std::ifstream raw(filename, std::ios::binary);
+		raw.read((char*)&numPages, sizeof(numPages));
+		if (numPages != 4)
+		{
+			PRINT_ERROR("ERROR :: Synced file header should count the header page and three pages.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 20 passed" << "\n";
+}
+
+void test21()
+{
+	//Frames of memory-mapped files view the mapping instead of holding copies
+	const std::string& filename = "test.15";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file15 = File::create(filename, FileBackend::MMAP);
+		BufMgr* mappedMgr = new BufMgr(num);
+		std::vector<PageId> pageNos;
+		std::vector<Page*> pages;
+		mappedMgr->allocPages(&file15, 2*num/3, pageNos, pages);
+		mappedMgr->unPinPages(&file15, pageNos, false);
+
+		//A record added through the pool is in the file at once
+		for (std::size_t p = 0; p < pageNos.size(); p++)
+		{
+			mappedMgr->readPage(&file15, pageNos[p], page);
+			sprintf((char*)tmpbuf, "test.15 Page %u %7.1f", pageNos[p], (float)pageNos[p]);
+			page->insertRecord(tmpbuf);
+			mappedMgr->unPinPage(&file15, pageNos[p], true);
+			Page onDisk = file15.readPage(pageNos[p]);
+			if (onDisk.begin() == onDisk.end() || *onDisk.begin() != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Mapped frame should be a view of the file.");
+			}
+		}
+
+		file15.advise(AccessPattern::SEQUENTIAL);
+		std::size_t visited = 0;
+		for (BufScanIterator iter(mappedMgr, &file15); iter != BufScanIterator(); ++iter)
+		{
+			sprintf((char*)tmpbuf, "test.15 Page %u %7.1f", pageNos[visited], (float)pageNos[visited]);
+			if (*(*iter)->begin() != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			visited++;
+		}
+		if (visited != pageNos.size())
+		{
+			PRINT_ERROR("ERROR :: Scan did not visit every page.");
+		}
+
+		try
+		{
+			mappedMgr->readPage(&file15, pageNos.back() + 1, page);
+			PRINT_ERROR("ERROR :: Should not be able to read invalid page. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const InvalidPageException &e)
+		{
+		}
+
+		mappedMgr->flushFile(&file15);
+		delete mappedMgr;
+	}
+
+	{
+		File file15 = File::open(filename);
+		PageId pageNo = 1;
+		for (FileIterator iter = file15.begin(); iter != file15.end(); ++iter, ++pageNo)
+		{
+			sprintf((char*)tmpbuf, "test.15 Page %u %7.1f", pageNo, (float)pageNo);
+			if (*(*iter).begin() != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 21 passed" << "\n";
+}
+
+void test22()
+{
+	//The clock sweeps past whole blocks of pinned frames to the one frame it can use
+	const std::string& filename = "test.16";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file16 = File::create(filename);
+		BufMgr* clockMgr = new BufMgr(num);
+		std::vector<PageId> pageNos;
+		std::vector<Page*> pages;
+		clockMgr->allocPages(&file16, num, pageNos, pages);
+		clockMgr->unPinPage(&file16, pageNos[num - 3], false);
+
+		PageId extra;
+		clockMgr->allocPage(&file16, extra, page);
+		if (page != pages[num - 3])
+		{
+			PRINT_ERROR("ERROR :: The only unpinned frame should have been chosen.");
+		}
+
+		try
+		{
+			PageId another;
+			clockMgr->allocPage(&file16, another, page);
+			PRINT_ERROR("ERROR :: No more pages can be allocated. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const BufferExceededException &e)
+		{
+		}
+
+		for (i = 0; i < num; i++)
+		{
+			if (i != num - 3)
+			{
+				clockMgr->unPinPage(&file16, pageNos[i], false);
+			}
+		}
+		clockMgr->unPinPage(&file16, extra, false);
+		clockMgr->flushFile(&file16);
+		delete clockMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 22 passed" << "\n";
+}
+
+void test23()
+{
+	//Page handles unpin their pages when they go away, also while an exception unwinds
+	const std::string& filename = "test.17";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file17 = File::create(filename);
+		BufMgr* handleMgr = new BufMgr(num);
+		std::vector<PageHandle> handles;
+		for (i = 0; i < 5; i++)
+		{
+			PageHandle handle = handleMgr->allocPage(&file17);
+			sprintf((char*)tmpbuf, "test.17 Page %u %7.1f", handle.page_number(), (float)handle.page_number());
+			handle->insertRecord(tmpbuf);
+			handle.markDirty();
+			handles.push_back(std::move(handle));
+		}
+		const PageId first = handles.front().page_number();
+		handles.clear();
+
+		try
+		{
+			PageHandle handle = handleMgr->readPage(&file17, first);
+			throw std::runtime_error("abandon the page");
+		}
+		catch(const std::runtime_error &e)
+		{
+		}
+
+		{
+			PageHandle handle = handleMgr->readPage(&file17, first);
+			PageHandle moved;
+			moved = std::move(handle);
+			if (handle || !moved)
+			{
+				PRINT_ERROR("ERROR :: Moving a handle should move its pin.");
+			}
+			moved.release();
+			moved.release();
+		}
+
+		//Every pin is gone, so the pages can be flushed and read back
+		handleMgr->flushFile(&file17);
+		for (FileIterator iter = file17.begin(); iter != file17.end(); ++iter)
+		{
+			sprintf((char*)tmpbuf, "test.17 Page %u %7.1f", (*iter).page_number(), (float)(*iter).page_number());
+			if (*(*iter).begin() != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Dirty pages should have been written back.");
+			}
+		}
+		delete handleMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 23 passed" << "\n";
+}
+
+void test24()
+{
+	//Latches order concurrent readers and writers of one page; optimistic reads notice writers
+	const std::string& filename = "test.18";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file18 = File::create(filename);
+		BufMgr* latchMgr = new BufMgr(num, 4);
+		PageId counterPage;
+		RecordId counter;
+		{
+			PageHandle handle = latchMgr->allocPage(&file18);
+			counterPage = handle.page_number();
+			counter = handle->insertRecord("0000000");
+			handle.markDirty();
+		}
+
+		//Two shared holders do not wait for each other
+		{
+			PageHandle reader1 = latchMgr->readPage(&file18, counterPage, LatchMode::SHARED);
+			PageHandle reader2 = latchMgr->readPage(&file18, counterPage, LatchMode::SHARED);
+			if (reader1->getRecord(counter) != reader2->getRecord(counter))
+			{
+				PRINT_ERROR("ERROR :: Shared readers should see the same record.");
+			}
+		}
+
+		const int threads = 4;
+		const int increments = 200;
+		std::atomic<bool> torn(false);
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; t++)
+		{
+			workers.push_back(std::thread([&]() {
+				for (int n = 0; n < increments; n++)
+				{
+					{
+						PageHandle handle = latchMgr->readPage(&file18, counterPage, LatchMode::EXCLUSIVE);
+						char next[16];
+						sprintf(next, "%07d", atoi(handle->getRecord(counter).c_str()) + 1);
+						handle->updateRecord(counter, next);
+						handle.markDirty();
+					}
+					PageHandle handle = latchMgr->readPage(&file18, counterPage, LatchMode::SHARED);
+					if (handle->getRecord(counter).size() != 7)
+					{
+						torn = true;
+					}
+				}
+			}));
+		}
+		for (int t = 0; t < threads; t++)
+		{
+			workers[t].join();
+		}
+		if (torn)
+		{
+			PRINT_ERROR("ERROR :: Shared readers should never see a partial update.");
+		}
+
+		PageHandle handle = latchMgr->readPage(&file18, counterPage);
+		std::uint64_t version = handle.readVersion();
+		if (atoi(handle->getRecord(counter).c_str()) != threads * increments || !handle.validate(version))
+		{
+			PRINT_ERROR("ERROR :: Every latched increment should have been applied.");
+		}
+		{
+			PageHandle writer = latchMgr->readPage(&file18, counterPage, LatchMode::EXCLUSIVE);
+			if (handle.readVersion() != FrameLatch::LOCKED)
+			{
+				PRINT_ERROR("ERROR :: Optimistic reads should not start while a writer holds the latch.");
+			}
+		}
+		if (handle.validate(version))
+		{
+			PRINT_ERROR("ERROR :: An optimistic read overlapping a writer should fail to validate.");
+		}
+		handle.release();
+
+		latchMgr->flushFile(&file18);
+		delete latchMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 24 passed" << "\n";
+}
+
+void test25()
+{
+	//The buffer manager counts hits, misses, evictions and write-backs
+	const std::string& filename = "test.19";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file19 = File::create(filename);
+		BufMgr* statsMgr = new BufMgr(num);
+		std::vector<PageId> pageNos;
+		std::vector<Page*> pages;
+		statsMgr->allocPages(&file19, num, pageNos, pages);
+		statsMgr->unPinPages(&file19, pageNos, true);
+		statsMgr->clearBufStats();
+
+		//Hits on every page, then misses that evict one dirty page each
+		for (i = 0; i < num; i++)
+		{
+			statsMgr->readPage(&file19, pageNos[i], page);
+			statsMgr->unPinPage(&file19, pageNos[i], false);
+		}
+		for (i = 0; i < 10; i++)
+		{
+			PageId extra;
+			statsMgr->allocPage(&file19, extra, page);
+			statsMgr->unPinPage(&file19, extra, false);
+		}
+		statsMgr->flushFile(&file19);
+		statsMgr->readPage(&file19, pageNos[0], page);
+		statsMgr->unPinPage(&file19, pageNos[0], false);
+
+		const BufStats stats = statsMgr->getBufStats();
+		std::uint64_t latencies = 0;
+		for (unsigned b = 0; b < BufMetrics::LATENCY_BUCKETS; b++)
+		{
+			latencies += stats.missLatency[b];
+		}
+		if (stats.accesses != num + 11 || stats.hits != num || stats.misses != 1 || latencies != 1)
+		{
+			PRINT_ERROR("ERROR :: Accesses, hits and misses were miscounted.");
+		}
+		if (stats.evictions != 10 || stats.dirtyEvictions != 10 || stats.diskwrites != num)
+		{
+			PRINT_ERROR("ERROR :: Evictions and write-backs were miscounted.");
+		}
+		if (stats.victimSearches != 11 || stats.revolutionsPerAllocation() <= 0 || stats.hitRatio() <= 0.8)
+		{
+			PRINT_ERROR("ERROR :: Victim searches were miscounted.");
+		}
+
+		statsMgr->clearBufStats();
+		if (statsMgr->getBufStats().accesses != 0 || statsMgr->getBufStats().clockRevolutions != 0)
+		{
+			PRINT_ERROR("ERROR :: Cleared statistics should be zero.");
+		}
+		statsMgr->flushFile(&file19);
+		delete statsMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 25 passed" << "\n";
+}
+
+void test26()
+{
+	//Traced calls can be saved, loaded and replayed against simulated pools
+	const std::string& filename = "test.20";
+	const std::string& tracename = "test.20.trace";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file20 = File::create(filename);
+		BufMgr* tracedMgr = new BufMgr(num);
+		tracedMgr->trace().start(1000);
+		std::vector<PageId> pageNos;
+		for (i = 0; i < 20; i++)
+		{
+			PageId pageNo;
+			tracedMgr->allocPage(&file20, pageNo, page);
+			tracedMgr->unPinPage(&file20, pageNo, true);
+			pageNos.push_back(pageNo);
+		}
+		//Loops over the pages, so a pool smaller than the loop never hits
+		for (int round = 0; round < 5; round++)
+		{
+			for (i = 0; i < 20; i++)
+			{
+				PageHandle handle = tracedMgr->readPage(&file20, pageNos[i]);
+			}
+		}
+		tracedMgr->disposePage(&file20, pageNos[0]);
+		tracedMgr->trace().stop();
+		tracedMgr->readPage(&file20, pageNos[1], page);
+		tracedMgr->unPinPage(&file20, pageNos[1], false);
+		tracedMgr->trace().save(tracename);
+		tracedMgr->flushFile(&file20);
+		delete tracedMgr;
+	}
+
+	std::vector<TraceRecord> records;
+	std::vector<std::string> files;
+	BufTrace::load(tracename, records, files);
+	if (records.size() != 241 || files.size() != 1 || files[0] != filename)
+	{
+		PRINT_ERROR("ERROR :: Trace should hold every call made while tracing.");
+	}
+	if (records[0].op() != TraceRecord::ALLOC || records[1].op() != TraceRecord::UNPIN_DIRTY ||
+		records[40].op() != TraceRecord::READ || records[41].op() != TraceRecord::UNPIN ||
+		records.back().op() != TraceRecord::DISPOSE || records.back().pageNo != records[0].pageNo ||
+		records[40].nanos() < records[0].nanos())
+	{
+		PRINT_ERROR("ERROR :: Trace records do not match the calls made.");
+	}
+
+	BufTrace::ReplayResult large = BufTrace::replay(records, ReplacementPolicyType::CLOCK, 32);
+	BufTrace::ReplayResult small = BufTrace::replay(records, ReplacementPolicyType::CLOCK, 10);
+	if (large.reads != 100 || large.hits != 100 || small.hits != 0 || large.exceeded != 0)
+	{
+		PRINT_ERROR("ERROR :: Replayed hit ratios are wrong.");
+	}
+	File::remove(filename);
+	File::remove(tracename);
+
+	std::cout << "Test 26 passed" << "\n";
+}
+
+void test27()
+{
+	//The buffer pool grows and shrinks while pages stay resident
+	const std::string& filename = "test.21";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file21 = File::create(filename);
+		BufMgr* resizeMgr = new BufMgr(10, 1, ReplacementPolicyType::CLOCK, num);
+		std::vector<PageId> pageNos;
+		for (i = 0; i < 10; i++)
+		{
+			PageId pageNo;
+			resizeMgr->allocPage(&file21, pageNo, page);
+			pageNos.push_back(pageNo);
+		}
+		try
+		{
+			PageId pageNo;
+			resizeMgr->allocPage(&file21, pageNo, page);
+			PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const BufferExceededException &e)
+		{
+		}
+
+		//Growing hands out new frames while the old pages stay pinned
+		if (resizeMgr->resize(50) != 50 || resizeMgr->numFrames() != 50 || resizeMgr->maxFrames() != num)
+		{
+			PRINT_ERROR("ERROR :: Buffer pool should have grown to 50 frames.");
+		}
+		for (i = 10; i < 50; i++)
+		{
+			PageId pageNo;
+			resizeMgr->allocPage(&file21, pageNo, page);
+			pageNos.push_back(pageNo);
+		}
+
+		//Pinned frames cannot be given up
+		if (resizeMgr->resize(20) != 50)
+		{
+			PRINT_ERROR("ERROR :: Buffer pool should not shrink past pinned frames.");
+		}
+		for (i = 0; i < 50; i++)
+		{
+			resizeMgr->readPage(&file21, pageNos[i], page);
+			sprintf((char*)tmpbuf, "test.21 Page %d %7.1f", pageNos[i], (float)pageNos[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			resizeMgr->unPinPage(&file21, pageNos[i], true);
+			resizeMgr->unPinPage(&file21, pageNos[i], true);
+		}
+		if (resizeMgr->resize(20) != 20)
+		{
+			PRINT_ERROR("ERROR :: Buffer pool should have shrunk to 20 frames.");
+		}
+		for (i = 0; i < 50; i++)
+		{
+			resizeMgr->readPage(&file21, pageNos[i], page);
+			sprintf((char*)tmpbuf, "test.21 Page %d %7.1f", pageNos[i], (float)pageNos[i]);
+			if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: Pages given up by shrinking should have been written back.");
+			}
+			resizeMgr->unPinPage(&file21, pageNos[i], false);
+		}
+
+		if (resizeMgr->resize(2 * num) != num || resizeMgr->resize(0) != 1)
+		{
+			PRINT_ERROR("ERROR :: Resizing should be clamped to the frames reserved.");
+		}
+		resizeMgr->flushFile(&file21);
+		delete resizeMgr;
+	}
+
+	//Every policy takes the resident pages over when the pool grows and hands out only the new frames
+	const ReplacementPolicyType policies[] = {ReplacementPolicyType::CLOCK, ReplacementPolicyType::LRU_K,
+		ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC, ReplacementPolicyType::CLOCK_PRO};
+	for (std::size_t p = 0; p < sizeof(policies)/sizeof(policies[0]); p++)
+	{
+		File file21 = File::open(filename);
+		BufMgr* resizeMgr = new BufMgr(10, 1, policies[p], 20);
+		for (i = 1; i <= 10; i++)
+		{
+			resizeMgr->readPage(&file21, i, page);
+			resizeMgr->unPinPage(&file21, i, false);
+		}
+		resizeMgr->resize(20);
+		for (i = 11; i <= 20; i++)
+		{
+			resizeMgr->readPage(&file21, i, page);
+			resizeMgr->unPinPage(&file21, i, false);
+		}
+		resizeMgr->clearBufStats();
+		for (i = 1; i <= 20; i++)
+		{
+			resizeMgr->readPage(&file21, i, page);
+			resizeMgr->unPinPage(&file21, i, false);
+		}
+		if (resizeMgr->getBufStats().hits != 20)
+		{
+			PRINT_ERROR("ERROR :: Pages resident before growing should stay while new frames are free.");
+		}
+		delete resizeMgr;
+	}
+
+	//Growing keeps the reference bits: the clock still passes over the pages used since its last sweep
+	{
+		File file21 = File::open(filename);
+		BufMgr* resizeMgr = new BufMgr(10, 1, ReplacementPolicyType::CLOCK, 20);
+		for (i = 1; i <= 11; i++)
+		{
+			resizeMgr->readPage(&file21, i, page);
+			resizeMgr->unPinPage(&file21, i, false);
+		}
+		for (i = 6; i <= 10; i++)
+		{
+			resizeMgr->readPage(&file21, i, page);
+			resizeMgr->unPinPage(&file21, i, false);
+		}
+		resizeMgr->resize(11);
+		for (i = 12; i <= 13; i++)
+		{
+			resizeMgr->readPage(&file21, i, page);
+			resizeMgr->unPinPage(&file21, i, false);
+		}
+		resizeMgr->clearBufStats();
+		for (i = 6; i <= 11; i++)
+		{
+			resizeMgr->readPage(&file21, i, page);
+			resizeMgr->unPinPage(&file21, i, false);
+		}
+		if (resizeMgr->getBufStats().hits != 6)
+		{
+			PRINT_ERROR("ERROR :: Resizing should not change which pages the clock has seen referenced.");
+		}
+		delete resizeMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 27 passed" << "\n";
+}
+
+void test28()
+{
+	//The hash table grows a little at a time past its load factor while lookups keep finding every entry
+	BufHashTbl table(4, 0.75);
+	const std::uint32_t initialSlots = table.slots();
+	for (i = 1; i <= num; i++)
+	{
+		table.insert(file1ptr, i, i);
+	}
+
+	std::atomic<bool> done(false);
+	std::thread writer([&]() {
+		for (PageId p = 1; p <= 50 * num; p++)
+			table.insert(file2ptr, p, p);
+		for (PageId p = 1; p <= 50 * num; p += 2)
+			table.remove(file2ptr, p);
+		done = true;
+	});
+
+	int missing = 0;
+	while (!done)
+	{
+		for (PageId p = 1; p <= num; p++)
+		{
+			FrameId frameNo;
+			if (!table.find(file1ptr, p, frameNo) || frameNo != p)
+			{
+				missing++;
+			}
+		}
+	}
+	writer.join();
+
+	if (missing != 0)
+	{
+		PRINT_ERROR("ERROR :: Hash table lost an entry while growing");
+	}
+	if (table.size() != num + 25 * num || table.slots() < initialSlots * 64 || table.size() > 0.75 * table.slots())
+	{
+		PRINT_ERROR("ERROR :: Hash table should have grown to keep its load factor");
+	}
+	for (PageId p = 1; p <= 50 * num; p++)
+	{
+		FrameId frameNo;
+		if (table.find(file2ptr, p, frameNo) != (p % 2 == 0) || (p % 2 == 0 && frameNo != p))
+		{
+			PRINT_ERROR("ERROR :: Hash table returned a wrong entry after growing");
+		}
+	}
+
+	//A table sized for its most entries never grows, so it never allocates after construction
+	BufHashTbl sized(num);
+	const std::uint32_t sizedSlots = sized.slots();
+	for (int round = 0; round < 10; round++)
+	{
+		for (i = 1; i <= num; i++)
+			sized.insert(file1ptr, i, i);
+		for (i = 1; i <= num; i++)
+			sized.remove(file1ptr, i);
+	}
+	if (sized.slots() != sizedSlots || sized.growing() || sized.size() != 0)
+	{
+		PRINT_ERROR("ERROR :: Hash table sized for its entries should not grow");
+	}
+
+	std::cout << "Test 28 passed" << "\n";
+}
+
+void test29()
+{
+	//Copies of a File share its id, so the buffer pool treats them as the same file
+	const std::string& filename = "test.22";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file22 = File::create(filename);
+		File copy = file22;
+		if (copy.id() != file22.id() || copy.id() == file1ptr->id() || file22.id() == 0)
+		{
+			PRINT_ERROR("ERROR :: Copies of a file should share one id, distinct from other files.");
+		}
+
+		BufMgr* idMgr = new BufMgr(num, 4);
+		PageId pageNo;
+		idMgr->allocPage(&file22, pageNo, page);
+		rid2 = page->insertRecord("test.22 shared page");
+		idMgr->unPinPage(&file22, pageNo, true);
+
+		//Reading through the copy hits the frame loaded through the original
+		idMgr->clearBufStats();
+		idMgr->readPage(&copy, pageNo, page2);
+		if (page2 != page || idMgr->getBufStats().hits != 1 || page2->getRecord(rid2) != "test.22 shared page")
+		{
+			PRINT_ERROR("ERROR :: A copy of a file should find the pages buffered through the original.");
+		}
+		idMgr->unPinPage(&file22, pageNo, false);
+
+		//Flushing through the copy writes back and drops the page
+		idMgr->flushFile(&copy);
+		idMgr->readPage(&file22, pageNo, page);
+		if (idMgr->getBufStats().misses != 1 || page->getRecord(rid2) != "test.22 shared page")
+		{
+			PRINT_ERROR("ERROR :: Flushing a copy of a file should flush the pages buffered through the original.");
+		}
+		idMgr->unPinPage(&copy, pageNo, false);
+
+		idMgr->flushFile(&file22);
+		delete idMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 29 passed" << "\n";
+}
+
+void test30()
+{
+	//Records can be inserted from raw bytes and read back as views into the buffered page, without copies
+	const std::string& filename = "test.23";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file23 = File::create(filename);
+		BufMgr* viewMgr = new BufMgr(num);
+		PageId pageNo;
+		viewMgr->allocPage(&file23, pageNo, page);
+		std::vector<RecordId> records;
+		for (i = 0; i < 10; i++)
+		{
+			const int length = sprintf(tmpbuf, "test.23 record %d", i);
+			records.push_back(page->insertRecord(tmpbuf, length));
+		}
+		viewMgr->unPinPage(&file23, pageNo, true);
+		viewMgr->flushFile(&file23);
+
+		viewMgr->readPage(&file23, pageNo, page);
+		i = 0;
+		for (PageIterator iter = page->begin(); iter != page->end(); ++iter, i++)
+		{
+			sprintf(tmpbuf, "test.23 record %d", i);
+			const RecordView record = iter.view();
+			if (record != std::string(tmpbuf) || record.str() != *iter ||
+				record.data() != page->getRecordView(records[i]).data())
+			{
+				PRINT_ERROR("ERROR :: Record views should show the records stored on the page.");
+			}
+		}
+		if (i != 10)
+		{
+			PRINT_ERROR("ERROR :: Iterating over record views should visit every record.");
+		}
+
+		//Updating from raw bytes keeps the record id
+		const char replacement[] = "test.23 replaced";
+		page->updateRecord(records[3], replacement, sizeof(replacement) - 1);
+		if (page->getRecordView(records[3]) != "test.23 replaced" || page->getRecordView(records[4]) != "test.23 record 4" ||
+			page->getRecordView(records[3]).size() != sizeof(replacement) - 1)
+		{
+			PRINT_ERROR("ERROR :: Updating a record from raw bytes should replace it in place.");
+		}
+		viewMgr->unPinPage(&file23, pageNo, true);
+
+		viewMgr->flushFile(&file23);
+		delete viewMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 30 passed" << "\n";
+}
+
+void test31()
+{
+	//Deleting a record leaves the others where they are; the space is reclaimed when an insert needs it
+	Page scratch;
+	std::vector<RecordId> records;
+	for (i = 0; i < 100; i++)
+	{
+		sprintf(tmpbuf, "test.31 record %03d", i);
+		records.push_back(scratch.insertRecord(tmpbuf));
+	}
+	const std::uint16_t freeSpace = scratch.getFreeSpace();
+	const char* kept = scratch.getRecordView(records[99]).data();
+	const std::size_t length = scratch.getRecordView(records[0]).size();
+	for (i = 0; i < 100; i += 2)
+	{
+		scratch.deleteRecord(records[i]);
+	}
+	if (scratch.getRecordView(records[99]).data() != kept || scratch.getFreeSpace() != freeSpace + 50 * length ||
+		scratch.getContiguousFreeSpace() >= scratch.getFreeSpace())
+	{
+		PRINT_ERROR("ERROR :: Deleting records should leave the others in place and count the space freed.");
+	}
+
+	//Reuses the freed slots, lowest first, then compacts to fit a record larger than the contiguous space
+	sprintf(tmpbuf, "test.31 reused");
+	if (scratch.insertRecord(tmpbuf).slot_number != records[0].slot_number)
+	{
+		PRINT_ERROR("ERROR :: Insert should reuse the lowest free slot.");
+	}
+	const std::string large(scratch.getContiguousFreeSpace() + 10, 'x');
+	const RecordId largeId = scratch.insertRecord(large);
+	if (scratch.getRecord(largeId) != large || largeId.slot_number != records[2].slot_number)
+	{
+		PRINT_ERROR("ERROR :: Insert should compact the page to reclaim the space of deleted records.");
+	}
+	for (i = 1; i < 100; i += 2)
+	{
+		sprintf(tmpbuf, "test.31 record %03d", i);
+		if (scratch.getRecordView(records[i]) != std::string(tmpbuf))
+		{
+			PRINT_ERROR("ERROR :: Compacting the page should keep every record and its id.");
+		}
+	}
+
+	std::cout << "Test 31 passed" << "\n";
+}
+
+void test32()
+{
+	//Whole pages of records are handed out at once, through the buffer pool
+	const std::string& filename = "test.24";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file24 = File::create(filename);
+		BufMgr* scanMgr = new BufMgr(num);
+		std::vector<PageId> pageNos;
+		for (i = 0; i < 5; i++)
+		{
+			PageId pageNo;
+			scanMgr->allocPage(&file24, pageNo, page);
+			//Page 2 stays empty; the others get 37 records with every third one deleted
+			std::vector<RecordId> inserted;
+			for (int r = 0; i != 2 && r < 37; r++)
+			{
+				sprintf(tmpbuf, "test.24 page %d record %d", pageNo, r);
+				inserted.push_back(page->insertRecord(tmpbuf));
+			}
+			for (std::size_t r = 0; r < inserted.size(); r += 3)
+			{
+				page->deleteRecord(inserted[r]);
+			}
+			scanMgr->unPinPage(&file24, pageNo, true);
+			pageNos.push_back(pageNo);
+		}
+		scanMgr->flushFile(&file24);
+
+		BufRecordScanner scanner(scanMgr, &file24);
+		std::vector<RecordView> records;
+		std::size_t batches = 0;
+		while (scanner.next(records))
+		{
+			if (records.size() != 24 || scanner.page_number() == pageNos[2])
+			{
+				PRINT_ERROR("ERROR :: A batch should hold every live record of one page.");
+			}
+			for (std::size_t r = 0; r < records.size(); r++)
+			{
+				const RecordId record = {scanner.page_number(), scanner.slots()[r]};
+				sprintf(tmpbuf, "test.24 page %d record %d", scanner.page_number(), scanner.slots()[r] - 1);
+				if (records[r] != std::string(tmpbuf) || scanner.slots()[r] % 3 == 1 ||
+					records[r].data() != scanMgr->readPage(&file24, scanner.page_number())->getRecordView(record).data())
+				{
+					PRINT_ERROR("ERROR :: Batched records should be views of the buffered page.");
+				}
+			}
+			batches++;
+		}
+		if (batches != 4 || scanner.page_number() != Page::INVALID_NUMBER || !records.empty())
+		{
+			PRINT_ERROR("ERROR :: Scanning should visit every page holding records.");
+		}
+
+		scanMgr->flushFile(&file24);
+		delete scanMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 32 passed" << "\n";
+}
+
+void test33()
+{
+	//Commits made at the same time share log writes, and no dirty page reaches the disk before its log records
+	const std::string& filename = "test.25";
+	const std::string& logname = "test.25.log";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file25 = File::create(filename);
+		LogManager* log = new LogManager(logname, 200);
+		BufMgr* walMgr = new BufMgr(num, 4);
+		walMgr->setLog(log);
+		std::vector<PageId> pageNos;
+		std::vector<Page*> pages;
+		walMgr->allocPages(&file25, 4, pageNos, pages);
+		walMgr->unPinPages(&file25, pageNos, true);
+
+		//Each thread updates a page of its own and commits, over and over
+		std::vector<std::thread> workers;
+		for (int t = 0; t < 4; t++)
+		{
+			workers.push_back(std::thread([&, t]() {
+				for (int n = 0; n < 25; n++)
+				{
+					const TxnId txn = log->begin();
+					PageHandle handle = walMgr->readPage(&file25, pageNos[t]);
+					handle->insertRecord("test.25 update");
+					const Lsn lsn = log->logPage(txn, file25, *handle);
+					handle.markDirty();
+					handle.release();
+					if (log->commit(txn) < lsn || log->durableLsn() < lsn)
+					{
+						PRINT_ERROR("ERROR :: A commit should return once its records are durable.");
+					}
+				}
+			}));
+		}
+		for (int t = 0; t < 4; t++)
+		{
+			workers[t].join();
+		}
+		if (log->syncs() >= 100)
+		{
+			PRINT_ERROR("ERROR :: Concurrent commits should share log writes.");
+		}
+
+		//A logged but uncommitted change: writing the page back makes its record durable first
+		const TxnId txn = log->begin();
+		walMgr->readPage(&file25, pageNos[0], page);
+		page->insertRecord("test.25 uncommitted");
+		const Lsn lsn = log->logPage(txn, file25, *page);
+		walMgr->unPinPage(&file25, pageNos[0], true);
+		if (log->durableLsn() >= lsn || page->lsn() != lsn)
+		{
+			PRINT_ERROR("ERROR :: Logging a page should stamp it without writing the log.");
+		}
+		walMgr->flushFile(&file25);
+		if (log->durableLsn() < lsn || file25.readPage(pageNos[0]).lsn() != lsn)
+		{
+			PRINT_ERROR("ERROR :: The log should be durable before a logged page is written.");
+		}
+
+		delete walMgr;
+		delete log;
+	}
+	File::remove(filename);
+	File::remove(logname);
+
+	//Pages changed and logged again while the cleaner writes them never reach the disk ahead of their log records
+	{
+		File file25 = File::create(filename, FileBackend::POSIX);
+		LogManager* log = new LogManager(logname);
+		BufMgr* walMgr = new BufMgr(num);
+		walMgr->setLog(log);
+		std::vector<PageId> pageNos;
+		std::vector<Page*> pages;
+		walMgr->allocPages(&file25, 4, pageNos, pages);
+		for (i = 0; i < 4; i++)
+		{
+			pages[i]->insertRecord("test.25 cleaned       0");
+		}
+		walMgr->unPinPages(&file25, pageNos, true);
+		walMgr->flushFile(&file25);
+		walMgr->startCleaner(0.0, 0.0, 1);
+
+		//Nothing commits, so only the cleaner makes the log durable
+		std::atomic<bool> done(false);
+		std::thread writer([&]() {
+			const TxnId txn = log->begin();
+			for (int n = 0; n < 2000; n++)
+			{
+				PageHandle handle = walMgr->readPage(&file25, pageNos[n % 4]);
+				handle.latch(LatchMode::EXCLUSIVE);
+				char record[100];
+				sprintf(record, "test.25 cleaned %7d", n);
+				const RecordId recordId = {pageNos[n % 4], 1};
+				handle->updateRecord(recordId, record);
+				log->logPage(txn, file25, *handle);
+				handle.markDirty();
+			}
+			done = true;
+		});
+		int ahead = 0;
+		while (!done)
+		{
+			for (i = 0; i < 4; i++)
+			{
+				try
+				{
+					const Lsn lsn = file25.readPage(pageNos[i]).lsn();
+					if (lsn > log->durableLsn())
+					{
+						ahead++;
+					}
+				}
+				catch(const PageChecksumException &e)
+				{
+					//Read while the cleaner was writing it
+				}
+			}
+		}
+		writer.join();
+		walMgr->stopCleaner();
+		if (ahead != 0)
+		{
+			PRINT_ERROR("ERROR :: The cleaner should make the log durable up to the page it writes.");
+		}
+		walMgr->flushFile(&file25);
+		delete walMgr;
+		delete log;
+	}
+	File::remove(filename);
+	File::remove(logname);
+
+	std::cout << "Test 33 passed" << "\n";
+}
+
+void test34()
+{
+	//Recovery after a crash starts from the last checkpoint and redoes only committed changes
+	const std::string& filename = "test.26";
+	const std::string& logname = "test.26.log";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file26 = File::create(filename);
+		std::vector<PageId> pageNos;
+		Lsn redoLsn;
+		Lsn end;
+		TxnId uncommitted;
+		std::vector<Page> stale;
+		{
+			LogManager log(logname);
+			BufMgr* walMgr = new BufMgr(num, 2);
+			walMgr->setLog(&log);
+			std::vector<Page*> pages;
+			walMgr->allocPages(&file26, 4, pageNos, pages);
+			TxnId txn = log.begin();
+			for (int i = 0; i < 4; i++)
+			{
+				pages[i]->insertRecord("test.26 before");
+				log.logPage(txn, file26, *pages[i]);
+			}
+			log.commit(txn);
+
+			//The checkpoint writes the pages even though one is still pinned
+			walMgr->unPinPages(&file26, std::vector<PageId>(pageNos.begin(), pageNos.begin() + 3), true);
+			redoLsn = log.appendedLsn();
+			const Lsn checkpointLsn = walMgr->checkpoint();
+			walMgr->unPinPage(&file26, pageNos[3], true);
+			if (checkpointLsn <= redoLsn || log.durableLsn() < checkpointLsn)
+			{
+				PRINT_ERROR("ERROR :: A checkpoint should be durable in the log once it returns.");
+			}
+			for (int i = 0; i < 4; i++)
+			{
+				stale.push_back(file26.readPage(pageNos[i]));
+				if (stale.back().lsn() == 0 || stale.back().lsn() > redoLsn)
+				{
+					PRINT_ERROR("ERROR :: A checkpoint should write back every page changed before it.");
+				}
+			}
+
+			//A committed transaction after the checkpoint, and one that never commits
+			txn = log.begin();
+			for (int i = 0; i < 2; i++)
+			{
+				walMgr->readPage(&file26, pageNos[i], page);
+				page->insertRecord("test.26 after");
+				log.logPage(txn, file26, *page);
+				walMgr->unPinPage(&file26, pageNos[i], true);
+			}
+			log.commit(txn);
+			uncommitted = log.begin();
+			walMgr->readPage(&file26, pageNos[2], page);
+			page->insertRecord("test.26 uncommitted");
+			log.logPage(uncommitted, file26, *page);
+			walMgr->unPinPage(&file26, pageNos[2], true);
+			delete walMgr;
+			end = log.appendedLsn();
+		}
+
+		//Crashing before the buffer pool wrote anything after the checkpoint leaves the pages as it wrote them
+		for (int i = 0; i < 4; i++)
+		{
+			file26.writePage(stale[i]);
+		}
+		RecoveryStats stats = LogManager::recover(logname);
+		if (stats.redoStart != redoLsn || stats.end != end || stats.records != 5 || stats.committed != 1 ||
+				stats.pagesRedone != 2 || stats.pagesSkipped != 0)
+		{
+			PRINT_ERROR("ERROR :: Recovery should only read the log from the last checkpoint on.");
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			const Page recovered = file26.readPage(pageNos[i]);
+			std::vector<RecordView> records;
+			recovered.getRecords(records);
+			const std::size_t expected = (i < 2) ? 2 : 1;
+			if (records.size() != expected || records[0] != "test.26 before" ||
+					(i < 2 && records[1] != "test.26 after"))
+			{
+				PRINT_ERROR("ERROR :: Recovery should redo committed changes and nothing else.");
+			}
+		}
+		stats = LogManager::recover(logname);
+		if (stats.pagesRedone != 0)
+		{
+			PRINT_ERROR("ERROR :: Recovering twice should change nothing.");
+		}
+
+		//A record torn by the crash is cut off when the log is opened again
+		{
+			std::ofstream torn(logname.c_str(), std::ios::binary | std::ios::app);
+			torn << "torn record";
+		}
+		{
+			LogManager log(logname, 0, false);
+			if (log.appendedLsn() != end || log.begin() <= uncommitted)
+			{
+				PRINT_ERROR("ERROR :: A reopened log should append after its last intact record.");
+			}
+			const TxnId txn = log.begin();
+			if (log.commit(txn) != end + sizeof(LogRecordHeader))
+			{
+				PRINT_ERROR("ERROR :: A reopened log should append after its last intact record.");
+			}
+		}
+		stats = LogManager::recover(logname);
+		if (stats.end != end + sizeof(LogRecordHeader) || stats.records != 6)
+		{
+			PRINT_ERROR("ERROR :: Records appended to a reopened log should be read back.");
+		}
+	}
+	File::remove(filename);
+	File::remove(logname);
+	File::remove(logname + ".master");
+
+	//A committed page allocated after the file header was last written is restored on the end of the file
+	{
+		FileHeader synced;
+		PageId appended;
+		{
+			File file26 = File::create(filename);
+			LogManager log(logname);
+			BufMgr* walMgr = new BufMgr(num);
+			walMgr->setLog(&log);
+			PageId first;
+			walMgr->allocPage(&file26, first, page);
+			walMgr->unPinPage(&file26, first, true);
+			walMgr->checkpoint();
+			std::ifstream header(filename.c_str(), std::ios::binary);
+			header.read(reinterpret_cast<char*>(&synced), sizeof(synced));
+
+			const TxnId txn = log.begin();
+			walMgr->allocPage(&file26, appended, page);
+			page->insertRecord("test.26 appended");
+			log.logPage(txn, file26, *page);
+			walMgr->unPinPage(&file26, appended, true);
+			log.commit(txn);
+			delete walMgr;
+		}
+
+		//Crashing leaves the header as the checkpoint synced it and the new page unwritten
+		{
+			std::fstream crashed(filename.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+			crashed.write(reinterpret_cast<const char*>(&synced), sizeof(synced));
+			const std::vector<char> zeros(Page::SIZE, 0);
+			crashed.seekp(appended * Page::SIZE);
+			crashed.write(&zeros[0], zeros.size());
+		}
+		RecoveryStats stats = LogManager::recover(logname);
+		if (stats.pagesRedone != 1 || stats.pagesSkipped != 0)
+		{
+			PRINT_ERROR("ERROR :: Recovery should redo a committed page past the end of the file on disk.");
+		}
+		File file26 = File::open(filename);
+		std::vector<RecordView> records;
+		file26.readPage(appended).getRecords(records);
+		PageId used = 0;
+		for (FileIterator iter = file26.begin(); iter != file26.end(); ++iter)
+		{
+			used++;
+		}
+		if (records.size() != 1 || records[0] != "test.26 appended" || used != 2)
+		{
+			PRINT_ERROR("ERROR :: A page restored on the end of the file should be readable and used.");
+		}
+	}
+	File::remove(filename);
+	File::remove(logname);
+	File::remove(logname + ".master");
+
+	//A checkpoint taken while reads are in flight writes nothing of their frames
+	const std::string asyncname = filename + ".async";
+	try
+	{
+		File::remove(asyncname);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		File asyncFile = File::create(asyncname);
+		std::vector<PageId> asyncPages;
+		for (int j = 0; j < 40; j++)
+		{
+			Page new_page = asyncFile.allocatePage();
+			sprintf(tmpbuf, "test.26 async page %d", j);
+			new_page.insertRecord(tmpbuf);
+			asyncFile.writePage(new_page);
+			asyncPages.push_back(new_page.page_number());
+		}
+		BufMgr* asyncMgr = new BufMgr(12);
+		for (int round = 0; round < 20; round++)
+		{
+			Page* page;
+			const PageId dirtied = asyncPages[(round * 7) % 40];
+			asyncMgr->readPage(&asyncFile, dirtied, page);
+			asyncMgr->unPinPage(&asyncFile, dirtied, true);
+			std::vector<std::future<Page*> > reads;
+			for (int k = 0; k < 8; k++)
+			{
+				reads.push_back(asyncMgr->readPageAsync(&asyncFile, asyncPages[(round * 8 + k) % 40]));
+			}
+			asyncMgr->checkpoint();
+			for (int k = 0; k < 8; k++)
+			{
+				reads[k].get();
+				asyncMgr->unPinPage(&asyncFile, asyncPages[(round * 8 + k) % 40], false);
+			}
+		}
+		delete asyncMgr;
+		for (int j = 0; j < 40; j++)
+		{
+			const Page stored = asyncFile.readPage(asyncPages[j]);
+			std::vector<RecordView> records;
+			stored.getRecords(records);
+			sprintf(tmpbuf, "test.26 async page %d", j);
+			if (stored.page_number() != asyncPages[j] || records.size() != 1 || records[0] != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: A checkpoint should not write frames still being read into.");
+			}
+		}
+	}
+	File::remove(asyncname);
+
+	std::cout << "Test 34 passed" << "\n";
+}
+
+void test35()
+{
+	//A new buffer manager warms up with the pages an earlier one held, and only as many as it has frames
+	const std::string& filename = "test.27";
+	const std::string& listname = "test.27.warm";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file27 = File::create(filename);
+		std::vector<PageId> pageNos;
+		std::vector<Page*> pages;
+		{
+			BufMgr* coldMgr = new BufMgr(40, 2);
+			coldMgr->allocPages(&file27, 30, pageNos, pages);
+			coldMgr->unPinPages(&file27, pageNos, true);
+			coldMgr->saveResidentPages(listname);
+			delete coldMgr;
+		}
+
+		BufMgr* warmMgr = new BufMgr(40, 2);
+		std::vector<File*> files(1, &file27);
+		warmMgr->startWarmUp(listname, files);
+		if (warmMgr->waitForWarmUp() != 30)
+		{
+			PRINT_ERROR("ERROR :: Warming up should bring back every listed page.");
+		}
+		warmMgr->clearBufStats();
+		warmMgr->readPages(&file27, pageNos, pages);
+		warmMgr->unPinPages(&file27, pageNos, false);
+		if (warmMgr->getBufStats().misses != 0 || warmMgr->getBufStats().diskreads != 0)
+		{
+			PRINT_ERROR("ERROR :: Warmed up pages should be hits.");
+		}
+		delete warmMgr;
+
+		//A smaller pool takes only as many pages as it has frames; files not given are left out
+		BufMgr* smallMgr = new BufMgr(10, 2);
+		smallMgr->startWarmUp(listname, files);
+		if (smallMgr->waitForWarmUp() != 10)
+		{
+			PRINT_ERROR("ERROR :: Warming up should stop once every frame is used.");
+		}
+		smallMgr->startWarmUp(listname, std::vector<File*>());
+		if (smallMgr->waitForWarmUp() != 0)
+		{
+			PRINT_ERROR("ERROR :: Warming up should skip pages of files it is not given.");
+		}
+		delete smallMgr;
+	}
+	File::remove(filename);
+	File::remove(listname);
+
+	std::cout << "Test 35 passed" << "\n";
+}
+
+void test36()
+{
+	//Pages are checksummed when written, and a page corrupted on disk is reported when read
+	const std::string& filename = "test.28";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	if (crc32c("123456789", 9) != 0xE3069283 || crc32c("56789", 5, crc32c("1234", 4)) != 0xE3069283)
+	{
+		PRINT_ERROR("ERROR :: CRC-32C of the check string should be e3069283.");
+	}
+
+	{
+		File file28 = File::create(filename);
+		PageId pageNo;
+		Page written;
+		{
+			written = file28.allocatePage();
+			pageNo = written.page_number();
+			written.insertRecord("test.28 record");
+			file28.writePage(written);
+			Page read = file28.readPage(pageNo);
+			if (read.computeChecksum() == 0 || *read.begin() != "test.28 record")
+			{
+				PRINT_ERROR("ERROR :: A written page should read back whole.");
+			}
+		}
+		file28.sync();
+
+		//Flips a byte of the record on disk
+		{
+			std::fstream raw(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+			raw.seekp(pageNo * Page::SIZE + Page::SIZE - 3);
+			raw.put('X');
+		}
+		try
+		{
+			file28.readPage(pageNo);
+			PRINT_ERROR("ERROR :: A corrupt page should fail its checksum. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const PageChecksumException &e)
+		{
+			if (e.page_number() != pageNo)
+			{
+				PRINT_ERROR("ERROR :: The exception should name the corrupt page.");
+			}
+		}
+		BufMgr* checkedMgr = new BufMgr(num);
+		try
+		{
+			checkedMgr->readPage(&file28, pageNo, page);
+			PRINT_ERROR("ERROR :: A corrupt page should not enter the buffer pool. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const PageChecksumException &e)
+		{
+		}
+
+		//Rewriting the page gives it a valid checksum again
+		written.insertRecord("test.28 rewritten");
+		file28.writePage(written);
+		checkedMgr->readPage(&file28, pageNo, page);
+		if (*page->begin() != "test.28 record")
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		checkedMgr->unPinPage(&file28, pageNo, false);
+		delete checkedMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 36 passed" << "\n";
+}
+
+void test37()
+{
+	//Pages of a compressed file take less space on disk and read back unchanged through the buffer pool
+	const std::string& filename = "test.29";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	const int pages = 40;
+	std::vector<PageId> pageNos;
+	{
+		File file29 = File::create(filename, FileBackend::COMPRESSED);
+		for (int j = 0; j < pages; j++)
+		{
+			Page new_page = file29.allocatePage();
+			for (int k = 0; k < 20; k++)
+			{
+				sprintf(tmpbuf, "test.29 archived record %d of page %d", k, j);
+				new_page.insertRecord(tmpbuf);
+			}
+			pageNos.push_back(new_page.page_number());
+			file29.writePage(new_page);
+		}
+		file29.sync();
+	}
+
+	std::ifstream raw(filename.c_str(), std::ios::binary | std::ios::ate);
+	const std::streamoff stored = raw.tellg();
+	raw.close();
+	if (stored <= 0 || stored * 2 > (std::streamoff) ((pages + 1) * Page::SIZE))
+	{
+		PRINT_ERROR("ERROR :: Compressed pages should take less than half their size on disk.");
+	}
+
+	{
+		//Opened with the default backend, the file is still read as compressed
+		File file29 = File::open(filename);
+		if (file29.backend() != FileBackend::COMPRESSED)
+		{
+			PRINT_ERROR("ERROR :: A compressed file should be recognized when opened.");
+		}
+		BufMgr* compressedMgr = new BufMgr(num);
+		for (int j = 0; j < pages; j++)
+		{
+			compressedMgr->readPage(&file29, pageNos[j], page);
+			sprintf(tmpbuf, "test.29 archived record %d of page %d", 0, j);
+			if (*page->begin() != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			compressedMgr->unPinPage(&file29, pageNos[j], false);
+		}
+		delete compressedMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 37 passed" << "\n";
+}
+
+void test38()
+{
+	//A file records its page size, and a file of another page size is refused when opened
+	const std::string& filename = "test.30";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	PageId pageNo;
+	{
+		File file30 = File::create(filename);
+		Page new_page = file30.allocatePage();
+		new_page.insertRecord("test.30 record");
+		pageNo = new_page.page_number();
+		file30.writePage(new_page);
+	}
+	{
+		File file30 = File::open(filename);
+		if (*file30.readPage(pageNo).begin() != "test.30 record")
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+
+	//Rewrites the recorded page size as if the file came from another build
+	{
+		const std::uint32_t other = Page::SIZE * 2;
+		std::fstream raw(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		raw.seekp(offsetof(FileHeader, page_size));
+		raw.write(reinterpret_cast<const char*>(&other), sizeof(other));
+	}
+	try
+	{
+		File file30 = File::open(filename);
+		PRINT_ERROR("ERROR :: A file of another page size should not open. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const PageSizeException &e)
+	{
+		if (e.page_size() != Page::SIZE * 2)
+		{
+			PRINT_ERROR("ERROR :: The exception should name the page size of the file.");
+		}
+	}
+	//The failed open leaves the file closed
+	File::remove(filename);
+
+	std::cout << "Test 38 passed" << "\n";
+}
+
+void test39()
+{
+	//A buffer pool placed on the NUMA nodes serves pages like any other, and counts hits crossing nodes
+	const std::string& filename = "test.31";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	if (numaNodes() == 0 || numaCurrentNode() >= numaNodes())
+	{
+		PRINT_ERROR("ERROR :: The calling thread should run on one of the nodes.");
+	}
+
+	{
+		File file31 = File::create(filename);
+		BufMgr* numaMgr = new BufMgr(num, 2 * numaNodes(), ReplacementPolicyType::CLOCK, 0, true /* numa */);
+		std::vector<PageId> pageNos;
+		std::vector<Page*> pages;
+		//Few enough pages that no partition runs out of frames, however they hash
+		const PageId count = num / 4;
+		numaMgr->allocPages(&file31, count, pageNos, pages);
+		for (i = 0; i < count; i++)
+		{
+			sprintf(tmpbuf, "test.31 Page %d", pageNos[i]);
+			pages[i]->insertRecord(tmpbuf);
+		}
+		numaMgr->unPinPages(&file31, pageNos, true);
+		numaMgr->clearBufStats();
+
+		//Reads from threads on every node
+		std::vector<std::thread> readers;
+		std::atomic<int> mismatches(0);
+		for (unsigned node = 0; node < numaNodes(); node++)
+		{
+			readers.push_back(std::thread([&, node]() {
+				numaRunOn(node);
+				for (PageId j = 0; j < count; j++)
+				{
+					Page* read;
+					numaMgr->readPage(&file31, pageNos[j], read);
+					char expected[100];
+					sprintf(expected, "test.31 Page %d", pageNos[j]);
+					if (*read->begin() != expected)
+					{
+						mismatches++;
+					}
+					numaMgr->unPinPage(&file31, pageNos[j], false);
+				}
+			}));
+		}
+		for (std::size_t t = 0; t < readers.size(); t++)
+		{
+			readers[t].join();
+		}
+		if (mismatches != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+
+		const BufStats stats = numaMgr->getBufStats();
+		if (stats.hits != count * numaNodes() || stats.remoteHits > stats.hits)
+		{
+			PRINT_ERROR("ERROR :: Hits were miscounted.");
+		}
+		if (numaNodes() == 1 && stats.remoteHits != 0)
+		{
+			PRINT_ERROR("ERROR :: With a single node no hit is remote.");
+		}
+		delete numaMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 39 passed" << "\n";
+}
+
+void test40()
+{
+	//Buffer classes cap the frames of a tenant, keep index pages and evict temporary pages first
+	const std::string names[4] = {"test.32.tenant", "test.32.index", "test.32.table", "test.32.temp"};
+	const PageId sizes[4] = {60, 30, 100, 10};
+	std::vector<PageId> pageNos[4];
+	for (int f = 0; f < 4; f++)
+	{
+		try
+		{
+			File::remove(names[f]);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+		File created = File::create(names[f]);
+		for (i = 0; i < sizes[f]; i++)
+		{
+			pageNos[f].push_back(created.allocatePage().page_number());
+		}
+	}
+
+	//Every policy passes over the pages of keep classes and finds those of evict-first classes
+	const ReplacementPolicyType policies[] = {ReplacementPolicyType::CLOCK, ReplacementPolicyType::LRU_K,
+		ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC, ReplacementPolicyType::CLOCK_PRO};
+	for (std::size_t p = 0; p < sizeof(policies)/sizeof(policies[0]); p++)
+	{
+		File tenant = File::open(names[0]);
+		File index = File::open(names[1]);
+		File table = File::open(names[2]);
+		File temp = File::open(names[3]);
+		File* files[4] = {&tenant, &index, &table, &temp};
+		BufMgr* classMgr = new BufMgr(num, 1, policies[p]);
+		classMgr->setBufferClass(1, BufferPriority::NORMAL, 20);
+		classMgr->setBufferClass(2, BufferPriority::KEEP);
+		classMgr->setBufferClass(3, BufferPriority::EVICT_FIRST);
+		classMgr->assignBufferClass(&tenant, 1);
+		classMgr->assignBufferClass(&index, 2);
+		classMgr->assignBufferClass(&temp, 3);
+
+		const auto scan = [&](int f, PageId count) {
+			for (PageId j = 0; j < count; j++)
+			{
+				classMgr->readPage(files[f], pageNos[f][j], page);
+				classMgr->unPinPage(files[f], pageNos[f][j], false);
+			}
+		};
+
+		//The tenant's scan replaces its own pages once it holds its quota
+		scan(1, sizes[1]);
+		scan(0, sizes[0]);
+		if (classMgr->bufferClassFrames(1) != 20 || classMgr->bufferClassFrames(2) != sizes[1])
+		{
+			PRINT_ERROR("ERROR :: A class should not hold more frames than its quota.");
+		}
+
+		//Temporary pages go before anything else once the pool is full
+		scan(3, sizes[3]);
+		scan(2, 45);
+		if (classMgr->bufferClassFrames(3) != 5)
+		{
+			PRINT_ERROR("ERROR :: Pages of an evict-first class should be evicted first.");
+		}
+
+		//Index pages survive a scan larger than the pool
+		scan(2, sizes[2]);
+		if (classMgr->bufferClassFrames(2) != sizes[1] || classMgr->bufferClassFrames(3) != 0)
+		{
+			PRINT_ERROR("ERROR :: Pages of a keep class should stay while others can be evicted.");
+		}
+		classMgr->clearBufStats();
+		scan(1, sizes[1]);
+		if (classMgr->getBufStats().hits != sizes[1])
+		{
+			PRINT_ERROR("ERROR :: Kept pages should be hits.");
+		}
+
+		classMgr->assignBufferClass(&tenant, 0);
+		if (classMgr->bufferClassFrames(1) != 0)
+		{
+			PRINT_ERROR("ERROR :: A file taken out of its class should not count towards it.");
+		}
+		delete classMgr;
+	}
+	for (int f = 0; f < 4; f++)
+	{
+		File::remove(names[f]);
+	}
+
+	std::cout << "Test 40 passed" << "\n";
+}
+
+void test41()
+{
+	//With every frame pinned, tryReadPage gives up at once and readPage waits for a frame to be unpinned
+	const std::string& filename = "test.33";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file33 = File::create(filename);
+		const PageId frames = 10;
+		std::vector<PageId> pageNos;
+		for (i = 0; i <= frames; i++)
+		{
+			pageNos.push_back(file33.allocatePage().page_number());
+		}
+		BufMgr* waitMgr = new BufMgr(frames);
+		for (i = 0; i < frames; i++)
+		{
+			waitMgr->readPage(&file33, pageNos[i], page);
+		}
+
+		Page* extra = NULL;
+		if (waitMgr->tryReadPage(&file33, pageNos[frames], extra) || extra != NULL)
+		{
+			PRINT_ERROR("ERROR :: tryReadPage should fail when every frame is pinned.");
+		}
+		if (!waitMgr->tryReadPage(&file33, pageNos[0], extra) || extra->page_number() != pageNos[0])
+		{
+			PRINT_ERROR("ERROR :: tryReadPage should pin a buffered page.");
+		}
+		waitMgr->unPinPage(&file33, pageNos[0], false);
+		try
+		{
+			waitMgr->readPage(&file33, pageNos[frames], extra);
+			PRINT_ERROR("ERROR :: Without a wait, a full pool should throw. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const BufferExceededException &e)
+		{
+		}
+
+		//A pin released meanwhile ends the wait
+		waitMgr->setFrameWait(10000);
+		std::thread releaser([&]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			waitMgr->unPinPage(&file33, pageNos[0], false);
+		});
+		waitMgr->readPage(&file33, pageNos[frames], extra);
+		releaser.join();
+		if (extra->page_number() != pageNos[frames] || waitMgr->getBufStats().frameWaits != 1)
+		{
+			PRINT_ERROR("ERROR :: The read should have waited for the frame unpinned.");
+		}
+
+		//Waits end with the exception if nothing is unpinned in time
+		waitMgr->setFrameWait(20);
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		try
+		{
+			waitMgr->readPage(&file33, pageNos[0], extra);
+			PRINT_ERROR("ERROR :: A wait should time out. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const BufferExceededException &e)
+		{
+		}
+		if (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20))
+		{
+			PRINT_ERROR("ERROR :: The read should have waited for the timeout.");
+		}
+
+		for (i = 1; i <= frames; i++)
+		{
+			waitMgr->unPinPage(&file33, pageNos[i], false);
+		}
+		delete waitMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 41 passed" << "\n";
+}
+
+#ifdef BADGERDB_HAS_COROUTINES
+/**
+ * Coroutine that starts at once and frees itself when it returns.
+ */
+struct DetachedTask
+{
+	struct promise_type
+	{
+		DetachedTask get_return_object() { return DetachedTask(); }
+		std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+		std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+/**
+ * Single-threaded scheduler: coroutines resumed by the I/O engine are queued for its thread.
+ */
+struct ResumeQueue
+{
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::vector<std::coroutine_handle<> > handles;
+
+	ResumeExecutor executor()
+	{
+		return [this](std::coroutine_handle<> handle) {
+			std::lock_guard<std::mutex> guard(mutex);
+			handles.push_back(handle);
+			ready.notify_one();
+		};
+	}
+
+	void runUntil(const std::atomic<int>& finished, const int count)
+	{
+		while (finished.load() < count)
+		{
+			std::vector<std::coroutine_handle<> > batch;
+			{
+				std::unique_lock<std::mutex> guard(mutex);
+				ready.wait_for(guard, std::chrono::milliseconds(10), [this]() { return !handles.empty(); });
+				batch.swap(handles);
+			}
+			for (std::size_t k = 0; k < batch.size(); k++)
+			{
+				batch[k].resume();
+			}
+		}
+	}
+};
+
+DetachedTask readThroughCoroutine(BufMgr& mgr, File* file, const PageId pageNo, ResumeExecutor executor,
+	Page*& result, bool& failed, std::thread::id& resumedOn, std::atomic<int>& finished)
+{
+	try
+	{
+		result = co_await awaitPage(mgr, file, pageNo, executor);
+	}
+	catch(const InvalidPageException &e)
+	{
+		failed = true;
+	}
+	resumedOn = std::this_thread::get_id();
+	finished++;
+}
+#endif
+
+void test42()
+{
+#ifdef BADGERDB_HAS_COROUTINES
+	//A hit completes without suspending; misses suspend and are resumed on the scheduler's thread
+	const std::string& filename = "test.34";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file34 = File::create(filename);
+		const int count = 16;
+		std::vector<PageId> pageNos;
+		for (int k = 0; k < count; k++)
+		{
+			pageNos.push_back(file34.allocatePage().page_number());
+		}
+		BufMgr* coMgr = new BufMgr(num);
+		ResumeQueue queue;
+		const std::thread::id self = std::this_thread::get_id();
+
+		coMgr->readPage(&file34, pageNos[0], page);
+		coMgr->unPinPage(&file34, pageNos[0], false);
+		std::atomic<int> hitFinished(0);
+		Page* hit = NULL;
+		bool hitFailed = false;
+		std::thread::id hitThread;
+		readThroughCoroutine(*coMgr, &file34, pageNos[0], queue.executor(), hit, hitFailed, hitThread, hitFinished);
+		if (hitFinished.load() != 1 || hitFailed || hit == NULL || hit->page_number() != pageNos[0])
+		{
+			PRINT_ERROR("ERROR :: A buffered page should be returned without suspending.");
+		}
+		coMgr->unPinPage(&file34, pageNos[0], false);
+
+		std::atomic<int> finished(0);
+		std::vector<Page*> results(count, NULL);
+		bool failed[count] = {false};
+		std::vector<std::thread::id> threads(count);
+		for (int k = 1; k < count; k++)
+		{
+			readThroughCoroutine(*coMgr, &file34, pageNos[k], queue.executor(), results[k], failed[k], threads[k], finished);
+		}
+		//A page past the end of the file fails on the engine thread and throws where awaited
+		readThroughCoroutine(*coMgr, &file34, pageNos[count - 1] + 1, queue.executor(), results[0], failed[0], threads[0], finished);
+		queue.runUntil(finished, count);
+
+		if (!failed[0])
+		{
+			PRINT_ERROR("ERROR :: Awaiting a page that does not exist should throw InvalidPageException.");
+		}
+		for (int k = 1; k < count; k++)
+		{
+			if (failed[k] || results[k] == NULL || results[k]->page_number() != pageNos[k] || threads[k] != self)
+			{
+				PRINT_ERROR("ERROR :: A coroutine should be resumed on its scheduler with the page it awaited.");
+			}
+			coMgr->unPinPage(&file34, pageNos[k], false);
+		}
+		delete coMgr;
+	}
+	File::remove(filename);
+#endif
+
+	std::cout << "Test 42 passed" << "\n";
+}
+
+void test43()
+{
+	//Records loaded in bulk are appended after the pages already used, in order, and read back through the pool
+	const std::string& filename = "test.35";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	const unsigned records = 3000;
+	std::uint64_t loaded = 0;
+	{
+		File file35 = File::create(filename);
+		Page first = file35.allocatePage();
+		first.insertRecord("test.35 existing");
+		file35.writePage(first);
+
+		BulkLoader loader(file35, 4);
+		for (unsigned k = 0; k < records; k++)
+		{
+			sprintf((char*)tmpbuf, "test.35 record %u", k);
+			loader.insertRecord(tmpbuf);
+		}
+		try
+		{
+			loader.insertRecord(std::string(Page::SIZE, 'x'));
+			PRINT_ERROR("ERROR :: A record larger than a page should not load. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const InsufficientSpaceException &e)
+		{
+		}
+		loader.finish();
+		loaded = loader.pagesLoaded();
+		if (loader.recordsLoaded() != records || loaded < 2)
+		{
+			PRINT_ERROR("ERROR :: The loader should count the records and pages it loaded.");
+		}
+	}
+
+	{
+		File file35 = File::open(filename);
+		unsigned k = 0;
+		std::uint64_t pages = 0;
+		for (FileIterator iter = file35.begin(); iter != file35.end(); ++iter, ++pages)
+		{
+			Page current = *iter;
+			for (PageIterator rec = current.begin(); rec != current.end(); ++rec)
+			{
+				if (pages == 0)
+				{
+					if (*rec != "test.35 existing")
+					{
+						PRINT_ERROR("ERROR :: The existing page should come first.");
+					}
+					continue;
+				}
+				sprintf((char*)tmpbuf, "test.35 record %u", k++);
+				if (*rec != tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+		}
+		if (k != records || pages != loaded + 1)
+		{
+			PRINT_ERROR("ERROR :: Every record loaded should be found, on the pages loaded.");
+		}
+
+		BufMgr* loadMgr = new BufMgr(num);
+		const PageId last = static_cast<PageId>(loaded) + 1;
+		loadMgr->readPage(&file35, last, page);
+		sprintf((char*)tmpbuf, "test.35 record %u", records - 1);
+		bool found = false;
+		for (PageIterator rec = page->begin(); rec != page->end(); ++rec)
+		{
+			found = *rec == tmpbuf;
+		}
+		if (!found)
+		{
+			PRINT_ERROR("ERROR :: The last page loaded should end with the last record.");
+		}
+		loadMgr->unPinPage(&file35, last, false);
+		delete loadMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 43 passed" << "\n";
+}
+
+void test44()
+{
+	//A scan with the sequential hint only takes the frames of its ring, leaving the pages read before it buffered
+	const std::string& filename = "test.36";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file36 = File::create(filename);
+		const PageId pages = 3 * num;
+		const PageId hot = num / 2;
+		std::vector<Page> allocated = file36.allocatePages(pages);
+
+		for (int ring = 1; ring >= 0; ring--)
+		{
+			BufMgr* ringMgr = new BufMgr(num);
+			if (!ring)
+			{
+				ringMgr->setScanRing(0);
+			}
+			for (i = 0; i < hot; i++)
+			{
+				ringMgr->readPage(&file36, allocated[i].page_number(), page);
+				ringMgr->unPinPage(&file36, allocated[i].page_number(), false);
+			}
+			ringMgr->clearBufStats();
+			PageId scanned = 0;
+			for (BufScanIterator iter(ringMgr, &file36, BufScanIterator::DEFAULT_READ_AHEAD, AccessHint::SEQUENTIAL_SCAN);
+			     iter != BufScanIterator(); ++iter)
+			{
+				scanned++;
+			}
+			if (scanned != pages)
+			{
+				PRINT_ERROR("ERROR :: The scan should visit every page.");
+			}
+			const BufStats scan = ringMgr->getBufStats();
+
+			for (i = 0; i < hot; i++)
+			{
+				ringMgr->readPage(&file36, allocated[i].page_number(), page);
+				ringMgr->unPinPage(&file36, allocated[i].page_number(), false);
+			}
+			const std::uint64_t hotHits = ringMgr->getBufStats().hits - scan.hits;
+			if (ring && (hotHits != hot || scan.ringReuses == 0))
+			{
+				PRINT_ERROR("ERROR :: The scan should have reused its ring and kept the hot pages buffered.");
+			}
+			if (!ring && (hotHits == hot || scan.ringReuses != 0))
+			{
+				PRINT_ERROR("ERROR :: Without a ring the scan should have evicted hot pages.");
+			}
+			delete ringMgr;
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 44 passed" << "\n";
+}
+
+void test45()
+{
+	//The free space map names a page with room without reading pages, follows writes and survives reopening
+	const std::string& filename = "test.37";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	const std::string quarter(Page::DATA_SIZE / 4, 'q');
+	PageId full, half, empty;
+	{
+		File file37 = File::create(filename);
+		Page fullPage = file37.allocatePage();
+		Page halfPage = file37.allocatePage();
+		Page emptyPage = file37.allocatePage();
+		full = fullPage.page_number();
+		half = halfPage.page_number();
+		empty = emptyPage.page_number();
+		while (fullPage.hasSpaceForRecord(quarter))
+		{
+			fullPage.insertRecord(quarter);
+		}
+		halfPage.insertRecord(quarter);
+		halfPage.insertRecord(quarter);
+		file37.writePage(fullPage);
+		file37.writePage(halfPage);
+
+		//The tightest page that fits
+		if (file37.findPageWithSpace(quarter.size()) != half)
+		{
+			PRINT_ERROR("ERROR :: The half-full page should be chosen for a small record.");
+		}
+		if (file37.findPageWithSpace(3 * quarter.size()) != empty)
+		{
+			PRINT_ERROR("ERROR :: Only the empty page has room for a large record.");
+		}
+		if (file37.findPageWithSpace(Page::DATA_SIZE + 1) != Page::INVALID_NUMBER)
+		{
+			PRINT_ERROR("ERROR :: No page has room for a record larger than a page.");
+		}
+
+		//Writes move pages between categories; slots take room too, so a third quarter leaves too little for a fourth
+		const RecordId third = halfPage.insertRecord(quarter);
+		file37.writePage(halfPage);
+		Page found = file37.readPage(file37.findPageWithSpace(quarter.size()));
+		if (found.page_number() != empty || !found.hasSpaceForRecord(quarter))
+		{
+			PRINT_ERROR("ERROR :: The map should follow the page written.");
+		}
+		halfPage.deleteRecord(third);
+		file37.writePage(halfPage);
+		file37.deletePage(empty);
+		if (file37.findPageWithSpace(3 * quarter.size()) != Page::INVALID_NUMBER)
+		{
+			PRINT_ERROR("ERROR :: A deleted page should not be offered.");
+		}
+	}
+
+	{
+		File file37 = File::open(filename);
+		if (file37.findPageWithSpace(quarter.size()) != half || file37.findPageWithSpace(2 * quarter.size()) == half)
+		{
+			PRINT_ERROR("ERROR :: The map should have been stored with the file.");
+		}
+		PageId pages = 0;
+		for (FileIterator iter = file37.begin(); iter != file37.end(); ++iter)
+		{
+			pages++;
+		}
+		if (pages != 2 || full == half)
+		{
+			PRINT_ERROR("ERROR :: The map should take no page of the file.");
+		}
+	}
+
+	//Without a stored map one is built from the page headers
+	std::remove((filename + ".fsm").c_str());
+	{
+		File file37 = File::open(filename);
+		if (file37.findPageWithSpace(quarter.size()) != half || file37.findPageWithSpace(2 * quarter.size()) == half)
+		{
+			PRINT_ERROR("ERROR :: The map should have been rebuilt.");
+		}
+	}
+	File::remove(filename);
+	if (File::exists(filename + ".fsm"))
+	{
+		PRINT_ERROR("ERROR :: The map should be removed with the file.");
+	}
+
+	std::cout << "Test 45 passed" << "\n";
+}
+
+void test46()
+{
+	//Files grow by preallocated extents, so appended pages are laid out contiguously, while the header still counts the pages
+	const std::string& filename = "test.38";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	const std::uint64_t extent = 64 * Page::SIZE;
+	struct SizeOnDisk
+	{
+		static std::uint64_t of(const std::string& name)
+		{
+			std::ifstream raw(name.c_str(), std::ios::binary | std::ios::ate);
+			return (std::uint64_t) raw.tellg();
+		}
+	};
+
+	bool preallocated;
+	{
+		File file38 = File::create(filename, FileBackend::POSIX);
+		if (file38.extentSize() != File::DEFAULT_EXTENT_SIZE)
+		{
+			PRINT_ERROR("ERROR :: Files should grow by the default extent.");
+		}
+		file38.setExtentSize(extent - 1);
+		if (file38.extentSize() != extent)
+		{
+			PRINT_ERROR("ERROR :: The extent should be rounded up to whole pages.");
+		}
+		Page new_page = file38.allocatePage();
+		new_page.insertRecord("test.38 page 1");
+		file38.writePage(new_page);
+		file38.sync();
+		//A filesystem that cannot preallocate grows the file by the pages written
+		const std::uint64_t size = SizeOnDisk::of(filename);
+		preallocated = size == extent;
+		if (!preallocated && size != 2 * Page::SIZE)
+		{
+			PRINT_ERROR("ERROR :: The first page should preallocate the first extent.");
+		}
+
+		for (int i = 2; i < 70; i++)
+		{
+			new_page = file38.allocatePage();
+			sprintf(tmpbuf, "test.38 page %d", i);
+			new_page.insertRecord(tmpbuf);
+			file38.writePage(new_page);
+		}
+		std::vector<Page> appended = file38.allocatePages(100);
+		for (int i = 0; i < 100; i++)
+		{
+			sprintf(tmpbuf, "test.38 page %d", 70 + i);
+			appended[i].insertRecord(tmpbuf);
+			file38.writePage(appended[i]);
+		}
+		file38.sync();
+		if (preallocated && SizeOnDisk::of(filename) != 3 * extent)
+		{
+			PRINT_ERROR("ERROR :: Pages appended past an extent should preallocate the next ones.");
+		}
+		try
+		{
+			file38.readPage(170);
+			PRINT_ERROR("ERROR :: A preallocated page should not be in use.");
+		}
+		catch(const InvalidPageException &e)
+		{
+		}
+	}
+
+	{
+		//Opened with another backend, the extents already allocated are used up first
+		File file38 = File::open(filename);
+		int pages = 0;
+		for (FileIterator iter = file38.begin(); iter != file38.end(); ++iter)
+		{
+			pages++;
+			sprintf(tmpbuf, "test.38 page %d", pages);
+			Page curr_page = *iter;
+			if (curr_page.page_number() != (PageId) pages || *curr_page.begin() != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Pages should be read back in the order appended.");
+			}
+		}
+		if (pages != 169)
+		{
+			PRINT_ERROR("ERROR :: Only the pages allocated should be in use.");
+		}
+		//The extent size is not stored with the file
+		if (file38.extentSize() != File::DEFAULT_EXTENT_SIZE)
+		{
+			PRINT_ERROR("ERROR :: A file should be reopened with the default extent.");
+		}
+		file38.setExtentSize(extent);
+		file38.allocatePage();
+		file38.sync();
+		if (preallocated && SizeOnDisk::of(filename) != 3 * extent)
+		{
+			PRINT_ERROR("ERROR :: A page within an extent should not grow the file.");
+		}
+	}
+	File::remove(filename);
+
+	{
+		//Without extents the file grows by the pages written
+		File file38 = File::create(filename);
+		file38.setExtentSize(0);
+		for (int i = 0; i < 3; i++)
+		{
+			file38.allocatePage();
+		}
+		file38.sync();
+		if (file38.extentSize() != 0 || SizeOnDisk::of(filename) != 4 * Page::SIZE)
+		{
+			PRINT_ERROR("ERROR :: The file should only hold the pages written.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 46 passed" << "\n";
+}
+
+void test47()
+{
+	//Handles share and release pins with single atomic operations, taking no lock, and such releases still end waits for frames
+	const std::string& filename = "test.39";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file39 = File::create(filename);
+		std::vector<PageId> pageNos;
+		for (int j = 0; j < 4; j++)
+		{
+			pageNos.push_back(file39.allocatePage().page_number());
+		}
+		const int frames = 3;
+		BufMgr* pinMgr = new BufMgr(frames);
+
+		PageHandle handle = pinMgr->readPage(&file39, pageNos[0]);
+		pinMgr->clearBufStats();
+		PageHandle copy = handle.share();
+		if (copy.get() != handle.get() || copy.page_number() != pageNos[0] || copy.latch_mode() != LatchMode::NONE)
+		{
+			PRINT_ERROR("ERROR :: A shared handle should hold the same page.");
+		}
+		if (pinMgr->getBufStats().accesses != 1 || pinMgr->getBufStats().hits != 1)
+		{
+			PRINT_ERROR("ERROR :: Sharing a pin should count as a hit.");
+		}
+
+		//Pins taken and dropped concurrently all balance out
+		std::vector<std::thread> sharers;
+		for (int t = 0; t < 4; t++)
+		{
+			sharers.push_back(std::thread([&handle, t]() {
+				for (int k = 0; k < 5000; k++)
+				{
+					PageHandle mine = handle.share();
+					if (k % 100 == t)
+					{
+						mine.markDirty();
+					}
+				}
+			}));
+		}
+		for (int t = 0; t < 4; t++)
+		{
+			sharers[t].join();
+		}
+		handle.release();
+		copy.release();
+		try
+		{
+			pinMgr->unPinPage(&file39, pageNos[0], false);
+			PRINT_ERROR("ERROR :: Every shared pin should have been released. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const PageNotPinnedException &e)
+		{
+		}
+
+		//A handle released without the partition mutex wakes a read waiting for a frame
+		std::vector<PageHandle> held;
+		for (int j = 1; j <= frames; j++)
+		{
+			held.push_back(pinMgr->readPage(&file39, pageNos[j]));
+		}
+		pinMgr->clearBufStats();
+		pinMgr->setFrameWait(10000);
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::thread releaser([&held]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			held[0].release();
+		});
+		Page* waited;
+		pinMgr->readPage(&file39, pageNos[0], waited);
+		releaser.join();
+		if (waited->page_number() != pageNos[0] || pinMgr->getBufStats().frameWaits != 1 ||
+		    std::chrono::steady_clock::now() - start > std::chrono::milliseconds(5000))
+		{
+			PRINT_ERROR("ERROR :: The read should have been woken by the handle released.");
+		}
+		pinMgr->unPinPage(&file39, pageNos[0], false);
+		held.clear();
+		pinMgr->flushFile(&file39);
+		delete pinMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 47 passed" << "\n";
+}
+
+void test48()
+{
+	//Hits under the clock policy pin pages without the partition mutex while other threads evict and flush them
+	const std::string& filename = "test.40";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file40 = File::create(filename);
+		BufMgr* clockMgr = new BufMgr(10, 1, ReplacementPolicyType::CLOCK);
+		std::vector<PageId> pages(30);
+		for (i = 0; i < pages.size(); i++)
+		{
+			clockMgr->allocPage(&file40, pages[i], page);
+			sprintf((char*)tmpbuf, "test.40 Page %u %7.1f", pages[i], (float)pages[i]);
+			page->insertRecord(tmpbuf);
+			clockMgr->unPinPage(&file40, pages[i], true);
+		}
+
+		//Readers favour a few pages so that most reads hit, while the rest keep evicting frames under them
+		std::atomic<int> mismatches(0);
+		std::atomic<bool> done(false);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; t++)
+		{
+			threads.push_back(std::thread([&, t]() {
+				unsigned int seed = t + 1;
+				char expected[100];
+				for (int n = 0; n < 2000; n++)
+				{
+					seed = seed * 1103515245 + 12345;
+					const unsigned int pick = seed >> 16;
+					const PageId pageNo = pages[pick % 4 == 0 ? pick % pages.size() : pick % 4];
+					Page* threadPage;
+					clockMgr->readPage(&file40, pageNo, threadPage);
+					sprintf(expected, "test.40 Page %u %7.1f", pageNo, (float)pageNo);
+					const RecordId recordId = {pageNo, 1};
+					if (threadPage->page_number() != pageNo || threadPage->getRecord(recordId) != expected)
+					{
+						mismatches++;
+					}
+					clockMgr->unPinPage(&file40, pageNo, false);
+				}
+			}));
+		}
+
+		//Flushing drops every unpinned page of the file, racing with the readers' pins
+		std::thread flusher([&]() {
+			while (!done)
+			{
+				try
+				{
+					clockMgr->flushFile(&file40);
+				}
+				catch(const PagePinnedException &e)
+				{
+				}
+				std::this_thread::yield();
+			}
+		});
+		for (std::size_t t = 0; t < threads.size(); t++)
+		{
+			threads[t].join();
+		}
+		done = true;
+		flusher.join();
+		if (mismatches != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+
+		//No pin may have been lost or left behind: the whole file can still be flushed
+		clockMgr->flushFile(&file40);
+		delete clockMgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 48 passed" << "\n";
+}
+
+void test49()
+{
+	//Files keep page links in memory: writing a page keeps its link to the next one without reading its header back,
+	//and the file header reaches the disk on sync(), after which the pages can be read back from a reopened file
+	const std::string& filename = "test.41";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	PageId firstNo;
+	PageId secondNo;
+	{
+		File file41 = File::create(filename, FileBackend::POSIX);
+		Page first = file41.allocatePage();
+		firstNo = first.page_number();
+		//The copy of the first page predates the link to the second
+		Page second = file41.allocatePage();
+		secondNo = second.page_number();
+		second.insertRecord("test.41 second");
+		file41.writePage(second);
+
+		//Wipes the header of the first page on disk; writing the stale copy must take the link from memory
+		{
+			std::fstream raw(filename.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+			const std::vector<char> zeros(sizeof(PageHeader), 0);
+			raw.seekp(firstNo * Page::SIZE);
+			raw.write(&zeros[0], zeros.size());
+		}
+		first.insertRecord("test.41 first");
+		file41.writePage(first);
+		if (file41.readPage(firstNo).next_page_number() != secondNo)
+		{
+			PRINT_ERROR("ERROR :: Writing a page should keep its link to the next page.");
+		}
+
+		//The header on disk only catches up on sync()
+		FileHeader onDisk;
+		{
+			std::ifstream raw(filename.c_str(), std::ios::binary);
+			raw.read(reinterpret_cast<char*>(&onDisk), sizeof(onDisk));
+		}
+		if (onDisk.num_pages == secondNo + 1)
+		{
+			PRINT_ERROR("ERROR :: The file header should not be written before sync().");
+		}
+		file41.sync();
+		{
+			std::ifstream raw(filename.c_str(), std::ios::binary);
+			raw.read(reinterpret_cast<char*>(&onDisk), sizeof(onDisk));
+		}
+		if (onDisk.num_pages != secondNo + 1 || onDisk.first_used_page != firstNo || onDisk.last_used_page != secondNo)
+		{
+			PRINT_ERROR("ERROR :: sync() should write the file header.");
+		}
+	}
+
+	{
+		File file41 = File::open(filename);
+		std::vector<std::string> records;
+		for (FileIterator iter = file41.begin(); iter != file41.end(); ++iter)
+		{
+			Page filePage = *iter;
+			std::vector<RecordView> pageRecords;
+			filePage.getRecords(pageRecords);
+			for (std::size_t r = 0; r < pageRecords.size(); r++)
+			{
+				records.push_back(std::string(pageRecords[r].data(), pageRecords[r].size()));
+			}
+		}
+		if (records.size() != 2 || records[0] != "test.41 first" || records[1] != "test.41 second")
+		{
+			PRINT_ERROR("ERROR :: A synced file should read back the same after reopening.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 49 passed" << "\n";
+}
@@ -0,0 +1,155 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "numa.h"
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Memory policy of mbind() that prefers one node; from <numaif.h>, which only
+ * comes with libnuma.
+ */
+const int MPOL_PREFERRED_NODE = 1;
+
+/**
+ * Parses a list of the form "0-3,8,10-11" as the kernel prints sets of
+ * processors and nodes.
+ */
+std::vector<unsigned> parseList(const std::string& text) {
+  std::vector<unsigned> values;
+  std::stringstream ss(text);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || range[0] < '0' || range[0] > '9') {
+      continue;
+    }
+    const std::size_t dash = range.find('-');
+    const unsigned first = std::strtoul(range.c_str(), NULL, 10);
+    const unsigned last = dash == std::string::npos
+        ? first : std::strtoul(range.c_str() + dash + 1, NULL, 10);
+    for (unsigned v = first; v <= last; v++) {
+      values.push_back(v);
+    }
+  }
+  return values;
+}
+
+std::string readLine(const std::string& path) {
+  std::ifstream stream(path.c_str());
+  std::string line;
+  std::getline(stream, line);
+  return line;
+}
+
+/**
+ * @brief Nodes of the machine and their processors, read once.
+ */
+struct Topology {
+  /**
+   * Number of nodes; node numbers are below it.
+   */
+  unsigned nodes;
+
+  /**
+   * Processors of each node.
+   */
+  std::vector<std::vector<unsigned> > cpus;
+
+  /**
+   * Node of each processor.
+   */
+  std::vector<unsigned> nodeOfCpu;
+
+  Topology() : nodes(1) {
+    const std::vector<unsigned> online =
+        parseList(readLine("/sys/devices/system/node/online"));
+    for (std::size_t i = 0; i < online.size(); i++) {
+      nodes = std::max(nodes, online[i] + 1);
+    }
+    cpus.resize(nodes);
+    for (std::size_t i = 0; i < online.size(); i++) {
+      const unsigned node = online[i];
+      std::stringstream path;
+      path << "/sys/devices/system/node/node" << node << "/cpulist";
+      cpus[node] = parseList(readLine(path.str()));
+      for (std::size_t c = 0; c < cpus[node].size(); c++) {
+        const unsigned cpu = cpus[node][c];
+        if (cpu >= nodeOfCpu.size()) {
+          nodeOfCpu.resize(cpu + 1, 0);
+        }
+        nodeOfCpu[cpu] = node;
+      }
+    }
+  }
+};
+
+const Topology& topology() {
+  static const Topology machine;
+  return machine;
+}
+
+}
+
+unsigned numaNodes() {
+  return topology().nodes;
+}
+
+unsigned numaCurrentNode() {
+  const Topology& machine = topology();
+  if (machine.nodes == 1) {
+    return 0;
+  }
+  const int cpu = sched_getcpu();
+  if (cpu < 0 || (std::size_t) cpu >= machine.nodeOfCpu.size()) {
+    return 0;
+  }
+  return machine.nodeOfCpu[cpu];
+}
+
+bool numaBind(void* address, std::size_t length, unsigned node) {
+#ifdef SYS_mbind
+  unsigned long mask[16] = {0};
+  const unsigned long bits = 8 * sizeof(mask[0]);
+  if (node >= bits * 16) {
+    return false;
+  }
+  mask[node / bits] = 1UL << (node % bits);
+  return syscall(SYS_mbind, address, length, MPOL_PREFERRED_NODE, mask,
+                 bits * 16, 0) == 0;
+#else
+  return false;
+#endif
+}
+
+bool numaRunOn(unsigned node) {
+  const Topology& machine = topology();
+  if (node >= machine.nodes || machine.cpus[node].empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (std::size_t c = 0; c < machine.cpus[node].size(); c++) {
+    if (machine.cpus[node][c] < CPU_SETSIZE) {
+      CPU_SET(machine.cpus[node][c], &set);
+    }
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+}
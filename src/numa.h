@@ -0,0 +1,48 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * Returns the number of NUMA nodes of the machine, as the kernel reports them
+ * under /sys/devices/system/node; 1 where it reports none.
+ */
+unsigned numaNodes();
+
+/**
+ * Returns the NUMA node of the processor the calling thread is running on, or
+ * 0 if it cannot be told.  Cheap enough to call on every buffer hit: the
+ * processor comes from sched_getcpu() and its node from a table built once.
+ */
+unsigned numaCurrentNode();
+
+/**
+ * Asks the kernel to place the memory of a range, as it is first touched, on
+ * the given node (mbind() with MPOL_PREFERRED, so allocation falls back to
+ * other nodes rather than fail).  Memory already touched stays where it is.
+ *
+ * @param address   Start of the range; a multiple of the OS page size.
+ * @param length    Length of the range.
+ * @param node      Node to place the memory on.
+ * @return  False if the kernel does not support placement or refused it.
+ */
+bool numaBind(void* address, std::size_t length, unsigned node);
+
+/**
+ * Restricts the calling thread to the processors of a node, so memory it then
+ * touches first is placed there.
+ *
+ * @param node      Node to run on.
+ * @return  False if the processors of the node are unknown.
+ */
+bool numaRunOn(unsigned node);
+
+}
@@ -5,8 +5,17 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <vector>
 
+#include "crc32c.h"
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
 #include "exceptions/invalid_slot_exception.h"
@@ -16,51 +25,212 @@
 
 namespace badgerdb {
 
+namespace {
+
+/**
+ * Number of slots whose used flags usedSlotMask() tests at once.
+ */
+const SlotId SLOT_BLOCK = 8;
+
+/**
+ * Returns a mask of the used slots among SLOT_BLOCK consecutive slots, bit i
+ * set if slots[i] is used.
+ */
+std::uint32_t usedSlotMask(const PageSlot* slots) {
+#if defined(__SSE2__)
+  // Eight 6-byte slots fill three 16-byte vectors; the used flags are the
+  // bytes at multiples of 6.
+  static_assert(sizeof(PageSlot) == 6 && offsetof(PageSlot, used) == 0,
+                "slot layout assumed by the vector scan");
+  const __m128i* raw = reinterpret_cast<const __m128i*>(slots);
+  const __m128i zero = _mm_setzero_si128();
+  const std::uint32_t unused0 = _mm_movemask_epi8(
+      _mm_cmpeq_epi8(_mm_loadu_si128(raw), zero));
+  const std::uint32_t unused1 = _mm_movemask_epi8(
+      _mm_cmpeq_epi8(_mm_loadu_si128(raw + 1), zero));
+  const std::uint32_t unused2 = _mm_movemask_epi8(
+      _mm_cmpeq_epi8(_mm_loadu_si128(raw + 2), zero));
+  // Gathers flag bytes 0, 6, 12 | 18, 24, 30 | 36, 42 into bits 0..7.
+  const std::uint32_t unused =
+      ((unused0 >> 0) & 1) | ((unused0 >> 5) & 2) | ((unused0 >> 10) & 4) |
+      ((unused1 << 1) & 8) | ((unused1 >> 4) & 16) | ((unused1 >> 9) & 32) |
+      ((unused2 << 2) & 64) | ((unused2 >> 3) & 128);
+  return ~unused & 0xFF;
+#else
+  std::uint32_t used = 0;
+  for (SlotId i = 0; i < SLOT_BLOCK; ++i) {
+    used |= (std::uint32_t) slots[i].used << i;
+  }
+  return used;
+#endif
+}
+
+}
+
 Page::Page() {
+  allocateStorage();
   initialize();
 }
 
+Page::Page(char* frame)
+    : header_(reinterpret_cast<PageHeader*>(frame)),
+      data_(frame + sizeof(PageHeader)),
+      storage_(NULL) {
+}
+
+void Page::view(char* frame) {
+  assert(storage_ == NULL);
+  header_ = reinterpret_cast<PageHeader*>(frame);
+  data_ = frame + sizeof(PageHeader);
+}
+
+Page::Page(const Page& other) {
+  allocateStorage();
+  std::memcpy(storage_, other.header_, SIZE);
+}
+
+Page::Page(Page&& other)
+    : header_(other.header_),
+      data_(other.data_),
+      storage_(other.storage_) {
+  if (storage_ == NULL) {
+    // Views don't give up their frame; copy it instead.
+    allocateStorage();
+    std::memcpy(storage_, other.header_, SIZE);
+  } else {
+    other.header_ = NULL;
+    other.data_ = NULL;
+    other.storage_ = NULL;
+  }
+}
+
+Page& Page::operator=(const Page& other) {
+  if (this != &other) {
+    if (header_ == NULL) {
+      allocateStorage();
+    }
+    std::memcpy(header_, other.header_, SIZE);
+  }
+  return *this;
+}
+
+Page::~Page() {
+  std::free(storage_);
+}
+
+void Page::allocateStorage() {
+  void* mem;
+  if (posix_memalign(&mem, ALIGNMENT, SIZE) != 0) {
+    throw std::bad_alloc();
+  }
+  storage_ = static_cast<char*>(mem);
+  header_ = reinterpret_cast<PageHeader*>(storage_);
+  data_ = storage_ + sizeof(PageHeader);
+}
+
 void Page::initialize() {
-  header_.free_space_lower_bound = 0;
-  header_.free_space_upper_bound = DATA_SIZE;
-  header_.num_slots = 0;
-  header_.num_free_slots = 0;
-  header_.current_page_number = INVALID_NUMBER;
-  header_.next_page_number = INVALID_NUMBER;
-  data_.assign(DATA_SIZE, char());
+  header_->free_space_lower_bound = 0;
+  header_->free_space_upper_bound = DATA_SIZE;
+  header_->num_slots = 0;
+  header_->num_free_slots = 0;
+  header_->current_page_number = INVALID_NUMBER;
+  header_->next_page_number = INVALID_NUMBER;
+  header_->fragmented_bytes = 0;
+  header_->free_slot_hint = 1;
+  header_->checksum = 0;
+  header_->lsn = 0;
+  std::memset(data_, 0, DATA_SIZE);
+}
+
+std::uint32_t Page::computeChecksum() const {
+  PageHeader header = *header_;
+  header.checksum = 0;
+  std::uint32_t crc = crc32c(&header, sizeof(header));
+  crc = crc32c(data_, DATA_SIZE, crc);
+  return crc != 0 ? crc : 1;
 }
 
 RecordId Page::insertRecord(const std::string& record_data) {
-  if (!hasSpaceForRecord(record_data)) {
-    throw InsufficientSpaceException(
-        page_number(), record_data.length(), getFreeSpace());
+  return insertRecord(record_data.data(), record_data.length());
+}
+
+RecordId Page::insertRecord(const char* record_data,
+                            const std::size_t length) {
+  if (!hasSpaceForRecord(length)) {
+    throw InsufficientSpaceException(page_number(), length, getFreeSpace());
+  }
+  // A new slot grows the slot array into the free space, so make room first
+  if (header_->num_free_slots == 0 &&
+      getContiguousFreeSpace() < length + sizeof(PageSlot)) {
+    compact();
   }
   const SlotId slot_number = getAvailableSlot();
-  insertRecordInSlot(slot_number, record_data);
+  insertRecordInSlot(slot_number, record_data, length);
   return {page_number(), slot_number};
 }
 
 std::string Page::getRecord(const RecordId& record_id) const {
+  return getRecordView(record_id).str();
+}
+
+RecordView Page::getRecordView(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-  return data_.substr(slot.item_offset, slot.item_length);
+  return RecordView(data_ + slot.item_offset, slot.item_length);
+}
+
+std::size_t Page::getRecords(std::vector<RecordView>& records,
+                             std::vector<SlotId>* slots) const {
+  records.clear();
+  if (slots != NULL) {
+    slots->clear();
+  }
+  const PageSlot* directory = &getSlot(1);
+  const SlotId num_slots = header_->num_slots;
+  SlotId first = 0;
+  for (; first < num_slots; first += SLOT_BLOCK) {
+    std::uint32_t used;
+    if (num_slots - first >= SLOT_BLOCK) {
+      used = usedSlotMask(directory + first);
+    } else {
+      used = 0;
+      for (SlotId i = first; i < num_slots; ++i) {
+        used |= (std::uint32_t) directory[i].used << (i - first);
+      }
+    }
+    while (used != 0) {
+      const SlotId i = first + __builtin_ctz(used);
+      records.push_back(
+          RecordView(data_ + directory[i].item_offset, directory[i].item_length));
+      if (slots != NULL) {
+        slots->push_back(i + 1);
+      }
+      used &= used - 1;
+    }
+  }
+  return records.size();
 }
 
 void Page::updateRecord(const RecordId& record_id,
                         const std::string& record_data) {
+  updateRecord(record_id, record_data.data(), record_data.length());
+}
+
+void Page::updateRecord(const RecordId& record_id, const char* record_data,
+                        const std::size_t length) {
   validateRecordId(record_id);
   const PageSlot* slot = getSlot(record_id.slot_number);
   const std::size_t free_space_after_delete =
       getFreeSpace() + slot->item_length;
-  if (record_data.length() > free_space_after_delete) {
+  if (length > free_space_after_delete) {
     throw InsufficientSpaceException(
-        page_number(), record_data.length(), free_space_after_delete);
+        page_number(), length, free_space_after_delete);
   }
   // We have to disallow slot compaction here because we're going to place the
   // record data in the same slot, and compaction might delete the slot if we
   // permit it.
   deleteRecord(record_id, false /* allow_slot_compaction */);
-  insertRecordInSlot(record_id.slot_number, record_data);
+  insertRecordInSlot(record_id.slot_number, record_data, length);
 }
 
 void Page::deleteRecord(const RecordId& record_id) {
@@ -71,43 +241,32 @@ void Page::deleteRecord(const RecordId& record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
   PageSlot* slot = getSlot(record_id.slot_number);
-  data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
-
-  // Compact the data by removing the hole left by this record (if necessary).
-  std::uint16_t move_offset = slot->item_offset; 
-  std::size_t move_bytes = 0;
-  for (SlotId i = 1; i <= header_.num_slots; ++i) {
-    PageSlot* other_slot = getSlot(i);
-    if (other_slot->used && other_slot->item_offset < slot->item_offset) {
-      if (other_slot->item_offset < move_offset) {
-        move_offset = other_slot->item_offset;
-      }
-      move_bytes += other_slot->item_length;
-      // Update the slot for the other data to reflect the soon-to-be-new
-      // location.
-      other_slot->item_offset += slot->item_length;
-    }
-  }
-  // If we have data to move, shift it to the right.
-  if (move_bytes > 0) {
-    const std::string& data_to_move = data_.substr(move_offset, move_bytes);
-    data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+  std::memset(data_ + slot->item_offset, 0, slot->item_length);
+
+  // The record's bytes become free space: contiguous if they border the free
+  // space, otherwise a hole reclaimed by the next compaction.
+  if (slot->item_offset == header_->free_space_upper_bound) {
+    header_->free_space_upper_bound += slot->item_length;
+  } else {
+    header_->fragmented_bytes += slot->item_length;
   }
-  header_.free_space_upper_bound += slot->item_length;
 
   // Mark slot as unused.
   slot->used = false;
   slot->item_offset = 0;
   slot->item_length = 0;
-  ++header_.num_free_slots;
+  ++header_->num_free_slots;
+  if (record_id.slot_number < header_->free_slot_hint) {
+    header_->free_slot_hint = record_id.slot_number;
+  }
 
-  if (allow_slot_compaction && record_id.slot_number == header_.num_slots) {
+  if (allow_slot_compaction && record_id.slot_number == header_->num_slots) {
     // Last slot in the list, so we need to free any unused slots that are at
     // the end of the slot list.
     int num_slots_to_delete = 1;
-    for (SlotId i = 1; i < header_.num_slots; ++i) {
+    for (SlotId i = 1; i < header_->num_slots; ++i) {
       // Traverse list backwards, looking for unused slots.
-      const PageSlot* other_slot = getSlot(header_.num_slots - i);
+      const PageSlot* other_slot = getSlot(header_->num_slots - i);
       if (!other_slot->used) {
         ++num_slots_to_delete;
       } else {
@@ -116,33 +275,68 @@ void Page::deleteRecord(const RecordId& record_id,
         break;
       }
     }
-    header_.num_slots -= num_slots_to_delete;
-    header_.num_free_slots -= num_slots_to_delete;
-    header_.free_space_lower_bound -= sizeof(PageSlot) * num_slots_to_delete;
+    header_->num_slots -= num_slots_to_delete;
+    header_->num_free_slots -= num_slots_to_delete;
+    header_->free_space_lower_bound -= sizeof(PageSlot) * num_slots_to_delete;
+  }
+}
+
+void Page::compact() {
+  if (header_->fragmented_bytes == 0) {
+    return;
+  }
+  // Moves the records, highest first, up against the end of the page; each
+  // only moves up, past bytes already moved or freed.
+  std::vector<SlotId> slots;
+  for (SlotId i = 1; i <= header_->num_slots; ++i) {
+    if (getSlot(i)->used) {
+      slots.push_back(i);
+    }
+  }
+  std::sort(slots.begin(), slots.end(), [this](SlotId a, SlotId b) {
+    return getSlot(a)->item_offset > getSlot(b)->item_offset;
+  });
+  std::uint16_t end = DATA_SIZE;
+  for (std::size_t i = 0; i < slots.size(); ++i) {
+    PageSlot* slot = getSlot(slots[i]);
+    end -= slot->item_length;
+    if (end != slot->item_offset) {
+      std::memmove(data_ + end, data_ + slot->item_offset, slot->item_length);
+      slot->item_offset = end;
+    }
   }
+  std::memset(data_ + header_->free_space_upper_bound, 0,
+              end - header_->free_space_upper_bound);
+  header_->free_space_upper_bound = end;
+  header_->fragmented_bytes = 0;
 }
 
 bool Page::hasSpaceForRecord(const std::string& record_data) const {
-  std::size_t record_size = record_data.length();
-  if (header_.num_free_slots == 0) {
+  return hasSpaceForRecord(record_data.length());
+}
+
+bool Page::hasSpaceForRecord(const std::size_t length) const {
+  std::size_t record_size = length;
+  if (header_->num_free_slots == 0) {
     record_size += sizeof(PageSlot);
   }
   return record_size <= getFreeSpace();
 }
 
 PageSlot* Page::getSlot(const SlotId slot_number) {
-  return reinterpret_cast<PageSlot*>(&data_[(slot_number - 1) * sizeof(PageSlot)]);
+  return reinterpret_cast<PageSlot*>(data_ + (slot_number - 1) * sizeof(PageSlot));
 }
 
 const PageSlot& Page::getSlot(const SlotId slot_number) const {
-  return *reinterpret_cast<const PageSlot*>(&data_[(slot_number - 1) * sizeof(PageSlot)]);
+  return *reinterpret_cast<const PageSlot*>(data_ + (slot_number - 1) * sizeof(PageSlot));
 }
 
 SlotId Page::getAvailableSlot() {
   SlotId slot_number = INVALID_SLOT;
-  if (header_.num_free_slots > 0) {
-    // Have an allocated but unused slot that we can reuse.
-    for (SlotId i = 1; i <= header_.num_slots; ++i) {
+  if (header_->num_free_slots > 0) {
+    // Have an allocated but unused slot that we can reuse; none lies below the
+    // hint.
+    for (SlotId i = header_->free_slot_hint; i <= header_->num_slots; ++i) {
       const PageSlot* slot = getSlot(i);
       if (!slot->used) {
         // We don't decrement the number of free slots until someone actually
@@ -153,18 +347,19 @@ SlotId Page::getAvailableSlot() {
     }
   } else {
     // Have to allocate a new slot.
-    slot_number = header_.num_slots + 1;
-    ++header_.num_slots;
-    ++header_.num_free_slots;
-    header_.free_space_lower_bound = sizeof(PageSlot) * header_.num_slots;
+    slot_number = header_->num_slots + 1;
+    ++header_->num_slots;
+    ++header_->num_free_slots;
+    header_->free_space_lower_bound = sizeof(PageSlot) * header_->num_slots;
   }
   assert(slot_number != INVALID_SLOT);
   return slot_number;
 }
 
 void Page::insertRecordInSlot(const SlotId slot_number,
-                              const std::string& record_data) {
-  if (slot_number > header_.num_slots ||
+                              const char* record_data,
+                              const std::size_t length) {
+  if (slot_number > header_->num_slots ||
       slot_number == INVALID_SLOT) {
     throw InvalidSlotException(page_number(), slot_number);
   }
@@ -172,13 +367,19 @@ void Page::insertRecordInSlot(const SlotId slot_number,
   if (slot->used) {
     throw SlotInUseException(page_number(), slot_number);
   }
-  const int record_length = record_data.length();
+  const int record_length = length;
+  if (getContiguousFreeSpace() < length) {
+    compact();
+  }
   slot->used = true;
   slot->item_length = record_length;
-  slot->item_offset = header_.free_space_upper_bound - record_length;
-  header_.free_space_upper_bound = slot->item_offset;
-  --header_.num_free_slots;
-  data_.replace(slot->item_offset, slot->item_length, record_data);
+  slot->item_offset = header_->free_space_upper_bound - record_length;
+  header_->free_space_upper_bound = slot->item_offset;
+  --header_->num_free_slots;
+  if (slot_number == header_->free_slot_hint) {
+    header_->free_slot_hint = slot_number + 1;
+  }
+  std::memcpy(data_ + slot->item_offset, record_data, record_length);
 }
 
 void Page::validateRecordId(const RecordId& record_id) const {
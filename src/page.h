@@ -11,9 +11,15 @@
 #include <stdint.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "types.h"
 
+// Page size of the build; see Page::SIZE
+#ifndef BADGERDB_PAGE_SIZE
+#define BADGERDB_PAGE_SIZE 8192
+#endif
+
 namespace badgerdb {
 
 /**
@@ -57,6 +63,31 @@ struct PageHeader {
    */
   PageId next_page_number;
 
+  /**
+   * Bytes of deleted records left between the free space and the end of the
+   * page; reclaimed by compacting the records once an insert needs them.
+   */
+  std::uint16_t fragmented_bytes;
+
+  /**
+   * No slot below this one is unused, so the search for a free slot starts
+   * here.
+   */
+  SlotId free_slot_hint;
+
+  /**
+   * CRC-32C of the page as last written to its file, computed with this field
+   * set to 0 (see Page::computeChecksum()); 0 if the page carries none, as
+   * pages never written do.
+   */
+  std::uint32_t checksum;
+
+  /**
+   * LSN of the last write-ahead log record of the page (see LogManager); 0 if
+   * the page was never logged.
+   */
+  Lsn lsn;
+
   /**
    * Returns true if this page header is equal to the other.
    *
@@ -92,6 +123,74 @@ struct PageSlot {
   std::uint16_t item_length;
 };
 
+/**
+ * @brief Read-only view of the bytes of a record, pointing into the page that
+ * holds it.
+ *
+ * A view stays valid only while the page is unchanged and, for a page in the
+ * buffer pool, pinned: any insert, update or delete on the page may move the
+ * bytes it points to.
+ */
+class RecordView {
+ public:
+  /**
+   * Constructs an empty view.
+   */
+  RecordView() : data_(NULL), size_(0) {}
+
+  /**
+   * Constructs a view of the given bytes.
+   *
+   * @param data  First byte of the record.
+   * @param size  Length of the record in bytes.
+   */
+  RecordView(const char* data, const std::size_t size)
+      : data_(data), size_(size) {}
+
+  /**
+   * Returns the first byte of the record; not NUL-terminated.
+   */
+  const char* data() const { return data_; }
+
+  /**
+   * Returns the length of the record in bytes.
+   */
+  std::size_t size() const { return size_; }
+
+  /**
+   * Returns true if the record has no bytes.
+   */
+  bool empty() const { return size_ == 0; }
+
+  /**
+   * Returns a copy of the record.
+   */
+  std::string str() const { return std::string(data_, size_); }
+
+  /**
+   * Returns true if the record holds exactly the given bytes.
+   *
+   * @param rhs   Bytes to compare against.
+   * @return  Whether the bytes are equal.
+   */
+  bool operator==(const std::string& rhs) const {
+    return rhs.compare(0, std::string::npos, data_, size_) == 0;
+  }
+
+  bool operator!=(const std::string& rhs) const { return !(*this == rhs); }
+
+ private:
+  /**
+   * First byte of the record.
+   */
+  const char* data_;
+
+  /**
+   * Length of the record in bytes.
+   */
+  std::size_t size_;
+};
+
 class PageIterator;
 
 /**
@@ -102,15 +201,28 @@ class PageIterator;
  * slots and identified by a RecordId.  Although a record's actual contents may
  * be moved on the page, accessing a record by its slot is consistent.
  *
+ * The header and data of a page are kept as one contiguous block of SIZE
+ * bytes, laid out exactly as on disk, so a page is read or written with a
+ * single transfer.  Pages created by users own their block; the pages of the
+ * buffer pool are views over frames of the buffer manager's arena.
+ *
  * @warning This class is not threadsafe.
  */
 class Page {
  public:
   /**
-   * Page size in bytes.  If this is changed, database files created with a
-   * different page size value will be unreadable by the resulting binaries.
+   * Page size in bytes: BADGERDB_PAGE_SIZE, 8192 unless the build defines it
+   * (make PAGE_SIZE=<bytes>).  Small pages suit random access, large ones
+   * scans.  Files record the page size they were created with, and opening a
+   * file of another page size fails.
+   */
+  static const std::size_t SIZE = BADGERDB_PAGE_SIZE;
+
+  /**
+   * Alignment of the memory holding a page, in bytes.  Large enough for
+   * direct I/O on common devices.
    */
-  static const std::size_t SIZE = 8192;
+  static const std::size_t ALIGNMENT = 4096;
 
   /**
    * Size of page free space area in bytes.
@@ -128,10 +240,41 @@ class Page {
   static const SlotId INVALID_SLOT = 0;
 
   /**
-   * Constructs a new, uninitialized page.
+   * Constructs a new, uninitialized page with its own storage.
    */
   Page();
 
+  /**
+   * Constructs a page with its own storage holding a copy of another page.
+   *
+   * @param other   Page to copy.
+   */
+  Page(const Page& other);
+
+  /**
+   * Constructs a page from a temporary.  Takes over its storage if it owns any,
+   * otherwise copies its contents.  A page whose storage was taken over holds
+   * none until it is assigned to, which gives it storage of its own again.
+   *
+   * @param other   Page to move from.
+   */
+  Page(Page&& other);
+
+  /**
+   * Copies the contents of another page into this page's storage.  A page
+   * viewing a buffer frame keeps viewing that frame; a page moved from gets
+   * new storage first.
+   *
+   * @param other   Page to copy.
+   * @return  This page.
+   */
+  Page& operator=(const Page& other);
+
+  /**
+   * Releases the page's storage if it owns it.
+   */
+  ~Page();
+
   /**
    * Inserts a new record into the page.
    *
@@ -140,6 +283,16 @@ class Page {
    */
   RecordId insertRecord(const std::string& record_data);
 
+  /**
+   * Inserts a new record into the page, copying it straight from the caller's
+   * bytes.  The bytes must not lie within this page.
+   *
+   * @param record_data  First byte of the record.
+   * @param length       Length of the record in bytes.
+   * @return  ID of the newly inserted record.
+   */
+  RecordId insertRecord(const char* record_data, const std::size_t length);
+
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
    * stored on the page; use updateRecord to change it.
@@ -150,6 +303,29 @@ class Page {
    */
   std::string getRecord(const RecordId& record_id) const;
 
+  /**
+   * Returns a view of the record with the given ID, pointing into the page
+   * rather than copying it.
+   *
+   * @see RecordView
+   * @param record_id  ID of the record to return.
+   * @return  View of the record.
+   */
+  RecordView getRecordView(const RecordId& record_id) const;
+
+  /**
+   * Returns views of every record on the page at once, in slot order.  The
+   * slot directory is filtered for used slots several slots at a time, which
+   * makes this much cheaper per record than stepping a PageIterator.
+   *
+   * @see RecordView
+   * @param records   Receives a view of each record; cleared first.
+   * @param slots     If not NULL, receives the slot number of each record.
+   * @return  Number of records.
+   */
+  std::size_t getRecords(std::vector<RecordView>& records,
+                         std::vector<SlotId>* slots = NULL) const;
+
   /**
    * Updates the record with the given ID, replacing its data with a new
    * version.  This is equivalent to deleting the old record and inserting a
@@ -161,14 +337,34 @@ class Page {
   void updateRecord(const RecordId& record_id, const std::string& record_data);
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array.
+   * Updates the record with the given ID, copying the new version straight
+   * from the caller's bytes.  The bytes must not lie within this page (in
+   * particular, they cannot be a view of the record being replaced).
+   *
+   * @param record_id   ID of record to update.
+   * @param record_data First byte of the updated record.
+   * @param length      Length of the updated record in bytes.
+   */
+  void updateRecord(const RecordId& record_id, const char* record_data,
+                    const std::size_t length);
+
+  /**
+   * Deletes the record with the given ID.  The bytes of the record are left
+   * where they are and counted as fragmented free space, which the next insert
+   * that needs it reclaims by compacting the page, so a delete does not move
+   * other records.  Slot array is compacted if the slot deleted is at the end
+   * of the slot array.
    *
    * @param record_id   ID of the record to delete.
    */
   void deleteRecord(const RecordId& record_id);
 
+  /**
+   * Moves all records to the end of the page so that its free space is
+   * contiguous again.  Record IDs do not change.
+   */
+  void compact();
+
   /**
    * Returns true if the page has enough free space to hold the given data.
    *
@@ -178,26 +374,62 @@ class Page {
   bool hasSpaceForRecord(const std::string& record_data) const;
 
   /**
-   * Returns this page's free space in bytes.
+   * Returns true if the page has enough free space to hold a record of the
+   * given length.
+   *
+   * @param length  Length of the record in bytes.
+   * @return  Whether the page can hold the record.
+   */
+  bool hasSpaceForRecord(const std::size_t length) const;
+
+  /**
+   * Returns this page's free space in bytes, including space left by deleted
+   * records that is only usable after compacting.
    *
    * @return  Free space in bytes.
    */
-  std::uint16_t getFreeSpace() const { return header_.free_space_upper_bound -
-                                              header_.free_space_lower_bound; }
+  std::uint16_t getFreeSpace() const { return getContiguousFreeSpace() +
+                                              header_->fragmented_bytes; }
+
+  /**
+   * Returns the bytes between the slot array and the records, usable without
+   * compacting.
+   *
+   * @return  Contiguous free space in bytes.
+   */
+  std::uint16_t getContiguousFreeSpace() const {
+    return header_->free_space_upper_bound - header_->free_space_lower_bound;
+  }
 
   /**
    * Returns this page's number in its file.
    *
    * @return  Page number.
    */
-  PageId page_number() const { return header_.current_page_number; }
+  PageId page_number() const { return header_->current_page_number; }
+
+  /**
+   * Returns the LSN of the last write-ahead log record of this page.
+   *
+   * @return  LSN, or 0 if the page was never logged.
+   */
+  Lsn lsn() const { return header_->lsn; }
+
+  /**
+   * Returns the CRC-32C of the page's bytes as they are now, taking the
+   * checksum field of the header to be 0.  Never 0, which marks a page
+   * without a checksum.
+   *
+   * @return  Checksum.
+   */
+  std::uint32_t computeChecksum() const;
 
   /**
    * Returns the number of the next used page this page in its file.
    *
    * @return  Page number of next used page in file.
    */
-  PageId next_page_number() const { return header_.next_page_number; }
+  PageId next_page_number() const { return header_->next_page_number; }
 
   /**
    * Returns an iterator at the first record in the page.
@@ -215,6 +447,29 @@ class Page {
   PageIterator end();
 
  private:
+  /**
+   * Constructs a page viewing SIZE bytes of memory owned by someone else, such
+   * as a frame of the buffer pool.  The memory is neither initialized nor freed
+   * by the page.
+   *
+   * @param frame   Start of the page's bytes; header followed by data.
+   */
+  explicit Page(char* frame);
+
+  /**
+   * Points a page constructed with Page(char*) at other memory, e.g. a frame
+   * of the buffer pool at a page of a memory-mapped file.
+   *
+   * @param frame   Start of the page's bytes; header followed by data.
+   */
+  void view(char* frame);
+
+  /**
+   * Allocates SIZE bytes aligned to ALIGNMENT for this page to own and points
+   * the header and data at them.
+   */
+  void allocateStorage();
+
   /**
    * Initializes this page as a new page with no header information or data.
    */
@@ -226,7 +481,7 @@ class Page {
    * @param page_number   Number of page in file.
    */
   void set_page_number(const PageId new_page_number) {
-    header_.current_page_number = new_page_number;
+    header_->current_page_number = new_page_number;
   }
 
   /**
@@ -235,14 +490,13 @@ class Page {
    * @param next_page_number  Page number of next used page in file.
    */
   void set_next_page_number(const PageId new_next_page_number) {
-    header_.next_page_number = new_next_page_number;
+    header_->next_page_number = new_next_page_number;
   }
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array and
-   * <allow_slot_compaction> is set.
+   * Deletes the record with the given ID, leaving its bytes as fragmented
+   * free space.  Slot array is compacted if the slot deleted is at the end of
+   * the slot array and <allow_slot_compaction> is set.
    *
    * @param record_id             ID of the record to delete.
    * @param allow_slot_compaction If true, the slot array will be compacted if
@@ -292,16 +546,18 @@ class Page {
    * in use.  <slot_number> must be less than <header_.num_slots>.
    *
    * Callers are responsible for making sure there is enough space to hold the
-   * record before calling this method.
+   * record before calling this method; the page is compacted if the space is
+   * fragmented.
    *
    * @param slot_number   Number of slot to insert record into.
-   * @param record_data   Bytes that compose the record.
+   * @param record_data   First byte of the record.
+   * @param length        Length of the record in bytes.
    * @throws  InvalidSlotException  Thrown when given slot number refers to an
    *                                unallocated slot.
    * @throws  SlotInUseException  Thrown when given slot is in use.
    */
-  void insertRecordInSlot(const SlotId slot_number,
-                          const std::string& record_data);
+  void insertRecordInSlot(const SlotId slot_number, const char* record_data,
+                          const std::size_t length);
 
   /**
    * Throws an exception if the given record ID is not valid for this page
@@ -321,18 +577,25 @@ class Page {
   bool isUsed() const { return page_number() != INVALID_NUMBER; }
 
   /**
-   * Header metadata.
+   * Header metadata; the first bytes of the page.
    */
-  PageHeader header_;
+  PageHeader* header_;
 
   /**
-   * Data stored on the page.  Includes bookkeeping information about slots as
-   * well as actual content.
+   * Data stored on the page, directly following the header.  Includes
+   * bookkeeping information about slots as well as actual content.
    */
+  char* data_;
 
-  std::string data_;
+  /**
+   * Memory allocated by this page, or NULL if the page views memory it does
+   * not own.
+   */
+  char* storage_;
 
+  friend class BufMgr;
   friend class File;
+  friend class LogManager;
   friend class PageIterator;
   friend class PageTest;
   friend class BufferTest;
@@ -342,5 +605,10 @@ static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0,
               "Page must have some space to hold data.");
+static_assert((Page::SIZE & (Page::SIZE - 1)) == 0 &&
+              Page::SIZE % Page::ALIGNMENT == 0,
+              "Page size must be a power of two and a multiple of the alignment.");
+static_assert(Page::DATA_SIZE <= 0xFFFF,
+              "Offsets within a page must fit in 16 bits.");
 
 }
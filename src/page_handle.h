@@ -0,0 +1,279 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cassert>
+#include "buffer.h"
+#include "frame_latch.h"
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Pin on a page of the buffer pool that is released automatically.
+ *
+ * Returned by BufMgr::readPage(File*, PageId) and BufMgr::allocPage(File*).
+ * The handle remembers the frame holding the page, so releasing the pin needs
+ * no hash table lookup and no lock, and the pin is released when the handle is
+ * destroyed, including during stack unwinding.  Changes to the page must be
+ * announced with markDirty() so that the page is written back.
+ *
+ * A pin only keeps the page in its frame.  Threads sharing a page also
+ * latch it (see FrameLatch): latch(LatchMode::SHARED) for reading,
+ * latch(LatchMode::EXCLUSIVE) for changing it, or readVersion() and
+ * validate() around an optimistic read that takes no latch at all.  The latch
+ * is released together with the pin.
+ *
+ * A handle owns its pin and latch, so it can be moved but not copied; share()
+ * takes a pin of its own for a second handle.  A default-constructed or
+ * moved-from handle holds no page.
+ */
+class PageHandle {
+  friend class BufMgr;
+
+ public:
+  /**
+   * Constructs a handle that holds no page.
+   */
+  PageHandle()
+      : buf_mgr_(NULL),
+        page_number_(Page::INVALID_NUMBER),
+        frame_(0),
+        page_(NULL),
+        dirty_(false),
+        latch_(LatchMode::NONE) {
+  }
+
+  /**
+   * Takes over the pin of another handle, which is left empty.
+   *
+   * @param other   Handle to move from.
+   */
+  PageHandle(PageHandle&& other)
+      : buf_mgr_(other.buf_mgr_),
+        page_number_(other.page_number_),
+        frame_(other.frame_),
+        page_(other.page_),
+        dirty_(other.dirty_),
+        latch_(other.latch_) {
+    other.page_ = NULL;
+    other.latch_ = LatchMode::NONE;
+  }
+
+  /**
+   * Releases the pin held by this handle and takes over that of another.
+   *
+   * @param other   Handle to move from.
+   */
+  PageHandle& operator=(PageHandle&& other) {
+    if (this != &other) {
+      release();
+      buf_mgr_ = other.buf_mgr_;
+      page_number_ = other.page_number_;
+      frame_ = other.frame_;
+      page_ = other.page_;
+      dirty_ = other.dirty_;
+      latch_ = other.latch_;
+      other.page_ = NULL;
+      other.latch_ = LatchMode::NONE;
+    }
+    return *this;
+  }
+
+  PageHandle(const PageHandle&) = delete;
+  PageHandle& operator=(const PageHandle&) = delete;
+
+  /**
+   * Releases the pin, if any.
+   */
+  ~PageHandle() {
+    release();
+  }
+
+  /**
+   * Returns true if the handle holds a page.
+   */
+  explicit operator bool() const {
+    return page_ != NULL;
+  }
+
+  /**
+   * Returns the pinned page.  It stays valid until the handle is released.
+   */
+  Page* get() const {
+    assert(page_ != NULL);
+    return page_;
+  }
+
+  Page* operator->() const {
+    return get();
+  }
+
+  Page& operator*() const {
+    return *get();
+  }
+
+  /**
+   * Returns the number of the pinned page.
+   */
+  PageId page_number() const {
+    return page_number_;
+  }
+
+  /**
+   * Records that the page has been modified; it is marked dirty when the pin
+   * is released.
+   */
+  void markDirty() {
+    dirty_ = true;
+  }
+
+  /**
+   * Latches the page, waiting for holders in a conflicting mode.  Any latch
+   * the handle already holds is released first.
+   *
+   * @param mode    Latch to take; NONE only releases the current one.
+   */
+  void latch(const LatchMode mode) {
+    assert(page_ != NULL);
+    unlatch();
+    if (mode == LatchMode::SHARED) {
+      frameLatch().lockShared();
+    } else if (mode == LatchMode::EXCLUSIVE) {
+      frameLatch().lockExclusive();
+    }
+    latch_ = mode;
+  }
+
+  /**
+   * Releases the latch held by the handle, if any; the pin stays.
+   */
+  void unlatch() {
+    if (latch_ == LatchMode::SHARED) {
+      frameLatch().unlockShared();
+    } else if (latch_ == LatchMode::EXCLUSIVE) {
+      frameLatch().unlockExclusive();
+    }
+    latch_ = LatchMode::NONE;
+  }
+
+  /**
+   * Returns the latch held by the handle.
+   */
+  LatchMode latch_mode() const {
+    return latch_;
+  }
+
+  /**
+   * Starts an optimistic read of the page; see FrameLatch::readVersion().
+   *
+   * @return  Version to pass to validate().
+   */
+  std::uint64_t readVersion() const {
+    assert(page_ != NULL);
+    return frameLatch().readVersion();
+  }
+
+  /**
+   * Finishes an optimistic read of the page; see FrameLatch::validate().
+   *
+   * @param version   Value returned by readVersion() before the read.
+   * @return  True if no writer latched the page since.
+   */
+  bool validate(const std::uint64_t version) const {
+    assert(page_ != NULL);
+    return frameLatch().validate(version);
+  }
+
+  /**
+   * Pins the page once more, for another handle that can outlive this one,
+   * e.g. one handed to another thread.  The page is known to be in its
+   * frame, so this costs one atomic operation on the frame's state word: no
+   * hash table lookup, no partition mutex and no latch.  Releasing either
+   * handle is equally cheap.
+   *
+   * @return  Handle on the page, holding no latch.
+   */
+  PageHandle share() const {
+    assert(page_ != NULL);
+    buf_mgr_->repinFrame(frame_);
+    return PageHandle(buf_mgr_, page_number_, frame_, page_);
+  }
+
+  /**
+   * Releases the latch and the pin now instead of when the handle is
+   * destroyed.  The handle holds no page afterwards.
+   */
+  void release() {
+    if (page_ != NULL) {
+      unlatch();
+      page_ = NULL;
+      buf_mgr_->unPinFrame(frame_, dirty_);
+    }
+  }
+
+ private:
+  /**
+   * Constructs a handle owning a pin taken by the buffer manager.
+   *
+   * @param buf_mgr       Buffer manager holding the page.
+   * @param page_number   Number of the page.
+   * @param frame         Frame holding the page.
+   * @param page          The page as buffered in that frame.
+   */
+  PageHandle(BufMgr* buf_mgr, const PageId page_number, const FrameId frame,
+             Page* page)
+      : buf_mgr_(buf_mgr),
+        page_number_(page_number),
+        frame_(frame),
+        page_(page),
+        dirty_(false),
+        latch_(LatchMode::NONE) {
+  }
+
+  /**
+   * Returns the latch of the frame holding the page.
+   */
+  FrameLatch& frameLatch() const {
+    return buf_mgr_->latchTable[frame_];
+  }
+
+  /**
+   * Buffer manager holding the page.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * Number of the pinned page.
+   */
+  PageId page_number_;
+
+  /**
+   * Frame holding the page.
+   */
+  FrameId frame_;
+
+  /**
+   * The pinned page; NULL if the handle holds none.
+   */
+  Page* page_;
+
+  /**
+   * True if the page is to be marked dirty when the pin is released.
+   */
+  bool dirty_;
+
+  /**
+   * Latch held on the page.
+   */
+  LatchMode latch_;
+};
+
+}
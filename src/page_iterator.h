@@ -101,6 +101,16 @@ class PageIterator {
 		return page_->getRecord(current_record_); 
 	}
 
+  /**
+   * Returns a view of the current record in the page, without copying it.
+   *
+   * @see RecordView
+   * @return  View of the record in page.
+   */
+	inline RecordView view() const {
+		return page_->getRecordView(current_record_);
+	}
+
   /**
    * Returns the next used slot in the page after the given slot or
    * Page::INVALID_SLOT if no slots are used after the given slot.
@@ -110,7 +120,7 @@ class PageIterator {
    */
   SlotId getNextUsedSlot(const SlotId start) const {
     SlotId slot_number = Page::INVALID_SLOT;
-    for (SlotId i = start + 1; i <= page_->header_.num_slots; ++i) {
+    for (SlotId i = start + 1; i <= page_->header_->num_slots; ++i) {
       const PageSlot* slot = page_->getSlot(i);
       if (slot->used) {
         slot_number = i;
@@ -0,0 +1,111 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "replacement_policy.h"
+
+#include <cassert>
+
+#include "arc_policy.h"
+#include "clock_policy.h"
+#include "clock_pro_policy.h"
+#include "lru_k_policy.h"
+#include "two_q_policy.h"
+
+namespace badgerdb {
+
+const FrameId FrameList::NONE;
+
+FrameList::FrameList(FrameId first, std::uint32_t num)
+    : firstFrame(first),
+      prev(num, NONE),
+      next(num, NONE),
+      member(num, false),
+      head(NONE),
+      tail(NONE),
+      count(0) {
+}
+
+void FrameList::pushFront(FrameId frame) {
+  const FrameId i = frame - firstFrame;
+  assert(!member[i]);
+  prev[i] = NONE;
+  next[i] = head;
+  if (head != NONE) {
+    prev[head - firstFrame] = frame;
+  } else {
+    tail = frame;
+  }
+  head = frame;
+  member[i] = true;
+  ++count;
+}
+
+void FrameList::remove(FrameId frame) {
+  const FrameId i = frame - firstFrame;
+  assert(member[i]);
+  if (prev[i] != NONE) {
+    next[prev[i] - firstFrame] = next[i];
+  } else {
+    head = next[i];
+  }
+  if (next[i] != NONE) {
+    prev[next[i] - firstFrame] = prev[i];
+  } else {
+    tail = prev[i];
+  }
+  member[i] = false;
+  --count;
+}
+
+void GhostList::pushFront(const PageKey& key) {
+  assert(!contains(key));
+  keys.push_front(key);
+  index[key] = keys.begin();
+}
+
+void GhostList::popBack() {
+  index.erase(keys.back());
+  keys.pop_back();
+}
+
+bool GhostList::erase(const PageKey& key) {
+  std::unordered_map<PageKey, std::list<PageKey>::iterator,
+                     PageKeyHash>::iterator it = index.find(key);
+  if (it == index.end()) {
+    return false;
+  }
+  keys.erase(it->second);
+  index.erase(it);
+  return true;
+}
+
+ReplacementPolicy* ReplacementPolicy::create(ReplacementPolicyType type,
+                                             FrameStates* states, FrameId first,
+                                             std::uint32_t num) {
+  switch (type) {
+    case ReplacementPolicyType::LRU_K:
+      return new LruKPolicy(states, first, num, 2 /* k */);
+    case ReplacementPolicyType::TWO_Q:
+      return new TwoQPolicy(states, first, num);
+    case ReplacementPolicyType::ARC:
+      return new ArcPolicy(states, first, num);
+    case ReplacementPolicyType::CLOCK_PRO:
+      return new ClockProPolicy(states, first, num);
+    case ReplacementPolicyType::CLOCK:
+    default:
+      return new ClockPolicy(states, first, num);
+  }
+}
+
+void ReplacementPolicy::victimOrder(std::vector<FrameId>& order) const {
+  order.clear();
+  for (FrameId frame = firstFrame; frame < firstFrame + numFrames; ++frame) {
+    order.push_back(frame);
+  }
+}
+
+}
@@ -0,0 +1,415 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Identity of a page, used by policies that remember pages no longer in the buffer pool.
+ */
+struct PageKey {
+  /**
+   * File the page belongs to (File::id()).
+   */
+  FileId file;
+
+  /**
+   * Page number within the file.
+   */
+  PageId pageNo;
+
+  /**
+   * Returns true if both keys name the same page.
+   *
+   * @param rhs   Key to compare against.
+   * @return  Whether the keys are equal.
+   */
+  bool operator==(const PageKey& rhs) const {
+    return file == rhs.file && pageNo == rhs.pageNo;
+  }
+
+  /**
+   * Returns both fields packed into one 64-bit value.
+   */
+  std::uint64_t value() const {
+    return ((std::uint64_t) file << 32) | pageNo;
+  }
+};
+
+/**
+ * @brief Hash functor for PageKey.
+ */
+struct PageKeyHash {
+  std::size_t operator()(const PageKey& key) const {
+    const std::uint64_t value = key.value() * 0x9E3779B97F4A7C15ULL;
+    return value ^ (value >> 32);
+  }
+};
+
+/**
+ * @brief Predicate over frames, e.g. those pickVictim() is to pass over.
+ */
+typedef std::function<bool(FrameId)> FrameFilter;
+
+/**
+ * @brief Intrusive doubly linked list over the frames of one partition.
+ *
+ * The front is the most recently inserted frame and the back the oldest.  All
+ * operations are O(1) and never allocate after construction.
+ */
+class FrameList {
+ public:
+  /**
+   * Marker for "no frame".
+   */
+  static const FrameId NONE = ~0u;
+
+  /**
+   * Constructs an empty list able to hold the frames [first, first + num).
+   *
+   * @param first   First frame of the partition.
+   * @param num     Number of frames in the partition.
+   */
+  FrameList(FrameId first, std::uint32_t num);
+
+  /**
+   * Inserts a frame at the front of the list.  The frame must not be in it.
+   *
+   * @param frame   Frame to insert.
+   */
+  void pushFront(FrameId frame);
+
+  /**
+   * Removes a frame from the list.  The frame must be in it.
+   *
+   * @param frame   Frame to remove.
+   */
+  void remove(FrameId frame);
+
+  /**
+   * Returns true if the frame is currently in this list.
+   *
+   * @param frame   Frame to check.
+   */
+  bool contains(FrameId frame) const { return member[frame - firstFrame]; }
+
+  /**
+   * Returns the oldest frame of the list, or NONE if it is empty.
+   */
+  FrameId back() const { return tail; }
+
+  /**
+   * Returns the frame inserted just after the given one (towards the front),
+   * or NONE if the given frame is the front.
+   *
+   * @param frame   Frame in the list.
+   */
+  FrameId newer(FrameId frame) const { return prev[frame - firstFrame]; }
+
+  /**
+   * Number of frames in the list.
+   */
+  std::uint32_t size() const { return count; }
+
+ private:
+  /**
+   * First frame of the partition; frames are stored relative to it.
+   */
+  FrameId firstFrame;
+
+  /**
+   * Neighbour towards the front of each frame.
+   */
+  std::vector<FrameId> prev;
+
+  /**
+   * Neighbour towards the back of each frame.
+   */
+  std::vector<FrameId> next;
+
+  /**
+   * Whether each frame is currently in the list.
+   */
+  std::vector<bool> member;
+
+  /**
+   * Most recently inserted frame.
+   */
+  FrameId head;
+
+  /**
+   * Oldest frame.
+   */
+  FrameId tail;
+
+  /**
+   * Number of frames in the list.
+   */
+  std::uint32_t count;
+};
+
+/**
+ * @brief Bounded recency list of pages that have been evicted ("ghost" entries).
+ *
+ * Keeps only page identities, never frames, so policies can recognize a page
+ * that comes back shortly after being evicted.
+ */
+class GhostList {
+ public:
+  /**
+   * Inserts a key as the most recent entry.  The key must not be in the list.
+   *
+   * @param key   Page to remember.
+   */
+  void pushFront(const PageKey& key);
+
+  /**
+   * Forgets the oldest entry.  The list must not be empty.
+   */
+  void popBack();
+
+  /**
+   * Forgets the given key if it is present.
+   *
+   * @param key   Page to forget.
+   * @return  True if the key was in the list.
+   */
+  bool erase(const PageKey& key);
+
+  /**
+   * Returns true if the key is in the list.
+   *
+   * @param key   Page to look for.
+   */
+  bool contains(const PageKey& key) const {
+    return index.find(key) != index.end();
+  }
+
+  /**
+   * Number of remembered pages.
+   */
+  std::size_t size() const { return keys.size(); }
+
+ private:
+  /**
+   * Remembered pages, most recent first.
+   */
+  std::list<PageKey> keys;
+
+  /**
+   * Position of every remembered page in <keys>.
+   */
+  std::unordered_map<PageKey, std::list<PageKey>::iterator, PageKeyHash> index;
+};
+
+/**
+ * @brief Interface of the page replacement policy of one buffer pool partition.
+ *
+ * BufMgr notifies the policy of every access, load and release of a frame and
+ * asks it for a victim whenever it needs a frame for a page that is not
+ * buffered.  All calls are made with the partition mutex held.
+ *
+ * A policy owns the bookkeeping for the frames [firstFrame, firstFrame +
+ * numFrames) and must never return a pinned frame as victim: it claims every
+ * victim holding a page before forgetting it (see claim()).  Every frame
+ * starts out free unless handed over through frameResident(); frames become
+ * free again through frameFreed() or by being returned from pickVictim().
+ */
+class ReplacementPolicy {
+ public:
+  /**
+   * Creates a policy of the given type for a partition of the buffer pool.
+   *
+   * @param type        Kind of policy to create.
+   * @param states      Frame state words of the buffer manager.
+   * @param first       First frame of the partition.
+   * @param num         Number of frames in the partition.
+   * @return  Newly allocated policy; owned by the caller.
+   */
+  static ReplacementPolicy* create(ReplacementPolicyType type,
+                                   FrameStates* states, FrameId first,
+                                   std::uint32_t num);
+
+  virtual ~ReplacementPolicy() {}
+
+  /**
+   * Called when a buffered page is pinned again (a buffer hit).
+   *
+   * @param frame   Frame holding the page.
+   */
+  virtual void frameAccessed(FrameId frame) = 0;
+
+  /**
+   * Called after a page has been read or allocated into a frame returned by
+   * pickVictim().
+   *
+   * @param frame   Frame now holding the page.
+   * @param key     Identity of the page.
+   */
+  virtual void frameLoaded(FrameId frame, const PageKey& key) = 0;
+
+  /**
+   * Called when a frame is released without being reused, e.g. because its
+   * page was disposed or flushed, or because loading a page into it failed.
+   *
+   * @param frame   Frame that is free again.
+   */
+  virtual void frameFreed(FrameId frame) = 0;
+
+  /**
+   * Chooses the frame to hold the given page: a free frame if there is one,
+   * otherwise an unpinned frame whose page is to be evicted.  The policy forgets
+   * the chosen frame; BufMgr follows up with frameLoaded() or frameFreed().
+   *
+   * Frames holding a page for which <skip> returns true are passed over like
+   * pinned ones: they are neither chosen nor aged, and keep their position and
+   * history.  Free frames are chosen regardless.
+   *
+   * @param key     Identity of the page that needs a frame.
+   * @param frame   Chosen frame is returned via this variable.
+   * @param skip    Frames to pass over, or NULL for none.
+   * @return  False if every frame of the partition is pinned or passed over.
+   */
+  virtual bool pickVictim(const PageKey& key, FrameId& frame,
+                          const FrameFilter* skip) = 0;
+
+  /**
+   * Called when BufMgr chooses a victim itself instead of asking pickVictim(),
+   * e.g. to replace a page of a buffer class at its quota.  The frame holds an
+   * unpinned page; the policy forgets the frame as if pickVictim() had returned
+   * it, and BufMgr follows up in the same way.
+   *
+   * @param frame   Frame taken.
+   */
+  virtual void frameTaken(FrameId frame) = 0;
+
+  /**
+   * Hands a frame that already holds a page to a newly created policy, e.g.
+   * when a partition is resized, or gives back a victim whose page stays in
+   * it after all, e.g. because it could not be written back.  The frame is no
+   * longer free; the page joins as if it had just been loaded, without a ghost
+   * hit or an access being recorded and without the frame state being
+   * touched, and any ghost entry its eviction left is forgotten.  Pages
+   * handed over first are evicted first.
+   *
+   * @param frame   Frame holding the page.
+   * @param key     Identity of the page.
+   */
+  virtual void frameResident(FrameId frame, const PageKey& key) = 0;
+
+  /**
+   * Lists the frames of the partition roughly in the order this policy would
+   * pick them as victims, soonest first.  Used by the page cleaner to write
+   * back dirty pages before they are evicted.  The default lists the frames
+   * in frame order.
+   *
+   * @param order   Receives the frames; cleared first.
+   */
+  virtual void victimOrder(std::vector<FrameId>& order) const;
+
+  /**
+   * Number of frames pickVictim() has examined so far.  Stays zero for
+   * policies that keep their victims in queues instead of sweeping.
+   */
+  std::uint64_t framesScanned() const { return scanned; }
+
+ protected:
+  /**
+   * Constructs the common part of a policy.
+   *
+   * @param states      Frame state words of the buffer manager.
+   * @param first       First frame of the partition.
+   * @param num         Number of frames in the partition.
+   */
+  ReplacementPolicy(FrameStates* states, FrameId first, std::uint32_t num)
+      : states(states), firstFrame(first), numFrames(num), scanned(0) {}
+
+  /**
+   * Returns true if the frame is pinned, or being written back by the page
+   * cleaner, and therefore cannot be evicted.
+   */
+  bool isPinned(FrameId frame) const {
+    return states->test(frame, FrameStates::UNEVICTABLE);
+  }
+
+  /**
+   * Returns true if the frame is pinned, or holds a page pickVictim() is to
+   * pass over.
+   *
+   * @param frame   Frame to check.
+   * @param skip    Filter passed to pickVictim(), or NULL.
+   */
+  bool isPassedOver(FrameId frame, const FrameFilter* skip) const {
+    return isPinned(frame) ||
+           (skip != NULL && isValid(frame) && (*skip)(frame));
+  }
+
+  /**
+   * Claims an unpinned frame as the victim.  Buffer hits pin frames without
+   * the partition mutex, so a frame found unpinned may have been pinned since;
+   * claiming fails then and the frame must be passed over.
+   */
+  bool claim(FrameId frame) {
+    return states->claim(frame);
+  }
+
+  /**
+   * Returns true if the frame holds a page.
+   */
+  bool isValid(FrameId frame) const {
+    return states->test(frame, FrameStates::VALID);
+  }
+
+  /**
+   * Reference bit of the frame, as maintained by the clock policy.
+   */
+  bool refbit(FrameId frame) const {
+    return states->test(frame, FrameStates::REFBIT);
+  }
+
+  /**
+   * Sets or clears the reference bit of the frame.
+   */
+  void setRefbit(FrameId frame, bool referenced) {
+    if (referenced) {
+      states->set(frame, FrameStates::REFBIT);
+    } else {
+      states->clear(frame, FrameStates::REFBIT);
+    }
+  }
+
+  /**
+   * Frame state words of the buffer manager.
+   */
+  FrameStates* states;
+
+  /**
+   * First frame of the partition.
+   */
+  FrameId firstFrame;
+
+  /**
+   * Number of frames in the partition.
+   */
+  std::uint32_t numFrames;
+
+  /**
+   * Frames examined by pickVictim(), for framesScanned().
+   */
+  std::uint64_t scanned;
+};
+
+}
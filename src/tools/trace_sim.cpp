@@ -0,0 +1,104 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Offline simulator for buffer manager traces (see BufTrace).
+ *
+ * Replays a trace saved with BufTrace::save() against simulated buffer pools
+ * of several sizes under every replacement policy, without touching the disk,
+ * and prints the hit ratio of each combination: one row per pool size, one
+ * column per policy, i.e. the hit-ratio (1 - miss-ratio) curve of the
+ * workload.
+ *
+ * Usage: badgerdb_tracesim TRACE [--sizes N,N,...]
+ *
+ * Without --sizes the pools double from 16 frames up to the number of
+ * distinct pages in the trace.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buf_trace.h"
+#include "buffer.h"
+#include "exceptions/badgerdb_exception.h"
+
+using namespace badgerdb;
+
+int main(int argc, char* argv[]) {
+  if (argc != 2 && !(argc == 4 && std::string(argv[2]) == "--sizes")) {
+    std::cerr << "usage: " << argv[0] << " TRACE [--sizes N,N,...]\n";
+    return 1;
+  }
+
+  std::vector<TraceRecord> records;
+  std::vector<std::string> files;
+  try {
+    BufTrace::load(argv[1], records, files);
+  } catch (const BadgerDbException& e) {
+    std::cerr << e.message() << "\n";
+    return 1;
+  }
+
+  std::set<std::pair<std::uint32_t, PageId> > distinct;
+  for (std::size_t r = 0; r < records.size(); r++) {
+    distinct.insert(std::make_pair(records[r].file, records[r].pageNo));
+  }
+
+  std::vector<std::uint32_t> sizes;
+  if (argc == 4) {
+    std::istringstream list(argv[3]);
+    std::string size;
+    while (std::getline(list, size, ',')) {
+      if (std::strtoul(size.c_str(), NULL, 10) > 0) {
+        sizes.push_back(std::strtoul(size.c_str(), NULL, 10));
+      }
+    }
+  } else {
+    for (std::uint32_t size = 16; size / 2 < distinct.size(); size *= 2) {
+      sizes.push_back(size);
+    }
+  }
+
+  const ReplacementPolicyType policies[] = {
+      ReplacementPolicyType::CLOCK, ReplacementPolicyType::LRU_K,
+      ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC,
+      ReplacementPolicyType::CLOCK_PRO};
+  const char* names[] = {"clock", "lru_k", "two_q", "arc", "clock_pro"};
+  const std::size_t numPolicies = sizeof(policies) / sizeof(policies[0]);
+
+  std::cout << records.size() << " records, " << files.size() << " files, "
+            << distinct.size() << " distinct pages\n";
+  std::cout << std::setw(10) << "frames";
+  for (std::size_t p = 0; p < numPolicies; p++) {
+    std::cout << std::setw(11) << names[p];
+  }
+  std::cout << "\n";
+  bool exceeded = false;
+  for (std::size_t s = 0; s < sizes.size(); s++) {
+    std::cout << std::setw(10) << sizes[s];
+    for (std::size_t p = 0; p < numPolicies; p++) {
+      const BufTrace::ReplayResult result =
+          BufTrace::replay(records, policies[p], sizes[s]);
+      std::cout << std::setw(10) << std::fixed << std::setprecision(1)
+                << 100 * result.hitRatio() << (result.exceeded ? "*" : "%");
+      exceeded = exceeded || result.exceeded != 0;
+    }
+    std::cout << "\n";
+  }
+  if (exceeded) {
+    std::cout << "(* some requests found every frame pinned)\n";
+  }
+  return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "two_q_policy.h"
+
+namespace badgerdb {
+
+TwoQPolicy::TwoQPolicy(FrameStates* states, FrameId first, std::uint32_t num)
+    : ReplacementPolicy(states, first, num),
+      kin(num / 4 > 0 ? num / 4 : 1),
+      kout(num / 2 > 0 ? num / 2 : 1),
+      a1in(first, num),
+      am(first, num),
+      freeFrames(first, num),
+      keys(num) {
+  for (std::uint32_t i = 0; i < num; ++i) {
+    freeFrames.pushFront(first + i);
+  }
+}
+
+FrameId TwoQPolicy::claimOldest(const FrameList& queue,
+                                 const FrameFilter* skip) {
+  FrameId frame = queue.back();
+  while (frame != FrameList::NONE &&
+         (isPassedOver(frame, skip) || !claim(frame))) {
+    frame = queue.newer(frame);
+  }
+  return frame;
+}
+
+void TwoQPolicy::frameAccessed(FrameId frame) {
+  // Pages in A1in stay where they are: a second access soon after the first
+  // is usually correlated and says nothing about the page being hot.
+  if (am.contains(frame)) {
+    am.remove(frame);
+    am.pushFront(frame);
+  }
+}
+
+void TwoQPolicy::frameLoaded(FrameId frame, const PageKey& key) {
+  keys[frame - firstFrame] = key;
+  if (a1out.erase(key)) {
+    am.pushFront(frame);
+  } else {
+    a1in.pushFront(frame);
+  }
+}
+
+void TwoQPolicy::frameFreed(FrameId frame) {
+  if (a1in.contains(frame)) {
+    a1in.remove(frame);
+  } else if (am.contains(frame)) {
+    am.remove(frame);
+  }
+  freeFrames.pushFront(frame);
+}
+
+void TwoQPolicy::frameTaken(FrameId frame) {
+  if (a1in.contains(frame)) {
+    a1in.remove(frame);
+  } else if (am.contains(frame)) {
+    am.remove(frame);
+  }
+}
+
+void TwoQPolicy::frameResident(FrameId frame, const PageKey& key) {
+  if (freeFrames.contains(frame)) {
+    freeFrames.remove(frame);
+  }
+  a1out.erase(key);
+  keys[frame - firstFrame] = key;
+  a1in.pushFront(frame);
+}
+
+bool TwoQPolicy::pickVictim(const PageKey& key, FrameId& frame,
+                            const FrameFilter* skip) {
+  if (freeFrames.size() > 0) {
+    frame = freeFrames.back();
+    freeFrames.remove(frame);
+    return true;
+  }
+
+  // Reclaim from A1in while it is over its share, otherwise from Am; fall
+  // back to the other queue if every page of the preferred one is pinned.
+  FrameId fromA1in = FrameList::NONE;
+  FrameId fromAm = FrameList::NONE;
+  if (a1in.size() > kin || am.size() == 0) {
+    fromA1in = claimOldest(a1in, skip);
+    if (fromA1in == FrameList::NONE) {
+      fromAm = claimOldest(am, skip);
+    }
+  } else {
+    fromAm = claimOldest(am, skip);
+    if (fromAm == FrameList::NONE) {
+      fromA1in = claimOldest(a1in, skip);
+    }
+  }
+
+  if (fromA1in != FrameList::NONE) {
+    a1in.remove(fromA1in);
+    a1out.pushFront(keys[fromA1in - firstFrame]);
+    while (a1out.size() > kout) {
+      a1out.popBack();
+    }
+    frame = fromA1in;
+    return true;
+  }
+  if (fromAm != FrameList::NONE) {
+    am.remove(fromAm);
+    frame = fromAm;
+    return true;
+  }
+  return false;
+}
+
+void TwoQPolicy::victimOrder(std::vector<FrameId>& order) const {
+  // A1in is drained first once it is over its share, then Am.
+  order.clear();
+  for (FrameId frame = a1in.back(); frame != FrameList::NONE;
+       frame = a1in.newer(frame)) {
+    order.push_back(frame);
+  }
+  for (FrameId frame = am.back(); frame != FrameList::NONE;
+       frame = am.newer(frame)) {
+    order.push_back(frame);
+  }
+}
+
+}
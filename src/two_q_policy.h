@@ -0,0 +1,91 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Full 2Q replacement policy (Johnson and Shasha).
+ *
+ * Pages seen for the first time enter the FIFO queue A1in.  When they are
+ * evicted from A1in only their identity is remembered in A1out; a page that is
+ * requested again while in A1out is considered hot and is placed in the LRU
+ * queue Am.  Pages touched once, such as those of a sequential scan, therefore
+ * cycle through A1in without disturbing Am.
+ */
+class TwoQPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs a 2Q policy over the frames [first, first + num).  A1in is
+   * limited to a quarter of the frames and A1out remembers half as many pages
+   * as there are frames.
+   *
+   * @param states      Frame state words of the buffer manager.
+   * @param first       First frame of the partition.
+   * @param num         Number of frames in the partition.
+   */
+  TwoQPolicy(FrameStates* states, FrameId first, std::uint32_t num);
+
+  void frameAccessed(FrameId frame);
+  void frameLoaded(FrameId frame, const PageKey& key);
+  void frameFreed(FrameId frame);
+  bool pickVictim(const PageKey& key, FrameId& frame,
+                  const FrameFilter* skip);
+  void frameTaken(FrameId frame);
+  void frameResident(FrameId frame, const PageKey& key);
+  void victimOrder(std::vector<FrameId>& order) const;
+
+ private:
+  /**
+   * Claims the oldest unpinned frame of a queue and returns it, or returns
+   * FrameList::NONE.
+   *
+   * @param queue   Queue to search.
+   * @param skip    Frames to pass over as if pinned, or NULL.
+   */
+  FrameId claimOldest(const FrameList& queue, const FrameFilter* skip);
+
+  /**
+   * Target size of A1in.
+   */
+  std::uint32_t kin;
+
+  /**
+   * Maximum number of pages remembered in A1out.
+   */
+  std::uint32_t kout;
+
+  /**
+   * FIFO of resident pages referenced once.
+   */
+  FrameList a1in;
+
+  /**
+   * LRU queue of resident hot pages.
+   */
+  FrameList am;
+
+  /**
+   * Frames not holding any page.
+   */
+  FrameList freeFrames;
+
+  /**
+   * Pages recently evicted from A1in.
+   */
+  GhostList a1out;
+
+  /**
+   * Page held by every resident frame.
+   */
+  std::vector<PageKey> keys;
+};
+
+}
@@ -14,6 +14,23 @@ namespace badgerdb {
  */
 typedef std::uint32_t PageId;
 
+/**
+ * @brief Identifier for an open file; every File object referring to the same
+ * open file has the same one.  Zero is never used.
+ */
+typedef std::uint32_t FileId;
+
+/**
+ * @brief Log sequence number: the position in the write-ahead log just past a
+ * log record.  Zero means nothing was logged.
+ */
+typedef std::uint64_t Lsn;
+
+/**
+ * @brief Identifier for a transaction in the write-ahead log.
+ */
+typedef std::uint64_t TxnId;
+
 /**
  * @brief Identifier for a slot in a page.
  */